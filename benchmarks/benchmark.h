@@ -0,0 +1,50 @@
+#pragma once
+
+#include "common.h"
+#include "core/log.h"
+
+#include <chrono>
+
+// Minimal benchmark registry, BENCHMARK(name) { ... } defines a benchmark that main() runs by name
+struct Benchmark
+{
+	const char* name;
+	void (*function)();
+};
+
+inline Vector<Benchmark>& get_benchmarks()
+{
+	static Vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+struct BenchmarkRegistrar
+{
+	BenchmarkRegistrar(const char* name, void (*function)()) { get_benchmarks().push_back({ name, function }); }
+};
+
+#define BENCHMARK(name)                                                             \
+	static void benchmark_##name();                                                 \
+	static BenchmarkRegistrar benchmark_registrar_##name(#name, &benchmark_##name); \
+	static void benchmark_##name()
+
+class BenchmarkTimer
+{
+public:
+	BenchmarkTimer()
+	    : start(std::chrono::steady_clock::now())
+	{
+	}
+
+	double get_seconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+
+	// Logs the time per item and the throughput of everything timed so far
+	void report(const char* label, uint64_t items, const char* unit) const
+	{
+		double seconds = get_seconds();
+		INFO("{}: {} {} in {:.3f} s, {:.3f} us each, {:.1f} {}/s", label, items, unit, seconds, seconds * 1e6 / items, items / seconds, unit);
+	}
+
+private:
+	std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "benchmark.h"
+
+#include "core/allocator.h"
+
+// Temporary lists built every frame, like visible entities or draw commands, from the heap and from the frame
+// arena
+BENCHMARK(Allocator)
+{
+	constexpr uint32_t frame_count = 1000;
+	constexpr uint32_t list_count = 256;
+
+	auto fill = [](auto& list, uint32_t i)
+	{
+		for (uint32_t j = 0; j < 32 + i % 64; j++)
+		{
+			list.push_back(i + j);
+		}
+	};
+
+	uint64_t sum = 0;
+	{
+		BenchmarkTimer timer;
+		for (uint32_t frame = 0; frame < frame_count; frame++)
+		{
+			for (uint32_t i = 0; i < list_count; i++)
+			{
+				Vector<uint32_t> list;
+				fill(list, i);
+				sum += list.back();
+			}
+		}
+		timer.report("Vector", frame_count * list_count, "lists");
+	}
+
+	FrameArena* frame_arena = FrameArena::get_singleton();
+	{
+		BenchmarkTimer timer;
+		for (uint32_t frame = 0; frame < frame_count; frame++)
+		{
+			for (uint32_t i = 0; i < list_count; i++)
+			{
+				Pmr::Vector<uint32_t> list(frame_arena);
+				fill(list, i);
+				sum += list.back();
+			}
+			frame_arena->end_frame();
+		}
+		timer.report("Pmr::Vector on the frame arena", frame_count * list_count, "lists");
+	}
+
+	{
+		BenchmarkTimer timer;
+		for (uint32_t frame = 0; frame < frame_count; frame++)
+		{
+			for (uint32_t i = 0; i < list_count; i++)
+			{
+				ScratchScope scratch;
+				Pmr::Vector<uint32_t> list(scratch.get_arena());
+				fill(list, i);
+				sum += list.back();
+			}
+		}
+		timer.report("Pmr::Vector on a scratch scope", frame_count * list_count, "lists");
+	}
+	DEBUG("{}", sum);
+
+	// Node containers, where every insert allocates
+	{
+		BenchmarkTimer timer;
+		for (uint32_t frame = 0; frame < frame_count / 10; frame++)
+		{
+			Map<uint32_t, uint32_t> map;
+			for (uint32_t i = 0; i < 1000; i++)
+			{
+				map[i * 7919 % 1000] = i;
+			}
+		}
+		timer.report("Map", frame_count / 10 * 1000, "inserts");
+	}
+
+	{
+		PoolAllocator pool(64);
+		BenchmarkTimer timer;
+		for (uint32_t frame = 0; frame < frame_count / 10; frame++)
+		{
+			Pmr::Map<uint32_t, uint32_t> map(&pool);
+			for (uint32_t i = 0; i < 1000; i++)
+			{
+				map[i * 7919 % 1000] = i;
+			}
+		}
+		timer.report("Pmr::Map on a pool", frame_count / 10 * 1000, "inserts");
+	}
+}
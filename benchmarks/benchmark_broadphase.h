@@ -0,0 +1,74 @@
+#pragma once
+
+#include "benchmark.h"
+
+#include "physics/broadphase.h"
+
+#include <random>
+
+BENCHMARK(Broadphase)
+{
+	constexpr uint32_t player_count = 64;
+	constexpr uint32_t projectile_count = 2000;
+	constexpr uint32_t prop_count = 500;
+	constexpr uint32_t frame_count = 1000;
+	constexpr float delta_s = 1.0f / 128.0f;
+
+	constexpr uint32_t player_layer = 1 << 0;
+	constexpr uint32_t projectile_layer = 1 << 1;
+	constexpr uint32_t prop_layer = 1 << 2;
+
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(0.0f, 256.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+
+	struct Body
+	{
+		AABB bounds;
+		Vector3 velocity;
+		ProxyID proxy;
+	};
+	Vector<Body> bodies;
+
+	Broadphase broadphase;
+	auto add_body = [&](Vector3 half_extent, float speed, uint32_t layer, uint32_t mask)
+	{
+		Vector3 center(position(random), direction(random) + 1.0f, position(random));
+		AABB bounds = { center - half_extent, center + half_extent };
+		bodies.push_back({ bounds, Vector3(direction(random), 0.0f, direction(random)) * speed, broadphase.add(bounds, layer, mask) });
+	};
+	for (uint32_t i = 0; i < player_count; i++)
+	{
+		add_body(Vector3(0.4f, 0.9f, 0.4f), 6.0f, player_layer, ~0u);
+	}
+	for (uint32_t i = 0; i < projectile_count; i++)
+	{
+		add_body(Vector3(0.1f), 40.0f, projectile_layer, player_layer | prop_layer);
+	}
+	for (uint32_t i = 0; i < prop_count; i++)
+	{
+		add_body(Vector3(0.5f), 1.0f, prop_layer, player_layer | projectile_layer | prop_layer);
+	}
+	broadphase.update();
+
+	size_t pair_count = 0;
+	size_t changed_count = 0;
+	{
+		BenchmarkTimer timer;
+		for (uint32_t frame = 0; frame < frame_count; frame++)
+		{
+			for (Body& body : bodies)
+			{
+				Vector3 offset = body.velocity * delta_s;
+				body.bounds.min += offset;
+				body.bounds.max += offset;
+				broadphase.move(body.proxy, body.bounds);
+			}
+			broadphase.update();
+			pair_count += broadphase.get_pairs().size();
+			changed_count += broadphase.get_added_pairs().size() + broadphase.get_removed_pairs().size();
+		}
+		timer.report("Broadphase update", frame_count, "frames");
+	}
+	INFO("{} proxies, {} pairs and {} pair changes per frame", broadphase.get_proxy_count(), pair_count / frame_count, changed_count / frame_count);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "benchmark.h"
+
+#include "physics/bvh.h"
+
+#include <random>
+
+// Heightfield terrain with crates scattered over it, about the triangle count of a competitive map
+inline void make_benchmark_level(Vector<Vector3>& vertices, Vector<uint32_t>& indices)
+{
+	constexpr uint32_t grid_size = 256;
+	constexpr float cell_size = 1.0f;
+	constexpr uint32_t crate_count = 5000;
+
+	for (uint32_t z = 0; z <= grid_size; z++)
+	{
+		for (uint32_t x = 0; x <= grid_size; x++)
+		{
+			float height = std::sin(x * 0.1f) * std::cos(z * 0.13f) * 2.0f;
+			vertices.push_back(Vector3(x * cell_size, height, z * cell_size));
+		}
+	}
+	for (uint32_t z = 0; z < grid_size; z++)
+	{
+		for (uint32_t x = 0; x < grid_size; x++)
+		{
+			uint32_t corner = z * (grid_size + 1) + x;
+			indices.insert(indices.end(), { corner, corner + grid_size + 1, corner + 1, corner + 1, corner + grid_size + 1, corner + grid_size + 2 });
+		}
+	}
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(0.0f, grid_size * cell_size);
+	std::uniform_real_distribution<float> size(0.5f, 2.0f);
+	const uint32_t box_faces[36] = { 0, 1, 2, 2, 1, 3, 4, 6, 5, 5, 6, 7, 0, 4, 1, 1, 4, 5, 2, 3, 6, 6, 3, 7, 0, 2, 4, 4, 2, 6, 1, 5, 3, 3, 5, 7 };
+	for (uint32_t i = 0; i < crate_count; i++)
+	{
+		Vector3 min(position(random), -2.0f, position(random));
+		Vector3 max = min + Vector3(size(random), size(random) + 2.0f, size(random));
+
+		uint32_t first = vertices.size();
+		for (uint32_t corner = 0; corner < 8; corner++)
+		{
+			vertices.push_back(Vector3(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z));
+		}
+		for (uint32_t index : box_faces)
+		{
+			indices.push_back(first + index);
+		}
+	}
+}
+
+BENCHMARK(BVH)
+{
+	constexpr size_t ray_count = 1 << 20;
+
+	Vector<Vector3> vertices;
+	Vector<uint32_t> indices;
+	make_benchmark_level(vertices, indices);
+
+	BVH bvh;
+	{
+		BenchmarkTimer timer;
+		bvh.build(vertices.data(), vertices.size(), indices.data(), indices.size() / 3);
+		timer.report("BVH build", indices.size() / 3, "triangles");
+	}
+	INFO("{} nodes, depth {}", bvh.get_node_count(), bvh.get_depth());
+
+	// Hitscan from head height in every direction, and line of sight between random player positions
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> position(0.0f, 256.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	Vector<Ray> shots(ray_count);
+	Vector<Ray> sight_lines(ray_count);
+	for (size_t i = 0; i < ray_count; i++)
+	{
+		Vector3 eye(position(random), 3.5f, position(random));
+		shots[i] = { eye, Vector3(direction(random), direction(random) * 0.3f, direction(random)), 1000.0f };
+
+		Vector3 target(position(random), 3.5f, position(random));
+		sight_lines[i] = { eye, target - eye, 1.0f };
+	}
+
+	Vector<RayHit> hits(ray_count);
+	Vector<uint8_t> occluded(ray_count);
+
+	{
+		size_t hit_count = 0;
+		BenchmarkTimer timer;
+		for (size_t i = 0; i < ray_count; i++)
+		{
+			hit_count += bvh.intersect(shots[i], hits[i]);
+		}
+		timer.report("Closest hit, one thread", ray_count, "rays");
+		DEBUG("{} hits", hit_count);
+	}
+
+	{
+		BenchmarkTimer timer;
+		bvh.intersect(shots.data(), hits.data(), ray_count);
+		timer.report("Closest hit, batched", ray_count, "rays");
+	}
+
+	{
+		BenchmarkTimer timer;
+		bvh.test_occlusion(sight_lines.data(), occluded.data(), ray_count);
+		timer.report("Line of sight, batched", ray_count, "rays");
+	}
+}
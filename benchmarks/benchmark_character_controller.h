@@ -0,0 +1,64 @@
+#pragma once
+
+#include "benchmark.h"
+#include "benchmark_bvh.h"
+
+#include "physics/character_controller.h"
+
+#include <random>
+
+BENCHMARK(CharacterController)
+{
+	constexpr uint32_t tick_count = 1280;
+	constexpr float delta_s = 1.0f / 128.0f;
+
+	Vector<Vector3> vertices;
+	Vector<uint32_t> indices;
+	make_benchmark_level(vertices, indices);
+	BVH bvh;
+	bvh.build(vertices.data(), vertices.size(), indices.data(), indices.size() / 3);
+	CharacterController controller(&bvh);
+
+	// Players running around the crates, turning every quarter second. Per player cost should not change
+	// with the player count.
+	for (uint32_t player_count : { 16, 64 })
+	{
+		std::mt19937 random(4);
+		std::uniform_real_distribution<float> position(8.0f, 248.0f);
+		std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+
+		Vector<Character> players(player_count);
+		for (Character& player : players)
+		{
+			player.position = Vector3(position(random), 4.0f, position(random));
+		}
+
+		INFO("{} players", player_count);
+		uint32_t grounded_count = 0;
+		BenchmarkTimer timer;
+		for (uint32_t tick = 0; tick < tick_count; tick++)
+		{
+			for (Character& player : players)
+			{
+				if (tick % 32 == 0)
+				{
+					Vector3 wish(direction(random), 0.0f, direction(random));
+					wish = wish * (6.0f / std::max(Math::length(wish), 1e-3f));
+					player.velocity.x = wish.x;
+					player.velocity.z = wish.z;
+				}
+				controller.move(player, delta_s);
+				grounded_count += player.is_grounded;
+			}
+		}
+		timer.report("Character move, one thread", tick_count * player_count, "moves");
+		DEBUG("{}% grounded", grounded_count * 100 / (tick_count * player_count));
+
+		BenchmarkTimer batched_timer;
+		for (uint32_t tick = 0; tick < tick_count; tick++)
+		{
+			controller.move(players.data(), players.size(), delta_s);
+		}
+		batched_timer.report("Character tick, batched", tick_count, "ticks");
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "benchmark.h"
+
+#include "platform/vulkan/vulkan_renderer.h"
+
+BENCHMARK(HeadlessRenderer)
+{
+	constexpr uint32_t width = 1920;
+	constexpr uint32_t height = 1080;
+	constexpr uint32_t frames = 2000;
+
+	VulkanRenderer renderer("kronic_benchmarks", width, height);
+	for (uint32_t i = 0; i < 100; i++)
+	{
+		renderer.draw();
+	}
+	renderer.finish();
+
+	BenchmarkTimer timer;
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		renderer.draw();
+	}
+	renderer.finish();
+	timer.report("Headless 1080p draw", frames, "frames");
+
+	const FrameStats& stats = renderer.get_frame_stats();
+	INFO("Frame stalls: average {:.3f} ms, worst {:.3f} ms", stats.average_stall_ns / 1e6, stats.max_stall_ns / 1e6);
+}
+
+BENCHMARK(HeadlessReadback)
+{
+	constexpr uint32_t width = 1920;
+	constexpr uint32_t height = 1080;
+	constexpr uint32_t frames = 500;
+
+	VulkanRenderer renderer("kronic_benchmarks", width, height);
+	renderer.draw();
+	renderer.finish();
+
+	uint32_t delivered = 0;
+	uint64_t checksum = 0;
+
+	BenchmarkTimer timer;
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		renderer.request_readback([&delivered, &checksum](const Byte* pixels, uint32_t image_width, uint32_t image_height)
+		    {
+			    // Touch the data so that the host actually reads it
+			    checksum += uint8_t(pixels[(image_width * (image_height / 2) + image_width / 2) * 4]);
+			    delivered++;
+		    });
+		renderer.draw();
+	}
+	renderer.finish();
+	timer.report("Headless 1080p draw with readback", delivered, "frames");
+	DEBUG("Readback checksum {}", checksum);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "benchmark.h"
+
+#include "core/math.h"
+#include "core/math_simd.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+// Per-frame work for 64k objects at every instruction set the CPU supports
+BENCHMARK(MathSIMD)
+{
+	constexpr size_t count = 64 * 1024;
+	constexpr uint32_t iterations = 200;
+
+	Vector<Matrix4x4> locals(count, Matrix4x4(1.0f));
+	Vector<Matrix4x4> worlds(count);
+	Matrix4x4 parent = Math::translate(Matrix4x4(1.0f), Vector3(1.0f, 2.0f, 3.0f));
+
+	Vector<float> x(count), y(count), z(count), radius(count, 1.0f);
+	for (size_t i = 0; i < count; i++)
+	{
+		x[i] = float(i % 256) - 128.0f;
+		y[i] = float((i / 256) % 16);
+		z[i] = -float(i / 4096) * 8.0f;
+	}
+	Matrix4x4 projection = Math::perspective(Math::radians(90.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	MathSIMD::Frustum frustum = MathSIMD::extract_frustum(&projection[0][0], MathSIMD::ClipDepth::MinusOneToOne);
+	Vector<uint8_t> visible(count);
+
+	Vector<float> qx(count, 0.0f), qy(count, 0.6f), qz(count, 0.0f), qw(count, 0.8f), t(count, 0.25f);
+	MathSIMD::QuaternionArrays quaternions = { qx.data(), qy.data(), qz.data(), qw.data() };
+
+	MathSIMD::set_level(MathSIMD::Level::AVX2);
+	MathSIMD::Level best = MathSIMD::get_level();
+	for (MathSIMD::Level level : { MathSIMD::Level::Scalar, MathSIMD::Level::SSE4, MathSIMD::Level::AVX2 })
+	{
+		if (level > best)
+		{
+			break;
+		}
+		MathSIMD::set_level(level);
+		INFO("{}:", MathSIMD::get_level_name(level));
+
+		{
+			BenchmarkTimer timer;
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				MathSIMD::multiply_matrix(&parent[0][0], &locals[0][0][0], &worlds[0][0][0], count);
+			}
+			timer.report("World transforms", uint64_t(count) * iterations, "matrices");
+		}
+
+		{
+			size_t visible_count = 0;
+			BenchmarkTimer timer;
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				visible_count += MathSIMD::cull_spheres(frustum, { x.data(), y.data(), z.data(), radius.data() }, visible.data(), count);
+			}
+			timer.report("Sphere culling", uint64_t(count) * iterations, "spheres");
+			DEBUG("Visible {}", visible_count / iterations);
+		}
+
+		{
+			BenchmarkTimer timer;
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				MathSIMD::slerp_quaternions(quaternions, quaternions, t.data(), quaternions, count);
+				MathSIMD::normalize_quaternions(quaternions, count);
+			}
+			timer.report("Quaternion slerp and normalize", uint64_t(count) * iterations, "quaternions");
+		}
+	}
+	MathSIMD::set_level(best);
+}
@@ -0,0 +1,42 @@
+#include "benchmark.h"
+
+#include "core/job_system.h"
+#include "os/file_system.h"
+
+#include "benchmark_allocator.h"
+#include "benchmark_broadphase.h"
+#include "benchmark_bvh.h"
+#include "benchmark_character_controller.h"
+#include "benchmark_headless_renderer.h"
+#include "benchmark_math_simd.h"
+
+#include <cstring>
+
+// Usage: kronic_benchmarks [name filter]
+int main(int argc, char** argv)
+{
+	Log::setup();
+	FileSystem::set_current_directory_to_root_file("kronic.root");
+	JobSystem::get_singleton();
+
+	const char* filter = argc > 1 ? argv[1] : "";
+	for (const Benchmark& benchmark : get_benchmarks())
+	{
+		if (!std::strstr(benchmark.name, filter))
+		{
+			continue;
+		}
+
+		INFO("Running {}", benchmark.name);
+		try
+		{
+			benchmark.function();
+		}
+		catch (const Exception& e)
+		{
+			ERR("{} failed: {}", benchmark.name, e.what());
+		}
+	}
+
+	return 0;
+}
@@ -1,7 +1,11 @@
 #include "app.h"
 
+#include "core/event.h"
+#include "core/job_system.h"
 #include "core/log.h"
+#include "core/profiler.h"
 #include "os/file_system.h"
+#include "os/file_watcher.h"
 
 Application::Application()
 {
@@ -9,4 +13,19 @@ Application::Application()
 
 	FileSystem::set_current_directory_to_root_file("kronic.root");
 	INFO("Current directory: {}", FileSystem::get_current_directory());
+
+	// Packed builds ship their assets as one archive next to kronic.root, loose files are used otherwise
+	FileSystem::mount("assets.kpak");
+
+	PROFILE_THREAD("Main");
+
+	// The thread that first touches the job system becomes its main thread
+	INFO("Started job system with {} workers", JobSystem::get_singleton()->get_worker_count());
+
+	// Handlers run at the start of the next frame, on the main thread
+	file_watcher = MakeUnique<FileWatcher>();
+	file_watcher->watch("assets", [](const String& path)
+	                    { EventFileChanged::post({ {}, path }); });
 }
+
+Application::~Application() = default;
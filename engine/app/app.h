@@ -2,11 +2,17 @@
 
 #include "common.h"
 
+class FileWatcher;
+
 class Application
 {
 public:
 	Application();
-	virtual ~Application() = default;
+	virtual ~Application();
 
 	virtual void run() = 0;
+
+protected:
+	// Reports edited assets through EventFileChanged
+	Ptr<FileWatcher> file_watcher;
 };
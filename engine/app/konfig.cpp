@@ -3,8 +3,13 @@
 #include "core/log.h"
 
 Konfig::Konfig()
+    : Konfig(*FileSystem::read_yaml(path))
 {
-	config_file = *FileSystem::read_yaml("assets/konfig.yaml");
+}
+
+Konfig::Konfig(const FileYAML& file)
+{
+	config_file = file;
 
 	String rendering_api_str = config_file.root["rendering_api"].as<String>();
 	String windowing_api_str = config_file.root["windowing_api"].as<String>();
@@ -27,5 +32,40 @@ Konfig::Konfig()
 		ERR("Found unknown windowing API: {}", windowing_api_str);
 	}
 
+	frames_in_flight = config_file.root["frames_in_flight"].as<uint32_t>(frames_in_flight);
+
+	String present_mode_str = config_file.root["present_mode"].as<String>("FIFO");
+	if (present_mode_str == "FIFO")
+	{
+		present_mode = PresentMode::Fifo;
+	}
+	else if (present_mode_str == "FIFO_RELAXED")
+	{
+		present_mode = PresentMode::FifoRelaxed;
+	}
+	else if (present_mode_str == "MAILBOX")
+	{
+		present_mode = PresentMode::Mailbox;
+	}
+	else if (present_mode_str == "IMMEDIATE")
+	{
+		present_mode = PresentMode::Immediate;
+	}
+	else
+	{
+		ERR("Found unknown present mode: {}", present_mode_str);
+	}
+
+	max_frame_rate = std::max(config_file.root["max_frame_rate"].as<double>(max_frame_rate), 0.0);
+
+	tick_rate = config_file.root["tick_rate"].as<double>(tick_rate);
+	if (tick_rate <= 0.0)
+	{
+		ERR("Found invalid tick rate: {}", tick_rate);
+		tick_rate = 128.0;
+	}
+
+	mouse_sensitivity = config_file.root["mouse_sensitivity"].as<float>(mouse_sensitivity);
+
 	INFO("Loaded konfig file from {}", config_file.path);
 }
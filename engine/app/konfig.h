@@ -1,11 +1,15 @@
 #pragma once
 
 #include "common.h"
+#include "core/renderer.h"
 #include "os/file_system.h"
 
 struct Konfig
 {
+	static constexpr const char* path = "assets/konfig.yaml";
+
 	Konfig();
+	Konfig(const FileYAML& file);
 
 	enum class RenderingAPI
 	{
@@ -21,5 +25,18 @@ struct Konfig
 	};
 	WindowingAPI windowing_api = WindowingAPI::None;
 
+	uint32_t frames_in_flight = 2;
+
+	PresentMode present_mode = PresentMode::Fifo;
+
+	// Frames per second, 0 leaves the frame rate to the present mode
+	double max_frame_rate = 0.0;
+
+	// Simulation ticks per second, independent of the frame rate
+	double tick_rate = 128.0;
+
+	// Degrees of view rotation per count of mouse motion
+	float mouse_sensitivity = 0.022f;
+
 	FileYAML config_file;
 };
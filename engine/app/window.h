@@ -16,4 +16,7 @@ public:
 	virtual bool has_closed() const = 0;
 
 	virtual void collect_events() const = 0;
+
+	// Handles events as they arrive for up to timeout_ns, returns early when there were any
+	virtual void wait_events(uint64_t timeout_ns) const = 0;
 };
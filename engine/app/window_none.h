@@ -15,6 +15,7 @@ public:
 
 	bool has_closed() const override { return is_closing; }
 	void collect_events() const override { }
+	void wait_events(uint64_t timeout_ns) const override { }
 
 private:
 	uint32_t width = 0;
@@ -64,3 +64,22 @@ using Function = std::function<T>;
 
 #include <cstddef>
 using Byte = std::byte;
+
+#include <memory_resource>
+using MemoryResource = std::pmr::memory_resource;
+
+// The containers above taking their memory from a MemoryResource, like the frame arena, a scratch scope or
+// a pool from core/allocator.h. The resource must outlive the container.
+namespace Pmr
+{
+template <class T>
+using Vector = std::pmr::vector<T>;
+
+template <class P, class Q>
+using Map = std::pmr::map<P, Q>;
+
+template <class P, class Q>
+using HashMap = std::pmr::unordered_map<P, Q>;
+
+using String = std::pmr::string;
+};
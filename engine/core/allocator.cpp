@@ -0,0 +1,217 @@
+#include "allocator.h"
+
+#include "core/log.h"
+
+#include <algorithm>
+
+namespace
+{
+size_t align_up(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool is_power_of_two(size_t value)
+{
+	return value != 0 && (value & (value - 1)) == 0;
+}
+
+struct OverflowHeader
+{
+	void* previous;
+	size_t size;
+	size_t alignment;
+};
+}
+
+LinearArena::LinearArena(size_t capacity, MemoryResource* upstream)
+    : upstream(upstream)
+    , capacity(capacity)
+{
+	buffer = static_cast<Byte*>(upstream->allocate(capacity, alignof(std::max_align_t)));
+}
+
+LinearArena::~LinearArena()
+{
+	release_overflow(nullptr);
+	upstream->deallocate(buffer, capacity, alignof(std::max_align_t));
+}
+
+void LinearArena::reset()
+{
+	used = 0;
+	release_overflow(nullptr);
+	overflow_count = 0;
+}
+
+void LinearArena::rewind(const Marker& marker)
+{
+	used = std::min(used, marker.used);
+	release_overflow(marker.overflow);
+}
+
+void* LinearArena::do_allocate(size_t bytes, size_t alignment)
+{
+	// Aligned by address rather than offset, alignments past the buffer's own still hold
+	uintptr_t base = reinterpret_cast<uintptr_t>(buffer);
+	size_t offset = align_up(base + used, alignment) - base;
+	if (offset + bytes > capacity)
+	{
+		return allocate_overflow(bytes, alignment);
+	}
+
+	used = offset + bytes;
+	peak = std::max(peak, used + overflow_used);
+	return buffer + offset;
+}
+
+void* LinearArena::allocate_overflow(size_t bytes, size_t alignment)
+{
+	alignment = std::max(alignment, alignof(OverflowHeader));
+	size_t header_size = align_up(sizeof(OverflowHeader), alignment);
+	size_t size = header_size + bytes;
+
+	Byte* block = static_cast<Byte*>(upstream->allocate(size, alignment));
+	OverflowHeader* header = reinterpret_cast<OverflowHeader*>(block);
+	header->previous = overflow;
+	header->size = size;
+	header->alignment = alignment;
+	overflow = block;
+
+	overflow_used += size;
+	overflow_count++;
+	peak = std::max(peak, used + overflow_used);
+	return block + header_size;
+}
+
+void LinearArena::release_overflow(void* until)
+{
+	while (overflow && overflow != until)
+	{
+		OverflowHeader header = *static_cast<OverflowHeader*>(overflow);
+		upstream->deallocate(overflow, header.size, header.alignment);
+		overflow_used -= header.size;
+		overflow = header.previous;
+	}
+}
+
+FrameArena* FrameArena::get_singleton()
+{
+	static FrameArena singleton;
+	return &singleton;
+}
+
+FrameArena::FrameArena()
+    : LinearArena(arena_size)
+{
+}
+
+void FrameArena::end_frame()
+{
+	if (get_overflow_count() > 0 && get_peak() > reported_peak)
+	{
+		WARN("Frame arena ran out, {} allocations this frame did not fit. Peak use is {} of {} bytes.", get_overflow_count(), get_peak(), get_capacity());
+		reported_peak = get_peak();
+	}
+	reset();
+}
+
+ScratchScope::ScratchScope()
+    : arena(get_thread_arena())
+    , marker(arena->get_marker())
+{
+}
+
+ScratchScope::~ScratchScope()
+{
+	arena->rewind(marker);
+}
+
+LinearArena* ScratchScope::get_thread_arena()
+{
+	thread_local LinearArena arena(capacity_per_thread);
+	return &arena;
+}
+
+PoolAllocator::PoolAllocator(size_t in_block_size, size_t in_block_alignment, size_t blocks_per_chunk, MemoryResource* upstream)
+    : upstream(upstream)
+    , blocks_per_chunk(blocks_per_chunk)
+{
+	if (!is_power_of_two(in_block_alignment) || blocks_per_chunk == 0)
+	{
+		throw Exception("Pool alignment must be a power of two and chunks must hold at least one block");
+	}
+
+	// Free blocks hold the free list link, so they must fit one
+	block_alignment = std::max(in_block_alignment, alignof(FreeBlock));
+	block_size = align_up(std::max(in_block_size, sizeof(FreeBlock)), block_alignment);
+	chunk_size = align_up(sizeof(void*), block_alignment) + block_size * blocks_per_chunk;
+}
+
+PoolAllocator::~PoolAllocator()
+{
+	while (chunks)
+	{
+		void* previous = *static_cast<void**>(chunks);
+		upstream->deallocate(chunks, chunk_size, block_alignment);
+		chunks = previous;
+	}
+}
+
+void* PoolAllocator::allocate_block()
+{
+	if (!free_list)
+	{
+		grow();
+	}
+
+	FreeBlock* block = free_list;
+	free_list = block->next;
+	free_count--;
+	return block;
+}
+
+void PoolAllocator::deallocate_block(void* block)
+{
+	if (!block)
+	{
+		return;
+	}
+
+	FreeBlock* free_block = static_cast<FreeBlock*>(block);
+	free_block->next = free_list;
+	free_list = free_block;
+	free_count++;
+}
+
+void* PoolAllocator::do_allocate(size_t bytes, size_t alignment)
+{
+	return fits(bytes, alignment) ? allocate_block() : upstream->allocate(bytes, alignment);
+}
+
+void PoolAllocator::do_deallocate(void* pointer, size_t bytes, size_t alignment)
+{
+	if (fits(bytes, alignment))
+	{
+		deallocate_block(pointer);
+	}
+	else
+	{
+		upstream->deallocate(pointer, bytes, alignment);
+	}
+}
+
+void PoolAllocator::grow()
+{
+	Byte* chunk = static_cast<Byte*>(upstream->allocate(chunk_size, block_alignment));
+	*reinterpret_cast<void**>(chunk) = chunks;
+	chunks = chunk;
+
+	// Pushed in reverse so blocks are handed out in address order
+	Byte* first = chunk + align_up(sizeof(void*), block_alignment);
+	for (size_t i = blocks_per_chunk; i > 0; i--)
+	{
+		deallocate_block(first + (i - 1) * block_size);
+	}
+	block_count += blocks_per_chunk;
+}
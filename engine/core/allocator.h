@@ -0,0 +1,156 @@
+#pragma once
+
+#include "common.h"
+
+// Bump allocator over one buffer taken from upstream up front. Memory is only given back all at once, by
+// reset() or by rewinding to a marker, so allocating is an aligned pointer bump and deallocating does nothing.
+//
+// Running out does not fail: the request is served by its own block from upstream, freed on the next reset,
+// and counted so an undersized arena shows up in get_overflow_count() instead of crashing. Not thread safe,
+// every arena belongs to one thread.
+class LinearArena : public MemoryResource
+{
+public:
+	struct Marker
+	{
+		size_t used;
+		void* overflow;
+	};
+
+	LinearArena(size_t capacity, MemoryResource* upstream = std::pmr::new_delete_resource());
+	~LinearArena();
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	void reset();
+
+	// Everything allocated after get_marker() is released by rewind(), like popping a stack
+	Marker get_marker() const { return { used, overflow }; }
+	void rewind(const Marker& marker);
+
+	size_t get_used() const { return used; }
+	size_t get_capacity() const { return capacity; }
+
+	// Highest use since construction, overflow included
+	size_t get_peak() const { return peak; }
+
+	// Allocations that did not fit since the last reset
+	uint32_t get_overflow_count() const { return overflow_count; }
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void*, size_t, size_t) override {}
+	bool do_is_equal(const MemoryResource& other) const noexcept override { return this == &other; }
+
+private:
+	void* allocate_overflow(size_t bytes, size_t alignment);
+	void release_overflow(void* until);
+
+	MemoryResource* upstream;
+	Byte* buffer;
+	size_t capacity;
+	size_t used = 0;
+	size_t peak = 0;
+
+	// Blocks that did not fit, newest first, each starting with a header linking to the one before
+	void* overflow = nullptr;
+	size_t overflow_used = 0;
+	uint32_t overflow_count = 0;
+};
+
+// Temporary memory for the main thread that lives until the end of the current frame, for lists built and
+// thrown away every frame:
+//
+//     Pmr::Vector<Entity> visible(FrameArena::get_singleton());
+//
+// Nothing allocated from it may be kept past end_frame() or handed to another thread that keeps it.
+class FrameArena : public LinearArena
+{
+public:
+	static FrameArena* get_singleton();
+
+	// Called by the main loop once the frame is done
+	void end_frame();
+
+	static constexpr size_t arena_size = 16 << 20;
+
+private:
+	FrameArena();
+
+	// Overflow is only logged once per size the arena reaches, not every frame
+	size_t reported_peak = 0;
+};
+
+// Scratch memory for the calling thread, released when the scope closes. Scopes nest like the stack they
+// are named after, so a function may open its own inside any other.
+//
+//     ScratchScope scratch;
+//     Pmr::Vector<uint32_t> indices(scratch.get_arena());
+//
+// Every thread gets its own arena on first use, so jobs use it without any locking.
+class ScratchScope
+{
+public:
+	ScratchScope();
+	~ScratchScope();
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	LinearArena* get_arena() const { return arena; }
+
+	static LinearArena* get_thread_arena();
+
+	static constexpr size_t capacity_per_thread = 1 << 20;
+
+private:
+	LinearArena* arena;
+	LinearArena::Marker marker;
+};
+
+// Hands out blocks of one size from a free list, for objects created and destroyed one at a time in
+// arbitrary order. Blocks come from upstream in chunks and are never given back before the pool is destroyed,
+// so once the pool has grown to its working size allocating and freeing are a pop and a push.
+//
+// As a memory resource it serves node based containers: requests that do not fit a block, like the bucket
+// array of a HashMap, go to upstream. Not thread safe.
+class PoolAllocator : public MemoryResource
+{
+public:
+	PoolAllocator(size_t block_size, size_t block_alignment = alignof(std::max_align_t), size_t blocks_per_chunk = 256, MemoryResource* upstream = std::pmr::new_delete_resource());
+	~PoolAllocator();
+	PoolAllocator(const PoolAllocator&) = delete;
+	PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+	void* allocate_block();
+	void deallocate_block(void* block);
+
+	size_t get_block_size() const { return block_size; }
+	size_t get_block_count() const { return block_count; }
+	size_t get_free_count() const { return free_count; }
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const MemoryResource& other) const noexcept override { return this == &other; }
+
+private:
+	bool fits(size_t bytes, size_t alignment) const { return bytes <= block_size && alignment <= block_alignment; }
+	void grow();
+
+	MemoryResource* upstream;
+	size_t block_size;
+	size_t block_alignment;
+	size_t blocks_per_chunk;
+
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+	FreeBlock* free_list = nullptr;
+
+	// Chunks, newest first, each starting with a link to the one before
+	void* chunks = nullptr;
+	size_t chunk_size;
+	size_t block_count = 0;
+	size_t free_count = 0;
+};
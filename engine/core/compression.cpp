@@ -0,0 +1,213 @@
+#include "compression.h"
+
+#include <cstring>
+
+namespace
+{
+constexpr size_t min_match = 4;
+
+// The format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+constexpr size_t last_literals = 5;
+constexpr size_t match_find_limit = 12;
+
+constexpr uint32_t hash_bits = 16;
+constexpr size_t max_offset = 65535;
+
+uint32_t read32(const uint8_t* data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+uint32_t hash_sequence(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - hash_bits);
+}
+
+void write_length(Vector<Byte>& out, size_t length)
+{
+	while (length >= 255)
+	{
+		out.push_back(Byte(255));
+		length -= 255;
+	}
+	out.push_back(Byte(length));
+}
+
+void write_sequence(Vector<Byte>& out, const uint8_t* literals, size_t literal_count, size_t offset, size_t match_length)
+{
+	size_t match_code = match_length - min_match;
+
+	uint8_t token = uint8_t(std::min<size_t>(literal_count, 15) << 4);
+	if (match_length > 0)
+	{
+		token |= uint8_t(std::min<size_t>(match_code, 15));
+	}
+	out.push_back(Byte(token));
+
+	if (literal_count >= 15)
+	{
+		write_length(out, literal_count - 15);
+	}
+	const Byte* literal_bytes = reinterpret_cast<const Byte*>(literals);
+	out.insert(out.end(), literal_bytes, literal_bytes + literal_count);
+
+	// The last sequence has no match
+	if (match_length == 0)
+	{
+		return;
+	}
+
+	out.push_back(Byte(offset & 0xff));
+	out.push_back(Byte(offset >> 8));
+	if (match_code >= 15)
+	{
+		write_length(out, match_code - 15);
+	}
+}
+
+bool read_length(const uint8_t*& in, const uint8_t* in_end, size_t& length)
+{
+	uint8_t extra;
+	do
+	{
+		if (in >= in_end)
+		{
+			return false;
+		}
+		extra = *in++;
+		length += extra;
+	} while (extra == 255);
+	return true;
+}
+}
+
+size_t Compression::get_max_compressed_size(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t Compression::compress_block(const void* data, size_t size, Vector<Byte>& out)
+{
+	const uint8_t* begin = static_cast<const uint8_t*>(data);
+	const uint8_t* end = begin + size;
+	size_t out_start = out.size();
+	out.reserve(out_start + get_max_compressed_size(size));
+
+	const uint8_t* anchor = begin;
+	if (size > match_find_limit)
+	{
+		// Positions are stored relative to begin, zero doubles as empty since the first byte can never be matched against itself
+		Vector<uint32_t> table(size_t(1) << hash_bits, 0);
+
+		const uint8_t* match_limit = end - match_find_limit;
+		const uint8_t* in = begin + 1;
+		while (in < match_limit)
+		{
+			uint32_t sequence = read32(in);
+			uint32_t& slot = table[hash_sequence(sequence)];
+			const uint8_t* candidate = begin + slot;
+			slot = uint32_t(in - begin);
+
+			if (candidate == begin || size_t(in - candidate) > max_offset || read32(candidate) != sequence)
+			{
+				in++;
+				continue;
+			}
+
+			// Extend backwards over literals that also match, then forwards up to the literal tail
+			while (in > anchor && candidate > begin && in[-1] == candidate[-1])
+			{
+				in--;
+				candidate--;
+			}
+			const uint8_t* match_end = in + min_match;
+			const uint8_t* candidate_end = candidate + min_match;
+			while (match_end < end - last_literals && *match_end == *candidate_end)
+			{
+				match_end++;
+				candidate_end++;
+			}
+
+			write_sequence(out, anchor, in - anchor, in - candidate, match_end - in);
+			in = match_end;
+			anchor = in;
+		}
+	}
+
+	write_sequence(out, anchor, end - anchor, 0, 0);
+	return out.size() - out_start;
+}
+
+bool Compression::decompress_block(const void* data, size_t data_size, void* out, size_t size)
+{
+	const uint8_t* in = static_cast<const uint8_t*>(data);
+	const uint8_t* in_end = in + data_size;
+	uint8_t* out_begin = static_cast<uint8_t*>(out);
+	uint8_t* out_ptr = out_begin;
+	uint8_t* out_end = out_begin + size;
+
+	while (in < in_end)
+	{
+		uint8_t token = *in++;
+
+		size_t literal_count = token >> 4;
+		if (literal_count == 15 && !read_length(in, in_end, literal_count))
+		{
+			return false;
+		}
+		if (literal_count > size_t(in_end - in) || literal_count > size_t(out_end - out_ptr))
+		{
+			return false;
+		}
+		std::memcpy(out_ptr, in, literal_count);
+		in += literal_count;
+		out_ptr += literal_count;
+
+		// Only the last sequence ends right after its literals
+		if (in == in_end)
+		{
+			break;
+		}
+
+		if (in_end - in < 2)
+		{
+			return false;
+		}
+		size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+		in += 2;
+		if (offset == 0 || offset > size_t(out_ptr - out_begin))
+		{
+			return false;
+		}
+
+		size_t match_length = token & 15;
+		if (match_length == 15 && !read_length(in, in_end, match_length))
+		{
+			return false;
+		}
+		match_length += min_match;
+		if (match_length > size_t(out_end - out_ptr))
+		{
+			return false;
+		}
+
+		// Matches may overlap the bytes they produce, which is how runs are encoded
+		const uint8_t* match = out_ptr - offset;
+		if (offset >= match_length)
+		{
+			std::memcpy(out_ptr, match, match_length);
+			out_ptr += match_length;
+		}
+		else
+		{
+			for (size_t i = 0; i < match_length; i++)
+			{
+				*out_ptr++ = *match++;
+			}
+		}
+	}
+
+	return out_ptr == out_end;
+}
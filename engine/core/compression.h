@@ -0,0 +1,17 @@
+#pragma once
+
+#include "common.h"
+
+// LZ4 compatible block compression. Decompression is a few byte copies per sequence, which is what matters
+// for assets that are compressed once offline and decompressed on every load.
+namespace Compression
+{
+// Worst case size of a compressed block, incompressible data grows slightly
+size_t get_max_compressed_size(size_t size);
+
+// Appends the compressed block to out and returns its size
+size_t compress_block(const void* data, size_t size, Vector<Byte>& out);
+
+// Returns false when the block is malformed or does not decompress to exactly size bytes
+bool decompress_block(const void* data, size_t data_size, void* out, size_t size);
+};
@@ -0,0 +1,391 @@
+#include "ecs.h"
+
+#include "core/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace
+{
+struct ComponentRegistry
+{
+	std::mutex mutex;
+	ComponentInfo infos[max_component_types];
+	uint32_t count = 0;
+};
+
+ComponentRegistry& get_registry()
+{
+	static ComponentRegistry registry;
+	return registry;
+}
+
+size_t align_up(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+}
+
+ComponentID ECS::register_component(const ComponentInfo& info)
+{
+	ComponentRegistry& registry = get_registry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	if (registry.count == max_component_types)
+	{
+		CRITICAL("More than {} component types registered, {} does not fit in a component mask", max_component_types, info.name);
+	}
+
+	registry.infos[registry.count] = info;
+	return registry.count++;
+}
+
+const ComponentInfo& ECS::get_component_info(ComponentID id)
+{
+	return get_registry().infos[id];
+}
+
+void EntityCommandBuffer::destroy(Entity entity)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	commands.push_back({ CommandType::Destroy, entity, 0, nullptr });
+}
+
+void EntityCommandBuffer::execute(World& world)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Entity created;
+	for (Command& command : commands)
+	{
+		Entity entity = command.entity.is_valid() ? command.entity : created;
+		switch (command.type)
+		{
+		case CommandType::Create:
+			created = world.create();
+			break;
+		case CommandType::Destroy:
+			world.destroy(entity);
+			break;
+		case CommandType::Add:
+			world.add_component(entity, command.component, command.payload);
+			break;
+		case CommandType::Remove:
+			world.remove_component(entity, command.component);
+			break;
+		}
+	}
+
+	// add_component() moves out of the payloads but they still need to be destroyed
+	release_commands();
+}
+
+void EntityCommandBuffer::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	release_commands();
+}
+
+void EntityCommandBuffer::release_commands()
+{
+	for (Command& command : commands)
+	{
+		if (command.payload)
+		{
+			ECS::get_component_info(command.component).destroy(command.payload);
+		}
+	}
+	commands.clear();
+
+	for (Page& page : pages)
+	{
+		page.used = 0;
+	}
+}
+
+void* EntityCommandBuffer::allocate_payload(size_t size, size_t alignment)
+{
+	// new[] only guarantees fundamental alignment so offsets are aligned relative to the real address
+	for (Page& page : pages)
+	{
+		size_t base = reinterpret_cast<uintptr_t>(page.memory.get());
+		size_t offset = align_up(base + page.used, alignment) - base;
+		if (offset + size <= page.capacity)
+		{
+			page.used = offset + size;
+			return page.memory.get() + offset;
+		}
+	}
+
+	Page page;
+	page.capacity = std::max(page_size, size + alignment);
+	page.memory = MakeUnique<Byte[]>(page.capacity);
+
+	size_t base = reinterpret_cast<uintptr_t>(page.memory.get());
+	size_t offset = align_up(base, alignment) - base;
+	page.used = offset + size;
+
+	void* payload = page.memory.get() + offset;
+	pages.push_back(std::move(page));
+	return payload;
+}
+
+World::World()
+{
+	empty_archetype = get_archetype(0);
+}
+
+World::~World()
+{
+	for (Archetype* archetype : archetype_list)
+	{
+		for (Ptr<Chunk>& chunk : archetype->chunks)
+		{
+			for (uint32_t column = 0; column < archetype->components.size(); column++)
+			{
+				const ComponentInfo& info = ECS::get_component_info(archetype->components[column]);
+				for (uint32_t row = 0; row < chunk->count; row++)
+				{
+					info.destroy(chunk->data + archetype->offsets[column] + info.size * row);
+				}
+			}
+		}
+	}
+}
+
+void World::destroy(Entity entity)
+{
+	if (!is_alive(entity))
+	{
+		WARN("Tried to destroy a dead entity {}", entity.index);
+		return;
+	}
+
+	EntityRecord& record = records[entity.index];
+	remove_row(record.archetype, record.chunk, record.row);
+
+	record.archetype = nullptr;
+	record.chunk = nullptr;
+	record.generation++;
+	free_indices.push_back(entity.index);
+	entity_count--;
+}
+
+bool World::is_alive(Entity entity) const
+{
+	return entity.index < records.size() && records[entity.index].generation == entity.generation && records[entity.index].archetype;
+}
+
+Entity World::allocate_entity()
+{
+	Entity entity;
+	if (!free_indices.empty())
+	{
+		entity.index = free_indices.back();
+		free_indices.pop_back();
+	}
+	else
+	{
+		entity.index = records.size();
+		records.emplace_back();
+	}
+
+	entity.generation = records[entity.index].generation;
+	entity_count++;
+	return entity;
+}
+
+Archetype* World::get_archetype(ComponentMask mask)
+{
+	auto found = archetypes.find(mask);
+	if (found != archetypes.end())
+	{
+		return found->second.get();
+	}
+
+	Ptr<Archetype> archetype = MakeUnique<Archetype>();
+	archetype->mask = mask;
+	std::memset(archetype->columns, Archetype::no_column, sizeof(archetype->columns));
+
+	size_t row_size = sizeof(Entity);
+	for (ComponentID id = 0; id < max_component_types; id++)
+	{
+		if (mask & (ComponentMask(1) << id))
+		{
+			archetype->columns[id] = archetype->components.size();
+			archetype->components.push_back(id);
+			archetype->sizes.push_back(ECS::get_component_info(id).size);
+			row_size += ECS::get_component_info(id).size;
+		}
+	}
+
+	// Start from the unpadded capacity and shrink until the aligned arrays fit
+	for (uint32_t capacity = Chunk::data_size / row_size; capacity > 0; capacity--)
+	{
+		archetype->offsets.clear();
+
+		size_t offset = sizeof(Entity) * capacity;
+		for (ComponentID id : archetype->components)
+		{
+			const ComponentInfo& info = ECS::get_component_info(id);
+			offset = align_up(offset, info.alignment);
+			archetype->offsets.push_back(offset);
+			offset += info.size * capacity;
+		}
+
+		if (offset <= Chunk::data_size)
+		{
+			archetype->chunk_capacity = capacity;
+			break;
+		}
+	}
+
+	if (archetype->chunk_capacity == 0)
+	{
+		CRITICAL("Archetype with mask {:#x} does not fit a single entity in a {} byte chunk", mask, Chunk::data_size);
+	}
+
+	Archetype* result = archetype.get();
+	archetypes[mask] = std::move(archetype);
+	archetype_list.push_back(result);
+	return result;
+}
+
+Archetype* World::get_add_target(Archetype* archetype, ComponentID id)
+{
+	auto found = archetype->add_edges.find(id);
+	if (found != archetype->add_edges.end())
+	{
+		return found->second;
+	}
+
+	Archetype* target = get_archetype(archetype->mask | (ComponentMask(1) << id));
+	archetype->add_edges[id] = target;
+	target->remove_edges[id] = archetype;
+	return target;
+}
+
+Archetype* World::get_remove_target(Archetype* archetype, ComponentID id)
+{
+	auto found = archetype->remove_edges.find(id);
+	if (found != archetype->remove_edges.end())
+	{
+		return found->second;
+	}
+
+	Archetype* target = get_archetype(archetype->mask & ~(ComponentMask(1) << id));
+	archetype->remove_edges[id] = target;
+	target->add_edges[id] = archetype;
+	return target;
+}
+
+void World::place(Entity entity, Archetype* archetype, EntityRecord& record)
+{
+	// Only the last chunk can have free rows because removals are filled from the end
+	if (archetype->chunks.empty() || archetype->chunks.back()->count == archetype->chunk_capacity)
+	{
+		Ptr<Chunk> chunk = MakeUnique<Chunk>();
+		chunk->archetype = archetype;
+		archetype->chunks.push_back(std::move(chunk));
+	}
+
+	Chunk* chunk = archetype->chunks.back().get();
+	uint32_t row = chunk->count++;
+	chunk->get_entities()[row] = entity;
+
+	record.archetype = archetype;
+	record.chunk = chunk;
+	record.row = row;
+}
+
+void World::remove_row(Archetype* archetype, Chunk* chunk, uint32_t row)
+{
+	Chunk* last_chunk = archetype->chunks.back().get();
+	uint32_t last_row = last_chunk->count - 1;
+
+	for (uint32_t column = 0; column < archetype->components.size(); column++)
+	{
+		const ComponentInfo& info = ECS::get_component_info(archetype->components[column]);
+		Byte* hole = chunk->data + archetype->offsets[column] + info.size * row;
+		info.destroy(hole);
+
+		if (chunk != last_chunk || row != last_row)
+		{
+			Byte* last = last_chunk->data + archetype->offsets[column] + info.size * last_row;
+			info.move_construct(hole, last);
+			info.destroy(last);
+		}
+	}
+
+	if (chunk != last_chunk || row != last_row)
+	{
+		Entity moved = last_chunk->get_entities()[last_row];
+		chunk->get_entities()[row] = moved;
+		records[moved.index].chunk = chunk;
+		records[moved.index].row = row;
+	}
+
+	if (--last_chunk->count == 0)
+	{
+		archetype->chunks.pop_back();
+	}
+}
+
+void World::move_entity(Entity entity, Archetype* target)
+{
+	EntityRecord& record = records[entity.index];
+	Archetype* source = record.archetype;
+	Chunk* source_chunk = record.chunk;
+	uint32_t source_row = record.row;
+
+	EntityRecord moved_to;
+	place(entity, target, moved_to);
+
+	for (ComponentID id : source->components)
+	{
+		if (target->has(id))
+		{
+			ECS::get_component_info(id).move_construct(target->get_component(moved_to.chunk, moved_to.row, id), source->get_component(source_chunk, source_row, id));
+		}
+	}
+
+	// Destroys the moved from leftovers and may relocate another entity into the freed row
+	remove_row(source, source_chunk, source_row);
+
+	record.archetype = moved_to.archetype;
+	record.chunk = moved_to.chunk;
+	record.row = moved_to.row;
+}
+
+void World::add_component(Entity entity, ComponentID id, void* component)
+{
+	if (!is_alive(entity))
+	{
+		WARN("Tried to add {} to a dead entity {}", ECS::get_component_info(id).name, entity.index);
+		return;
+	}
+
+	const ComponentInfo& info = ECS::get_component_info(id);
+	EntityRecord& record = records[entity.index];
+	if (record.archetype->has(id))
+	{
+		void* existing = record.archetype->get_component(record.chunk, record.row, id);
+		info.destroy(existing);
+		info.move_construct(existing, component);
+		return;
+	}
+
+	move_entity(entity, get_add_target(record.archetype, id));
+	info.move_construct(record.archetype->get_component(record.chunk, record.row, id), component);
+}
+
+void World::remove_component(Entity entity, ComponentID id)
+{
+	if (!is_alive(entity) || !records[entity.index].archetype->has(id))
+	{
+		return;
+	}
+
+	move_entity(entity, get_remove_target(records[entity.index].archetype, id));
+}
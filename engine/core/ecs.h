@@ -0,0 +1,376 @@
+#pragma once
+
+#include "common.h"
+#include "core/job_system.h"
+
+#include <mutex>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+
+// Archetype based entity component system.
+//
+// Entities with the same set of components share an archetype, which stores them in 16 KiB chunks laid out
+// as one tightly packed array per component. Queries walk those arrays linearly.
+// Structural changes (create, destroy, add, remove) move entities between archetypes, so they must not happen
+// while iterating. Use an EntityCommandBuffer to record them and apply it afterwards.
+
+struct Entity
+{
+	uint32_t index = ~0u;
+	uint32_t generation = 0;
+
+	bool is_valid() const { return index != ~0u; }
+	bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+using ComponentID = uint32_t;
+using ComponentMask = uint64_t;
+
+constexpr uint32_t max_component_types = 64;
+
+struct ComponentInfo
+{
+	size_t size;
+	size_t alignment;
+	void (*move_construct)(void* destination, void* source);
+	void (*destroy)(void* component);
+	const char* name;
+};
+
+namespace ECS
+{
+ComponentID register_component(const ComponentInfo& info);
+const ComponentInfo& get_component_info(ComponentID id);
+
+template <class T>
+ComponentID get_component_id()
+{
+	using Component = std::remove_cv_t<std::remove_reference_t<T>>;
+	if constexpr (!std::is_same_v<T, Component>)
+	{
+		// Queries may ask for const components, they share the id of the plain type
+		return get_component_id<Component>();
+	}
+	else
+	{
+		static_assert(std::is_move_constructible_v<Component>, "Components are moved between chunks");
+		static_assert(alignof(Component) <= 64, "Chunk arrays are only 64 byte aligned");
+
+		static const ComponentID id = register_component({
+		    sizeof(Component),
+		    alignof(Component),
+		    [](void* destination, void* source)
+		    { new (destination) Component(std::move(*static_cast<Component*>(source))); },
+		    [](void* component)
+		    { static_cast<Component*>(component)->~Component(); },
+		    typeid(Component).name(),
+		});
+		return id;
+	}
+}
+
+template <class... Ts>
+ComponentMask get_component_mask()
+{
+	return ((ComponentMask(1) << get_component_id<Ts>()) | ... | ComponentMask(0));
+}
+};
+
+struct Archetype;
+
+struct alignas(64) Chunk
+{
+	static constexpr size_t size = 16 * 1024;
+	static constexpr size_t header_size = 64;
+	static constexpr size_t data_size = size - header_size;
+
+	Archetype* archetype = nullptr;
+	uint32_t count = 0;
+
+	alignas(64) Byte data[data_size];
+
+	Entity* get_entities() { return reinterpret_cast<Entity*>(data); }
+};
+static_assert(sizeof(Chunk) == Chunk::size, "Chunks must fill exactly 16 KiB");
+
+struct Archetype
+{
+	ComponentMask mask = 0;
+	Vector<ComponentID> components;
+
+	// Byte offset of each component's array inside a chunk and the component's size, indexed like components
+	Vector<uint32_t> offsets;
+	Vector<uint32_t> sizes;
+
+	// Maps a component id to its index in components, or no_column
+	static constexpr uint8_t no_column = 0xff;
+	uint8_t columns[max_component_types];
+
+	uint32_t chunk_capacity = 0;
+	Vector<Ptr<Chunk>> chunks;
+
+	// Cached transitions to the archetypes with one component added or removed
+	HashMap<ComponentID, Archetype*> add_edges;
+	HashMap<ComponentID, Archetype*> remove_edges;
+
+	bool has(ComponentID id) const { return columns[id] != no_column; }
+
+	void* get_component(Chunk* chunk, uint32_t row, ComponentID id) const
+	{
+		uint8_t column = columns[id];
+		return chunk->data + offsets[column] + sizes[column] * row;
+	}
+
+	template <class T>
+	T* get_array(Chunk* chunk) const
+	{
+		using Component = std::remove_cv_t<T>;
+		return reinterpret_cast<T*>(chunk->data + offsets[columns[ECS::get_component_id<Component>()]]);
+	}
+};
+
+class World;
+
+// Records structural changes from any thread to be applied to a world later. Thread safe.
+class EntityCommandBuffer
+{
+public:
+	EntityCommandBuffer() = default;
+	~EntityCommandBuffer() { clear(); }
+
+	EntityCommandBuffer(const EntityCommandBuffer&) = delete;
+	EntityCommandBuffer& operator=(const EntityCommandBuffer&) = delete;
+
+	template <class... Ts>
+	void create(Ts&&... components)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		commands.push_back({ CommandType::Create, Entity {}, 0, nullptr });
+		(record_add(Entity {}, std::forward<Ts>(components)), ...);
+	}
+
+	void destroy(Entity entity);
+
+	template <class T>
+	void add(Entity entity, T&& component)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		record_add(entity, std::forward<T>(component));
+	}
+
+	template <class T>
+	void remove(Entity entity)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		commands.push_back({ CommandType::Remove, entity, ECS::get_component_id<T>(), nullptr });
+	}
+
+	void execute(World& world);
+	void clear();
+
+	bool is_empty() const { return commands.empty(); }
+
+private:
+	enum class CommandType
+	{
+		Create,
+		Destroy,
+		Add,
+		Remove
+	};
+
+	struct Command
+	{
+		CommandType type;
+		Entity entity;
+		ComponentID component;
+		void* payload;
+	};
+
+	// An invalid entity refers to the one made by the preceding create command
+	template <class T>
+	void record_add(Entity entity, T&& component)
+	{
+		using Component = std::remove_cv_t<std::remove_reference_t<T>>;
+
+		void* payload = allocate_payload(sizeof(Component), alignof(Component));
+		new (payload) Component(std::forward<T>(component));
+		commands.push_back({ CommandType::Add, entity, ECS::get_component_id<Component>(), payload });
+	}
+
+	// Destroys pending payloads and rewinds the pages, expects the mutex to be held
+	void release_commands();
+
+	// Payloads live in fixed pages so they never move once constructed
+	void* allocate_payload(size_t size, size_t alignment);
+
+	static constexpr size_t page_size = 64 * 1024;
+	struct Page
+	{
+		Ptr<Byte[]> memory;
+		size_t capacity = 0;
+		size_t used = 0;
+	};
+
+	std::mutex mutex;
+	Vector<Command> commands;
+	Vector<Page> pages;
+};
+
+class World
+{
+public:
+	World();
+	~World();
+
+	World(const World&) = delete;
+	World& operator=(const World&) = delete;
+
+	template <class... Ts>
+	Entity create(Ts&&... components)
+	{
+		Archetype* archetype = get_archetype(ECS::get_component_mask<Ts...>());
+		Entity entity = allocate_entity();
+		EntityRecord& record = records[entity.index];
+		place(entity, archetype, record);
+		(new (archetype->get_component(record.chunk, record.row, ECS::get_component_id<Ts>())) std::remove_cv_t<std::remove_reference_t<Ts>>(std::forward<Ts>(components)), ...);
+		return entity;
+	}
+
+	void destroy(Entity entity);
+	bool is_alive(Entity entity) const;
+
+	template <class T>
+	void add(Entity entity, T&& component)
+	{
+		using Component = std::remove_cv_t<std::remove_reference_t<T>>;
+
+		Component value(std::forward<T>(component));
+		add_component(entity, ECS::get_component_id<Component>(), &value);
+	}
+
+	template <class T>
+	void remove(Entity entity)
+	{
+		remove_component(entity, ECS::get_component_id<T>());
+	}
+
+	template <class T>
+	bool has(Entity entity) const
+	{
+		return is_alive(entity) && records[entity.index].archetype->has(ECS::get_component_id<T>());
+	}
+
+	template <class T>
+	T* get(Entity entity)
+	{
+		ComponentID id = ECS::get_component_id<T>();
+		if (!is_alive(entity) || !records[entity.index].archetype->has(id))
+		{
+			return nullptr;
+		}
+
+		const EntityRecord& record = records[entity.index];
+		return static_cast<T*>(record.archetype->get_component(record.chunk, record.row, id));
+	}
+
+	// Calls function(Ts&...) or function(Entity, Ts&...) for every entity that has all of Ts
+	template <class... Ts, class F>
+	void each(F&& function)
+	{
+		for_each_matching_chunk(ECS::get_component_mask<Ts...>(), [&function](Archetype* archetype, Chunk* chunk)
+		    { iterate_chunk<Ts...>(archetype, chunk, function); });
+	}
+
+	// Same as each() but splits the matching chunks across the job system's workers
+	template <class... Ts, class F>
+	void parallel_each(F&& function, size_t chunks_per_job = 1)
+	{
+		Vector<std::pair<Archetype*, Chunk*>> chunks;
+		for_each_matching_chunk(ECS::get_component_mask<Ts...>(), [&chunks](Archetype* archetype, Chunk* chunk)
+		    { chunks.emplace_back(archetype, chunk); });
+
+		JobSystem::get_singleton()->parallel_for(0, chunks.size(), chunks_per_job, [&chunks, &function](size_t begin, size_t end)
+		    {
+			    for (size_t i = begin; i < end; i++)
+			    {
+				    iterate_chunk<Ts...>(chunks[i].first, chunks[i].second, function);
+			    }
+		    });
+	}
+
+	uint32_t get_entity_count() const { return entity_count; }
+	uint32_t get_archetype_count() const { return archetypes.size(); }
+
+private:
+	friend class EntityCommandBuffer;
+
+	struct EntityRecord
+	{
+		Archetype* archetype = nullptr;
+		Chunk* chunk = nullptr;
+		uint32_t row = 0;
+		uint32_t generation = 0;
+	};
+
+	template <class... Ts, class F>
+	static void iterate_chunk(Archetype* archetype, Chunk* chunk, F& function)
+	{
+		Entity* entities = chunk->get_entities();
+		std::tuple<Ts*...> arrays = { archetype->get_array<Ts>(chunk)... };
+		for (uint32_t row = 0; row < chunk->count; row++)
+		{
+			if constexpr (std::is_invocable_v<F&, Entity, Ts&...>)
+			{
+				function(entities[row], std::get<Ts*>(arrays)[row]...);
+			}
+			else
+			{
+				function(std::get<Ts*>(arrays)[row]...);
+			}
+		}
+	}
+
+	template <class F>
+	void for_each_matching_chunk(ComponentMask mask, F&& function)
+	{
+		for (Archetype* archetype : archetype_list)
+		{
+			if ((archetype->mask & mask) != mask)
+			{
+				continue;
+			}
+
+			for (Ptr<Chunk>& chunk : archetype->chunks)
+			{
+				function(archetype, chunk.get());
+			}
+		}
+	}
+
+	Entity allocate_entity();
+	Archetype* get_archetype(ComponentMask mask);
+	Archetype* get_add_target(Archetype* archetype, ComponentID id);
+	Archetype* get_remove_target(Archetype* archetype, ComponentID id);
+
+	// Reserves a row for the entity at the end of the archetype
+	void place(Entity entity, Archetype* archetype, EntityRecord& record);
+
+	// Destroys the row's components and fills the hole with the archetype's last entity
+	void remove_row(Archetype* archetype, Chunk* chunk, uint32_t row);
+
+	void move_entity(Entity entity, Archetype* target);
+	void add_component(Entity entity, ComponentID id, void* component);
+	void remove_component(Entity entity, ComponentID id);
+
+	Vector<EntityRecord> records;
+	Vector<uint32_t> free_indices;
+	uint32_t entity_count = 0;
+
+	HashMap<ComponentMask, Ptr<Archetype>> archetypes;
+	Vector<Archetype*> archetype_list;
+	Archetype* empty_archetype = nullptr;
+};
@@ -1 +1,44 @@
 #include "event.h"
+
+#include "core/log.h"
+
+#include <atomic>
+
+namespace
+{
+// Filled once per event type and never shrunk, so dispatch() can read it without taking the lock
+struct PhaseDispatchers
+{
+	EventBus::Dispatcher dispatchers[EventBus::max_events_per_phase];
+	std::atomic<uint32_t> count = 0;
+};
+
+std::mutex dispatchers_mutex;
+PhaseDispatchers phases[uint32_t(EventPhase::Count)];
+}
+
+void EventBus::dispatch(EventPhase phase)
+{
+	PhaseDispatchers& phase_dispatchers = phases[uint32_t(phase)];
+
+	uint32_t count = phase_dispatchers.count.load(std::memory_order_acquire);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		phase_dispatchers.dispatchers[i]();
+	}
+}
+
+void EventBus::add_dispatcher(EventPhase phase, Dispatcher dispatcher)
+{
+	std::lock_guard<std::mutex> lock(dispatchers_mutex);
+	PhaseDispatchers& phase_dispatchers = phases[uint32_t(phase)];
+
+	uint32_t count = phase_dispatchers.count.load(std::memory_order_relaxed);
+	if (count == max_events_per_phase)
+	{
+		CRITICAL("More than {} event types are posted at phase {}", max_events_per_phase, uint32_t(phase));
+	}
+
+	phase_dispatchers.dispatchers[count] = dispatcher;
+	phase_dispatchers.count.store(count + 1, std::memory_order_release);
+}
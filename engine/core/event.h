@@ -2,18 +2,152 @@
 
 #include "core/math.h"
 #include "event_link.h"
+#include "mpsc_queue.h"
+
+#include <algorithm>
+#include <mutex>
+
+// Points in the frame where posted events are delivered, in the order the application dispatches them
+enum class EventPhase
+{
+	FrameStart,
+	FrameEnd,
+	Count
+};
+
+class EventBus
+{
+public:
+	// Delivers every event posted so far to events of this phase. Events posted by the handlers themselves
+	// wait for the next dispatch. Main thread only.
+	static void dispatch(EventPhase phase);
+
+	using Dispatcher = void (*)();
+	static void add_dispatcher(EventPhase phase, Dispatcher dispatcher);
+
+	static constexpr uint32_t max_events_per_phase = 64;
+};
 
 template <class EventData>
 class BaseEvent
 {
 public:
-	static inline Vector<BaseEventLink<EventData>*> queue;
+	// Events can hide this to be delivered at another phase
+	static constexpr EventPhase phase = EventPhase::FrameStart;
+
+	// Calls every subscriber right away. Main thread only, other threads should post().
 	static void fire(const EventData& e)
 	{
-		for (BaseEventLink<EventData>* event_link : queue)
+		Subscribers& subscribers = get_subscribers();
+
+		// Links made by the handlers only receive later events
+		size_t count = subscribers.list.size();
+		subscribers.dispatch_depth++;
+		for (size_t i = 0; i < count; i++)
+		{
+			// Copied so that handlers subscribing more links can not invalidate it
+			EventDelegate<EventData> delegate = subscribers.list[i].delegate;
+			if (delegate.is_bound())
+			{
+				delegate(e);
+			}
+		}
+		subscribers.dispatch_depth--;
+
+		if (subscribers.dispatch_depth == 0)
+		{
+			subscribers.remove_unbound();
+		}
+	}
+
+	// Queues the event for the next EventBus::dispatch() of its phase. Safe from any thread.
+	static void post(EventData e)
+	{
+		static std::once_flag registration;
+		std::call_once(registration, []()
+		    { EventBus::add_dispatcher(EventData::phase, &dispatch_posted); });
+
+		get_posted().push(std::move(e));
+	}
+
+	// O(1), slot receives the subscriber's index and is updated whenever it moves
+	static void subscribe(EventDelegate<EventData> delegate, uint32_t* slot)
+	{
+		Subscribers& subscribers = get_subscribers();
+		*slot = subscribers.list.size();
+		subscribers.list.push_back({ delegate, slot });
+	}
+
+	// O(1), swaps the last subscriber into the hole
+	static void unsubscribe(uint32_t* slot)
+	{
+		Subscribers& subscribers = get_subscribers();
+		uint32_t index = *slot;
+
+		// Moving subscribers around during fire() would skip or repeat handlers, so only unbind for now
+		if (subscribers.dispatch_depth > 0)
+		{
+			subscribers.list[index] = {};
+			subscribers.unbound.push_back(index);
+			return;
+		}
+
+		subscribers.remove(index);
+	}
+
+	static uint32_t get_subscriber_count() { return get_subscribers().list.size() - get_subscribers().unbound.size(); }
+
+private:
+	struct Subscriber
+	{
+		EventDelegate<EventData> delegate;
+		uint32_t* slot = nullptr;
+	};
+
+	struct Subscribers
+	{
+		Vector<Subscriber> list;
+		Vector<uint32_t> unbound;
+		uint32_t dispatch_depth = 0;
+
+		void remove(uint32_t index)
+		{
+			list[index] = list.back();
+			if (list[index].slot)
+			{
+				*list[index].slot = index;
+			}
+			list.pop_back();
+		}
+
+		// Removing from the back first keeps the remaining indices valid
+		void remove_unbound()
 		{
-			event_link->fire(e);
+			std::sort(unbound.begin(), unbound.end(), std::greater<uint32_t>());
+			for (uint32_t index : unbound)
+			{
+				remove(index);
+			}
+			unbound.clear();
 		}
+	};
+
+	static Subscribers& get_subscribers()
+	{
+		static Subscribers subscribers;
+		return subscribers;
+	}
+
+	static MPSCQueue<EventData>& get_posted()
+	{
+		static MPSCQueue<EventData> posted;
+		return posted;
+	}
+
+	static void dispatch_posted()
+	{
+		get_posted().consume_all([](const EventData& e)
+		    { fire(e); });
 	}
 };
 
@@ -26,3 +160,9 @@ struct EventWindowResizing : public BaseEvent<EventWindowResizing>
 struct EventWindowClosing : public BaseEvent<EventWindowClosing>
 {
 };
+
+// Posted by the application's file watcher once a file below assets/ has been written
+struct EventFileChanged : public BaseEvent<EventFileChanged>
+{
+	String path;
+};
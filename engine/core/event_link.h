@@ -2,47 +2,54 @@
 
 #include "common.h"
 
+// Non-virtual, type-erased handler: a context pointer and a plain function that knows how to call into it
 template <class EventData>
-class BaseEventLink
+struct EventDelegate
 {
-public:
-	virtual void fire(const EventData& e) = 0;
+	void* context = nullptr;
+	void (*function)(void* context, const EventData& e) = nullptr;
+
+	void operator()(const EventData& e) const { function(context, e); }
+	bool is_bound() const { return function != nullptr; }
 };
 
+// Subscribes a member function to EventData for as long as the link lives.
+// Links must be created and destroyed on the main thread, the same one that fires and dispatches events.
 template <class EventReceiverClass, class EventData>
-class EventLink : public BaseEventLink<EventData>
+class EventLink
 {
 	using EventHandler = void (EventReceiverClass::*)(const EventData&);
 
 public:
 	EventLink(EventReceiverClass* handling_object, EventHandler event_handler)
-	    : handler(event_handler)
-	    , object(handling_object)
+	    : object(handling_object)
+	    , handler(event_handler)
 	{
 		// Establish link
-		EventData::queue.push_back(this);
+		EventData::subscribe({ this, &EventLink::call }, &slot);
 	}
 
 	~EventLink()
 	{
 		// Break link since we can't receive events now
-		for (int i = 0; i < EventData::queue.size(); i++)
-		{
-			if (EventData::queue.at(i) == this)
-			{
-				EventData::queue.erase(EventData::queue.begin() + i);
-			}
-		}
+		EventData::unsubscribe(&slot);
 	}
 
 	EventLink(const EventLink&) = delete;
 	EventLink(EventLink&&) = delete;
 	EventLink& operator=(const EventLink&) = delete;
-	EventLink& operator=(EventLink&&) = default;
-
-	void fire(const EventData& e) override { (object->*handler)(e); }
+	EventLink& operator=(EventLink&&) = delete;
 
 private:
+	static void call(void* context, const EventData& e)
+	{
+		EventLink* link = static_cast<EventLink*>(context);
+		(link->object->*link->handler)(e);
+	}
+
 	EventReceiverClass* object = nullptr;
 	EventHandler handler;
+
+	// Index of this link's delegate, kept up to date by the event when other links leave
+	uint32_t slot;
 };
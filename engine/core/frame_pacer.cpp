@@ -0,0 +1,70 @@
+#include "frame_pacer.h"
+
+#include <thread>
+
+#include "profiler.h"
+
+FramePacer::FramePacer(double max_frame_rate)
+{
+	set_max_frame_rate(max_frame_rate);
+}
+
+void FramePacer::set_max_frame_rate(double frames_per_second)
+{
+	max_frame_rate = std::max(frames_per_second, 0.0);
+	frame_ns = max_frame_rate > 0.0 ? uint64_t(1e9 / max_frame_rate) : 0;
+	deadline_ns = 0;
+}
+
+void FramePacer::wait(const Function<void(uint64_t timeout_ns)>& idle)
+{
+	PROFILE_FUNCTION();
+
+	if (frame_ns == 0)
+	{
+		return;
+	}
+
+	uint64_t now = Profiler::now_ns();
+
+	// Restart the schedule on the first frame and after a hitch instead of rushing frames out to catch up
+	if (deadline_ns == 0 || now > deadline_ns + frame_ns)
+	{
+		deadline_ns = now + frame_ns;
+		return;
+	}
+
+	waiter.wait_until(deadline_ns, idle);
+
+	// Deadlines advance by whole frames so the average rate stays exact when a wait runs late
+	deadline_ns += frame_ns;
+}
+
+void DeadlineWaiter::wait_until(uint64_t deadline_ns, const Function<void(uint64_t timeout_ns)>& idle)
+{
+	uint64_t now = Profiler::now_ns();
+	while (deadline_ns > now + spin_margin_ns)
+	{
+		uint64_t sleep_ns = deadline_ns - spin_margin_ns - now;
+		if (idle)
+		{
+			idle(sleep_ns);
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::nanoseconds(sleep_ns));
+		}
+
+		// Jumps up to the worst oversleep right away and decays slowly, so one good sleep cannot shrink the margin
+		uint64_t woke = Profiler::now_ns();
+		double oversleep = double(woke - now) - double(sleep_ns);
+		oversleep_ns = std::max(oversleep, oversleep_ns * 0.99);
+		spin_margin_ns = std::clamp(uint64_t(oversleep_ns * 1.25), min_spin_margin_ns, max_spin_margin_ns);
+		now = woke;
+	}
+
+	while (Profiler::now_ns() < deadline_ns)
+	{
+		std::this_thread::yield();
+	}
+}
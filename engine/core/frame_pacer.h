@@ -0,0 +1,48 @@
+#pragma once
+
+#include "common.h"
+
+// Waits for a deadline more precisely than an OS sleep can. Sleeps overshoot, so it sleeps until shortly before
+// the deadline and spins the rest of the way, cutting the sleep short by the worst recent oversleep.
+class DeadlineWaiter
+{
+public:
+	// The sleeping part can be handed to idle, which may return early and is called again until it is time to spin
+	void wait_until(uint64_t deadline_ns, const Function<void(uint64_t timeout_ns)>& idle = nullptr);
+
+	// How far the sleep is cut short of the deadline
+	uint64_t get_spin_margin_ns() const { return spin_margin_ns; }
+
+	static constexpr uint64_t min_spin_margin_ns = 100'000;
+	static constexpr uint64_t max_spin_margin_ns = 4'000'000;
+
+private:
+	uint64_t spin_margin_ns = 1'000'000;
+	double oversleep_ns = 0.0;
+};
+
+// Caps the frame rate by waiting at the top of the frame, before input is sampled, so the frame that follows
+// is built from the freshest input instead of idling in acquire or present. OS sleeps overshoot, so the pacer
+// sleeps until shortly before the deadline and spins the rest of the way.
+class FramePacer
+{
+public:
+	FramePacer(double max_frame_rate = 0.0);
+
+	// 0 disables the limit
+	void set_max_frame_rate(double frames_per_second);
+	double get_max_frame_rate() const { return max_frame_rate; }
+
+	// Blocks until the next frame is due. The sleeping part can be handed to idle, which may return early
+	// and is called again until it is time to spin, so the window can take input events as they arrive.
+	void wait(const Function<void(uint64_t timeout_ns)>& idle = nullptr);
+
+	uint64_t get_spin_margin_ns() const { return waiter.get_spin_margin_ns(); }
+
+private:
+	double max_frame_rate = 0.0;
+	uint64_t frame_ns = 0;
+	uint64_t deadline_ns = 0;
+
+	DeadlineWaiter waiter;
+};
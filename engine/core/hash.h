@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common.h"
+
+namespace Hash
+{
+constexpr uint64_t fnv1a64_offset = 0xcbf29ce484222325ull;
+constexpr uint64_t fnv1a64_prime = 0x100000001b3ull;
+
+inline uint64_t fnv1a64(const void* data, size_t size, uint64_t seed = fnv1a64_offset)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= fnv1a64_prime;
+	}
+	return hash;
+}
+
+inline uint64_t fnv1a64(const String& str, uint64_t seed = fnv1a64_offset)
+{
+	return fnv1a64(str.data(), str.size(), seed);
+}
+
+template <class T>
+inline uint64_t combine(uint64_t hash, const T& value)
+{
+	static_assert(std::is_trivially_copyable_v<T>, "Only plain values can be hashed bytewise");
+	return fnv1a64(&value, sizeof(T), hash);
+}
+};
@@ -0,0 +1,23 @@
+#include "input.h"
+
+Input* Input::get_singleton()
+{
+	static Input singleton;
+	return &singleton;
+}
+
+void Input::push(const InputEvent& event)
+{
+	if (!queue.push(event))
+	{
+		dropped_count.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// Dropped motion is never consumed, so it is left out of the sum as well
+	if (event.type == InputEventType::MouseMotion)
+	{
+		pushed_motion_x += event.delta_x;
+		pushed_motion_y += event.delta_y;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "common.h"
+#include "core/spsc_queue.h"
+
+enum class InputEventType : uint8_t
+{
+	MouseMotion,
+	MouseButton,
+	Key
+};
+
+struct InputEvent
+{
+	// When the window saw the event, in Profiler::now_ns() time
+	uint64_t time_ns = 0;
+	InputEventType type = InputEventType::MouseMotion;
+
+	// Mouse buttons and keys use the windowing API's codes
+	int32_t code = 0;
+	bool is_pressed = false;
+
+	// Mouse motion in raw counts when the platform has unaccelerated motion, in pixels otherwise
+	float delta_x = 0.0f;
+	float delta_y = 0.0f;
+};
+
+// Hands timestamped input from the window to the simulation. The window pushes events as it receives them,
+// the simulation consumes them per tick by timestamp, so motion is split between ticks where it happened
+// instead of where the frame happened to poll.
+//
+// There is one producer, the thread that polls the window, and one consumer, the simulation thread.
+class Input
+{
+public:
+	static Input* get_singleton();
+
+	static constexpr uint32_t capacity = 4096;
+
+	// Producer side. Events are dropped when the consumer falls a whole queue behind.
+	void push(const InputEvent& event);
+
+	// Everything pushed so far. Producer thread only, the render thread can subtract the motion a snapshot
+	// was simulated with to turn the view by input that has not reached the simulation yet.
+	double get_pushed_motion_x() const { return pushed_motion_x; }
+	double get_pushed_motion_y() const { return pushed_motion_y; }
+
+	// Consumer side. Calls function on every event up to and including until_ns, in push order, and leaves
+	// later events queued. Returns how many were consumed.
+	template <class F>
+	uint32_t consume(uint64_t until_ns, F&& function)
+	{
+		uint32_t count = 0;
+		while (const InputEvent* event = queue.peek())
+		{
+			if (event->time_ns > until_ns)
+			{
+				break;
+			}
+
+			if (event->type == InputEventType::MouseMotion)
+			{
+				consumed_motion_x += event->delta_x;
+				consumed_motion_y += event->delta_y;
+			}
+
+			function(*event);
+			queue.pop();
+			count++;
+		}
+		return count;
+	}
+
+	// Sums of the motion consumed so far, in the same order as the pushed sums so the two compare exactly.
+	// Consumer thread only.
+	double get_consumed_motion_x() const { return consumed_motion_x; }
+	double get_consumed_motion_y() const { return consumed_motion_y; }
+
+	uint64_t get_dropped_count() const { return dropped_count.load(std::memory_order_relaxed); }
+
+private:
+	SPSCQueue<InputEvent, capacity> queue;
+
+	double pushed_motion_x = 0.0;
+	double pushed_motion_y = 0.0;
+	std::atomic<uint64_t> dropped_count = 0;
+
+	double consumed_motion_x = 0.0;
+	double consumed_motion_y = 0.0;
+};
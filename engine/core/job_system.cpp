@@ -0,0 +1,294 @@
+#include "job_system.h"
+
+#include "profiler.h"
+
+namespace
+{
+constexpr uint32_t no_queue = ~0u;
+
+// Several job systems can exist (tests), so remember which one the queue index belongs to
+thread_local const JobSystem* current_job_system = nullptr;
+thread_local uint32_t current_queue_index = no_queue;
+}
+
+JobSystem* JobSystem::get_singleton()
+{
+	static JobSystem singleton;
+	return &singleton;
+}
+
+JobSystem::JobSystem(uint32_t worker_count)
+    : main_thread_id(std::this_thread::get_id())
+{
+	if (worker_count == 0)
+	{
+		worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	for (uint32_t i = 0; i < worker_count + 1; i++)
+	{
+		queues.push_back(MakeUnique<WorkQueue>());
+	}
+	current_job_system = this;
+	current_queue_index = worker_count;
+
+	for (uint32_t i = 0; i < worker_count; i++)
+	{
+		workers.emplace_back(&JobSystem::worker_loop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		is_running = false;
+	}
+	sleep_condition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	if (current_job_system == this)
+	{
+		current_job_system = nullptr;
+		current_queue_index = no_queue;
+	}
+}
+
+void JobSystem::run(Job job, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+	push({ std::move(job), counter });
+}
+
+void JobSystem::run_on_main_thread(Job job, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+	push_main_thread({ std::move(job), counter });
+}
+
+void JobSystem::run_after(JobCounter& dependency, Job job, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.continuation_mutex);
+		if (!dependency.is_done())
+		{
+			dependency.continuations.push_back({ std::move(job), counter });
+			return;
+		}
+	}
+
+	push({ std::move(job), counter });
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	while (!counter.is_done())
+	{
+		Task task;
+		if (find_task(task))
+		{
+			execute(task);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// The last job releases the lock right after dropping the counter to zero. Taking it here makes sure
+	// that has happened before the caller is allowed to destroy the counter.
+	std::lock_guard<std::mutex> lock(counter.continuation_mutex);
+}
+
+void JobSystem::pump_main_thread()
+{
+	Task task;
+	while (pop_main_thread(task))
+	{
+		execute(task);
+	}
+}
+
+void JobSystem::push(Task task)
+{
+	// Workers keep their own jobs local for cache locality, other threads spread theirs around
+	uint32_t queue_index = get_queue_index();
+	if (queue_index == no_queue)
+	{
+		queue_index = next_external_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+	}
+
+	// Counted before the job is published, a worker taking it right away must not drive the count below zero
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		queued_tasks.fetch_add(1, std::memory_order_release);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(queues[queue_index]->mutex);
+		queues[queue_index]->tasks.push_back(std::move(task));
+	}
+	sleep_condition.notify_one();
+}
+
+void JobSystem::push_main_thread(Task task)
+{
+	std::lock_guard<std::mutex> lock(main_thread_queue.mutex);
+	main_thread_queue.tasks.push_back(std::move(task));
+}
+
+bool JobSystem::pop_local(uint32_t queue_index, Task& task)
+{
+	WorkQueue& queue = *queues[queue_index];
+
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty())
+	{
+		return false;
+	}
+
+	// Newest first, its data is most likely still in cache
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	queued_tasks.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool JobSystem::steal(uint32_t thief_index, Task& task)
+{
+	uint32_t queue_count = queues.size();
+	uint32_t first_victim = thief_index == no_queue ? 0 : thief_index + 1;
+	for (uint32_t offset = 0; offset < queue_count; offset++)
+	{
+		uint32_t victim_index = (first_victim + offset) % queue_count;
+		if (victim_index == thief_index)
+		{
+			continue;
+		}
+
+		WorkQueue& queue = *queues[victim_index];
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+		{
+			continue;
+		}
+
+		// Oldest first, it tends to be the biggest piece of remaining work
+		task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		queued_tasks.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+bool JobSystem::pop_main_thread(Task& task)
+{
+	std::lock_guard<std::mutex> lock(main_thread_queue.mutex);
+	if (main_thread_queue.tasks.empty())
+	{
+		return false;
+	}
+
+	task = std::move(main_thread_queue.tasks.front());
+	main_thread_queue.tasks.pop_front();
+	return true;
+}
+
+bool JobSystem::find_task(Task& task)
+{
+	// Waiting on the main thread must still make progress on main thread jobs or it could wait forever
+	if (is_main_thread() && pop_main_thread(task))
+	{
+		return true;
+	}
+
+	uint32_t queue_index = get_queue_index();
+	if (queue_index != no_queue && pop_local(queue_index, task))
+	{
+		return true;
+	}
+
+	return steal(queue_index, task);
+}
+
+void JobSystem::execute(Task& task)
+{
+	{
+		PROFILE_SCOPE("Job");
+		task.job();
+	}
+	finish(task.counter);
+}
+
+void JobSystem::finish(JobCounter* counter)
+{
+	if (!counter)
+	{
+		return;
+	}
+
+	Vector<JobCounter::Continuation> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->continuation_mutex);
+		if (counter->value.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		{
+			return;
+		}
+		continuations.swap(counter->continuations);
+	}
+
+	// Their counters were already incremented when they were registered
+	for (JobCounter::Continuation& continuation : continuations)
+	{
+		push({ std::move(continuation.job), continuation.counter });
+	}
+}
+
+uint32_t JobSystem::get_queue_index() const
+{
+	return current_job_system == this ? current_queue_index : no_queue;
+}
+
+void JobSystem::worker_loop(uint32_t queue_index)
+{
+	current_job_system = this;
+	current_queue_index = queue_index;
+	PROFILE_THREAD(("Worker " + std::to_string(queue_index)).c_str());
+
+	while (true)
+	{
+		Task task;
+		if (pop_local(queue_index, task) || steal(queue_index, task))
+		{
+			execute(task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		sleep_condition.wait(lock, [this]()
+		    { return queued_tasks.load(std::memory_order_acquire) > 0 || !is_running; });
+
+		if (!is_running && queued_tasks.load(std::memory_order_acquire) == 0)
+		{
+			break;
+		}
+	}
+}
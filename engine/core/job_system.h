@@ -0,0 +1,138 @@
+#pragma once
+
+#include "common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using Job = Function<void()>;
+
+// Tracks a group of jobs. Jobs can be chained onto a counter so they start once it drops to zero.
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool is_done() const { return value.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	struct Continuation
+	{
+		Job job;
+		JobCounter* counter;
+	};
+
+	std::atomic<uint32_t> value = 0;
+	std::mutex continuation_mutex;
+	Vector<Continuation> continuations;
+};
+
+// Work stealing job system. Every worker owns a deque it pushes to and pops from at the back, idle workers
+// steal from the front of the others. Threads that wait on a counter run jobs in the meantime instead of blocking.
+// Jobs that must run on the main thread (GLFW calls) go to a separate queue drained by pump_main_thread().
+class JobSystem
+{
+public:
+	static JobSystem* get_singleton();
+
+	// Spawns one worker per core besides the calling thread, which becomes the main thread
+	JobSystem(uint32_t worker_count = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem(JobSystem&&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	JobSystem& operator=(JobSystem&&) = delete;
+
+	void run(Job job, JobCounter* counter = nullptr);
+	void run_on_main_thread(Job job, JobCounter* counter = nullptr);
+
+	// Schedules the job once every job tracked by the dependency has finished
+	void run_after(JobCounter& dependency, Job job, JobCounter* counter = nullptr);
+
+	// Executes other jobs until the counter reaches zero
+	void wait(JobCounter& counter);
+
+	// Runs every job that was queued for the main thread. Called once per frame by the application.
+	void pump_main_thread();
+
+	// Calls function(chunk_begin, chunk_end) over [begin, end) in chunks of at most grain_size and waits for all of them
+	template <class F>
+	void parallel_for(size_t begin, size_t end, size_t grain_size, F&& function)
+	{
+		if (begin >= end)
+		{
+			return;
+		}
+
+		grain_size = std::max<size_t>(grain_size, 1);
+		if (end - begin <= grain_size)
+		{
+			function(begin, end);
+			return;
+		}
+
+		JobCounter counter;
+		for (size_t chunk_begin = begin + grain_size; chunk_begin < end; chunk_begin += grain_size)
+		{
+			size_t chunk_end = std::min(chunk_begin + grain_size, end);
+			run([&function, chunk_begin, chunk_end]()
+			    { function(chunk_begin, chunk_end); },
+			    &counter);
+		}
+
+		// The calling thread takes the first chunk itself
+		function(begin, std::min(begin + grain_size, end));
+		wait(counter);
+	}
+
+	uint32_t get_worker_count() const { return workers.size(); }
+	bool is_main_thread() const { return std::this_thread::get_id() == main_thread_id; }
+
+private:
+	struct Task
+	{
+		Job job;
+		JobCounter* counter = nullptr;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void push(Task task);
+	void push_main_thread(Task task);
+
+	bool pop_local(uint32_t queue_index, Task& task);
+	bool steal(uint32_t thief_index, Task& task);
+	bool pop_main_thread(Task& task);
+	bool find_task(Task& task);
+	void execute(Task& task);
+	void finish(JobCounter* counter);
+	uint32_t get_queue_index() const;
+
+	void worker_loop(uint32_t queue_index);
+
+	std::thread::id main_thread_id;
+	Vector<std::thread> workers;
+
+	// One queue per worker plus a last one that belongs to the main thread
+	Vector<Ptr<WorkQueue>> queues;
+	std::atomic<uint32_t> next_external_queue = 0;
+
+	WorkQueue main_thread_queue;
+
+	std::atomic<uint32_t> queued_tasks = 0;
+	std::mutex sleep_mutex;
+	std::condition_variable sleep_condition;
+	std::atomic<bool> is_running = true;
+};
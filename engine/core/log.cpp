@@ -1 +1,269 @@
 #include "log.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+std::atomic<bool> is_backend_running = false;
+thread_local bool is_backend_thread = false;
+}
+
+// Formats records from every thread's ring and writes them to spdlog's sinks
+class LogBackend
+{
+public:
+	static LogBackend& get()
+	{
+		static LogBackend backend;
+		return backend;
+	}
+
+	LogBackend()
+	{
+		// Makes sure spdlog's registry outlives the backend
+		spdlog::default_logger_raw();
+
+		thread = std::thread(&LogBackend::run, this);
+		is_backend_running = true;
+	}
+
+	~LogBackend()
+	{
+		// Threads that log after this point write synchronously
+		is_backend_running = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			is_stopping = true;
+		}
+		wake_condition.notify_one();
+		thread.join();
+	}
+
+	void register_ring(LogRing* ring)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		rings.emplace_back(ring);
+	}
+
+	void wake()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			wake_requested = true;
+		}
+		wake_condition.notify_one();
+	}
+
+	void flush()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		uint64_t ticket = ++flush_requested;
+		wake_condition.notify_one();
+		flushed_condition.wait(lock, [this, ticket]()
+		    { return flush_completed >= ticket; });
+	}
+
+private:
+	void run()
+	{
+		is_backend_thread = true;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			uint64_t flush_ticket = flush_requested;
+			bool should_stop = is_stopping;
+
+			// Rings are only added and removed under the lock, so drain with it released
+			Vector<LogRing*> current_rings;
+			for (Ptr<LogRing>& ring : rings)
+			{
+				current_rings.push_back(ring.get());
+			}
+			lock.unlock();
+
+			// Held for the whole tick so swapping the default logger meanwhile can not free it under the backend
+			Ref<spdlog::logger> logger = spdlog::default_logger();
+			bool has_written = false;
+			for (LogRing* ring : current_rings)
+			{
+				has_written |= drain(logger.get(), ring);
+			}
+			if (has_written || flush_ticket > flush_completed)
+			{
+				logger->flush();
+			}
+			logger.reset();
+
+			lock.lock();
+			release_abandoned_rings();
+
+			if (flush_ticket > flush_completed)
+			{
+				flush_completed = flush_ticket;
+				flushed_condition.notify_all();
+			}
+			if (should_stop)
+			{
+				return;
+			}
+
+			// Producers only wake the backend when something urgent is logged, everything else is picked up
+			// on the next tick
+			wake_condition.wait_for(lock, std::chrono::milliseconds(5), [this]()
+			    { return is_stopping || wake_requested || flush_requested > flush_completed; });
+			wake_requested = false;
+		}
+	}
+
+	bool drain(spdlog::logger* logger, LogRing* ring)
+	{
+		auto write_record = [this, logger](const LogRing::Record& record, Byte* payload)
+		{
+			buffer.clear();
+			record.decode(payload, record.site->format, buffer);
+			Log::write(logger, *record.site, record.time, String(buffer.data(), buffer.size()));
+		};
+
+		bool has_written = false;
+		while (ring->consume(write_record))
+		{
+			has_written = true;
+		}
+		return has_written;
+	}
+
+	void release_abandoned_rings()
+	{
+		for (size_t i = 0; i < rings.size();)
+		{
+			if (rings[i]->is_abandoned && rings[i]->is_empty())
+			{
+				rings[i] = std::move(rings.back());
+				rings.pop_back();
+				continue;
+			}
+			i++;
+		}
+	}
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake_condition;
+	std::condition_variable flushed_condition;
+	Vector<Ptr<LogRing>> rings;
+	uint64_t flush_requested = 0;
+	uint64_t flush_completed = 0;
+	bool is_stopping = false;
+	bool wake_requested = false;
+
+	fmt::memory_buffer buffer;
+};
+
+namespace
+{
+// Hands the ring back to the backend when its thread exits
+struct ThreadRing
+{
+	LogRing* ring = nullptr;
+
+	~ThreadRing()
+	{
+		if (ring && is_backend_running)
+		{
+			ring->is_abandoned = true;
+		}
+	}
+};
+thread_local ThreadRing thread_ring;
+}
+
+Byte* LogRing::reserve(size_t size)
+{
+	size = (size + alignment - 1) & ~(alignment - 1);
+
+	size_t write = write_position.load(std::memory_order_relaxed);
+	size_t padding = capacity - write % capacity;
+	if (padding >= size)
+	{
+		padding = 0;
+	}
+
+	// Full rings wait for the backend instead of dropping messages
+	while (capacity - (write - read_position.load(std::memory_order_acquire)) < padding + size)
+	{
+		LogBackend::get().wake();
+		std::this_thread::yield();
+	}
+
+	if (padding)
+	{
+		Record* skip = reinterpret_cast<Record*>(data + write % capacity);
+		skip->site = nullptr;
+		skip->size = padding;
+		write += padding;
+		write_position.store(write, std::memory_order_release);
+	}
+
+	Record* record = reinterpret_cast<Record*>(data + write % capacity);
+	record->size = size;
+	reserved_position = write + size;
+	return data + write % capacity;
+}
+
+void LogRing::commit()
+{
+	write_position.store(reserved_position, std::memory_order_release);
+}
+
+void Log::flush()
+{
+	if (is_async())
+	{
+		LogBackend::get().flush();
+	}
+}
+
+void Log::wake_backend()
+{
+	LogBackend::get().wake();
+}
+
+void Log::setup()
+{
+#ifndef NDEBUG
+	spdlog::set_level(spdlog::level::trace);
+#endif // NDEBUG
+
+	LogBackend::get();
+}
+
+bool Log::is_async()
+{
+	return is_backend_running.load(std::memory_order_relaxed) && !is_backend_thread;
+}
+
+LogRing* Log::get_thread_ring()
+{
+	if (!thread_ring.ring)
+	{
+		Ptr<LogRing> ring = MakeUnique<LogRing>();
+		thread_ring.ring = ring.get();
+		LogBackend::get().register_ring(ring.release());
+	}
+	return thread_ring.ring;
+}
+
+void Log::write(spdlog::logger* logger, const LogSite& site, spdlog::log_clock::time_point time, const String& message)
+{
+	String located = message + format(LOG_FORMAT, site.function, site.line);
+	logger->log(time, spdlog::source_loc {}, site.level, located);
+
+	// Errors should show up right away
+	if (site.level >= spdlog::level::err)
+	{
+		logger->flush();
+	}
+}
@@ -4,74 +4,220 @@
 #include "os/os.h"
 
 #include "spdlog/spdlog.h"
-#include "spdlog/logger.h"
-#include "spdlog/pattern_formatter.h"
-#include "spdlog/sinks/ostream_sink.h"
+#include "spdlog/fmt/fmt.h"
 
-struct Log
+#include <atomic>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+// Levels below KRONIC_LOG_LEVEL are compiled out, the values follow spdlog::level::level_enum
+#ifndef KRONIC_LOG_LEVEL
+#ifdef NDEBUG
+#define KRONIC_LOG_LEVEL 2
+#else
+#define KRONIC_LOG_LEVEL 1
+#endif // NDEBUG
+#endif // KRONIC_LOG_LEVEL
+
+// Everything about a log statement that is known at compile time. Its address identifies the statement.
+struct LogSite
 {
-	template <typename... Args>
-	static void info(Args&&... args)
+	spdlog::level::level_enum level;
+	const char* format;
+	const char* function;
+	int line;
+};
+
+// Fixed size single producer single consumer byte ring, one per logging thread
+class LogRing
+{
+public:
+	static constexpr size_t capacity = 64 * 1024;
+	static constexpr size_t alignment = 32;
+
+	using Decoder = void (*)(Byte* payload, const char* format, fmt::memory_buffer& out);
+
+	struct alignas(alignment) Record
+	{
+		const LogSite* site; // Null for padding before the ring wraps around
+		Decoder decode;
+		spdlog::log_clock::time_point time;
+		uint32_t size;
+	};
+	static_assert(sizeof(Record) == alignment, "Records must keep the ring aligned");
+
+	// Blocks while the ring is full
+	Byte* reserve(size_t size);
+	void commit();
+
+	// Consumer side, returns false when empty
+	template <class F>
+	bool consume(F&& function)
 	{
-		spdlog::info(std::forward<Args>(args)...);
+		size_t read = read_position.load(std::memory_order_relaxed);
+		if (read == write_position.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+
+		Record* record = reinterpret_cast<Record*>(data + read % capacity);
+		if (record->site)
+		{
+			function(*record, reinterpret_cast<Byte*>(record + 1));
+		}
+		read_position.store(read + record->size, std::memory_order_release);
+		return true;
 	}
 
+	bool is_empty() const { return read_position.load(std::memory_order_acquire) == write_position.load(std::memory_order_acquire); }
+
+	// Set when the owning thread exits, the backend frees the ring once it is drained
+	std::atomic<bool> is_abandoned = false;
+
+private:
+	alignas(64) std::atomic<size_t> write_position = 0;
+	size_t reserved_position = 0;
+	alignas(64) std::atomic<size_t> read_position = 0;
+
+	alignas(alignment) Byte data[capacity];
+};
+
+struct Log
+{
+	// Call sites only copy their arguments into the calling thread's ring, formatting and sink I/O happen on a
+	// background thread
 	template <typename... Args>
-	static void warn(Args&&... args)
+	static void push(const LogSite& site, Args&&... args)
 	{
-		spdlog::warn(std::forward<Args>(args)...);
+		if (!spdlog::default_logger_raw()->should_log(site.level))
+		{
+			return;
+		}
+
+		if (!is_async())
+		{
+			write(spdlog::default_logger_raw(), site, spdlog::log_clock::now(), format(site.format, args...));
+			return;
+		}
+
+		using Arguments = std::tuple<Stored<Args>...>;
+		static_assert(sizeof(LogRing::Record) + sizeof(Arguments) <= LogRing::capacity / 4, "Log arguments are too large");
+
+		LogRing* ring = get_thread_ring();
+		LogRing::Record* record = reinterpret_cast<LogRing::Record*>(ring->reserve(sizeof(LogRing::Record) + sizeof(Arguments)));
+		record->site = &site;
+		record->decode = &decode<Arguments>;
+		record->time = spdlog::log_clock::now();
+		new (record + 1) Arguments(std::forward<Args>(args)...);
+		ring->commit();
+
+		if (site.level >= spdlog::level::warn)
+		{
+			wake_backend();
+		}
 	}
 
+	// Errors crash right after, so they are formatted and written synchronously once the queue is drained
 	template <typename... Args>
-	static void error(Args&&... args)
+	static void critical(const LogSite& site, Args&&... args)
 	{
-		spdlog::error(std::forward<Args>(args)...);
+		String error_msg = format(site.format, args...);
+
+		flush();
+		write(spdlog::default_logger_raw(), site, spdlog::log_clock::now(), error_msg);
+		spdlog::default_logger_raw()->flush();
+
+		OS::get_singleton()->post_error_message("Kritical Error", error_msg);
+		OS::get_singleton()->crash();
 	}
 
 	template <typename... Args>
-	static void debug(Args&&... args)
+	static String format(const char* format, const Args&... args)
 	{
-		spdlog::debug(std::forward<Args>(args)...);
+		fmt::memory_buffer out;
+		format_to(out, format, args...);
+		return String(out.data(), out.size());
 	}
 
-	// https://github.com/gabime/spdlog/blob/f5492aed12b144df73faf8ae336b3dbc39ebbc38/tests/test_pattern_formatter.cpp#L7
+	// A format string that does not match its arguments is reported in place of the message, like spdlog
+	// does, instead of throwing out of a log statement
 	template <typename... Args>
-	static std::string log_to_str(Args... args)
+	static void format_to(fmt::memory_buffer& out, const char* format, const Args&... args)
 	{
-		std::ostringstream oss;
-		auto oss_sink = std::make_shared<spdlog::sinks::ostream_sink_mt>(oss);
-		spdlog::logger oss_logger("pattern", oss_sink);
+		try
+		{
+			fmt::vformat_to(std::back_inserter(out), std::string_view(format), fmt::make_format_args(args...));
+		}
+		catch (const fmt::format_error& error)
+		{
+			out.clear();
+			fmt::format_to(std::back_inserter(out), "Invalid log format \"{}\": {}", format, error.what());
+		}
+	}
 
-		oss_logger.set_level(spdlog::level::critical);
-		oss_logger.set_formatter(MakeUnique<spdlog::pattern_formatter>("%v", spdlog::pattern_time_type::local));
+	// Blocks until everything logged so far has reached the sinks
+	static void flush();
 
-		oss_logger.critical(std::forward<Args>(args)...);
-		return oss.str();
-	}
+	static void setup();
 
-	template <typename... Args>
-	static void critical(Args&&... args)
-	{
-		String error_msg = log_to_str(std::forward<Args>(args)...);
+private:
+	// Strings passed by pointer may not outlive the call, so they are copied
+	template <class T>
+	using Stored = std::conditional_t<
+	    std::is_same_v<std::decay_t<T>, const char*> || std::is_same_v<std::decay_t<T>, char*> || std::is_same_v<std::decay_t<T>, std::string_view>,
+	    String,
+	    std::decay_t<T>>;
 
-		spdlog::critical(std::forward<Args>(args)...);
-		OS::get_singleton()->post_error_message("Kritical Error", error_msg);
-		OS::get_singleton()->crash();
+	template <class Arguments>
+	static void decode(Byte* payload, const char* format, fmt::memory_buffer& out)
+	{
+		Arguments* arguments = reinterpret_cast<Arguments*>(payload);
+		std::apply([format, &out](const auto&... args)
+		    { format_to(out, format, args...); },
+		    *arguments);
+		arguments->~Arguments();
 	}
 
-	static void setup()
-	{
+	friend class LogBackend;
 
-#ifndef NDEBUG
-		spdlog::set_level(spdlog::level::trace);
-#endif // NDEBUG
-	}
+	static bool is_async();
+	static void wake_backend();
+	static LogRing* get_thread_ring();
+	static void write(spdlog::logger* logger, const LogSite& site, spdlog::log_clock::time_point time, const String& message);
 };
 
 #define LOG_FORMAT " \033[90m({}#L{})\033[39m"
 
-#define DEBUG(fmt, ...) Log::debug(fmt LOG_FORMAT, __VA_ARGS__, __func__, __LINE__)
-#define INFO(fmt, ...) Log::info(fmt LOG_FORMAT, __VA_ARGS__, __func__, __LINE__)
-#define ERR(fmt, ...) Log::error(fmt LOG_FORMAT, __VA_ARGS__, __func__, __LINE__)
-#define WARN(fmt, ...) Log::warn(fmt LOG_FORMAT, __VA_ARGS__, __func__, __LINE__)
-#define CRITICAL(fmt, ...) Log::critical(fmt LOG_FORMAT, __VA_ARGS__, __func__, __LINE__)
+#define KRONIC_LOG(function_name, log_level, fmt, ...)                                          \
+	do                                                                                           \
+	{                                                                                            \
+		static const LogSite kronic_log_site = { log_level, fmt, __func__, __LINE__ };           \
+		Log::function_name(kronic_log_site, ##__VA_ARGS__);                                      \
+	} while (false)
+
+#if KRONIC_LOG_LEVEL <= 1
+#define DEBUG(fmt, ...) KRONIC_LOG(push, spdlog::level::debug, fmt, ##__VA_ARGS__)
+#else
+#define DEBUG(fmt, ...) ((void)0)
+#endif
+
+#if KRONIC_LOG_LEVEL <= 2
+#define INFO(fmt, ...) KRONIC_LOG(push, spdlog::level::info, fmt, ##__VA_ARGS__)
+#else
+#define INFO(fmt, ...) ((void)0)
+#endif
+
+#if KRONIC_LOG_LEVEL <= 3
+#define WARN(fmt, ...) KRONIC_LOG(push, spdlog::level::warn, fmt, ##__VA_ARGS__)
+#else
+#define WARN(fmt, ...) ((void)0)
+#endif
+
+#if KRONIC_LOG_LEVEL <= 4
+#define ERR(fmt, ...) KRONIC_LOG(push, spdlog::level::err, fmt, ##__VA_ARGS__)
+#else
+#define ERR(fmt, ...) ((void)0)
+#endif
+
+#define CRITICAL(fmt, ...) KRONIC_LOG(critical, spdlog::level::critical, fmt, ##__VA_ARGS__)
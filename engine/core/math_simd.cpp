@@ -0,0 +1,320 @@
+#include "math_simd.h"
+
+#include <atomic>
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace MathSIMD
+{
+// Eberly, "A Fast and Accurate Algorithm for Computing SLERP". The last term is scaled by a constant that
+// minimises the error of the truncated series over the shortest path range.
+constexpr float slerp_mu = 1.85298109240830f;
+
+const float slerp_u[slerp_term_count] = {
+	1.0f / (1 * 3),
+	1.0f / (2 * 5),
+	1.0f / (3 * 7),
+	1.0f / (4 * 9),
+	1.0f / (5 * 11),
+	1.0f / (6 * 13),
+	1.0f / (7 * 15),
+	slerp_mu / (8 * 17),
+};
+
+const float slerp_v[slerp_term_count] = {
+	1.0f / 3,
+	2.0f / 5,
+	3.0f / 7,
+	4.0f / 9,
+	5.0f / 11,
+	6.0f / 13,
+	7.0f / 15,
+	slerp_mu * 8.0f / 17,
+};
+
+static void multiply_matrices_scalar(const float* a, size_t a_stride, const float* b, float* out, size_t count)
+{
+	for (size_t i = 0; i < count; i++, a += a_stride, b += 16, out += 16)
+	{
+		float result[16];
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				result[column * 4 + row] = a[row] * b[column * 4] + a[4 + row] * b[column * 4 + 1] + a[8 + row] * b[column * 4 + 2] + a[12 + row] * b[column * 4 + 3];
+			}
+		}
+
+		for (int j = 0; j < 16; j++)
+		{
+			out[j] = result[j];
+		}
+	}
+}
+
+static size_t cull_spheres_scalar(const Frustum& frustum, const SphereArrays& spheres, uint8_t* visible, size_t count)
+{
+	size_t visible_count = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		bool inside = true;
+		for (const float* plane : frustum.planes)
+		{
+			float distance = plane[0] * spheres.x[i] + plane[1] * spheres.y[i] + plane[2] * spheres.z[i] + plane[3];
+			inside &= distance >= -spheres.radius[i];
+		}
+
+		visible[i] = inside;
+		visible_count += inside;
+	}
+	return visible_count;
+}
+
+static size_t cull_aabbs_scalar(const Frustum& frustum, const AABBArrays& boxes, uint8_t* visible, size_t count)
+{
+	size_t visible_count = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		bool inside = true;
+		for (const float* plane : frustum.planes)
+		{
+			// Distance of the corner furthest along the plane normal
+			float distance = plane[0] * boxes.center_x[i] + plane[1] * boxes.center_y[i] + plane[2] * boxes.center_z[i] + plane[3];
+			float radius = std::abs(plane[0]) * boxes.extent_x[i] + std::abs(plane[1]) * boxes.extent_y[i] + std::abs(plane[2]) * boxes.extent_z[i];
+			inside &= distance >= -radius;
+		}
+
+		visible[i] = inside;
+		visible_count += inside;
+	}
+	return visible_count;
+}
+
+static void normalize_quaternions_scalar(const QuaternionArrays& quaternions, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		float x = quaternions.x[i];
+		float y = quaternions.y[i];
+		float z = quaternions.z[i];
+		float w = quaternions.w[i];
+		float length_squared = x * x + y * y + z * z + w * w;
+		if (length_squared > 0.0f)
+		{
+			float inverse_length = 1.0f / std::sqrt(length_squared);
+			quaternions.x[i] = x * inverse_length;
+			quaternions.y[i] = y * inverse_length;
+			quaternions.z[i] = z * inverse_length;
+			quaternions.w[i] = w * inverse_length;
+		}
+		else
+		{
+			quaternions.x[i] = 0.0f;
+			quaternions.y[i] = 0.0f;
+			quaternions.z[i] = 0.0f;
+			quaternions.w[i] = 1.0f;
+		}
+	}
+}
+
+static void slerp_quaternions_scalar(const QuaternionArrays& a, const QuaternionArrays& b, const float* t, const QuaternionArrays& out, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		float cos_theta = a.x[i] * b.x[i] + a.y[i] * b.y[i] + a.z[i] * b.z[i] + a.w[i] * b.w[i];
+		float sign = 1.0f;
+		if (cos_theta < 0.0f)
+		{
+			cos_theta = -cos_theta;
+			sign = -1.0f;
+		}
+
+		float x_minus_one = cos_theta - 1.0f;
+		float to = t[i];
+		float from = 1.0f - to;
+		float to_squared = to * to;
+		float from_squared = from * from;
+
+		// sin(t * theta) / sin(theta) as a nested product in cos(theta) - 1
+		float to_series = 1.0f;
+		float from_series = 1.0f;
+		for (int term = slerp_term_count - 1; term >= 0; term--)
+		{
+			to_series = 1.0f + (slerp_u[term] * to_squared - slerp_v[term]) * x_minus_one * to_series;
+			from_series = 1.0f + (slerp_u[term] * from_squared - slerp_v[term]) * x_minus_one * from_series;
+		}
+
+		float to_weight = sign * to * to_series;
+		float from_weight = from * from_series;
+
+		float x = from_weight * a.x[i] + to_weight * b.x[i];
+		float y = from_weight * a.y[i] + to_weight * b.y[i];
+		float z = from_weight * a.z[i] + to_weight * b.z[i];
+		float w = from_weight * a.w[i] + to_weight * b.w[i];
+		out.x[i] = x;
+		out.y[i] = y;
+		out.z[i] = z;
+		out.w[i] = w;
+	}
+}
+
+const Kernels& get_scalar_kernels()
+{
+	static const Kernels kernels = {
+		multiply_matrices_scalar,
+		cull_spheres_scalar,
+		cull_aabbs_scalar,
+		normalize_quaternions_scalar,
+		slerp_quaternions_scalar,
+	};
+	return kernels;
+}
+
+static Level get_supported_level()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+	if (get_avx2_kernels() && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+	{
+		return Level::AVX2;
+	}
+	if (get_sse4_kernels() && __builtin_cpu_supports("sse4.1"))
+	{
+		return Level::SSE4;
+	}
+#elif defined(_M_X64) || defined(_M_IX86)
+	int registers[4];
+	__cpuid(registers, 0);
+	int max_leaf = registers[0];
+
+	__cpuid(registers, 1);
+	bool has_sse4 = registers[2] & (1 << 19);
+	bool has_fma = registers[2] & (1 << 12);
+
+	// AVX state must also be saved by the OS on context switches
+	bool has_os_avx = (registers[2] & (1 << 27)) && (registers[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+
+	bool has_avx2 = false;
+	if (max_leaf >= 7)
+	{
+		__cpuidex(registers, 7, 0);
+		has_avx2 = registers[1] & (1 << 5);
+	}
+
+	if (get_avx2_kernels() && has_avx2 && has_fma && has_os_avx)
+	{
+		return Level::AVX2;
+	}
+	if (get_sse4_kernels() && has_sse4)
+	{
+		return Level::SSE4;
+	}
+#endif
+	return Level::Scalar;
+}
+
+static const Level supported_level = get_supported_level();
+static std::atomic<Level> current_level = supported_level;
+
+static const Kernels& get_kernels()
+{
+	switch (current_level.load(std::memory_order_relaxed))
+	{
+	case Level::AVX2:
+		return *get_avx2_kernels();
+	case Level::SSE4:
+		return *get_sse4_kernels();
+	default:
+		return get_scalar_kernels();
+	}
+}
+
+Level get_level()
+{
+	return current_level.load(std::memory_order_relaxed);
+}
+
+const char* get_level_name(Level level)
+{
+	switch (level)
+	{
+	case Level::AVX2:
+		return "AVX2";
+	case Level::SSE4:
+		return "SSE4.1";
+	default:
+		return "Scalar";
+	}
+}
+
+void set_level(Level level)
+{
+	current_level.store(level < supported_level ? level : supported_level, std::memory_order_relaxed);
+}
+
+void multiply_matrices(const float* a, const float* b, float* out, size_t count)
+{
+	get_kernels().multiply_matrices(a, 16, b, out, count);
+}
+
+void multiply_matrix(const float* matrix, const float* b, float* out, size_t count)
+{
+	get_kernels().multiply_matrices(matrix, 0, b, out, count);
+}
+
+Frustum extract_frustum(const float* view_projection, ClipDepth depth)
+{
+	// Gribb and Hartmann, the planes are sums and differences of the matrix rows
+	auto row = [view_projection](int index, int component)
+	{ return view_projection[component * 4 + index]; };
+
+	Frustum frustum;
+	for (int component = 0; component < 4; component++)
+	{
+		float w = row(3, component);
+		frustum.planes[0][component] = w + row(0, component);
+		frustum.planes[1][component] = w - row(0, component);
+		frustum.planes[2][component] = w + row(1, component);
+		frustum.planes[3][component] = w - row(1, component);
+		frustum.planes[4][component] = depth == ClipDepth::ZeroToOne ? row(2, component) : w + row(2, component);
+		frustum.planes[5][component] = w - row(2, component);
+	}
+
+	for (float* plane : frustum.planes)
+	{
+		float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		if (length > 0.0f)
+		{
+			for (int component = 0; component < 4; component++)
+			{
+				plane[component] /= length;
+			}
+		}
+	}
+
+	return frustum;
+}
+
+size_t cull_spheres(const Frustum& frustum, const SphereArrays& spheres, uint8_t* visible, size_t count)
+{
+	return get_kernels().cull_spheres(frustum, spheres, visible, count);
+}
+
+size_t cull_aabbs(const Frustum& frustum, const AABBArrays& boxes, uint8_t* visible, size_t count)
+{
+	return get_kernels().cull_aabbs(frustum, boxes, visible, count);
+}
+
+void normalize_quaternions(const QuaternionArrays& quaternions, size_t count)
+{
+	get_kernels().normalize_quaternions(quaternions, count);
+}
+
+void slerp_quaternions(const QuaternionArrays& a, const QuaternionArrays& b, const float* t, const QuaternionArrays& out, size_t count)
+{
+	get_kernels().slerp_quaternions(a, b, t, out, count);
+}
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Batched math over packed float arrays. Kernels are built for SSE4.1 and AVX2 and the best one the CPU
+// supports is picked on first use, so the engine itself does not need a newer baseline than SSE2.
+//
+// This header is included by the kernel translation units, which are compiled with extra instruction sets,
+// so it must not pull in anything with inline functions the rest of the engine also uses.
+namespace MathSIMD
+{
+enum class Level
+{
+	Scalar,
+	SSE4,
+	AVX2
+};
+
+Level get_level();
+const char* get_level_name(Level level);
+
+// Clamped to what the CPU supports, for tests and benchmarks
+void set_level(Level level);
+
+// Matrices are 16 floats, column-major like Matrix4x4, so &matrix[0][0] can be passed straight through.
+// out[i] = a[i] * b[i]. out may alias b but not a.
+void multiply_matrices(const float* a, const float* b, float* out, size_t count);
+
+// out[i] = matrix * b[i], for example the view projection applied to every world transform
+void multiply_matrix(const float* matrix, const float* b, float* out, size_t count);
+
+// Clip space depth range of the projection the frustum is extracted from
+enum class ClipDepth
+{
+	ZeroToOne,
+	MinusOneToOne
+};
+
+// Normalized planes (a, b, c, d), a point is inside when a * x + b * y + c * z + d >= 0 for all six
+struct Frustum
+{
+	float planes[6][4];
+};
+
+Frustum extract_frustum(const float* view_projection, ClipDepth depth = ClipDepth::ZeroToOne);
+
+struct SphereArrays
+{
+	const float* x;
+	const float* y;
+	const float* z;
+	const float* radius;
+};
+
+struct AABBArrays
+{
+	const float* center_x;
+	const float* center_y;
+	const float* center_z;
+	const float* extent_x;
+	const float* extent_y;
+	const float* extent_z;
+};
+
+// Writes 1 to visible for every volume that touches the frustum and 0 otherwise, returns the number visible.
+// Volumes that straddle a corner outside the frustum count as visible.
+size_t cull_spheres(const Frustum& frustum, const SphereArrays& spheres, uint8_t* visible, size_t count);
+size_t cull_aabbs(const Frustum& frustum, const AABBArrays& boxes, uint8_t* visible, size_t count);
+
+struct QuaternionArrays
+{
+	float* x;
+	float* y;
+	float* z;
+	float* w;
+};
+
+// Zero length quaternions become the identity
+void normalize_quaternions(const QuaternionArrays& quaternions, size_t count);
+
+// Shortest path slerp from a to b by t, out may alias a or b. Uses a polynomial in place of the acos and sin
+// calls, accurate to about 3e-5 for unit inputs.
+void slerp_quaternions(const QuaternionArrays& a, const QuaternionArrays& b, const float* t, const QuaternionArrays& out, size_t count);
+
+// Function table per instruction set. SIMD kernels finish the elements left over after their last full vector
+// with the scalar ones.
+struct Kernels
+{
+	void (*multiply_matrices)(const float* a, size_t a_stride, const float* b, float* out, size_t count);
+	size_t (*cull_spheres)(const Frustum& frustum, const SphereArrays& spheres, uint8_t* visible, size_t count);
+	size_t (*cull_aabbs)(const Frustum& frustum, const AABBArrays& boxes, uint8_t* visible, size_t count);
+	void (*normalize_quaternions)(const QuaternionArrays& quaternions, size_t count);
+	void (*slerp_quaternions)(const QuaternionArrays& a, const QuaternionArrays& b, const float* t, const QuaternionArrays& out, size_t count);
+};
+
+const Kernels& get_scalar_kernels();
+
+// Null when the engine was built for a CPU without them
+const Kernels* get_sse4_kernels();
+const Kernels* get_avx2_kernels();
+
+// Slerp polynomial coefficients, see slerp_quaternions
+constexpr int slerp_term_count = 8;
+extern const float slerp_u[slerp_term_count];
+extern const float slerp_v[slerp_term_count];
+
+// Static so that every kernel translation unit keeps its own copy built for its own instruction set
+static inline SphereArrays offset(const SphereArrays& arrays, size_t i)
+{
+	return { arrays.x + i, arrays.y + i, arrays.z + i, arrays.radius + i };
+}
+
+static inline AABBArrays offset(const AABBArrays& arrays, size_t i)
+{
+	return { arrays.center_x + i, arrays.center_y + i, arrays.center_z + i, arrays.extent_x + i, arrays.extent_y + i, arrays.extent_z + i };
+}
+
+static inline QuaternionArrays offset(const QuaternionArrays& arrays, size_t i)
+{
+	return { arrays.x + i, arrays.y + i, arrays.z + i, arrays.w + i };
+}
+};
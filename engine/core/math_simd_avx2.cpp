@@ -0,0 +1,205 @@
+// Compiled with AVX2 and FMA enabled, only called after the CPU was checked for both
+#include "math_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+
+namespace MathSIMD
+{
+static void multiply_matrices_avx2(const float* a, size_t a_stride, const float* b, float* out, size_t count)
+{
+	for (size_t i = 0; i < count; i++, a += a_stride, b += 16, out += 16)
+	{
+		// Both halves of a register hold the same column of a, so two output columns are built at once
+		__m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+		__m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+		__m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+		__m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+
+		for (int column = 0; column < 16; column += 8)
+		{
+			__m256 b_columns = _mm256_loadu_ps(b + column);
+			__m256 result = _mm256_mul_ps(a0, _mm256_permute_ps(b_columns, _MM_SHUFFLE(0, 0, 0, 0)));
+			result = _mm256_fmadd_ps(a1, _mm256_permute_ps(b_columns, _MM_SHUFFLE(1, 1, 1, 1)), result);
+			result = _mm256_fmadd_ps(a2, _mm256_permute_ps(b_columns, _MM_SHUFFLE(2, 2, 2, 2)), result);
+			result = _mm256_fmadd_ps(a3, _mm256_permute_ps(b_columns, _MM_SHUFFLE(3, 3, 3, 3)), result);
+			_mm256_storeu_ps(out + column, result);
+		}
+	}
+}
+
+// Kept local so that nothing from <cmath> gets instantiated with AVX2 code
+static float absolute(float value)
+{
+	return value < 0.0f ? -value : value;
+}
+
+// Writes one byte per lane of the mask and returns how many were set
+static size_t store_mask(int mask, uint8_t* visible)
+{
+	size_t visible_count = 0;
+	for (int lane = 0; lane < 8; lane++)
+	{
+		visible[lane] = (mask >> lane) & 1;
+		visible_count += visible[lane];
+	}
+	return visible_count;
+}
+
+static size_t cull_spheres_avx2(const Frustum& frustum, const SphereArrays& spheres, uint8_t* visible, size_t count)
+{
+	size_t visible_count = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(spheres.x + i);
+		__m256 y = _mm256_loadu_ps(spheres.y + i);
+		__m256 z = _mm256_loadu_ps(spheres.z + i);
+		__m256 negative_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const float* plane : frustum.planes)
+		{
+			__m256 distance = _mm256_fmadd_ps(x, _mm256_set1_ps(plane[0]), _mm256_set1_ps(plane[3]));
+			distance = _mm256_fmadd_ps(y, _mm256_set1_ps(plane[1]), distance);
+			distance = _mm256_fmadd_ps(z, _mm256_set1_ps(plane[2]), distance);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ));
+		}
+
+		visible_count += store_mask(_mm256_movemask_ps(inside), visible + i);
+	}
+
+	return visible_count + get_scalar_kernels().cull_spheres(frustum, offset(spheres, i), visible + i, count - i);
+}
+
+static size_t cull_aabbs_avx2(const Frustum& frustum, const AABBArrays& boxes, uint8_t* visible, size_t count)
+{
+	size_t visible_count = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(boxes.center_x + i);
+		__m256 y = _mm256_loadu_ps(boxes.center_y + i);
+		__m256 z = _mm256_loadu_ps(boxes.center_z + i);
+		__m256 extent_x = _mm256_loadu_ps(boxes.extent_x + i);
+		__m256 extent_y = _mm256_loadu_ps(boxes.extent_y + i);
+		__m256 extent_z = _mm256_loadu_ps(boxes.extent_z + i);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const float* plane : frustum.planes)
+		{
+			__m256 distance = _mm256_fmadd_ps(x, _mm256_set1_ps(plane[0]), _mm256_set1_ps(plane[3]));
+			distance = _mm256_fmadd_ps(y, _mm256_set1_ps(plane[1]), distance);
+			distance = _mm256_fmadd_ps(z, _mm256_set1_ps(plane[2]), distance);
+			distance = _mm256_fmadd_ps(extent_x, _mm256_set1_ps(absolute(plane[0])), distance);
+			distance = _mm256_fmadd_ps(extent_y, _mm256_set1_ps(absolute(plane[1])), distance);
+			distance = _mm256_fmadd_ps(extent_z, _mm256_set1_ps(absolute(plane[2])), distance);
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		visible_count += store_mask(_mm256_movemask_ps(inside), visible + i);
+	}
+
+	return visible_count + get_scalar_kernels().cull_aabbs(frustum, offset(boxes, i), visible + i, count - i);
+}
+
+static void normalize_quaternions_avx2(const QuaternionArrays& quaternions, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(quaternions.x + i);
+		__m256 y = _mm256_loadu_ps(quaternions.y + i);
+		__m256 z = _mm256_loadu_ps(quaternions.z + i);
+		__m256 w = _mm256_loadu_ps(quaternions.w + i);
+
+		__m256 length_squared = _mm256_mul_ps(x, x);
+		length_squared = _mm256_fmadd_ps(y, y, length_squared);
+		length_squared = _mm256_fmadd_ps(z, z, length_squared);
+		length_squared = _mm256_fmadd_ps(w, w, length_squared);
+		__m256 is_zero = _mm256_cmp_ps(length_squared, _mm256_setzero_ps(), _CMP_LE_OQ);
+		__m256 inverse_length = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(length_squared));
+
+		_mm256_storeu_ps(quaternions.x + i, _mm256_blendv_ps(_mm256_mul_ps(x, inverse_length), _mm256_setzero_ps(), is_zero));
+		_mm256_storeu_ps(quaternions.y + i, _mm256_blendv_ps(_mm256_mul_ps(y, inverse_length), _mm256_setzero_ps(), is_zero));
+		_mm256_storeu_ps(quaternions.z + i, _mm256_blendv_ps(_mm256_mul_ps(z, inverse_length), _mm256_setzero_ps(), is_zero));
+		_mm256_storeu_ps(quaternions.w + i, _mm256_blendv_ps(_mm256_mul_ps(w, inverse_length), _mm256_set1_ps(1.0f), is_zero));
+	}
+
+	get_scalar_kernels().normalize_quaternions(offset(quaternions, i), count - i);
+}
+
+static void slerp_quaternions_avx2(const QuaternionArrays& a, const QuaternionArrays& b, const float* t, const QuaternionArrays& out, size_t count)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 sign_bit = _mm256_set1_ps(-0.0f);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 ax = _mm256_loadu_ps(a.x + i);
+		__m256 ay = _mm256_loadu_ps(a.y + i);
+		__m256 az = _mm256_loadu_ps(a.z + i);
+		__m256 aw = _mm256_loadu_ps(a.w + i);
+		__m256 bx = _mm256_loadu_ps(b.x + i);
+		__m256 by = _mm256_loadu_ps(b.y + i);
+		__m256 bz = _mm256_loadu_ps(b.z + i);
+		__m256 bw = _mm256_loadu_ps(b.w + i);
+
+		__m256 cos_theta = _mm256_mul_ps(ax, bx);
+		cos_theta = _mm256_fmadd_ps(ay, by, cos_theta);
+		cos_theta = _mm256_fmadd_ps(az, bz, cos_theta);
+		cos_theta = _mm256_fmadd_ps(aw, bw, cos_theta);
+		__m256 sign = _mm256_and_ps(_mm256_cmp_ps(cos_theta, _mm256_setzero_ps(), _CMP_LT_OQ), sign_bit);
+		cos_theta = _mm256_xor_ps(cos_theta, sign);
+
+		__m256 x_minus_one = _mm256_sub_ps(cos_theta, one);
+		__m256 to = _mm256_loadu_ps(t + i);
+		__m256 from = _mm256_sub_ps(one, to);
+		__m256 to_squared = _mm256_mul_ps(to, to);
+		__m256 from_squared = _mm256_mul_ps(from, from);
+
+		__m256 to_series = one;
+		__m256 from_series = one;
+		for (int term = slerp_term_count - 1; term >= 0; term--)
+		{
+			__m256 u = _mm256_set1_ps(slerp_u[term]);
+			__m256 v = _mm256_set1_ps(slerp_v[term]);
+			to_series = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_fmsub_ps(u, to_squared, v), x_minus_one), to_series, one);
+			from_series = _mm256_fmadd_ps(_mm256_mul_ps(_mm256_fmsub_ps(u, from_squared, v), x_minus_one), from_series, one);
+		}
+
+		// Flipping b onto the same hemisphere as a is folded into the sign of its weight
+		__m256 to_weight = _mm256_xor_ps(_mm256_mul_ps(to, to_series), sign);
+		__m256 from_weight = _mm256_mul_ps(from, from_series);
+
+		_mm256_storeu_ps(out.x + i, _mm256_fmadd_ps(from_weight, ax, _mm256_mul_ps(to_weight, bx)));
+		_mm256_storeu_ps(out.y + i, _mm256_fmadd_ps(from_weight, ay, _mm256_mul_ps(to_weight, by)));
+		_mm256_storeu_ps(out.z + i, _mm256_fmadd_ps(from_weight, az, _mm256_mul_ps(to_weight, bz)));
+		_mm256_storeu_ps(out.w + i, _mm256_fmadd_ps(from_weight, aw, _mm256_mul_ps(to_weight, bw)));
+	}
+
+	get_scalar_kernels().slerp_quaternions(offset(a, i), offset(b, i), t + i, offset(out, i), count - i);
+}
+
+const Kernels* get_avx2_kernels()
+{
+	static const Kernels kernels = {
+		multiply_matrices_avx2,
+		cull_spheres_avx2,
+		cull_aabbs_avx2,
+		normalize_quaternions_avx2,
+		slerp_quaternions_avx2,
+	};
+	return &kernels;
+}
+};
+#else
+namespace MathSIMD
+{
+const Kernels* get_avx2_kernels()
+{
+	return nullptr;
+}
+};
+#endif
@@ -0,0 +1,197 @@
+// Compiled with SSE4.1 enabled, only called after the CPU was checked for it
+#include "math_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <smmintrin.h>
+
+namespace MathSIMD
+{
+static void multiply_matrices_sse4(const float* a, size_t a_stride, const float* b, float* out, size_t count)
+{
+	for (size_t i = 0; i < count; i++, a += a_stride, b += 16, out += 16)
+	{
+		__m128 a0 = _mm_loadu_ps(a);
+		__m128 a1 = _mm_loadu_ps(a + 4);
+		__m128 a2 = _mm_loadu_ps(a + 8);
+		__m128 a3 = _mm_loadu_ps(a + 12);
+
+		// Each output column only reads the same column of b, so out may alias b
+		for (int column = 0; column < 16; column += 4)
+		{
+			__m128 b_column = _mm_loadu_ps(b + column);
+			__m128 result = _mm_mul_ps(a0, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(0, 0, 0, 0)));
+			result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(1, 1, 1, 1))));
+			result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(2, 2, 2, 2))));
+			result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_shuffle_ps(b_column, b_column, _MM_SHUFFLE(3, 3, 3, 3))));
+			_mm_storeu_ps(out + column, result);
+		}
+	}
+}
+
+// Kept local so that nothing from <cmath> gets instantiated with SSE4.1 code
+static float absolute(float value)
+{
+	return value < 0.0f ? -value : value;
+}
+
+// Writes one byte per lane of the mask and returns how many were set
+static size_t store_mask(int mask, uint8_t* visible)
+{
+	visible[0] = mask & 1;
+	visible[1] = (mask >> 1) & 1;
+	visible[2] = (mask >> 2) & 1;
+	visible[3] = (mask >> 3) & 1;
+	return visible[0] + visible[1] + visible[2] + visible[3];
+}
+
+static size_t cull_spheres_sse4(const Frustum& frustum, const SphereArrays& spheres, uint8_t* visible, size_t count)
+{
+	size_t visible_count = 0;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(spheres.x + i);
+		__m128 y = _mm_loadu_ps(spheres.y + i);
+		__m128 z = _mm_loadu_ps(spheres.z + i);
+		__m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const float* plane : frustum.planes)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane[0])), _mm_mul_ps(y, _mm_set1_ps(plane[1])));
+			distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(plane[2])));
+			distance = _mm_add_ps(distance, _mm_set1_ps(plane[3]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+		}
+
+		visible_count += store_mask(_mm_movemask_ps(inside), visible + i);
+	}
+
+	return visible_count + get_scalar_kernels().cull_spheres(frustum, offset(spheres, i), visible + i, count - i);
+}
+
+static size_t cull_aabbs_sse4(const Frustum& frustum, const AABBArrays& boxes, uint8_t* visible, size_t count)
+{
+	size_t visible_count = 0;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(boxes.center_x + i);
+		__m128 y = _mm_loadu_ps(boxes.center_y + i);
+		__m128 z = _mm_loadu_ps(boxes.center_z + i);
+		__m128 extent_x = _mm_loadu_ps(boxes.extent_x + i);
+		__m128 extent_y = _mm_loadu_ps(boxes.extent_y + i);
+		__m128 extent_z = _mm_loadu_ps(boxes.extent_z + i);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const float* plane : frustum.planes)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane[0])), _mm_mul_ps(y, _mm_set1_ps(plane[1])));
+			distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(plane[2])));
+			distance = _mm_add_ps(distance, _mm_set1_ps(plane[3]));
+
+			__m128 radius = _mm_add_ps(_mm_mul_ps(extent_x, _mm_set1_ps(absolute(plane[0]))), _mm_mul_ps(extent_y, _mm_set1_ps(absolute(plane[1]))));
+			radius = _mm_add_ps(radius, _mm_mul_ps(extent_z, _mm_set1_ps(absolute(plane[2]))));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+
+		visible_count += store_mask(_mm_movemask_ps(inside), visible + i);
+	}
+
+	return visible_count + get_scalar_kernels().cull_aabbs(frustum, offset(boxes, i), visible + i, count - i);
+}
+
+static void normalize_quaternions_sse4(const QuaternionArrays& quaternions, size_t count)
+{
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(quaternions.x + i);
+		__m128 y = _mm_loadu_ps(quaternions.y + i);
+		__m128 z = _mm_loadu_ps(quaternions.z + i);
+		__m128 w = _mm_loadu_ps(quaternions.w + i);
+
+		__m128 length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w)));
+		__m128 is_zero = _mm_cmple_ps(length_squared, _mm_setzero_ps());
+		__m128 inverse_length = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(length_squared));
+
+		_mm_storeu_ps(quaternions.x + i, _mm_blendv_ps(_mm_mul_ps(x, inverse_length), _mm_setzero_ps(), is_zero));
+		_mm_storeu_ps(quaternions.y + i, _mm_blendv_ps(_mm_mul_ps(y, inverse_length), _mm_setzero_ps(), is_zero));
+		_mm_storeu_ps(quaternions.z + i, _mm_blendv_ps(_mm_mul_ps(z, inverse_length), _mm_setzero_ps(), is_zero));
+		_mm_storeu_ps(quaternions.w + i, _mm_blendv_ps(_mm_mul_ps(w, inverse_length), _mm_set1_ps(1.0f), is_zero));
+	}
+
+	get_scalar_kernels().normalize_quaternions(offset(quaternions, i), count - i);
+}
+
+static void slerp_quaternions_sse4(const QuaternionArrays& a, const QuaternionArrays& b, const float* t, const QuaternionArrays& out, size_t count)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 sign_bit = _mm_set1_ps(-0.0f);
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 ax = _mm_loadu_ps(a.x + i);
+		__m128 ay = _mm_loadu_ps(a.y + i);
+		__m128 az = _mm_loadu_ps(a.z + i);
+		__m128 aw = _mm_loadu_ps(a.w + i);
+		__m128 bx = _mm_loadu_ps(b.x + i);
+		__m128 by = _mm_loadu_ps(b.y + i);
+		__m128 bz = _mm_loadu_ps(b.z + i);
+		__m128 bw = _mm_loadu_ps(b.w + i);
+
+		__m128 cos_theta = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+		__m128 sign = _mm_and_ps(_mm_cmplt_ps(cos_theta, _mm_setzero_ps()), sign_bit);
+		cos_theta = _mm_xor_ps(cos_theta, sign);
+
+		__m128 x_minus_one = _mm_sub_ps(cos_theta, one);
+		__m128 to = _mm_loadu_ps(t + i);
+		__m128 from = _mm_sub_ps(one, to);
+		__m128 to_squared = _mm_mul_ps(to, to);
+		__m128 from_squared = _mm_mul_ps(from, from);
+
+		__m128 to_series = one;
+		__m128 from_series = one;
+		for (int term = slerp_term_count - 1; term >= 0; term--)
+		{
+			__m128 u = _mm_set1_ps(slerp_u[term]);
+			__m128 v = _mm_set1_ps(slerp_v[term]);
+			to_series = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, to_squared), v), x_minus_one), to_series));
+			from_series = _mm_add_ps(one, _mm_mul_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(u, from_squared), v), x_minus_one), from_series));
+		}
+
+		// Flipping b onto the same hemisphere as a is folded into the sign of its weight
+		__m128 to_weight = _mm_xor_ps(_mm_mul_ps(to, to_series), sign);
+		__m128 from_weight = _mm_mul_ps(from, from_series);
+
+		_mm_storeu_ps(out.x + i, _mm_add_ps(_mm_mul_ps(from_weight, ax), _mm_mul_ps(to_weight, bx)));
+		_mm_storeu_ps(out.y + i, _mm_add_ps(_mm_mul_ps(from_weight, ay), _mm_mul_ps(to_weight, by)));
+		_mm_storeu_ps(out.z + i, _mm_add_ps(_mm_mul_ps(from_weight, az), _mm_mul_ps(to_weight, bz)));
+		_mm_storeu_ps(out.w + i, _mm_add_ps(_mm_mul_ps(from_weight, aw), _mm_mul_ps(to_weight, bw)));
+	}
+
+	get_scalar_kernels().slerp_quaternions(offset(a, i), offset(b, i), t + i, offset(out, i), count - i);
+}
+
+const Kernels* get_sse4_kernels()
+{
+	static const Kernels kernels = {
+		multiply_matrices_sse4,
+		cull_spheres_sse4,
+		cull_aabbs_sse4,
+		normalize_quaternions_sse4,
+		slerp_quaternions_sse4,
+	};
+	return &kernels;
+}
+};
+#else
+namespace MathSIMD
+{
+const Kernels* get_sse4_kernels()
+{
+	return nullptr;
+}
+};
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "common.h"
+
+#include <atomic>
+
+// Unbounded multi producer single consumer queue. Producers push with a single CAS on the head of a
+// linked list and the consumer takes the whole list at once, so neither side ever blocks the other.
+template <class T>
+class MPSCQueue
+{
+public:
+	MPSCQueue() = default;
+	~MPSCQueue()
+	{
+		consume_all([](T&) {});
+	}
+
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	// Safe from any thread
+	void push(T value)
+	{
+		Node* node = new Node { std::move(value), head.load(std::memory_order_relaxed) };
+		while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	// Calls function on everything pushed so far in push order. Only one thread may consume at a time and
+	// values pushed while consuming are left for the next call.
+	template <class F>
+	uint32_t consume_all(F&& function)
+	{
+		Node* node = head.exchange(nullptr, std::memory_order_acquire);
+
+		// The list is newest first
+		Node* reversed = nullptr;
+		while (node)
+		{
+			Node* next = node->next;
+			node->next = reversed;
+			reversed = node;
+			node = next;
+		}
+
+		uint32_t count = 0;
+		while (reversed)
+		{
+			Node* next = reversed->next;
+			function(reversed->value);
+			delete reversed;
+			reversed = next;
+			count++;
+		}
+		return count;
+	}
+
+	bool is_empty() const { return head.load(std::memory_order_acquire) == nullptr; }
+
+private:
+	struct Node
+	{
+		T value;
+		Node* next;
+	};
+
+	std::atomic<Node*> head = nullptr;
+};
@@ -0,0 +1,215 @@
+#include "profiler.h"
+
+#include "os/file_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+namespace
+{
+// Several profilers can exist (tests), so remember which one the buffer belongs to
+thread_local const Profiler* current_profiler = nullptr;
+thread_local void* current_buffer = nullptr;
+
+void write_json_string(OStringStream& out, const char* text)
+{
+	out << '"';
+	for (const char* c = text; *c; c++)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			out << '\\';
+		}
+		out << *c;
+	}
+	out << '"';
+}
+}
+
+void FrameHistogram::record(double frame_ms)
+{
+	if (count == window_size)
+	{
+		double evicted = frames[next];
+		sum -= evicted;
+		buckets[get_bucket_index(evicted)]--;
+	}
+	else
+	{
+		count++;
+	}
+
+	frames[next] = frame_ms;
+	next = (next + 1) % window_size;
+	sum += frame_ms;
+	buckets[get_bucket_index(frame_ms)]++;
+}
+
+double FrameHistogram::get_percentile(double p) const
+{
+	if (count == 0)
+	{
+		return 0.0;
+	}
+
+	Vector<double> sorted(frames, frames + count);
+	size_t index = std::min<size_t>(p * count, count - 1);
+	std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+	return sorted[index];
+}
+
+uint32_t FrameHistogram::get_bucket_index(double frame_ms)
+{
+	return std::min<uint32_t>(std::max(frame_ms, 0.0) / bucket_width_ms, bucket_count - 1);
+}
+
+Profiler* Profiler::get_singleton()
+{
+	static Profiler singleton;
+	return &singleton;
+}
+
+Profiler::Profiler()
+    : start_ns(now_ns())
+    , frame_start_ns(start_ns)
+{
+	gpu_buffer = add_thread_buffer("GPU");
+}
+
+Profiler::~Profiler()
+{
+	if (current_profiler == this)
+	{
+		current_profiler = nullptr;
+		current_buffer = nullptr;
+	}
+}
+
+uint64_t Profiler::now_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::record(const char* name, uint64_t start_ns, uint64_t end_ns)
+{
+	push(get_thread_buffer(), { name, start_ns, end_ns });
+}
+
+void Profiler::record_gpu(const char* name, uint64_t start_ns, uint64_t end_ns)
+{
+	push(gpu_buffer, { name, start_ns, end_ns });
+}
+
+void Profiler::set_thread_name(const char* name)
+{
+	ThreadBuffer* buffer = get_thread_buffer();
+
+	std::lock_guard<std::mutex> lock(buffers_mutex);
+	buffer->name = name;
+}
+
+void Profiler::end_frame()
+{
+	uint64_t frame_end_ns = now_ns();
+	record("Frame", frame_start_ns, frame_end_ns);
+	frame_histogram.record((frame_end_ns - frame_start_ns) / 1e6);
+	frame_start_ns = frame_end_ns;
+}
+
+String Profiler::export_chrome_trace() const
+{
+	// Microseconds, fixed so long sessions do not turn into exponents
+	OStringStream out;
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool is_first = true;
+	auto separate = [&out, &is_first]()
+	{
+		if (!is_first)
+		{
+			out << ",\n";
+		}
+		is_first = false;
+	};
+
+	std::lock_guard<std::mutex> lock(buffers_mutex);
+	for (const Ptr<ThreadBuffer>& buffer : buffers)
+	{
+		separate();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":";
+		write_json_string(out, buffer->name.c_str());
+		out << "}}";
+
+		uint64_t end = buffer->write_index.load(std::memory_order_acquire);
+		uint64_t begin = end > events_per_thread ? end - events_per_thread : 0;
+		for (uint64_t i = begin; i < end; i++)
+		{
+			// The owning thread may be rewriting the slot, a copy is only kept if its sequence did not change
+			const EventSlot& slot = buffer->events[i % events_per_thread];
+			if (slot.sequence.load(std::memory_order_acquire) != i + 1)
+			{
+				continue;
+			}
+			ProfileEvent event = { slot.name.load(std::memory_order_relaxed), slot.start_ns.load(std::memory_order_relaxed), slot.end_ns.load(std::memory_order_relaxed) };
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != i + 1)
+			{
+				continue;
+			}
+
+			// Events may be stamped before the profiler started
+			separate();
+			out << "{\"name\":";
+			write_json_string(out, event.name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+			    << ",\"ts\":" << (int64_t(event.start_ns) - int64_t(start_ns)) / 1e3
+			    << ",\"dur\":" << (int64_t(event.end_ns) - int64_t(event.start_ns)) / 1e3 << "}";
+		}
+	}
+
+	out << "]}\n";
+	return out.str();
+}
+
+bool Profiler::write_chrome_trace(const String& path) const
+{
+	String trace = export_chrome_trace();
+	return FileSystem::write_file(path, trace.data(), trace.size());
+}
+
+Profiler::ThreadBuffer* Profiler::get_thread_buffer()
+{
+	if (current_profiler != this)
+	{
+		current_profiler = this;
+		current_buffer = add_thread_buffer("Thread");
+	}
+	return static_cast<ThreadBuffer*>(current_buffer);
+}
+
+Profiler::ThreadBuffer* Profiler::add_thread_buffer(const String& name)
+{
+	Ptr<ThreadBuffer> buffer = MakeUnique<ThreadBuffer>();
+	buffer->events = MakeUnique<EventSlot[]>(events_per_thread);
+	buffer->name = name;
+
+	std::lock_guard<std::mutex> lock(buffers_mutex);
+	buffer->id = buffers.size();
+	buffers.push_back(std::move(buffer));
+	return buffers.back().get();
+}
+
+void Profiler::push(ThreadBuffer* buffer, const ProfileEvent& event)
+{
+	uint64_t index = buffer->write_index.load(std::memory_order_relaxed);
+	EventSlot& slot = buffer->events[index % events_per_thread];
+	slot.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.name.store(event.name, std::memory_order_relaxed);
+	slot.start_ns.store(event.start_ns, std::memory_order_relaxed);
+	slot.end_ns.store(event.end_ns, std::memory_order_relaxed);
+	slot.sequence.store(index + 1, std::memory_order_release);
+	buffer->write_index.store(index + 1, std::memory_order_release);
+}
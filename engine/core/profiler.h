@@ -0,0 +1,145 @@
+#pragma once
+
+#include "common.h"
+
+#include <atomic>
+#include <mutex>
+
+// Frame profiler. CPU scopes are recorded into per-thread ring buffers, GPU zones are fed in by the renderer
+// from timestamp queries, and everything can be exported as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+// The PROFILE_* markers compile to nothing unless the engine is built with ENABLE_PROFILER.
+
+#ifdef KRONIC_PROFILER
+constexpr bool is_profiler_enabled = true;
+#else
+constexpr bool is_profiler_enabled = false;
+#endif
+
+struct ProfileEvent
+{
+	const char* name;
+	uint64_t start_ns;
+	uint64_t end_ns;
+};
+
+// Frame times of the last window_size frames
+class FrameHistogram
+{
+public:
+	static constexpr uint32_t window_size = 512;
+	static constexpr uint32_t bucket_count = 34;
+	static constexpr double bucket_width_ms = 1.0;
+
+	void record(double frame_ms);
+
+	// p in [0, 1]
+	double get_percentile(double p) const;
+	double get_average() const { return count ? sum / count : 0.0; }
+	uint32_t get_frame_count() const { return count; }
+
+	// Frames in [i, i + 1) ms, the last bucket also holds everything slower
+	uint32_t get_bucket(uint32_t i) const { return buckets[i]; }
+
+private:
+	static uint32_t get_bucket_index(double frame_ms);
+
+	double frames[window_size] = {};
+	uint32_t next = 0;
+	uint32_t count = 0;
+	double sum = 0.0;
+	uint32_t buckets[bucket_count] = {};
+};
+
+class Profiler
+{
+public:
+	static Profiler* get_singleton();
+
+	Profiler();
+	~Profiler();
+
+	static uint64_t now_ns();
+
+	// Only touches the calling thread's buffer
+	void record(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+	// GPU zones go on their own track, must only be called from the render thread
+	void record_gpu(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+	void set_thread_name(const char* name);
+
+	// Closes the frame started by the previous call and adds it to the histogram
+	void end_frame();
+
+	const FrameHistogram& get_frame_histogram() const { return frame_histogram; }
+
+	// Safe while other threads record, events that were overwritten while exporting are skipped
+	String export_chrome_trace() const;
+	bool write_chrome_trace(const String& path) const;
+
+	// Trace timestamps are relative to this
+	uint64_t get_start_ns() const { return start_ns; }
+
+	static constexpr uint32_t events_per_thread = 1 << 15;
+
+private:
+	// Written by the owning thread only. sequence is the write index plus one once the event is complete and
+	// 0 while it is being written, so the exporter can tell a torn or lapped copy apart from a good one.
+	struct EventSlot
+	{
+		std::atomic<uint64_t> sequence = 0;
+		std::atomic<const char*> name = nullptr;
+		std::atomic<uint64_t> start_ns = 0;
+		std::atomic<uint64_t> end_ns = 0;
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t id;
+		String name;
+		Ptr<EventSlot[]> events;
+		std::atomic<uint64_t> write_index = 0;
+	};
+
+	ThreadBuffer* get_thread_buffer();
+	ThreadBuffer* add_thread_buffer(const String& name);
+	static void push(ThreadBuffer* buffer, const ProfileEvent& event);
+
+	const uint64_t start_ns;
+	uint64_t frame_start_ns;
+	FrameHistogram frame_histogram;
+
+	mutable std::mutex buffers_mutex;
+	Vector<Ptr<ThreadBuffer>> buffers;
+	ThreadBuffer* gpu_buffer;
+};
+
+class ProfileScope
+{
+public:
+	ProfileScope(const char* scope_name)
+	    : name(scope_name)
+	    , start_ns(Profiler::now_ns())
+	{
+	}
+
+	~ProfileScope() { Profiler::get_singleton()->record(name, start_ns, Profiler::now_ns()); }
+
+private:
+	const char* name;
+	uint64_t start_ns;
+};
+
+#ifdef KRONIC_PROFILER
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_THREAD(name) Profiler::get_singleton()->set_thread_name(name)
+#define PROFILE_FRAME() Profiler::get_singleton()->end_frame()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+#define PROFILE_FRAME()
+#endif
@@ -1,5 +1,41 @@
 #pragma once
 
+#include "common.h"
+#include "core/profiler.h"
+
+#include <algorithm>
+
+// Renderers fall back to the closest mode the display supports, FIFO is always available
+enum class PresentMode
+{
+	Fifo,
+	FifoRelaxed,
+	Mailbox,
+	Immediate
+};
+
+struct FrameStats
+{
+	// Time the CPU spent blocked waiting for a frame in flight to retire
+	uint64_t last_stall_ns = 0;
+	uint64_t max_stall_ns = 0;
+	double average_stall_ns = 0.0;
+
+	void record_stall(uint64_t stall_ns)
+	{
+		constexpr double smoothing = 0.05;
+
+		last_stall_ns = stall_ns;
+		max_stall_ns = std::max(max_stall_ns, stall_ns);
+		average_stall_ns += (double(stall_ns) - average_stall_ns) * smoothing;
+	}
+
+	// Time from sampling the input a frame was built from until that frame was handed to present
+	FrameHistogram input_latency;
+
+	void record_input_latency(uint64_t latency_ns) { input_latency.record(double(latency_ns) * 1e-6); }
+};
+
 class Renderer
 {
 public:
@@ -7,4 +43,11 @@ public:
 	virtual ~Renderer() = default;
 
 	virtual void draw() = 0;
+	virtual const FrameStats& get_frame_stats() const = 0;
+
+	// When the input the next draw() is built from was sampled, in Profiler::now_ns() time
+	void set_input_time(uint64_t time_ns) { input_time_ns = time_ns; }
+
+protected:
+	uint64_t input_time_ns = 0;
 };
@@ -0,0 +1,81 @@
+#include "simulation.h"
+
+#include "log.h"
+#include "profiler.h"
+
+Simulation::Simulation(double tick_rate, TickFunction tick_function)
+    : tick_rate(tick_rate)
+    , tick_function(std::move(tick_function))
+{
+	if (tick_rate <= 0.0)
+	{
+		throw Exception("Simulation tick rate must be positive");
+	}
+	tick_ns = uint64_t(1e9 / tick_rate);
+}
+
+Simulation::~Simulation()
+{
+	stop();
+}
+
+void Simulation::start()
+{
+	if (thread.joinable())
+	{
+		return;
+	}
+
+	should_stop = false;
+	thread = std::thread([this]()
+	    { loop(); });
+}
+
+void Simulation::stop()
+{
+	if (!thread.joinable())
+	{
+		return;
+	}
+
+	should_stop = true;
+	thread.join();
+}
+
+void Simulation::loop()
+{
+	PROFILE_THREAD("Simulation");
+
+	uint64_t index = 0;
+	uint64_t next_tick_ns = Profiler::now_ns();
+	double delta_s = 1.0 / tick_rate;
+
+	while (!should_stop.load(std::memory_order_relaxed))
+	{
+		waiter.wait_until(next_tick_ns);
+
+		uint64_t tick_start = Profiler::now_ns();
+		{
+			PROFILE_SCOPE("Simulation tick");
+			tick_function({ index, delta_s, next_tick_ns, next_tick_ns + tick_ns });
+		}
+		uint64_t tick_end = Profiler::now_ns();
+
+		index++;
+		next_tick_ns += tick_ns;
+		tick_count.store(index, std::memory_order_relaxed);
+		if (tick_end - tick_start > max_tick_duration_ns.load(std::memory_order_relaxed))
+		{
+			max_tick_duration_ns.store(tick_end - tick_start, std::memory_order_relaxed);
+		}
+
+		// Ticks cost more than they cover, catching up would only fall further behind
+		if (tick_end > next_tick_ns + max_catch_up_ticks * tick_ns)
+		{
+			uint64_t dropped = (tick_end - next_tick_ns) / tick_ns;
+			dropped_tick_count.fetch_add(dropped, std::memory_order_relaxed);
+			next_tick_ns += dropped * tick_ns;
+			WARN("Simulation fell behind, dropped {} ticks", dropped);
+		}
+	}
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "common.h"
+#include "core/frame_pacer.h"
+
+#include <atomic>
+#include <thread>
+
+// Lock free hand-off of simulation state from the simulation thread to the render thread. Every published
+// slot holds the state after a tick together with the state after the tick before it, so the reader always
+// interpolates between two consecutive ticks no matter how many it missed. Three slots rotate between the
+// writer, the reader and the latest published one, neither side ever waits on the other.
+template <class T>
+class SnapshotBuffer
+{
+public:
+	struct Snapshot
+	{
+		T state = {};
+		uint64_t tick = 0;
+
+		// Simulation time the state belongs to, in Profiler::now_ns() time
+		uint64_t time_ns = 0;
+	};
+
+	SnapshotBuffer() = default;
+	SnapshotBuffer(const SnapshotBuffer&) = delete;
+	SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+	// Writer side. Fill in the state returned by begin_write() and hand it over with publish().
+	T& begin_write() { return slots[back].current.state; }
+	void publish(uint64_t tick, uint64_t time_ns)
+	{
+		Slot& slot = slots[back];
+		slot.current.tick = tick;
+		slot.current.time_ns = time_ns;
+
+		// The last published slot is only ever read until it comes back to the writer, which can not happen
+		// before this swap
+		slot.previous = has_published ? slots[last_published].current : slot.current;
+		has_published = true;
+
+		last_published = back;
+		back = latest.exchange(back | fresh_bit, std::memory_order_acq_rel) & index_mask;
+	}
+
+	// Reader side. Takes the newest published snapshots, returns false when nothing was published since the last call.
+	bool acquire()
+	{
+		if (!(latest.load(std::memory_order_relaxed) & fresh_bit))
+		{
+			return false;
+		}
+
+		front = latest.exchange(front, std::memory_order_acq_rel) & index_mask;
+		has_acquired = true;
+		return true;
+	}
+
+	bool has_snapshot() const { return has_acquired; }
+	const Snapshot& get_previous() const { return slots[front].previous; }
+	const Snapshot& get_current() const { return slots[front].current; }
+
+	// How far time_ns is from the previous towards the current snapshot, clamped to [0, 1]
+	float get_alpha(uint64_t time_ns) const
+	{
+		const Snapshot& previous = get_previous();
+		const Snapshot& current = get_current();
+		if (current.time_ns <= previous.time_ns || time_ns >= current.time_ns)
+		{
+			return 1.0f;
+		}
+		if (time_ns <= previous.time_ns)
+		{
+			return 0.0f;
+		}
+		return float(double(time_ns - previous.time_ns) / double(current.time_ns - previous.time_ns));
+	}
+
+private:
+	struct Slot
+	{
+		Snapshot previous;
+		Snapshot current;
+	};
+
+	static constexpr uint32_t fresh_bit = 4;
+	static constexpr uint32_t index_mask = 3;
+
+	Slot slots[3];
+
+	// Writer
+	uint32_t back = 0;
+	uint32_t last_published = 0;
+	bool has_published = false;
+
+	// Reader
+	uint32_t front = 1;
+	bool has_acquired = false;
+
+	std::atomic<uint32_t> latest = 2;
+};
+
+struct SimulationTick
+{
+	uint64_t index;
+
+	// Fixed length of every tick
+	double delta_s;
+
+	// The tick runs once start_ns has passed and computes the state at end_ns, both in Profiler::now_ns() time.
+	// A snapshot published with end_ns can be drawn at the current time by interpolating from the one before it.
+	uint64_t start_ns;
+	uint64_t end_ns;
+};
+
+// Runs a fixed rate tick function on its own thread, independent of the render frame rate. Ticks are scheduled
+// on an absolute timeline, so a late tick is followed by catch-up ticks rather than shifting every later one.
+// When the tick function itself is too slow to keep up, the backlog is dropped instead of spiralling.
+class Simulation
+{
+public:
+	using TickFunction = Function<void(const SimulationTick& tick)>;
+
+	Simulation(double tick_rate, TickFunction tick_function);
+	~Simulation();
+
+	Simulation(const Simulation&) = delete;
+	Simulation& operator=(const Simulation&) = delete;
+
+	void start();
+
+	// Finishes the tick in progress and joins the thread
+	void stop();
+
+	bool is_running() const { return thread.joinable(); }
+	double get_tick_rate() const { return tick_rate; }
+	uint64_t get_tick_ns() const { return tick_ns; }
+
+	uint64_t get_tick_count() const { return tick_count.load(std::memory_order_relaxed); }
+	uint64_t get_dropped_tick_count() const { return dropped_tick_count.load(std::memory_order_relaxed); }
+	uint64_t get_max_tick_duration_ns() const { return max_tick_duration_ns.load(std::memory_order_relaxed); }
+
+	// Ticks that may run back to back to catch up before the rest are dropped
+	static constexpr uint32_t max_catch_up_ticks = 8;
+
+private:
+	void loop();
+
+	double tick_rate;
+	uint64_t tick_ns;
+	TickFunction tick_function;
+
+	std::thread thread;
+	std::atomic<bool> should_stop = false;
+	DeadlineWaiter waiter;
+
+	std::atomic<uint64_t> tick_count = 0;
+	std::atomic<uint64_t> dropped_tick_count = 0;
+	std::atomic<uint64_t> max_tick_duration_ns = 0;
+};
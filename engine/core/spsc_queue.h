@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common.h"
+
+#include <atomic>
+
+// Bounded single producer single consumer ring. Each side only writes its own index, so pushing and popping
+// are a couple of loads and one release store, with no allocation and no locks.
+template <class T, uint32_t capacity>
+class SPSCQueue
+{
+	static_assert((capacity & (capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	SPSCQueue() = default;
+	SPSCQueue(const SPSCQueue&) = delete;
+	SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+	// Producer side, returns false and drops the value when the queue is full
+	bool push(const T& value)
+	{
+		uint32_t write = write_index.load(std::memory_order_relaxed);
+		if (write - read_index.load(std::memory_order_acquire) == capacity)
+		{
+			return false;
+		}
+
+		values[write & (capacity - 1)] = value;
+		write_index.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side, null when empty. The value stays valid until pop().
+	const T* peek() const
+	{
+		uint32_t read = read_index.load(std::memory_order_relaxed);
+		if (read == write_index.load(std::memory_order_acquire))
+		{
+			return nullptr;
+		}
+		return &values[read & (capacity - 1)];
+	}
+
+	void pop() { read_index.store(read_index.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+	// Either side, only a snapshot
+	uint32_t get_size() const { return write_index.load(std::memory_order_acquire) - read_index.load(std::memory_order_acquire); }
+
+private:
+	T values[capacity];
+
+	// On separate cache lines so the two sides do not invalidate each other's
+	alignas(64) std::atomic<uint32_t> write_index = 0;
+	alignas(64) std::atomic<uint32_t> read_index = 0;
+};
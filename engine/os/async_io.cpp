@@ -0,0 +1,341 @@
+#include "async_io.h"
+
+#include <fstream>
+
+#include "core/log.h"
+#include "core/profiler.h"
+
+namespace
+{
+// Portable fallback, a few threads doing blocking reads
+class ThreadPoolIOBackend : public AsyncIOBackend
+{
+public:
+	ThreadPoolIOBackend(uint32_t thread_count, CompletionHandler on_complete)
+	    : on_complete(std::move(on_complete))
+	{
+		for (uint32_t i = 0; i < thread_count; i++)
+		{
+			threads.emplace_back(&ThreadPoolIOBackend::worker_loop, this);
+		}
+	}
+
+	~ThreadPoolIOBackend()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			is_running = false;
+		}
+		condition.notify_all();
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	const char* get_name() const override { return "thread pool"; }
+
+	void queue(IORequest* request) override
+	{
+		staged.push_back(request);
+	}
+
+	void submit() override
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			work.insert(work.end(), staged.begin(), staged.end());
+		}
+		staged.clear();
+		condition.notify_all();
+	}
+
+private:
+	static void read(IORequest* request)
+	{
+		std::ifstream file(request->path.c_str(), std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			request->status = IOStatus::Failed;
+			return;
+		}
+
+		uint64_t file_size = uint64_t(file.tellg());
+		if (request->offset > file_size)
+		{
+			request->status = IOStatus::Failed;
+			return;
+		}
+
+		size_t size = file_size - request->offset;
+		if (request->size > 0)
+		{
+			size = std::min(size, request->size);
+		}
+
+		// Not value initialized, every byte is about to be overwritten
+		request->buffer = Ptr<Byte[]>(new Byte[size]);
+		file.seekg(request->offset);
+		file.read(reinterpret_cast<char*>(request->buffer.get()), size);
+		request->bytes_read = file.gcount();
+		request->status = request->bytes_read == size ? IOStatus::Completed : IOStatus::Failed;
+	}
+
+	void worker_loop()
+	{
+		PROFILE_THREAD("IO");
+
+		while (true)
+		{
+			IORequest* request = nullptr;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this]()
+				               { return !work.empty() || !is_running; });
+				if (work.empty())
+				{
+					return;
+				}
+				request = work.front();
+				work.pop_front();
+			}
+
+			if (!request->is_cancelled.load(std::memory_order_relaxed))
+			{
+				PROFILE_SCOPE("Read");
+				read(request);
+			}
+			on_complete(request);
+		}
+	}
+
+	CompletionHandler on_complete;
+
+	// Only touched by the dispatcher thread
+	Vector<IORequest*> staged;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<IORequest*> work;
+	bool is_running = true;
+	Vector<std::thread> threads;
+};
+}
+
+Ptr<AsyncIOBackend> AsyncIOBackend::create_thread_pool(uint32_t thread_count, CompletionHandler on_complete)
+{
+	return MakeUnique<ThreadPoolIOBackend>(thread_count, std::move(on_complete));
+}
+
+AsyncIO* AsyncIO::get_singleton()
+{
+	static AsyncIO singleton;
+	return &singleton;
+}
+
+AsyncIO::AsyncIO(uint32_t queue_depth, bool use_native)
+    : queue_depth(std::max(queue_depth, 1u))
+{
+	AsyncIOBackend::CompletionHandler on_complete = [this](IORequest* request)
+	{ complete(request); };
+
+	if (use_native)
+	{
+		backend = AsyncIOBackend::create_native(this->queue_depth, on_complete);
+	}
+	if (!backend)
+	{
+		// Reads block the pool threads, so more of them keeps more requests in flight
+		backend = AsyncIOBackend::create_thread_pool(std::clamp(this->queue_depth, 1u, 8u), on_complete);
+	}
+	DEBUG("Async IO is using the {} backend", backend->get_name());
+
+	dispatcher = std::thread(&AsyncIO::dispatch_loop, this);
+}
+
+AsyncIO::~AsyncIO()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		is_running = false;
+		for (std::deque<IORequest*>& queue : queued)
+		{
+			queue.clear();
+		}
+		dispatch_condition.notify_all();
+
+		// The backend reports back to us, so everything it holds has to come back first
+		completion_condition.wait(lock, [this]()
+		                          { return in_flight == 0; });
+	}
+	dispatcher.join();
+	backend.reset();
+}
+
+IOHandle AsyncIO::read(const String& path, IOCallback callback, IOPriority priority, uint64_t offset, size_t size)
+{
+	Ptr<IORequest> request = MakeUnique<IORequest>();
+	request->path = path;
+	request->offset = offset;
+	request->size = size;
+	request->priority = priority;
+	request->callback = std::move(callback);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	IOHandle handle = next_handle++;
+	request->handle = handle;
+	queued[size_t(priority)].push_back(request.get());
+	requests[handle] = std::move(request);
+	dispatch_condition.notify_one();
+
+	return handle;
+}
+
+bool AsyncIO::cancel(IOHandle handle)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = requests.find(handle);
+	if (it == requests.end())
+	{
+		return false;
+	}
+
+	IORequest* request = it->second.get();
+	if (request->is_cancelled.exchange(true))
+	{
+		return true;
+	}
+
+	// Still waiting for a slot, it never has to reach the backend
+	std::deque<IORequest*>& queue = queued[size_t(request->priority)];
+	auto queued_it = std::find(queue.begin(), queue.end(), request);
+	if (queued_it != queue.end())
+	{
+		queue.erase(queued_it);
+		completed.push(request);
+		completion_condition.notify_all();
+		return true;
+	}
+
+	backend->cancel(request);
+	return true;
+}
+
+uint32_t AsyncIO::pump()
+{
+	PROFILE_FUNCTION();
+
+	return completed.consume_all([this](IORequest* finished)
+	                             {
+		Ptr<IORequest> request;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = requests.find(finished->handle);
+			request = std::move(it->second);
+			requests.erase(it);
+		}
+
+		// Checked here rather than in complete() so a successful cancel() always reports a cancellation
+		IOResult result;
+		result.handle = request->handle;
+		result.path = std::move(request->path);
+		result.status = request->is_cancelled.load() ? IOStatus::Cancelled : request->status;
+		if (result.status == IOStatus::Completed)
+		{
+			result.data = std::move(request->buffer);
+			result.size = request->bytes_read;
+		}
+
+		if (request->callback)
+		{
+			request->callback(result);
+		} });
+}
+
+void AsyncIO::wait_idle()
+{
+	while (true)
+	{
+		pump();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		if (requests.empty())
+		{
+			return;
+		}
+		completion_condition.wait(lock, [this]()
+		                          { return !completed.is_empty() || requests.empty(); });
+	}
+}
+
+uint32_t AsyncIO::get_pending_count() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return requests.size();
+}
+
+bool AsyncIO::has_queued() const
+{
+	for (const std::deque<IORequest*>& queue : queued)
+	{
+		if (!queue.empty())
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void AsyncIO::dispatch_loop()
+{
+	PROFILE_THREAD("IO Dispatch");
+
+	Vector<IORequest*> batch;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			dispatch_condition.wait(lock, [this]()
+			                        { return !is_running || (in_flight < queue_depth && has_queued()); });
+			if (!is_running)
+			{
+				return;
+			}
+
+			// Fill every free slot, highest priority first
+			for (size_t priority = size_t(IOPriority::Count); priority-- > 0 && in_flight < queue_depth;)
+			{
+				std::deque<IORequest*>& queue = queued[priority];
+				while (!queue.empty() && in_flight < queue_depth)
+				{
+					batch.push_back(queue.front());
+					queue.pop_front();
+					in_flight++;
+				}
+			}
+		}
+
+		// Everything that became ready together reaches the device in one submission
+		for (IORequest* request : batch)
+		{
+			backend->queue(request);
+		}
+		backend->submit();
+		batch.clear();
+	}
+}
+
+void AsyncIO::complete(IORequest* request)
+{
+	// Nobody is going to look at the data
+	if (request->is_cancelled.load(std::memory_order_relaxed))
+	{
+		request->buffer.reset();
+	}
+	completed.push(request);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	in_flight--;
+	dispatch_condition.notify_one();
+	completion_condition.notify_all();
+}
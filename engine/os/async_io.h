@@ -0,0 +1,136 @@
+#pragma once
+
+#include "common.h"
+
+#include "core/mpsc_queue.h"
+#include "os/file_system.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using IOHandle = uint64_t;
+constexpr IOHandle invalid_io_handle = 0;
+
+enum class IOPriority
+{
+	Low,
+	Normal,
+	High,
+	Count
+};
+
+enum class IOStatus
+{
+	Completed,
+	Failed,
+	Cancelled
+};
+
+struct IOResult
+{
+	IOHandle handle = invalid_io_handle;
+	String path;
+	IOStatus status = IOStatus::Failed;
+	Ptr<Byte[]> data;
+	size_t size = 0;
+
+	FileView view() const { return { data.get(), size }; }
+};
+
+using IOCallback = Function<void(IOResult& result)>;
+
+// A read while it is owned by AsyncIO. Backends fill in everything below the callback.
+struct IORequest
+{
+	IOHandle handle = invalid_io_handle;
+	String path;
+	uint64_t offset = 0;
+	size_t size = 0; // Zero reads up to the end of the file
+	IOPriority priority = IOPriority::Normal;
+	IOCallback callback;
+	std::atomic<bool> is_cancelled = false;
+
+	IOStatus status = IOStatus::Failed;
+	Ptr<Byte[]> buffer;
+	size_t bytes_read = 0;
+	intptr_t native_file = -1;
+};
+
+// Performs the reads for AsyncIO. Requests are handed over from a single dispatcher thread and reported
+// back through the completion handler, from whatever thread the backend finishes them on.
+class AsyncIOBackend
+{
+public:
+	using CompletionHandler = Function<void(IORequest* request)>;
+
+	// Implemented per platform, null when the platform has nothing better than the thread pool
+	static Ptr<AsyncIOBackend> create_native(uint32_t queue_depth, CompletionHandler on_complete);
+	static Ptr<AsyncIOBackend> create_thread_pool(uint32_t thread_count, CompletionHandler on_complete);
+
+	virtual ~AsyncIOBackend() = default;
+
+	virtual const char* get_name() const = 0;
+
+	// Stages a read, nothing reaches the device before submit()
+	virtual void queue(IORequest* request) = 0;
+	virtual void submit() = 0;
+
+	// Best effort and safe from any thread. The request still completes through the handler.
+	virtual void cancel(IORequest* request) { }
+};
+
+// Reads files in the background. Requests wait in per priority queues until the backend has a free slot, so
+// hundreds of reads can be in flight while urgent ones still jump ahead of the rest. Callbacks run on the
+// thread that calls pump(), which is the main thread once per frame.
+class AsyncIO
+{
+public:
+	static AsyncIO* get_singleton();
+
+	// Falls back to a thread pool when use_native is off or the platform backend is unavailable
+	AsyncIO(uint32_t queue_depth = 128, bool use_native = true);
+	~AsyncIO();
+
+	AsyncIO(const AsyncIO&) = delete;
+	AsyncIO(AsyncIO&&) = delete;
+	AsyncIO& operator=(const AsyncIO&) = delete;
+	AsyncIO& operator=(AsyncIO&&) = delete;
+
+	// Reads size bytes from offset, or the rest of the file when size is zero. Safe from any thread.
+	IOHandle read(const String& path, IOCallback callback, IOPriority priority = IOPriority::Normal, uint64_t offset = 0, size_t size = 0);
+
+	// Returns false once the callback has run. Otherwise the callback still runs, with IOStatus::Cancelled.
+	bool cancel(IOHandle handle);
+
+	// Runs the callbacks of every finished request
+	uint32_t pump();
+
+	// Pumps until every request, including ones issued by callbacks, has been delivered
+	void wait_idle();
+
+	uint32_t get_pending_count() const;
+	const char* get_backend_name() const { return backend->get_name(); }
+
+private:
+	void dispatch_loop();
+	void complete(IORequest* request);
+	bool has_queued() const;
+
+	Ptr<AsyncIOBackend> backend;
+	uint32_t queue_depth;
+
+	mutable std::mutex mutex;
+	std::condition_variable dispatch_condition;
+	std::condition_variable completion_condition;
+	std::deque<IORequest*> queued[size_t(IOPriority::Count)];
+	HashMap<IOHandle, Ptr<IORequest>> requests;
+	IOHandle next_handle = 1;
+	uint32_t in_flight = 0;
+	bool is_running = true;
+
+	MPSCQueue<IORequest*> completed;
+	std::thread dispatcher;
+};
@@ -1,15 +1,60 @@
 #include "file_system.h"
 
+#include <atomic>
 #include <filesystem>
 #include <fstream>
+#include <random>
 
 #include "core/log.h"
+#include "os/pak.h"
 
-Optional<FileYAML> FileSystem::read_yaml(const String& path)
+namespace
+{
+Vector<PakArchive>& get_mounted_archives()
+{
+	static Vector<PakArchive> archives;
+	return archives;
+}
+
+// Archive names are relative to the root with forward slashes, so "./assets//a.yaml" finds "assets/a.yaml"
+const PakEntry* find_in_archives(const String& path, const PakArchive** out_archive)
+{
+	Vector<PakArchive>& archives = get_mounted_archives();
+	if (archives.empty())
+	{
+		return nullptr;
+	}
+
+	String name = std::filesystem::path(path).lexically_normal().generic_string();
+	for (auto it = archives.rbegin(); it != archives.rend(); it++)
+	{
+		if (const PakEntry* entry = it->find(name))
+		{
+			*out_archive = &*it;
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+// Lets std::istream based parsers read straight from a view without copying it
+class FileViewStreamBuffer : public std::streambuf
+{
+public:
+	FileViewStreamBuffer(FileView view)
+	{
+		char* begin = const_cast<char*>(view.chars());
+		setg(begin, begin, begin + view.size);
+	}
+};
+
+Optional<FileYAML> parse_yaml(const String& path, FileView view)
 {
 	try
 	{
-		YAML::Node node = YAML::LoadFile(path);
+		FileViewStreamBuffer buffer(view);
+		std::istream stream(&buffer);
+		YAML::Node node = YAML::Load(stream);
 
 		if (node)
 		{
@@ -20,16 +65,58 @@ Optional<FileYAML> FileSystem::read_yaml(const String& path)
 			return yaml_file;
 		}
 	}
-	catch (const Exception* e)
+	catch (const std::exception& e)
 	{
-		ERR("Could not load YAML file from {}. {}", path, e->what());
+		ERR("Could not load YAML file from {}. {}", path, e.what());
 	}
 	return {};
 }
+}
+
+bool FileSystem::mount(const String& archive_path)
+{
+	Optional<PakArchive> archive = PakArchive::open(archive_path);
+	if (!archive)
+	{
+		return false;
+	}
+
+	INFO("Mounted {} with {} files", archive_path, archive->get_entry_count());
+	get_mounted_archives().push_back(std::move(*archive));
+	return true;
+}
+
+void FileSystem::unmount_all()
+{
+	get_mounted_archives().clear();
+}
+
+Optional<FileYAML> FileSystem::read_yaml(const String& path)
+{
+	Optional<FileContents> contents = view_file(path);
+	if (!contents)
+	{
+		return {};
+	}
+	return parse_yaml(path, contents->view());
+}
 
 Optional<File> FileSystem::read_file(const String& path)
 {
-	std::ifstream file(path.c_str(), std::ios::binary);
+	const PakArchive* archive = nullptr;
+	if (const PakEntry* entry = find_in_archives(path, &archive))
+	{
+		File file_obj;
+		file_obj.path = path;
+		file_obj.contents.resize(entry->size);
+		if (!archive->read(*entry, reinterpret_cast<Byte*>(file_obj.contents.data())))
+		{
+			return {};
+		}
+		return file_obj;
+	}
+
+	std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
 
 	if (!file.is_open())
 	{
@@ -37,13 +124,98 @@ Optional<File> FileSystem::read_file(const String& path)
 		return {};
 	}
 
+	// One allocation and one read instead of growing the string a character at a time
 	File file_obj;
 	file_obj.path = path;
-	file_obj.contents = { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+	file_obj.contents.resize(size_t(file.tellg()));
+	file.seekg(0);
+	if (!file.read(file_obj.contents.data(), file_obj.contents.size()))
+	{
+		ERR("Could not read file: {}", path);
+		return {};
+	}
 
 	return file_obj;
 }
 
+Optional<MappedFile> FileSystem::map_file(const String& path, FileAccess access)
+{
+	Optional<MappedFile> mapped = MappedFile::map(path, access);
+	if (!mapped)
+	{
+		ERR("Could not map file: {}", path);
+	}
+	return mapped;
+}
+
+Optional<FileContents> FileSystem::view_file(const String& path, FileAccess access)
+{
+	FileContents contents;
+	contents.path = path;
+
+	const PakArchive* archive = nullptr;
+	if (const PakEntry* entry = find_in_archives(path, &archive))
+	{
+		if (Optional<FileView> view = archive->view(*entry))
+		{
+			contents.contents = *view;
+			return contents;
+		}
+
+		contents.decompressed = Ptr<Byte[]>(new Byte[entry->size]);
+		if (!archive->read(*entry, contents.decompressed.get()))
+		{
+			return {};
+		}
+		contents.contents = { contents.decompressed.get(), entry->size };
+		return contents;
+	}
+
+	Optional<MappedFile> mapped = map_file(path, access);
+	if (!mapped)
+	{
+		return {};
+	}
+	contents.mapped = std::move(*mapped);
+	contents.contents = contents.mapped.view();
+	return contents;
+}
+
+bool FileSystem::write_file(const String& path, const void* data, size_t size)
+{
+	std::error_code error;
+	std::filesystem::path file_path(path);
+	if (file_path.has_parent_path())
+	{
+		std::filesystem::create_directories(file_path.parent_path(), error);
+	}
+
+	// Write next to the destination and rename so readers never observe a partially written file.
+	// The name is unique per process and call so concurrent writers of the same path never share it.
+	static const uint32_t process_tag = std::random_device()();
+	static std::atomic<uint32_t> write_count = 0;
+	std::filesystem::path temp_path = file_path;
+	temp_path += "." + std::to_string(process_tag) + "." + std::to_string(write_count++) + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open() || !file.write(static_cast<const char*>(data), size))
+		{
+			ERR("Could not write file: {}", path);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temp_path, file_path, error);
+	if (error)
+	{
+		ERR("Could not write file: {}. {}", path, error.message());
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+
+	return true;
+}
+
 void FileSystem::set_current_directory_to_root_file(const String& root_file_name)
 {
 	try
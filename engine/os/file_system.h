@@ -4,6 +4,9 @@
 
 #include "yaml-cpp/yaml.h"
 
+#include <algorithm>
+#include <string_view>
+
 struct BaseFile
 {
 	String path;
@@ -19,10 +22,101 @@ struct FileYAML : public BaseFile
 	YAML::Node root;
 };
 
+// Non-owning span over file contents, valid for as long as whatever it was taken from
+struct FileView
+{
+	const Byte* data = nullptr;
+	size_t size = 0;
+
+	const char* chars() const { return reinterpret_cast<const char*>(data); }
+	std::string_view as_string_view() const { return { chars(), size }; }
+	bool is_empty() const { return size == 0; }
+
+	// Clamped to the end of the view
+	FileView subview(size_t offset, size_t count = SIZE_MAX) const
+	{
+		offset = std::min(offset, size);
+		return { data + offset, std::min(count, size - offset) };
+	}
+};
+
+// How a mapping is going to be read, passed on to the OS so it can tune read-ahead
+enum class FileAccess
+{
+	Normal,
+	Sequential,
+	Random
+};
+
+// Read-only view of a whole file mapped into the address space. Unmapped when destroyed.
+// Pages come straight from the OS page cache, so they are shared with every other process mapping the file.
+class MappedFile : public BaseFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { unmap(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+	MappedFile& operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			unmap();
+			path = std::move(other.path);
+			mapped_data = std::exchange(other.mapped_data, nullptr);
+			mapped_size = std::exchange(other.mapped_size, 0);
+		}
+		return *this;
+	}
+
+	// Implemented per platform
+	static Optional<MappedFile> map(const String& path, FileAccess access = FileAccess::Sequential);
+
+	// Starts paging the range in ahead of use
+	void prefetch(size_t offset, size_t size) const;
+
+	// Lets the OS drop the range from this process, it stays in the page cache
+	void release(size_t offset, size_t size) const;
+
+	const Byte* data() const { return mapped_data; }
+	size_t size() const { return mapped_size; }
+	FileView view() const { return { mapped_data, mapped_size }; }
+
+private:
+	void unmap();
+
+	const Byte* mapped_data = nullptr;
+	size_t mapped_size = 0;
+};
+
+// Whole file contents wherever they live. Stored archive entries are borrowed and stay valid until unmount_all,
+// compressed ones are decompressed into memory owned here and loose files are mapped.
+class FileContents : public BaseFile
+{
+public:
+	FileView view() const { return contents; }
+
+private:
+	friend struct FileSystem;
+
+	MappedFile mapped;
+	Ptr<Byte[]> decompressed;
+	FileView contents;
+};
+
 struct FileSystem
 {
+	// Archives are searched newest first before falling back to loose files. Mount before anything reads.
+	static bool mount(const String& archive_path);
+	static void unmount_all();
+
 	static Optional<FileYAML> read_yaml(const String& path);
 	static Optional<File> read_file(const String& path);
+	static Optional<MappedFile> map_file(const String& path, FileAccess access = FileAccess::Sequential);
+	static Optional<FileContents> view_file(const String& path, FileAccess access = FileAccess::Sequential);
+	static bool write_file(const String& path, const void* data, size_t size);
 
 	static void set_current_directory_to_root_file(const String& root_file_name);
 	static String get_current_directory();
@@ -0,0 +1,201 @@
+#include "file_watcher.h"
+
+#include <condition_variable>
+#include <filesystem>
+
+#include "core/log.h"
+#include "core/profiler.h"
+
+namespace
+{
+// Portable fallback that rescans the directories for new modification times
+class PollingFileWatcherBackend : public FileWatcherBackend
+{
+public:
+	PollingFileWatcherBackend(uint32_t interval_ms)
+	    : interval(interval_ms)
+	{
+	}
+
+	const char* get_name() const override { return "polling"; }
+
+	bool add_directory(const String& directory) override
+	{
+		std::error_code error;
+		if (!std::filesystem::is_directory(directory, error))
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		directories.push_back(directory);
+		scan(directory, nullptr);
+		return true;
+	}
+
+	void wait(uint32_t timeout_ms, Vector<String>& changed) override
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]()
+		                   { return is_woken; });
+		is_woken = false;
+
+		auto now = std::chrono::steady_clock::now();
+		if (now - last_scan < interval)
+		{
+			return;
+		}
+		last_scan = now;
+
+		for (const String& directory : directories)
+		{
+			scan(directory, &changed);
+		}
+	}
+
+	void wake() override
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			is_woken = true;
+		}
+		condition.notify_all();
+	}
+
+private:
+	// Needs mutex. Only records times when changed is null.
+	void scan(const String& directory, Vector<String>* changed)
+	{
+		std::error_code error;
+		for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+		{
+			if (!it->is_regular_file(error))
+			{
+				continue;
+			}
+
+			std::filesystem::file_time_type time = it->last_write_time(error);
+			String path = it->path().generic_string();
+			auto [known, is_new] = write_times.try_emplace(path, time);
+			if (changed && (is_new || known->second != time))
+			{
+				changed->push_back(path);
+			}
+			known->second = time;
+		}
+	}
+
+	std::chrono::milliseconds interval;
+	std::chrono::steady_clock::time_point last_scan;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool is_woken = false;
+	Vector<String> directories;
+	HashMap<String, std::filesystem::file_time_type> write_times;
+};
+
+String normalize_directory(const String& directory)
+{
+	String normalized = std::filesystem::path(directory).lexically_normal().generic_string();
+	while (normalized.size() > 1 && normalized.back() == '/')
+	{
+		normalized.pop_back();
+	}
+	return normalized;
+}
+}
+
+Ptr<FileWatcherBackend> FileWatcherBackend::create_polling(uint32_t interval_ms)
+{
+	return MakeUnique<PollingFileWatcherBackend>(interval_ms);
+}
+
+FileWatcher::FileWatcher(uint32_t debounce_ms, bool use_native)
+    : debounce(debounce_ms)
+{
+	if (use_native)
+	{
+		backend = FileWatcherBackend::create_native();
+	}
+	if (!backend)
+	{
+		backend = FileWatcherBackend::create_polling(250);
+	}
+	DEBUG("File watcher is using the {} backend", backend->get_name());
+
+	thread = std::thread(&FileWatcher::watch_loop, this);
+}
+
+FileWatcher::~FileWatcher()
+{
+	is_running = false;
+	backend->wake();
+	thread.join();
+}
+
+bool FileWatcher::watch(const String& directory, Callback callback)
+{
+	String prefix = normalize_directory(directory);
+	if (!backend->add_directory(prefix))
+	{
+		ERR("Could not watch {}", directory);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	watches.push_back({ prefix, std::move(callback) });
+	return true;
+}
+
+void FileWatcher::watch_loop()
+{
+	PROFILE_THREAD("File Watcher");
+
+	// Reported once nothing has touched them for the debounce time
+	HashMap<String, Clock::time_point> settling;
+	Vector<String> changed;
+	Vector<Callback> callbacks;
+
+	while (is_running)
+	{
+		uint32_t timeout_ms = settling.empty() ? 250 : std::max<uint32_t>(debounce.count(), 1);
+		backend->wait(timeout_ms, changed);
+
+		Clock::time_point now = Clock::now();
+		for (String& path : changed)
+		{
+			settling[std::move(path)] = now + debounce;
+		}
+		changed.clear();
+
+		for (auto it = settling.begin(); it != settling.end();)
+		{
+			if (it->second > now)
+			{
+				it++;
+				continue;
+			}
+
+			// Copied out so callbacks can add watches of their own
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (const Watch& watch : watches)
+				{
+					const String& path = it->first;
+					if (path.compare(0, watch.prefix.size(), watch.prefix) == 0 && (path.size() == watch.prefix.size() || path[watch.prefix.size()] == '/'))
+					{
+						callbacks.push_back(watch.callback);
+					}
+				}
+			}
+			for (const Callback& callback : callbacks)
+			{
+				callback(it->first);
+			}
+			callbacks.clear();
+
+			it = settling.erase(it);
+		}
+	}
+}
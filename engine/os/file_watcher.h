@@ -0,0 +1,71 @@
+#pragma once
+
+#include "common.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+// Reports files that were written below the watched directories. Paths use forward slashes and start with
+// the directory they were found under, so watching "assets" reports "assets/shaders/shader.frag".
+class FileWatcherBackend
+{
+public:
+	// Implemented per platform, null when the platform has nothing better than polling
+	static Ptr<FileWatcherBackend> create_native();
+	static Ptr<FileWatcherBackend> create_polling(uint32_t interval_ms);
+
+	virtual ~FileWatcherBackend() = default;
+
+	virtual const char* get_name() const = 0;
+
+	// Watches the directory and everything below it, including subdirectories created later
+	virtual bool add_directory(const String& directory) = 0;
+
+	// Blocks for at most timeout_ms and appends whatever changed in the meantime
+	virtual void wait(uint32_t timeout_ms, Vector<String>& changed) = 0;
+
+	// Makes a blocked wait() return early. Safe from any thread.
+	virtual void wake() = 0;
+};
+
+// Watches directories on a background thread. Editors tend to save in bursts of writes and renames, so a
+// path is only reported once it has been quiet for the debounce time. Callbacks run on the watcher thread.
+class FileWatcher
+{
+public:
+	using Callback = Function<void(const String& path)>;
+
+	FileWatcher(uint32_t debounce_ms = 50, bool use_native = true);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher(FileWatcher&&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	FileWatcher& operator=(FileWatcher&&) = delete;
+
+	bool watch(const String& directory, Callback callback);
+
+	const char* get_backend_name() const { return backend->get_name(); }
+
+private:
+	void watch_loop();
+
+	struct Watch
+	{
+		String prefix;
+		Callback callback;
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	Ptr<FileWatcherBackend> backend;
+	std::chrono::milliseconds debounce;
+
+	std::mutex mutex;
+	Vector<Watch> watches;
+
+	std::atomic<bool> is_running = true;
+	std::thread thread;
+};
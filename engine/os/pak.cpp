@@ -0,0 +1,215 @@
+#include "pak.h"
+
+#include <cstring>
+
+#include "core/compression.h"
+#include "core/hash.h"
+#include "core/log.h"
+
+namespace
+{
+uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+}
+
+uint64_t PakArchive::hash_name(std::string_view name)
+{
+	return Hash::fnv1a64(name.data(), name.size());
+}
+
+Optional<PakArchive> PakArchive::open(const String& path)
+{
+	// Lookups jump around the index and entries are read in any order
+	Optional<MappedFile> mapped = MappedFile::map(path, FileAccess::Random);
+	if (!mapped)
+	{
+		return {};
+	}
+
+	FileView view = mapped->view();
+	if (view.size < sizeof(PakHeader))
+	{
+		ERR("{} is too small to be an archive", path);
+		return {};
+	}
+
+	PakHeader header;
+	std::memcpy(&header, view.data, sizeof(header));
+	if (std::memcmp(header.magic, pak_magic, sizeof(pak_magic)) != 0 || header.version != pak_version)
+	{
+		ERR("{} is not a version {} archive", path, pak_version);
+		return {};
+	}
+
+	uint64_t index_size = uint64_t(header.entry_count) * sizeof(PakEntry);
+	if (header.index_offset % alignof(PakEntry) != 0 || header.index_offset > view.size || index_size > view.size - header.index_offset || header.names_offset > view.size || header.names_size > view.size - header.names_offset)
+	{
+		ERR("{} has a corrupt index", path);
+		return {};
+	}
+
+	PakArchive archive;
+	archive.entries = reinterpret_cast<const PakEntry*>(view.data + header.index_offset);
+	archive.entry_count = header.entry_count;
+	archive.names = view.chars() + header.names_offset;
+
+	// Validated once here so reads never have to
+	for (uint32_t i = 0; i < archive.entry_count; i++)
+	{
+		const PakEntry& entry = archive.entries[i];
+		if (entry.offset > view.size || entry.stored_size > view.size - entry.offset || uint64_t(entry.name_offset) + entry.name_size > header.names_size || (entry.compression == PakCompression::None && entry.stored_size != entry.size) || (i > 0 && archive.entries[i - 1].hash > entry.hash))
+		{
+			ERR("{} has a corrupt entry at {}", path, i);
+			return {};
+		}
+	}
+
+	archive.file = std::move(*mapped);
+	return archive;
+}
+
+const PakEntry* PakArchive::find(std::string_view name) const
+{
+	uint64_t hash = hash_name(name);
+	const PakEntry* end = entries + entry_count;
+	const PakEntry* it = std::lower_bound(entries, end, hash, [](const PakEntry& entry, uint64_t hash)
+	                                      { return entry.hash < hash; });
+
+	// Colliding hashes sit next to each other
+	for (; it != end && it->hash == hash; it++)
+	{
+		if (get_name(*it) == name)
+		{
+			return it;
+		}
+	}
+	return nullptr;
+}
+
+Optional<FileView> PakArchive::view(const PakEntry& entry) const
+{
+	if (entry.compression != PakCompression::None)
+	{
+		return {};
+	}
+	return file.view().subview(entry.offset, entry.size);
+}
+
+bool PakArchive::read(const PakEntry& entry, Byte* out) const
+{
+	FileView stored = file.view().subview(entry.offset, entry.stored_size);
+	switch (entry.compression)
+	{
+	case PakCompression::None:
+		if (stored.size > 0)
+		{
+			std::memcpy(out, stored.data, stored.size);
+		}
+		return true;
+	case PakCompression::Block:
+		if (!Compression::decompress_block(stored.data, stored.size, out, entry.size))
+		{
+			ERR("Could not decompress {} from {}", get_name(entry), get_path());
+			return false;
+		}
+		return true;
+	}
+
+	ERR("{} in {} uses an unknown compression", get_name(entry), get_path());
+	return false;
+}
+
+void PakWriter::add(const String& name, const void* data, size_t size, bool compress)
+{
+	PendingEntry entry;
+	entry.name = name;
+	entry.hash = PakArchive::hash_name(name);
+	entry.size = size;
+	entry.compression = PakCompression::None;
+
+	if (compress)
+	{
+		Compression::compress_block(data, size, entry.data);
+		if (entry.data.size() <= size - size / 8)
+		{
+			entry.compression = PakCompression::Block;
+		}
+		else
+		{
+			entry.data.clear();
+		}
+	}
+	if (entry.compression == PakCompression::None)
+	{
+		const Byte* bytes = static_cast<const Byte*>(data);
+		entry.data.assign(bytes, bytes + size);
+	}
+
+	// Adding the same name again replaces it
+	for (PendingEntry& existing : pending)
+	{
+		if (existing.name == name)
+		{
+			existing = std::move(entry);
+			return;
+		}
+	}
+	pending.push_back(std::move(entry));
+}
+
+bool PakWriter::write(const String& path) const
+{
+	Vector<const PendingEntry*> sorted;
+	for (const PendingEntry& entry : pending)
+	{
+		sorted.push_back(&entry);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const PendingEntry* a, const PendingEntry* b)
+	          { return a->hash != b->hash ? a->hash < b->hash : a->name < b->name; });
+
+	Vector<PakEntry> index;
+	String names;
+	uint64_t offset = pak_alignment;
+	for (const PendingEntry* pending_entry : sorted)
+	{
+		PakEntry entry = {};
+		entry.hash = pending_entry->hash;
+		entry.offset = offset;
+		entry.stored_size = pending_entry->data.size();
+		entry.size = pending_entry->size;
+		entry.name_offset = uint32_t(names.size());
+		entry.name_size = uint32_t(pending_entry->name.size());
+		entry.compression = pending_entry->compression;
+		index.push_back(entry);
+
+		names += pending_entry->name;
+		offset = align_up(offset + entry.stored_size, pak_alignment);
+	}
+
+	PakHeader header = {};
+	std::memcpy(header.magic, pak_magic, sizeof(pak_magic));
+	header.version = pak_version;
+	header.entry_count = uint32_t(index.size());
+	header.names_size = uint32_t(names.size());
+	header.index_offset = offset;
+	header.names_offset = offset + index.size() * sizeof(PakEntry);
+
+	Vector<Byte> archive(header.names_offset + names.size());
+	std::memcpy(archive.data(), &header, sizeof(header));
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		if (!sorted[i]->data.empty())
+		{
+			std::memcpy(archive.data() + index[i].offset, sorted[i]->data.data(), sorted[i]->data.size());
+		}
+	}
+	if (!index.empty())
+	{
+		std::memcpy(archive.data() + header.index_offset, index.data(), index.size() * sizeof(PakEntry));
+	}
+	std::memcpy(archive.data() + header.names_offset, names.data(), names.size());
+
+	return FileSystem::write_file(path, archive.data(), archive.size());
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "common.h"
+
+#include "os/file_system.h"
+
+#include <string_view>
+
+// .kpak layout: header, entries each starting on a 4 KiB boundary, then the index sorted by name hash and the
+// names it points into. Everything is little endian and read in place from a mapping.
+constexpr char pak_magic[4] = { 'K', 'P', 'A', 'K' };
+constexpr uint32_t pak_version = 1;
+constexpr uint64_t pak_alignment = 4096;
+
+enum class PakCompression : uint32_t
+{
+	None,
+	Block
+};
+
+struct PakHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t entry_count;
+	uint32_t names_size;
+	uint64_t index_offset;
+	uint64_t names_offset;
+};
+static_assert(sizeof(PakHeader) == 32);
+
+struct PakEntry
+{
+	uint64_t hash;
+	uint64_t offset;
+	uint64_t stored_size;
+	uint64_t size;
+	uint32_t name_offset;
+	uint32_t name_size;
+	PakCompression compression;
+	uint32_t reserved;
+};
+static_assert(sizeof(PakEntry) == 48);
+
+// Read-only archive kept mapped for as long as it lives. Lookups binary search the index without allocating.
+class PakArchive
+{
+public:
+	static Optional<PakArchive> open(const String& path);
+	static uint64_t hash_name(std::string_view name);
+
+	// Names are relative to the root directory with forward slashes, like "assets/konfig.yaml"
+	const PakEntry* find(std::string_view name) const;
+
+	// Points straight into the mapping for stored entries, empty for compressed ones
+	Optional<FileView> view(const PakEntry& entry) const;
+
+	// Copies or decompresses the entry into out, which must hold entry.size bytes
+	bool read(const PakEntry& entry, Byte* out) const;
+
+	std::string_view get_name(const PakEntry& entry) const { return { names + entry.name_offset, entry.name_size }; }
+	uint32_t get_entry_count() const { return entry_count; }
+	const String& get_path() const { return file.path; }
+
+private:
+	MappedFile file;
+	const PakEntry* entries = nullptr;
+	uint32_t entry_count = 0;
+	const char* names = nullptr;
+};
+
+// Builds an archive in memory and writes it in one go. Used by the kpak tool.
+class PakWriter
+{
+public:
+	// Compressed entries are stored raw anyway when compression does not save at least an eighth
+	void add(const String& name, const void* data, size_t size, bool compress = false);
+
+	bool write(const String& path) const;
+
+	uint32_t get_entry_count() const { return pending.size(); }
+
+private:
+	struct PendingEntry
+	{
+		String name;
+		uint64_t hash;
+		Vector<Byte> data;
+		uint64_t size;
+		PakCompression compression;
+	};
+
+	Vector<PendingEntry> pending;
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "common.h"
+#include "core/math.h"
+
+#include <cfloat>
+
+// Empty until something is added
+struct AABB
+{
+	Vector3 min = Vector3(FLT_MAX);
+	Vector3 max = Vector3(-FLT_MAX);
+
+	bool is_empty() const { return min.x > max.x; }
+	Vector3 get_center() const { return (min + max) * 0.5f; }
+	Vector3 get_extent() const { return (max - min) * 0.5f; }
+
+	void add(const Vector3& point)
+	{
+		min = Math::min(min, point);
+		max = Math::max(max, point);
+	}
+
+	void add(const AABB& box)
+	{
+		min = Math::min(min, box.min);
+		max = Math::max(max, box.max);
+	}
+
+	float get_surface_area() const
+	{
+		if (is_empty())
+		{
+			return 0.0f;
+		}
+		Vector3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool overlaps(const AABB& other) const
+	{
+		return min.x <= other.max.x && max.x >= other.min.x && min.y <= other.max.y && max.y >= other.min.y && min.z <= other.max.z && max.z >= other.min.z;
+	}
+};
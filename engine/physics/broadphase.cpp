@@ -0,0 +1,136 @@
+#include "broadphase.h"
+
+#include "core/profiler.h"
+
+#include <algorithm>
+
+ProxyID Broadphase::add(const AABB& bounds, uint32_t layer, uint32_t mask)
+{
+	ProxyID proxy;
+	if (!free_proxies.empty())
+	{
+		proxy = free_proxies.back();
+		free_proxies.pop_back();
+	}
+	else
+	{
+		proxy = min_x.size();
+		min_x.push_back(0.0f);
+		min_y.push_back(0.0f);
+		min_z.push_back(0.0f);
+		max_x.push_back(0.0f);
+		max_y.push_back(0.0f);
+		max_z.push_back(0.0f);
+		layers.push_back(0);
+		masks.push_back(0);
+		is_alive.push_back(false);
+	}
+
+	is_alive[proxy] = true;
+	layers[proxy] = layer;
+	masks[proxy] = mask;
+	move(proxy, bounds);
+
+	// Appended at the end, the next update sorts it into place
+	order.push_back(proxy);
+	return proxy;
+}
+
+void Broadphase::remove(ProxyID proxy)
+{
+	if (proxy >= is_alive.size() || !is_alive[proxy])
+	{
+		return;
+	}
+
+	is_alive[proxy] = false;
+	released_proxies.push_back(proxy);
+	has_removed = true;
+}
+
+void Broadphase::move(ProxyID proxy, const AABB& bounds)
+{
+	min_x[proxy] = bounds.min.x;
+	min_y[proxy] = bounds.min.y;
+	min_z[proxy] = bounds.min.z;
+	max_x[proxy] = bounds.max.x;
+	max_y[proxy] = bounds.max.y;
+	max_z[proxy] = bounds.max.z;
+}
+
+void Broadphase::update()
+{
+	PROFILE_FUNCTION();
+
+	if (has_removed)
+	{
+		order.erase(std::remove_if(order.begin(), order.end(), [this](ProxyID proxy)
+		                { return !is_alive[proxy]; }),
+		    order.end());
+		has_removed = false;
+	}
+
+	// Insertion sort, proxies only move a few places between updates
+	for (size_t i = 1; i < order.size(); i++)
+	{
+		ProxyID proxy = order[i];
+		float key = min_x[proxy];
+		size_t j = i;
+		for (; j > 0 && min_x[order[j - 1]] > key; j--)
+		{
+			order[j] = order[j - 1];
+		}
+		order[j] = proxy;
+	}
+
+	size_t count = order.size();
+	sorted_min_x.resize(count);
+	sorted_max_x.resize(count);
+	sorted_min_y.resize(count);
+	sorted_max_y.resize(count);
+	sorted_min_z.resize(count);
+	sorted_max_z.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		ProxyID proxy = order[i];
+		sorted_min_x[i] = min_x[proxy];
+		sorted_max_x[i] = max_x[proxy];
+		sorted_min_y[i] = min_y[proxy];
+		sorted_max_y[i] = max_y[proxy];
+		sorted_min_z[i] = min_z[proxy];
+		sorted_max_z[i] = max_z[proxy];
+	}
+
+	std::swap(pairs, previous_pairs);
+	pairs.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		float end_x = sorted_max_x[i];
+		for (size_t j = i + 1; j < count && sorted_min_x[j] <= end_x; j++)
+		{
+			if (sorted_min_y[j] > sorted_max_y[i] || sorted_max_y[j] < sorted_min_y[i] || sorted_min_z[j] > sorted_max_z[i] || sorted_max_z[j] < sorted_min_z[i])
+			{
+				continue;
+			}
+
+			ProxyID a = order[i];
+			ProxyID b = order[j];
+			if (!(layers[a] & masks[b]) || !(layers[b] & masks[a]))
+			{
+				continue;
+			}
+
+			pairs.push_back(a < b ? BroadphasePair { a, b } : BroadphasePair { b, a });
+		}
+	}
+	std::sort(pairs.begin(), pairs.end());
+
+	added_pairs.clear();
+	removed_pairs.clear();
+	std::set_difference(pairs.begin(), pairs.end(), previous_pairs.begin(), previous_pairs.end(), std::back_inserter(added_pairs));
+	std::set_difference(previous_pairs.begin(), previous_pairs.end(), pairs.begin(), pairs.end(), std::back_inserter(removed_pairs));
+
+	// Their last pairs have now been reported as removed
+	free_proxies.insert(free_proxies.end(), released_proxies.begin(), released_proxies.end());
+	released_proxies.clear();
+}
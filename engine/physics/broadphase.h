@@ -0,0 +1,82 @@
+#pragma once
+
+#include "common.h"
+#include "physics/aabb.h"
+
+using ProxyID = uint32_t;
+constexpr ProxyID invalid_proxy = ~0u;
+
+struct BroadphasePair
+{
+	// a < b
+	ProxyID a;
+	ProxyID b;
+
+	bool operator==(const BroadphasePair& other) const { return a == other.a && b == other.b; }
+	bool operator<(const BroadphasePair& other) const { return a < other.a || (a == other.a && b < other.b); }
+};
+
+// Overlap pairs between moving boxes (players, projectiles, props), found by sort and sweep along x.
+//
+// Bounds live in arrays indexed by proxy. Every update re-sorts the proxies by their minimum x with an
+// insertion sort, which is close to linear because objects move little between ticks, copies the bounds
+// into sorted arrays and sweeps them, so only proxies whose x intervals overlap are ever compared.
+// The pairs are diffed against the previous update, so callers can react to overlaps starting and ending
+// instead of rescanning every pair.
+//
+// Layers filter pairs that never matter, like projectiles against projectiles: two proxies pair up only when
+// each one's layer is in the other's mask.
+class Broadphase
+{
+public:
+	Broadphase() = default;
+
+	ProxyID add(const AABB& bounds, uint32_t layer = 1, uint32_t mask = ~0u);
+
+	// The id is not handed out again before the next update, so pairs of the removed proxy are reported
+	// as removed rather than mistaken for pairs of a new one
+	void remove(ProxyID proxy);
+
+	void move(ProxyID proxy, const AABB& bounds);
+
+	// Finds the pairs for the current bounds
+	void update();
+
+	// Sorted, as of the last update
+	const Vector<BroadphasePair>& get_pairs() const { return pairs; }
+	const Vector<BroadphasePair>& get_added_pairs() const { return added_pairs; }
+	const Vector<BroadphasePair>& get_removed_pairs() const { return removed_pairs; }
+
+	uint32_t get_proxy_count() const { return order.size(); }
+
+private:
+	Vector<float> min_x;
+	Vector<float> min_y;
+	Vector<float> min_z;
+	Vector<float> max_x;
+	Vector<float> max_y;
+	Vector<float> max_z;
+	Vector<uint32_t> layers;
+	Vector<uint32_t> masks;
+	Vector<uint8_t> is_alive;
+
+	Vector<ProxyID> free_proxies;
+	Vector<ProxyID> released_proxies;
+
+	// Live proxies by minimum x, kept from update to update so sorting starts nearly sorted
+	Vector<ProxyID> order;
+	bool has_removed = false;
+
+	// Bounds gathered in sweep order
+	Vector<float> sorted_min_x;
+	Vector<float> sorted_max_x;
+	Vector<float> sorted_min_y;
+	Vector<float> sorted_max_y;
+	Vector<float> sorted_min_z;
+	Vector<float> sorted_max_z;
+
+	Vector<BroadphasePair> pairs;
+	Vector<BroadphasePair> previous_pairs;
+	Vector<BroadphasePair> added_pairs;
+	Vector<BroadphasePair> removed_pairs;
+};
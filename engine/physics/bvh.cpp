@@ -0,0 +1,469 @@
+#include "bvh.h"
+
+#include "core/job_system.h"
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KRONIC_BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+constexpr uint32_t bin_count = 16;
+constexpr uint32_t rays_per_job = 256;
+
+struct Bin
+{
+	AABB bounds;
+	uint32_t count = 0;
+};
+
+struct StackEntry
+{
+	uint32_t node;
+	float distance;
+};
+
+// Per ray constants of the slab test. Near and far pick the min or max arrays of a node by the sign of
+// the direction so the test needs no min or max per axis.
+struct RayData
+{
+	Vector3 origin;
+	Vector3 inverse_direction;
+	uint32_t near_offset[3];
+	uint32_t far_offset[3];
+};
+
+RayData make_ray_data(const Ray& ray)
+{
+	RayData data;
+	data.origin = ray.origin;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// Keeps the slab distances finite for axis aligned rays, inf * 0 would give NaN
+		float direction = ray.direction[axis];
+		if (std::abs(direction) < 1e-20f)
+		{
+			direction = std::copysign(1e-20f, direction);
+		}
+		data.inverse_direction[axis] = 1.0f / direction;
+
+		// Offsets in floats from min_x, the max arrays follow the three min arrays
+		bool is_negative = direction < 0.0f;
+		data.near_offset[axis] = axis * 4 + (is_negative ? 12 : 0);
+		data.far_offset[axis] = axis * 4 + (is_negative ? 0 : 12);
+	}
+	return data;
+}
+}
+
+BVH::BuildRange BVH::make_range(const Vector<BuildPrimitive>& primitives, uint32_t begin, uint32_t end) const
+{
+	BuildRange range = { begin, end, {}, {}, false };
+	for (uint32_t i = begin; i < end; i++)
+	{
+		range.bounds.add(primitives[i].bounds);
+		range.centroid_bounds.add(primitives[i].centroid);
+	}
+	return range;
+}
+
+bool BVH::split(Vector<BuildPrimitive>& primitives, BuildRange& range, BuildRange& left, BuildRange& right, uint32_t level) const
+{
+	uint32_t count = range.get_count();
+	if (count <= max_leaf_size)
+	{
+		return false;
+	}
+
+	Vector3 extent = range.centroid_bounds.max - range.centroid_bounds.min;
+	uint32_t longest_axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+	auto split_at_median = [&]()
+	{
+		uint32_t middle = range.begin + count / 2;
+		std::nth_element(primitives.begin() + range.begin, primitives.begin() + middle, primitives.begin() + range.end, [longest_axis](const BuildPrimitive& a, const BuildPrimitive& b)
+		    { return a.centroid[longest_axis] < b.centroid[longest_axis]; });
+		left = make_range(primitives, range.begin, middle);
+		right = make_range(primitives, middle, range.end);
+		return true;
+	};
+
+	if (level >= median_split_depth || extent[longest_axis] <= 0.0f)
+	{
+		return split_at_median();
+	}
+
+	// Binned SAH, the cost of a split is the area of each side weighted by its triangle count
+	float best_cost = FLT_MAX;
+	uint32_t best_axis = 0;
+	uint32_t best_bin = 0;
+	for (uint32_t axis = 0; axis < 3; axis++)
+	{
+		if (extent[axis] <= 0.0f)
+		{
+			continue;
+		}
+
+		float scale = bin_count / extent[axis] * 0.9999f;
+		float axis_min = range.centroid_bounds.min[axis];
+
+		Bin bins[bin_count];
+		for (uint32_t i = range.begin; i < range.end; i++)
+		{
+			uint32_t bin = std::min(uint32_t((primitives[i].centroid[axis] - axis_min) * scale), bin_count - 1);
+			bins[bin].bounds.add(primitives[i].bounds);
+			bins[bin].count++;
+		}
+
+		float right_areas[bin_count];
+		uint32_t right_counts[bin_count];
+		AABB right_bounds;
+		uint32_t right_count = 0;
+		for (uint32_t bin = bin_count - 1; bin > 0; bin--)
+		{
+			right_bounds.add(bins[bin].bounds);
+			right_count += bins[bin].count;
+			right_areas[bin] = right_bounds.get_surface_area();
+			right_counts[bin] = right_count;
+		}
+
+		AABB left_bounds;
+		uint32_t left_count = 0;
+		for (uint32_t bin = 0; bin < bin_count - 1; bin++)
+		{
+			left_bounds.add(bins[bin].bounds);
+			left_count += bins[bin].count;
+			if (left_count == 0 || right_counts[bin + 1] == 0)
+			{
+				continue;
+			}
+
+			float cost = left_bounds.get_surface_area() * left_count + right_areas[bin + 1] * right_counts[bin + 1];
+			if (cost < best_cost)
+			{
+				best_cost = cost;
+				best_axis = axis;
+				best_bin = bin;
+			}
+		}
+	}
+
+	if (best_cost == FLT_MAX)
+	{
+		return split_at_median();
+	}
+
+	float scale = bin_count / extent[best_axis] * 0.9999f;
+	float axis_min = range.centroid_bounds.min[best_axis];
+	auto middle = std::partition(primitives.begin() + range.begin, primitives.begin() + range.end, [=](const BuildPrimitive& primitive)
+	    { return std::min(uint32_t((primitive.centroid[best_axis] - axis_min) * scale), bin_count - 1) <= best_bin; });
+
+	uint32_t middle_index = uint32_t(middle - primitives.begin());
+	if (middle_index == range.begin || middle_index == range.end)
+	{
+		return split_at_median();
+	}
+
+	left = make_range(primitives, range.begin, middle_index);
+	right = make_range(primitives, middle_index, range.end);
+	return true;
+}
+
+uint32_t BVH::build_node(Vector<BuildPrimitive>& primitives, const BuildRange& range, uint32_t level)
+{
+	uint32_t node_index = nodes.size();
+	nodes.emplace_back();
+	depth = std::max(depth, level);
+
+	// Splits the child with the largest area until there are four, which flattens two levels of a binary tree
+	BuildRange children[4] = { range };
+	uint32_t child_count = 1;
+	while (child_count < 4)
+	{
+		int largest = -1;
+		for (uint32_t i = 0; i < child_count; i++)
+		{
+			if (!children[i].is_leaf && (largest < 0 || children[i].bounds.get_surface_area() > children[largest].bounds.get_surface_area()))
+			{
+				largest = i;
+			}
+		}
+
+		if (largest < 0)
+		{
+			break;
+		}
+
+		BuildRange left;
+		BuildRange right;
+		if (!split(primitives, children[largest], left, right, level))
+		{
+			children[largest].is_leaf = true;
+			continue;
+		}
+
+		children[largest] = left;
+		children[child_count++] = right;
+	}
+
+	// Recursion may reallocate the array, so the node is filled in locally and stored at the end
+	Node node;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		node.min_x[i] = node.min_y[i] = node.min_z[i] = FLT_MAX;
+		node.max_x[i] = node.max_y[i] = node.max_z[i] = -FLT_MAX;
+		node.children[i] = 0;
+		node.counts[i] = 0;
+	}
+
+	for (uint32_t i = 0; i < child_count; i++)
+	{
+		const AABB& box = children[i].bounds;
+		node.min_x[i] = box.min.x;
+		node.min_y[i] = box.min.y;
+		node.min_z[i] = box.min.z;
+		node.max_x[i] = box.max.x;
+		node.max_y[i] = box.max.y;
+		node.max_z[i] = box.max.z;
+
+		if (children[i].get_count() <= max_leaf_size)
+		{
+			node.children[i] = children[i].begin;
+			node.counts[i] = children[i].get_count();
+		}
+		else
+		{
+			node.children[i] = build_node(primitives, children[i], level + 1);
+		}
+	}
+
+	nodes[node_index] = node;
+	return node_index;
+}
+
+void BVH::build(const Vector3* in_vertices, size_t vertex_count, const uint32_t* indices, size_t triangle_count)
+{
+	PROFILE_FUNCTION();
+
+	nodes.clear();
+	triangles.clear();
+	vertices.clear();
+	bounds = {};
+	depth = 0;
+
+	if (triangle_count == 0)
+	{
+		return;
+	}
+
+	Vector<BuildPrimitive> primitives(triangle_count);
+	vertices.resize(triangle_count * 3);
+	for (uint32_t i = 0; i < triangle_count; i++)
+	{
+		BuildPrimitive& primitive = primitives[i];
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[i * 3 + corner];
+			if (vertex >= vertex_count)
+			{
+				throw Exception("BVH triangle indexes a vertex out of range");
+			}
+
+			vertices[i * 3 + corner] = in_vertices[vertex];
+			primitive.bounds.add(in_vertices[vertex]);
+		}
+		primitive.centroid = primitive.bounds.get_center();
+		primitive.index = i;
+	}
+
+	nodes.reserve(triangle_count / 2 + 1);
+	BuildRange root = make_range(primitives, 0, triangle_count);
+	bounds = root.bounds;
+	build_node(primitives, root, 1);
+
+	// Leaves index runs of the primitives in the order the partitioning left them in
+	triangles.resize(triangle_count);
+	for (uint32_t i = 0; i < triangle_count; i++)
+	{
+		uint32_t index = primitives[i].index;
+		const Vector3* corners = &vertices[index * 3];
+		triangles[i] = { corners[0], corners[1] - corners[0], corners[2] - corners[0], index };
+	}
+}
+
+template <bool any_hit>
+bool BVH::traverse(const Ray& ray, RayHit& hit) const
+{
+	if (nodes.empty())
+	{
+		return false;
+	}
+
+	RayData data = make_ray_data(ray);
+	float closest = ray.max_distance;
+	bool has_hit = false;
+
+#ifdef KRONIC_BVH_SSE
+	__m128 origin[3] = { _mm_set1_ps(data.origin.x), _mm_set1_ps(data.origin.y), _mm_set1_ps(data.origin.z) };
+	__m128 inverse_direction[3] = { _mm_set1_ps(data.inverse_direction.x), _mm_set1_ps(data.inverse_direction.y), _mm_set1_ps(data.inverse_direction.z) };
+#endif
+
+	StackEntry stack[max_stack_size];
+	uint32_t stack_size = 0;
+	stack[stack_size++] = { 0, 0.0f };
+
+	while (stack_size > 0)
+	{
+		StackEntry entry = stack[--stack_size];
+		if (entry.distance > closest)
+		{
+			continue;
+		}
+
+		const Node& node = nodes[entry.node];
+		const float* planes = node.min_x;
+
+		// Slab test against all four children at once
+		alignas(16) float distances[4];
+		uint32_t hit_mask = 0;
+#ifdef KRONIC_BVH_SSE
+		__m128 t_near = _mm_setzero_ps();
+		__m128 t_far = _mm_set1_ps(closest);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			__m128 near_plane = _mm_load_ps(planes + data.near_offset[axis]);
+			__m128 far_plane = _mm_load_ps(planes + data.far_offset[axis]);
+			t_near = _mm_max_ps(t_near, _mm_mul_ps(_mm_sub_ps(near_plane, origin[axis]), inverse_direction[axis]));
+			t_far = _mm_min_ps(t_far, _mm_mul_ps(_mm_sub_ps(far_plane, origin[axis]), inverse_direction[axis]));
+		}
+		hit_mask = _mm_movemask_ps(_mm_cmple_ps(t_near, t_far));
+		_mm_store_ps(distances, t_near);
+#else
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			float t_near = 0.0f;
+			float t_far = closest;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				t_near = std::max(t_near, (planes[data.near_offset[axis] + i] - data.origin[axis]) * data.inverse_direction[axis]);
+				t_far = std::min(t_far, (planes[data.far_offset[axis] + i] - data.origin[axis]) * data.inverse_direction[axis]);
+			}
+			distances[i] = t_near;
+			hit_mask |= uint32_t(t_near <= t_far) << i;
+		}
+#endif
+
+		// Inner children are pushed furthest first so the nearest is visited next
+		StackEntry inner[4];
+		uint32_t inner_count = 0;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			if (!(hit_mask & (1u << i)))
+			{
+				continue;
+			}
+
+			if (node.counts[i] == 0)
+			{
+				inner[inner_count++] = { node.children[i], distances[i] };
+				continue;
+			}
+
+			for (uint32_t j = node.children[i]; j < node.children[i] + node.counts[i]; j++)
+			{
+				// Moller-Trumbore, two sided
+				const Triangle& triangle = triangles[j];
+				Vector3 p = Math::cross(ray.direction, triangle.edge2);
+				float determinant = Math::dot(triangle.edge1, p);
+				if (std::abs(determinant) < FLT_MIN)
+				{
+					continue;
+				}
+
+				float inverse_determinant = 1.0f / determinant;
+				Vector3 t = ray.origin - triangle.v0;
+				float u = Math::dot(t, p) * inverse_determinant;
+				if (u < 0.0f || u > 1.0f)
+				{
+					continue;
+				}
+
+				Vector3 q = Math::cross(t, triangle.edge1);
+				float v = Math::dot(ray.direction, q) * inverse_determinant;
+				if (v < 0.0f || u + v > 1.0f)
+				{
+					continue;
+				}
+
+				float distance = Math::dot(triangle.edge2, q) * inverse_determinant;
+				if (distance < 0.0f || distance > closest)
+				{
+					continue;
+				}
+
+				closest = distance;
+				has_hit = true;
+				hit = { distance, triangle.index, u, v };
+				if (any_hit)
+				{
+					return true;
+				}
+			}
+		}
+
+		for (uint32_t i = 1; i < inner_count; i++)
+		{
+			for (uint32_t j = i; j > 0 && inner[j - 1].distance < inner[j].distance; j--)
+			{
+				std::swap(inner[j - 1], inner[j]);
+			}
+		}
+		for (uint32_t i = 0; i < inner_count; i++)
+		{
+			stack[stack_size++] = inner[i];
+		}
+	}
+
+	return has_hit;
+}
+
+bool BVH::intersect(const Ray& ray, RayHit& hit) const
+{
+	return traverse<false>(ray, hit);
+}
+
+bool BVH::is_occluded(const Ray& ray) const
+{
+	RayHit hit;
+	return traverse<true>(ray, hit);
+}
+
+void BVH::intersect(const Ray* rays, RayHit* hits, size_t count) const
+{
+	PROFILE_FUNCTION();
+
+	JobSystem::get_singleton()->parallel_for(0, count, rays_per_job, [this, rays, hits](size_t begin, size_t end)
+	    {
+		    for (size_t i = begin; i < end; i++)
+		    {
+			    hits[i] = {};
+			    intersect(rays[i], hits[i]);
+		    } });
+}
+
+void BVH::test_occlusion(const Ray* rays, uint8_t* occluded, size_t count) const
+{
+	PROFILE_FUNCTION();
+
+	JobSystem::get_singleton()->parallel_for(0, count, rays_per_job, [this, rays, occluded](size_t begin, size_t end)
+	    {
+		    for (size_t i = begin; i < end; i++)
+		    {
+			    occluded[i] = is_occluded(rays[i]);
+		    } });
+}
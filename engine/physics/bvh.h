@@ -0,0 +1,165 @@
+#pragma once
+
+#include "common.h"
+#include "core/math.h"
+#include "physics/aabb.h"
+
+#include <cfloat>
+
+struct Ray
+{
+	Vector3 origin;
+
+	// Does not need to be normalized, distances are in multiples of its length
+	Vector3 direction;
+	float max_distance = FLT_MAX;
+};
+
+struct RayHit
+{
+	float distance = FLT_MAX;
+	uint32_t triangle = ~0u;
+
+	// Barycentric coordinates of the hit on the triangle
+	float u = 0.0f;
+	float v = 0.0f;
+
+	bool is_hit() const { return triangle != ~0u; }
+};
+
+// Bounding volume hierarchy over static triangle soup, for hitscan and line-of-sight rays against level
+// geometry.
+//
+// The tree is built with binned SAH and stored as 4-wide nodes in one flat array, each node holding the
+// boxes of its four children as arrays so a ray is tested against all of them with one SIMD slab test.
+// Leaves index a copy of the triangles reordered so every leaf reads one contiguous run.
+class BVH
+{
+public:
+	BVH() = default;
+
+	// indices holds three vertex indices per triangle. Triangles are reported by their position in it.
+	void build(const Vector3* vertices, size_t vertex_count, const uint32_t* indices, size_t triangle_count);
+
+	// Nearest hit within the ray's max_distance
+	bool intersect(const Ray& ray, RayHit& hit) const;
+
+	// Stops at the first hit within max_distance, for line of sight
+	bool is_occluded(const Ray& ray) const;
+
+	// Split over the job system, hits[i] and occluded[i] answer rays[i]
+	void intersect(const Ray* rays, RayHit* hits, size_t count) const;
+	void test_occlusion(const Ray* rays, uint8_t* occluded, size_t count) const;
+
+	// Calls function(triangle) for every triangle in a leaf whose box overlaps box, which includes every
+	// triangle that overlaps it and a few neighbours. Used by shape queries that do their own exact test.
+	template <class F>
+	void query(const AABB& box, F&& function) const
+	{
+		if (nodes.empty())
+		{
+			return;
+		}
+
+		uint32_t stack[max_stack_size];
+		uint32_t stack_size = 0;
+		stack[stack_size++] = 0;
+		while (stack_size > 0)
+		{
+			const Node& node = nodes[stack[--stack_size]];
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				if (node.min_x[i] > box.max.x || node.max_x[i] < box.min.x || node.min_y[i] > box.max.y || node.max_y[i] < box.min.y || node.min_z[i] > box.max.z || node.max_z[i] < box.min.z)
+				{
+					continue;
+				}
+
+				if (node.counts[i] == 0)
+				{
+					stack[stack_size++] = node.children[i];
+					continue;
+				}
+
+				for (uint32_t j = node.children[i]; j < node.children[i] + node.counts[i]; j++)
+				{
+					function(triangles[j].index);
+				}
+			}
+		}
+	}
+
+	const Vector3& get_vertex(uint32_t triangle, uint32_t corner) const { return vertices[triangle * 3 + corner]; }
+	size_t get_triangle_count() const { return triangles.size(); }
+	size_t get_node_count() const { return nodes.size(); }
+	uint32_t get_depth() const { return depth; }
+	const AABB& get_bounds() const { return bounds; }
+
+	static constexpr uint32_t max_leaf_size = 4;
+
+	// Each level pushes at most three children besides the one it continues with. Past median_split_depth
+	// nodes are split at the median, which at least halves them per level and keeps any tree that can be
+	// indexed by 32 bits within max_depth.
+	static constexpr uint32_t median_split_depth = 24;
+	static constexpr uint32_t max_depth = 64;
+	static constexpr uint32_t max_stack_size = max_depth * 3 + 1;
+
+private:
+	struct alignas(64) Node
+	{
+		float min_x[4];
+		float min_y[4];
+		float min_z[4];
+		float max_x[4];
+		float max_y[4];
+		float max_z[4];
+
+		// Inner children have a count of zero and index nodes, leaves index their first triangle.
+		// Unused slots have an inverted box that no ray can hit.
+		uint32_t children[4];
+		uint32_t counts[4];
+	};
+	static_assert(sizeof(Node) == 128, "Nodes must fill exactly two cache lines");
+
+	// Precomputed for the Moller-Trumbore test
+	struct Triangle
+	{
+		Vector3 v0;
+		Vector3 edge1;
+		Vector3 edge2;
+		uint32_t index;
+	};
+
+	struct BuildRange
+	{
+		uint32_t begin;
+		uint32_t end;
+		AABB bounds;
+		AABB centroid_bounds;
+		bool is_leaf;
+
+		uint32_t get_count() const { return end - begin; }
+	};
+
+	struct BuildPrimitive
+	{
+		AABB bounds;
+		Vector3 centroid;
+		uint32_t index;
+	};
+
+	bool split(Vector<BuildPrimitive>& primitives, BuildRange& range, BuildRange& left, BuildRange& right, uint32_t level) const;
+	uint32_t build_node(Vector<BuildPrimitive>& primitives, const BuildRange& range, uint32_t level);
+	BuildRange make_range(const Vector<BuildPrimitive>& primitives, uint32_t begin, uint32_t end) const;
+
+	template <bool any_hit>
+	bool traverse(const Ray& ray, RayHit& hit) const;
+
+	Vector<Node> nodes;
+	Vector<Triangle> triangles;
+
+	// Three corners per triangle by its original index, for queries that need more than the ray test data
+	Vector<Vector3> vertices;
+
+	AABB bounds;
+	uint32_t depth = 0;
+};
@@ -0,0 +1,502 @@
+#include "character_controller.h"
+
+#include "core/job_system.h"
+#include "core/profiler.h"
+#include "physics/bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr uint32_t characters_per_job = 8;
+
+// Moves shorter than this are dropped, they would only grind against the surface they are resting on
+constexpr float min_move = 1e-5f;
+
+// Removes slightly more than the part of a move going into a plane, so the next sweep starts moving away
+// from it instead of touching it again through rounding. Velocities are clipped exactly.
+constexpr float overclip = 1.001f;
+
+Vector3 clip(const Vector3& vector, const Vector3& normal, float factor = 1.0f)
+{
+	float into = Math::dot(vector, normal);
+	return into < 0.0f ? vector - normal * (into * factor) : vector;
+}
+
+Vector3 closest_point_on_triangle(const Vector3& point, const Vector3& a, const Vector3& b, const Vector3& c)
+{
+	// Voronoi regions of the corners, then the edges, then the face, after Ericson's Real-Time Collision
+	// Detection 5.1.5
+	Vector3 ab = b - a;
+	Vector3 ac = c - a;
+	Vector3 ap = point - a;
+	float d1 = Math::dot(ab, ap);
+	float d2 = Math::dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		return a;
+	}
+
+	Vector3 bp = point - b;
+	float d3 = Math::dot(ab, bp);
+	float d4 = Math::dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3)
+	{
+		return b;
+	}
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		return a + ab * (d1 / (d1 - d3));
+	}
+
+	Vector3 cp = point - c;
+	float d5 = Math::dot(ab, cp);
+	float d6 = Math::dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6)
+	{
+		return c;
+	}
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		return a + ac * (d2 / (d2 - d6));
+	}
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+	{
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+	}
+
+	float denominator = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+
+// Squared distance between segments p1 q1 and p2 q2, after Ericson 5.1.9
+float closest_points_on_segments(const Vector3& p1, const Vector3& q1, const Vector3& p2, const Vector3& q2, Vector3& c1, Vector3& c2)
+{
+	Vector3 d1 = q1 - p1;
+	Vector3 d2 = q2 - p2;
+	Vector3 r = p1 - p2;
+	float a = Math::dot(d1, d1);
+	float e = Math::dot(d2, d2);
+	float f = Math::dot(d2, r);
+	float s = 0.0f;
+	float t = 0.0f;
+
+	if (a <= 1e-12f && e <= 1e-12f)
+	{
+		s = 0.0f;
+		t = 0.0f;
+	}
+	else if (a <= 1e-12f)
+	{
+		t = std::clamp(f / e, 0.0f, 1.0f);
+	}
+	else
+	{
+		float c = Math::dot(d1, r);
+		if (e <= 1e-12f)
+		{
+			s = std::clamp(-c / a, 0.0f, 1.0f);
+		}
+		else
+		{
+			float b = Math::dot(d1, d2);
+			float denominator = a * e - b * b;
+
+			// Parallel segments pick the start of the first one
+			s = denominator != 0.0f ? std::clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+			t = (b * s + f) / e;
+			if (t < 0.0f)
+			{
+				t = 0.0f;
+				s = std::clamp(-c / a, 0.0f, 1.0f);
+			}
+			else if (t > 1.0f)
+			{
+				t = 1.0f;
+				s = std::clamp((b - c) / a, 0.0f, 1.0f);
+			}
+		}
+	}
+
+	c1 = p1 + d1 * s;
+	c2 = p2 + d2 * t;
+	Vector3 difference = c1 - c2;
+	return Math::dot(difference, difference);
+}
+
+bool segment_intersects_triangle(const Vector3& p, const Vector3& q, const Vector3& v0, const Vector3& edge1, const Vector3& edge2, Vector3& point)
+{
+	Vector3 direction = q - p;
+	Vector3 p_vector = Math::cross(direction, edge2);
+	float determinant = Math::dot(edge1, p_vector);
+	if (std::abs(determinant) < 1e-12f)
+	{
+		return false;
+	}
+
+	float inverse_determinant = 1.0f / determinant;
+	Vector3 t_vector = p - v0;
+	float u = Math::dot(t_vector, p_vector) * inverse_determinant;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+
+	Vector3 q_vector = Math::cross(t_vector, edge1);
+	float v = Math::dot(direction, q_vector) * inverse_determinant;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+
+	float t = Math::dot(edge2, q_vector) * inverse_determinant;
+	if (t < 0.0f || t > 1.0f)
+	{
+		return false;
+	}
+
+	point = p + direction * t;
+	return true;
+}
+
+// Squared distance between segment p q and a triangle. When they do not cross, the closest points are
+// between an end of the segment and the triangle or between the segment and an edge.
+float closest_points_on_segment_triangle(const Vector3& p, const Vector3& q, const Vector3 corners[3], Vector3& segment_point, Vector3& triangle_point)
+{
+	Vector3 edge1 = corners[1] - corners[0];
+	Vector3 edge2 = corners[2] - corners[0];
+	if (segment_intersects_triangle(p, q, corners[0], edge1, edge2, segment_point))
+	{
+		triangle_point = segment_point;
+		return 0.0f;
+	}
+
+	segment_point = p;
+	triangle_point = closest_point_on_triangle(p, corners[0], corners[1], corners[2]);
+	Vector3 difference = segment_point - triangle_point;
+	float best = Math::dot(difference, difference);
+
+	Vector3 on_triangle = closest_point_on_triangle(q, corners[0], corners[1], corners[2]);
+	difference = q - on_triangle;
+	float distance = Math::dot(difference, difference);
+	if (distance < best)
+	{
+		best = distance;
+		segment_point = q;
+		triangle_point = on_triangle;
+	}
+
+	for (uint32_t edge = 0; edge < 3; edge++)
+	{
+		Vector3 on_segment;
+		distance = closest_points_on_segments(p, q, corners[edge], corners[(edge + 1) % 3], on_segment, on_triangle);
+		if (distance < best)
+		{
+			best = distance;
+			segment_point = on_segment;
+			triangle_point = on_triangle;
+		}
+	}
+	return best;
+}
+}
+
+CharacterController::CharacterController(const BVH* level, const CharacterSettings& settings)
+    : level(level)
+    , settings(settings)
+{
+	if (settings.radius <= 0.0f || settings.height < settings.radius * 2.0f)
+	{
+		throw Exception("Character capsule must have a positive radius and be at least as tall as it is wide");
+	}
+	if (settings.skin <= 0.0f || settings.skin >= settings.radius)
+	{
+		throw Exception("Character skin must be positive and thinner than the capsule radius");
+	}
+}
+
+CharacterSweep CharacterController::sweep(const Vector3& position, const Vector3& displacement) const
+{
+	CharacterSweep result;
+	float length = Math::length(displacement);
+	if (length < min_move)
+	{
+		return result;
+	}
+
+	Vector3 bottom = position + Vector3(0.0f, settings.radius, 0.0f);
+	Vector3 top = position + Vector3(0.0f, settings.height - settings.radius, 0.0f);
+	float contact_distance = settings.radius + settings.skin;
+
+	// Advancing to the middle of the skin leaves room for the distance to land inside it
+	float target_distance = settings.radius + settings.skin * 0.5f;
+
+	AABB box;
+	box.add(bottom);
+	box.add(top);
+	box.add(bottom + displacement);
+	box.add(top + displacement);
+	box.min -= Vector3(contact_distance);
+	box.max += Vector3(contact_distance);
+
+	// Conservative advancement: the moving capsule can not get closer to the triangle than the distance it
+	// moves, so stepping by the current gap never passes through it. The distance between a moving convex
+	// shape and a triangle is convex in time, so a capsule already touching and moving away never comes back.
+	level->query(box, [&](uint32_t triangle)
+	    {
+		    Vector3 corners[3] = { level->get_vertex(triangle, 0), level->get_vertex(triangle, 1), level->get_vertex(triangle, 2) };
+
+		    float t = 0.0f;
+		    for (uint32_t iteration = 0; iteration < max_advance_iterations; iteration++)
+		    {
+			    Vector3 offset = displacement * t;
+			    Vector3 segment_point;
+			    Vector3 triangle_point;
+			    float distance = std::sqrt(closest_points_on_segment_triangle(bottom + offset, top + offset, corners, segment_point, triangle_point));
+
+			    bool is_last = iteration + 1 == max_advance_iterations;
+			    if (distance <= contact_distance || is_last)
+			    {
+				    Vector3 normal;
+				    if (distance > 1e-6f)
+				    {
+					    normal = (segment_point - triangle_point) / distance;
+				    }
+				    else
+				    {
+					    // Only when already overlapping, fall back to the face against the motion
+					    normal = Math::cross(corners[1] - corners[0], corners[2] - corners[0]);
+					    float normal_length = Math::length(normal);
+					    normal = normal_length > 0.0f ? normal / normal_length : -displacement / length;
+					    if (Math::dot(normal, displacement) > 0.0f)
+					    {
+						    normal = -normal;
+					    }
+				    }
+
+				    if (t == 0.0f && Math::dot(normal, displacement) >= 0.0f)
+				    {
+					    return;
+				    }
+
+				    // Ties go to the lower triangle so the result does not depend on the traversal order
+				    if (t < result.fraction || (t == result.fraction && triangle < result.triangle))
+				    {
+					    result.fraction = t;
+					    result.normal = normal;
+					    result.triangle = triangle;
+				    }
+				    return;
+			    }
+
+			    t += (distance - target_distance) / length;
+			    if (t > result.fraction || t > 1.0f)
+			    {
+				    return;
+			    }
+		    } });
+
+	return result;
+}
+
+bool CharacterController::slide(Vector3& position, Vector3& velocity, Vector3 displacement, bool is_grounded) const
+{
+	bool is_blocked = false;
+	Vector3 planes[max_slide_iterations];
+	uint32_t plane_count = 0;
+
+	for (uint32_t iteration = 0; iteration < max_slide_iterations; iteration++)
+	{
+		if (Math::dot(displacement, displacement) < min_move * min_move)
+		{
+			break;
+		}
+
+		CharacterSweep hit = sweep(position, displacement);
+		position += displacement * hit.fraction;
+		if (!hit.is_hit())
+		{
+			break;
+		}
+		displacement *= 1.0f - hit.fraction;
+
+		Vector3 normal = hit.normal;
+		if (!is_walkable(normal))
+		{
+			is_blocked = true;
+
+			// Walls are walked along, not up, while on the ground
+			Vector3 horizontal(normal.x, 0.0f, normal.z);
+			float horizontal_length = Math::length(horizontal);
+			if (is_grounded && normal.y > 0.0f && horizontal_length > 1e-3f)
+			{
+				normal = horizontal / horizontal_length;
+			}
+		}
+
+		planes[plane_count++] = normal;
+		displacement = clip(displacement, normal, overclip);
+		velocity = clip(velocity, normal);
+
+		// Pushed back into an earlier plane, follow the crease between the two or stop in a corner
+		for (uint32_t i = 0; i + 1 < plane_count; i++)
+		{
+			if (Math::dot(displacement, planes[i]) >= 0.0f)
+			{
+				continue;
+			}
+
+			Vector3 crease = Math::cross(planes[i], normal);
+			float crease_length = Math::length(crease);
+			if (crease_length < 1e-3f)
+			{
+				displacement = Vector3(0.0f);
+				velocity = Vector3(0.0f);
+				break;
+			}
+			crease /= crease_length;
+			displacement = crease * Math::dot(crease, displacement);
+			velocity = crease * Math::dot(crease, velocity);
+
+			for (uint32_t j = 0; j < plane_count; j++)
+			{
+				if (Math::dot(displacement, planes[j]) < -min_move)
+				{
+					displacement = Vector3(0.0f);
+					velocity = Vector3(0.0f);
+					break;
+				}
+			}
+			break;
+		}
+	}
+
+	return is_blocked;
+}
+
+bool CharacterController::find_ground(const Vector3& position, Vector3& normal) const
+{
+	// Slightly further than the sweeps leave the capsule from the surface it stopped at
+	Vector3 center = position + Vector3(0.0f, settings.radius, 0.0f);
+	float reach = settings.radius + settings.skin * 2.0f;
+	AABB box = { center - Vector3(reach), center + Vector3(reach) };
+
+	uint32_t ground = ~0u;
+	level->query(box, [&](uint32_t triangle)
+	    {
+		    const Vector3& a = level->get_vertex(triangle, 0);
+		    const Vector3& b = level->get_vertex(triangle, 1);
+		    const Vector3& c = level->get_vertex(triangle, 2);
+
+		    Vector3 offset = center - closest_point_on_triangle(center, a, b, c);
+		    if (offset.y <= 0.0f || Math::dot(offset, offset) > reach * reach)
+		    {
+			    return;
+		    }
+
+		    Vector3 face = Math::cross(b - a, c - a);
+		    float face_length = Math::length(face);
+		    if (face_length == 0.0f)
+		    {
+			    return;
+		    }
+		    face /= face.y < 0.0f ? -face_length : face_length;
+
+		    // Prefers the flattest ground, ties go to the lower triangle like in sweep
+		    if (is_walkable(face) && (ground == ~0u || face.y > normal.y || (face.y == normal.y && triangle < ground)))
+		    {
+			    ground = triangle;
+			    normal = face;
+		    }
+	    });
+
+	return ground != ~0u;
+}
+
+void CharacterController::move(Character& character, float delta_s) const
+{
+	bool was_grounded = character.is_grounded;
+	if (!was_grounded)
+	{
+		character.velocity.y -= settings.gravity * delta_s;
+	}
+
+	// Read before sliding, walking up a slope also gives an upwards velocity
+	bool is_rising = character.velocity.y > 0.0f;
+
+	Vector3 start = character.position;
+	Vector3 displacement = character.velocity * delta_s;
+	Vector3 position = start;
+	Vector3 velocity = character.velocity;
+	bool is_blocked = slide(position, velocity, displacement, was_grounded);
+
+	// Blocked while walking, try again from step_height up and keep it if it gets further and lands on ground
+	if (was_grounded && is_blocked && settings.step_height > 0.0f)
+	{
+		Vector3 step_position = start;
+		Vector3 step_velocity = character.velocity;
+
+		Vector3 up(0.0f, settings.step_height, 0.0f);
+		step_position += up * sweep(step_position, up).fraction;
+		float raised = step_position.y - start.y;
+		slide(step_position, step_velocity, Vector3(displacement.x, 0.0f, displacement.z), true);
+
+		Vector3 down(0.0f, -(raised + settings.ground_snap_distance), 0.0f);
+		CharacterSweep landing = sweep(step_position, down);
+		step_position += down * landing.fraction;
+		Vector3 ground_normal;
+		if (landing.is_hit() && find_ground(step_position, ground_normal))
+		{
+			Vector2 stepped(step_position.x - start.x, step_position.z - start.z);
+			Vector2 walked(position.x - start.x, position.z - start.z);
+			if (Math::dot(stepped, stepped) > Math::dot(walked, walked) + min_move * min_move)
+			{
+				position = step_position;
+				velocity = step_velocity;
+			}
+		}
+	}
+
+	// Snapping keeps walking characters on slopes and stairs down, a character in the air or jumping only
+	// lands once it touches the ground
+	character.is_grounded = false;
+	if (!is_rising)
+	{
+		float probe = was_grounded ? settings.ground_snap_distance : settings.skin * 2.0f;
+		Vector3 down(0.0f, -probe, 0.0f);
+		CharacterSweep ground = sweep(position, down);
+		Vector3 landed = position + down * ground.fraction;
+		if (ground.is_hit() && find_ground(landed, character.ground_normal))
+		{
+			position = landed;
+			character.is_grounded = true;
+			velocity.y = 0.0f;
+		}
+	}
+	if (!character.is_grounded)
+	{
+		character.ground_normal = Vector3(0.0f, 1.0f, 0.0f);
+	}
+
+	character.position = position;
+	character.velocity = velocity;
+}
+
+void CharacterController::move(Character* characters, size_t count, float delta_s) const
+{
+	PROFILE_FUNCTION();
+
+	JobSystem::get_singleton()->parallel_for(0, count, characters_per_job, [this, characters, delta_s](size_t begin, size_t end)
+	    {
+		    for (size_t i = begin; i < end; i++)
+		    {
+			    move(characters[i], delta_s);
+		    } });
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "common.h"
+#include "core/math.h"
+
+class BVH;
+
+struct CharacterSettings
+{
+	// The capsule stands upright on the character's position, y is up
+	float radius = 0.4f;
+	float height = 1.8f;
+
+	// Ledges up to this high are stepped onto instead of blocking
+	float step_height = 0.45f;
+
+	// Walking down slopes and stairs keeps the character on the ground within this distance
+	float ground_snap_distance = 0.3f;
+
+	// Cosine of the steepest slope that still counts as ground, 45 degrees
+	float min_ground_normal_y = 0.7071f;
+
+	float gravity = 20.0f;
+
+	// Gap kept between the capsule and the level so sliding along a surface does not hit it again
+	float skin = 0.01f;
+};
+
+struct Character
+{
+	// Bottom of the capsule
+	Vector3 position = Vector3(0.0f);
+	Vector3 velocity = Vector3(0.0f);
+	Vector3 ground_normal = Vector3(0.0f, 1.0f, 0.0f);
+	bool is_grounded = false;
+};
+
+struct CharacterSweep
+{
+	// Part of the displacement that can be moved before touching the level
+	float fraction = 1.0f;
+
+	// Points away from the surface that was hit
+	Vector3 normal = Vector3(0.0f);
+	uint32_t triangle = ~0u;
+
+	bool is_hit() const { return triangle != ~0u; }
+};
+
+// Moves player capsules through the static level, sliding along walls, stepping up ledges and staying on
+// the ground while walking down slopes.
+//
+// Every query walks the level BVH with a stack on the stack and keeps no state between characters, so
+// moving one allocates nothing and costs the same no matter how many others move in the same tick. Results
+// only depend on the character and the level, never on the order or thread it is moved on, so the server
+// and predicting clients agree as long as they run the same build.
+class CharacterController
+{
+public:
+	CharacterController(const BVH* level, const CharacterSettings& settings = {});
+
+	// Advances the character by one tick. Gameplay sets the horizontal velocity, and a positive vertical
+	// velocity to jump, before calling it.
+	void move(Character& character, float delta_s) const;
+
+	// Split over the job system
+	void move(Character* characters, size_t count, float delta_s) const;
+
+	// Sweeps the capsule standing on position along displacement
+	CharacterSweep sweep(const Vector3& position, const Vector3& displacement) const;
+
+	const CharacterSettings& get_settings() const { return settings; }
+
+	static constexpr uint32_t max_slide_iterations = 4;
+
+	// Conservative advancement steps per triangle. Grazing contacts that are not resolved within them are
+	// reported as hits where the advancement stopped, which is always short of the surface.
+	static constexpr uint32_t max_advance_iterations = 24;
+
+private:
+	bool is_walkable(const Vector3& normal) const { return normal.y >= settings.min_ground_normal_y; }
+
+	// Looks for walkable faces under the bottom of the capsule. The face normal is used rather than the
+	// contact normal so a capsule resting on the edge of a ledge or step stands on it instead of sliding off.
+	bool find_ground(const Vector3& position, Vector3& normal) const;
+
+	// Returns true if a surface too steep to walk on was hit
+	bool slide(Vector3& position, Vector3& velocity, Vector3 displacement, bool is_grounded) const;
+
+	const BVH* level;
+	CharacterSettings settings;
+};
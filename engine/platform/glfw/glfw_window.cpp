@@ -1,6 +1,9 @@
 #include "glfw_window.h"
 
+#include "core/event.h"
+#include "core/input.h"
 #include "core/log.h"
+#include "core/profiler.h"
 #include "os/os.h"
 
 class GLFWContext
@@ -36,7 +39,68 @@ GLFWWindow::GLFWWindow(uint32_t width, uint32_t height)
 	if (!glfw_window)
 	{
 		ERR("Could not create window");
+		return;
 	}
+
+	// Runs inside glfwPollEvents, on the main thread. Minimizing reports a size of 0x0.
+	glfwSetFramebufferSizeCallback(glfw_window, [](GLFWwindow* window, int width, int height)
+	                               { EventWindowResizing::fire({ {}, uint32_t(width), uint32_t(height) }); });
+
+	// Input callbacks also run inside glfwPollEvents, every event is stamped as soon as GLFW hands it over
+	glfwSetWindowUserPointer(glfw_window, this);
+	glfwSetCursorPosCallback(glfw_window, [](GLFWwindow* window, double x, double y)
+	                         {
+		GLFWWindow* self = static_cast<GLFWWindow*>(glfwGetWindowUserPointer(window));
+		if (!self->is_captured)
+		{
+			return;
+		}
+
+		// GLFW reports positions, the first one after capturing only sets the origin
+		if (self->has_cursor_position)
+		{
+			Input::get_singleton()->push({ Profiler::now_ns(), InputEventType::MouseMotion, 0, false, float(x - self->cursor_x), float(y - self->cursor_y) });
+		}
+		self->has_cursor_position = true;
+		self->cursor_x = x;
+		self->cursor_y = y; });
+	glfwSetMouseButtonCallback(glfw_window, [](GLFWwindow* window, int button, int action, int mods)
+	                           {
+		GLFWWindow* self = static_cast<GLFWWindow*>(glfwGetWindowUserPointer(window));
+		if (!self->is_captured)
+		{
+			if (action == GLFW_PRESS)
+			{
+				self->set_cursor_captured(true);
+			}
+			return;
+		}
+
+		Input::get_singleton()->push({ Profiler::now_ns(), InputEventType::MouseButton, button, action == GLFW_PRESS }); });
+	glfwSetKeyCallback(glfw_window, [](GLFWwindow* window, int key, int scancode, int action, int mods)
+	                   {
+		GLFWWindow* self = static_cast<GLFWWindow*>(glfwGetWindowUserPointer(window));
+		if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+		{
+			self->set_cursor_captured(false);
+		}
+
+		// Repeats carry no new state
+		if (action != GLFW_REPEAT)
+		{
+			Input::get_singleton()->push({ Profiler::now_ns(), InputEventType::Key, key, action == GLFW_PRESS });
+		} });
+
+	if (glfwRawMouseMotionSupported())
+	{
+		glfwSetInputMode(glfw_window, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+		INFO("Using raw mouse motion");
+	}
+	else
+	{
+		WARN("Raw mouse motion is not supported, mouse motion will be accelerated");
+	}
+	set_cursor_captured(true);
 }
 
 GLFWWindow::~GLFWWindow()
@@ -80,6 +144,30 @@ void GLFWWindow::collect_events() const
 	glfwPollEvents();
 }
 
+void GLFWWindow::wait_events(uint64_t timeout_ns) const
+{
+	glfwWaitEventsTimeout(timeout_ns * 1e-9);
+}
+
+void GLFWWindow::set_cursor_captured(bool captured)
+{
+	is_captured = captured;
+	has_cursor_position = false;
+
+	// Raw motion only applies while the cursor is disabled
+	glfwSetInputMode(glfw_window, GLFW_CURSOR, captured ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+}
+
+void GLFWWindow::get_framebuffer_size(uint32_t& width, uint32_t& height) const
+{
+	int32_t framebuffer_width = 0;
+	int32_t framebuffer_height = 0;
+	glfwGetFramebufferSize(glfw_window, &framebuffer_width, &framebuffer_height);
+
+	width = framebuffer_width;
+	height = framebuffer_height;
+}
+
 VkSurfaceKHR GLFWWindow::get_surface(VkInstance& instance) const
 {
 	VkSurfaceKHR surface;
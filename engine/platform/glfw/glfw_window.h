@@ -16,9 +16,23 @@ public:
 
 	bool has_closed() const override;
 	void collect_events() const override;
+	void wait_events(uint64_t timeout_ns) const override;
+
+	// A captured cursor is hidden and reports raw, unaccelerated motion where the platform supports it.
+	// Escape releases it and clicking into the window captures it again.
+	void set_cursor_captured(bool captured);
+	bool is_cursor_captured() const { return is_captured; }
+
+	// In pixels, which differs from the window size on high DPI displays
+	void get_framebuffer_size(uint32_t& width, uint32_t& height) const;
 
 	VkSurfaceKHR get_surface(VkInstance& instance) const;
 
 private:
 	GLFWwindow* glfw_window = nullptr;
+
+	bool is_captured = false;
+	bool has_cursor_position = false;
+	double cursor_x = 0.0;
+	double cursor_y = 0.0;
 };
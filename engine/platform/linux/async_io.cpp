@@ -0,0 +1,371 @@
+#include "os/async_io.h"
+
+#include "core/log.h"
+#include "core/profiler.h"
+
+#include <cerrno>
+#include <initializer_list>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+// Tags for submissions that are not reads
+constexpr uint64_t ignored_tag = 0;
+constexpr uint64_t stop_tag = ~0ull;
+
+// The kernel caps a single read a little below 2 GiB, larger requests are split
+constexpr size_t max_read_size = 1ull << 30;
+
+int io_uring_setup(uint32_t entries, io_uring_params* params)
+{
+	return int(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int ring, uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+{
+	return int(syscall(__NR_io_uring_enter, ring, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int io_uring_register(int ring, uint32_t opcode, void* arg, uint32_t count)
+{
+	return int(syscall(__NR_io_uring_register, ring, opcode, arg, count));
+}
+
+// The probe arrived in 5.6 together with IORING_OP_READ, so kernels that cannot probe cannot read either
+bool supports_opcodes(int ring, std::initializer_list<uint8_t> opcodes)
+{
+	// io_uring_probe ends in one entry per opcode
+	constexpr uint32_t max_opcodes = 256;
+	alignas(io_uring_probe) Byte memory[sizeof(io_uring_probe) + max_opcodes * sizeof(io_uring_probe_op)] = {};
+	io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(memory);
+	if (io_uring_register(ring, IORING_REGISTER_PROBE, probe, max_opcodes) < 0)
+	{
+		return false;
+	}
+
+	for (uint8_t opcode : opcodes)
+	{
+		if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED))
+		{
+			errno = EOPNOTSUPP;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Talks to io_uring through raw syscalls. The dispatcher thread opens files and fills the submission ring,
+// a reaper thread blocks on the completion ring and hands finished reads back.
+class IOUringBackend : public AsyncIOBackend
+{
+public:
+	IOUringBackend(CompletionHandler on_complete)
+	    : on_complete(std::move(on_complete))
+	{
+	}
+
+	~IOUringBackend()
+	{
+		if (reaper.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(submission_mutex);
+				io_uring_sqe* sqe = get_sqe();
+				sqe->opcode = IORING_OP_NOP;
+				sqe->user_data = stop_tag;
+				flush();
+			}
+			reaper.join();
+		}
+
+		if (sqes)
+		{
+			munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+		}
+		if (rings != MAP_FAILED)
+		{
+			munmap(rings, rings_size);
+		}
+		if (ring >= 0)
+		{
+			close(ring);
+		}
+	}
+
+	bool setup(uint32_t queue_depth)
+	{
+		// Room for the reads, the continuations of split reads and the odd cancellation
+		ring = io_uring_setup(queue_depth * 2, &params);
+		if (ring < 0)
+		{
+			return false;
+		}
+
+		// Kernels from 5.4 on place both rings in one mapping
+		if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+		{
+			return false;
+		}
+
+		// Reads need 5.6 and cancellation 5.5, older kernels fail every request with EINVAL
+		if (!supports_opcodes(ring, { IORING_OP_READ, IORING_OP_ASYNC_CANCEL, IORING_OP_NOP }))
+		{
+			return false;
+		}
+
+		rings_size = std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+		rings = mmap(nullptr, rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+		if (rings == MAP_FAILED)
+		{
+			return false;
+		}
+
+		void* sqe_memory = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+		if (sqe_memory == MAP_FAILED)
+		{
+			return false;
+		}
+		sqes = static_cast<io_uring_sqe*>(sqe_memory);
+
+		Byte* base = static_cast<Byte*>(rings);
+		sq_head = reinterpret_cast<uint32_t*>(base + params.sq_off.head);
+		sq_tail = reinterpret_cast<uint32_t*>(base + params.sq_off.tail);
+		sq_mask = *reinterpret_cast<uint32_t*>(base + params.sq_off.ring_mask);
+		sq_array = reinterpret_cast<uint32_t*>(base + params.sq_off.array);
+		cq_head = reinterpret_cast<uint32_t*>(base + params.cq_off.head);
+		cq_tail = reinterpret_cast<uint32_t*>(base + params.cq_off.tail);
+		cq_mask = *reinterpret_cast<uint32_t*>(base + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+		reaper = std::thread(&IOUringBackend::reap_loop, this);
+		return true;
+	}
+
+	const char* get_name() const override { return "io_uring"; }
+
+	void queue(IORequest* request) override
+	{
+		if (request->is_cancelled.load(std::memory_order_relaxed) || !open(request))
+		{
+			on_complete(request);
+			return;
+		}
+
+		if (request->size == 0)
+		{
+			request->status = IOStatus::Completed;
+			finish(request);
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(submission_mutex);
+		push_read(request);
+	}
+
+	void submit() override
+	{
+		std::lock_guard<std::mutex> lock(submission_mutex);
+		flush();
+	}
+
+	void cancel(IORequest* request) override
+	{
+		std::lock_guard<std::mutex> lock(submission_mutex);
+		io_uring_sqe* sqe = get_sqe();
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->addr = reinterpret_cast<uint64_t>(request);
+		sqe->user_data = ignored_tag;
+		flush();
+	}
+
+private:
+	bool open(IORequest* request)
+	{
+		int file = ::open(request->path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file < 0)
+		{
+			request->status = IOStatus::Failed;
+			return false;
+		}
+
+		struct stat file_stat;
+		if (fstat(file, &file_stat) != 0 || request->offset > uint64_t(file_stat.st_size))
+		{
+			::close(file);
+			request->status = IOStatus::Failed;
+			return false;
+		}
+
+		size_t size = file_stat.st_size - request->offset;
+		request->size = request->size > 0 ? std::min(request->size, size) : size;
+
+		// Not value initialized, every byte is about to be overwritten
+		request->buffer = Ptr<Byte[]>(new Byte[request->size]);
+		request->native_file = file;
+		return true;
+	}
+
+	void finish(IORequest* request)
+	{
+		::close(int(request->native_file));
+		request->native_file = -1;
+		on_complete(request);
+	}
+
+	// Needs submission_mutex
+	io_uring_sqe* get_sqe()
+	{
+		uint32_t tail = *sq_tail;
+		if (tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) > sq_mask)
+		{
+			// Full, the kernel consumes entries during the enter call so this frees the whole ring
+			flush();
+			tail = *sq_tail;
+		}
+
+		uint32_t index = tail & sq_mask;
+		io_uring_sqe* sqe = &sqes[index];
+		*sqe = {};
+		sq_array[index] = index;
+		__atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+		pending_submissions++;
+		return sqe;
+	}
+
+	// Needs submission_mutex
+	void push_read(IORequest* request)
+	{
+		io_uring_sqe* sqe = get_sqe();
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = int(request->native_file);
+		sqe->off = request->offset + request->bytes_read;
+		sqe->addr = reinterpret_cast<uint64_t>(request->buffer.get() + request->bytes_read);
+		sqe->len = uint32_t(std::min(request->size - request->bytes_read, max_read_size));
+		sqe->user_data = reinterpret_cast<uint64_t>(request);
+	}
+
+	// Needs submission_mutex
+	void flush()
+	{
+		while (pending_submissions > 0)
+		{
+			int submitted = io_uring_enter(ring, pending_submissions, 0, 0);
+			if (submitted < 0)
+			{
+				if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+				{
+					continue;
+				}
+				ERR("io_uring submission failed: {}", errno);
+				return;
+			}
+			pending_submissions -= submitted;
+		}
+	}
+
+	void reap_loop()
+	{
+		PROFILE_THREAD("IO Reaper");
+
+		while (true)
+		{
+			if (io_uring_enter(ring, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+			{
+				ERR("io_uring wait failed: {}", errno);
+			}
+
+			uint32_t head = *cq_head;
+			uint32_t tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+			// The kernel orders the submission before its completion but that is invisible to the C++ memory model
+			// and to race detectors. Every read was pushed under this mutex, so taking it once per batch makes the
+			// request fields written before submission visible here.
+			{
+				std::lock_guard<std::mutex> lock(submission_mutex);
+			}
+
+			bool stop = false;
+			for (; head != tail; head++)
+			{
+				const io_uring_cqe& cqe = cqes[head & cq_mask];
+				if (cqe.user_data == stop_tag)
+				{
+					stop = true;
+				}
+				else if (cqe.user_data != ignored_tag)
+				{
+					handle_completion(reinterpret_cast<IORequest*>(cqe.user_data), cqe.res);
+				}
+			}
+			__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+			if (stop)
+			{
+				return;
+			}
+		}
+	}
+
+	void handle_completion(IORequest* request, int result)
+	{
+		if (result < 0 || (result == 0 && request->bytes_read < request->size))
+		{
+			request->status = request->is_cancelled.load(std::memory_order_relaxed) ? IOStatus::Cancelled : IOStatus::Failed;
+			finish(request);
+			return;
+		}
+
+		request->bytes_read += result;
+		if (request->bytes_read < request->size && !request->is_cancelled.load(std::memory_order_relaxed))
+		{
+			// Short read, continue where it stopped
+			std::lock_guard<std::mutex> lock(submission_mutex);
+			push_read(request);
+			flush();
+			return;
+		}
+
+		request->status = IOStatus::Completed;
+		finish(request);
+	}
+
+	CompletionHandler on_complete;
+
+	int ring = -1;
+	io_uring_params params = {};
+	void* rings = MAP_FAILED;
+	size_t rings_size = 0;
+	io_uring_sqe* sqes = nullptr;
+
+	uint32_t* sq_head = nullptr;
+	uint32_t* sq_tail = nullptr;
+	uint32_t* sq_array = nullptr;
+	uint32_t sq_mask = 0;
+	uint32_t* cq_head = nullptr;
+	uint32_t* cq_tail = nullptr;
+	io_uring_cqe* cqes = nullptr;
+	uint32_t cq_mask = 0;
+
+	std::mutex submission_mutex;
+	uint32_t pending_submissions = 0;
+	std::thread reaper;
+};
+}
+
+Ptr<AsyncIOBackend> AsyncIOBackend::create_native(uint32_t queue_depth, CompletionHandler on_complete)
+{
+	Ptr<IOUringBackend> backend = MakeUnique<IOUringBackend>(std::move(on_complete));
+	if (!backend->setup(queue_depth))
+	{
+		// Old kernels and sandboxes that filter the syscall
+		WARN("io_uring is unavailable ({}), falling back to blocking reads", errno);
+		return nullptr;
+	}
+	return backend;
+}
@@ -0,0 +1,178 @@
+#include "os/file_watcher.h"
+
+#include "core/log.h"
+
+#include <cerrno>
+#include <filesystem>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace
+{
+constexpr uint32_t watch_mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+
+// Editors save by writing in place (IN_CLOSE_WRITE) or by renaming a temporary over the file (IN_MOVED_TO)
+class InotifyFileWatcherBackend : public FileWatcherBackend
+{
+public:
+	~InotifyFileWatcherBackend()
+	{
+		if (inotify >= 0)
+		{
+			close(inotify);
+		}
+		if (wake_event >= 0)
+		{
+			close(wake_event);
+		}
+	}
+
+	bool setup()
+	{
+		inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		wake_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		return inotify >= 0 && wake_event >= 0;
+	}
+
+	const char* get_name() const override { return "inotify"; }
+
+	bool add_directory(const String& directory) override
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return add_recursive(directory, nullptr);
+	}
+
+	void wait(uint32_t timeout_ms, Vector<String>& changed) override
+	{
+		pollfd fds[2] = { { inotify, POLLIN, 0 }, { wake_event, POLLIN, 0 } };
+		if (poll(fds, 2, timeout_ms) <= 0)
+		{
+			return;
+		}
+
+		if (fds[1].revents & POLLIN)
+		{
+			// Resets the counter. EAGAIN only means another wait already did.
+			uint64_t count;
+			while (read(wake_event, &count, sizeof(count)) < 0 && errno == EINTR)
+			{
+			}
+		}
+
+		if (!(fds[0].revents & POLLIN))
+		{
+			return;
+		}
+
+		alignas(inotify_event) char buffer[4096];
+		std::lock_guard<std::mutex> lock(mutex);
+		while (true)
+		{
+			ssize_t size = read(inotify, buffer, sizeof(buffer));
+			if (size <= 0)
+			{
+				return;
+			}
+
+			for (char* it = buffer; it < buffer + size;)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(it);
+				it += sizeof(inotify_event) + event->len;
+				handle_event(*event, changed);
+			}
+		}
+	}
+
+	void wake() override
+	{
+		// EAGAIN means the counter is full, so the waiter is woken anyway
+		uint64_t count = 1;
+		while (write(wake_event, &count, sizeof(count)) < 0 && errno == EINTR)
+		{
+		}
+	}
+
+private:
+	// Needs mutex
+	void handle_event(const inotify_event& event, Vector<String>& changed)
+	{
+		if (event.mask & IN_Q_OVERFLOW)
+		{
+			WARN("Missed file changes, the inotify queue overflowed");
+			return;
+		}
+
+		if (event.mask & IN_IGNORED)
+		{
+			directories.erase(event.wd);
+			return;
+		}
+
+		auto directory = directories.find(event.wd);
+		if (directory == directories.end() || event.len == 0)
+		{
+			return;
+		}
+
+		String path = directory->second + "/" + event.name;
+		if (event.mask & IN_ISDIR)
+		{
+			// Files may land in a new directory before it is watched, so they are all reported
+			if (event.mask & (IN_CREATE | IN_MOVED_TO))
+			{
+				add_recursive(path, &changed);
+			}
+		}
+		else if (event.mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+		{
+			changed.push_back(std::move(path));
+		}
+	}
+
+	// Needs mutex
+	bool add_recursive(const String& directory, Vector<String>* existing_files)
+	{
+		int watch = inotify_add_watch(inotify, directory.c_str(), watch_mask);
+		if (watch < 0)
+		{
+			return false;
+		}
+		directories[watch] = directory;
+
+		std::error_code error;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+		{
+			String path = entry.path().generic_string();
+			if (entry.is_directory(error))
+			{
+				add_recursive(path, existing_files);
+			}
+			else if (existing_files)
+			{
+				existing_files->push_back(std::move(path));
+			}
+		}
+		return true;
+	}
+
+	int inotify = -1;
+	int wake_event = -1;
+
+	std::mutex mutex;
+	HashMap<int, String> directories;
+};
+}
+
+Ptr<FileWatcherBackend> FileWatcherBackend::create_native()
+{
+	Ptr<InotifyFileWatcherBackend> backend = MakeUnique<InotifyFileWatcherBackend>();
+	if (!backend->setup())
+	{
+		WARN("inotify is unavailable, falling back to polling for file changes");
+		return nullptr;
+	}
+	return backend;
+}
@@ -0,0 +1,96 @@
+#include "os/file_system.h"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+int to_advice(FileAccess access)
+{
+	switch (access)
+	{
+	case FileAccess::Sequential:
+		return MADV_SEQUENTIAL;
+	case FileAccess::Random:
+		return MADV_RANDOM;
+	default:
+		return MADV_NORMAL;
+	}
+}
+
+// madvise wants page aligned ranges, widen the range to the pages it touches
+void advise_range(const Byte* data, size_t data_size, size_t offset, size_t size, int advice)
+{
+	if (!data || offset >= data_size)
+	{
+		return;
+	}
+	static const size_t page_size = size_t(sysconf(_SC_PAGESIZE));
+	size_t begin = offset & ~(page_size - 1);
+	size_t end = std::min(offset + size, data_size);
+	madvise(const_cast<Byte*>(data) + begin, end - begin, advice);
+}
+}
+
+Optional<MappedFile> MappedFile::map(const String& path, FileAccess access)
+{
+	int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		return {};
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0)
+	{
+		::close(fd);
+		return {};
+	}
+
+	MappedFile mapped_file;
+	mapped_file.path = path;
+	mapped_file.mapped_size = file_stat.st_size;
+
+	// Empty files are valid but cannot be mapped
+	if (mapped_file.mapped_size > 0)
+	{
+		// Read-only shared mappings point straight at the page cache, so processes mapping the same file share memory
+		void* address = mmap(nullptr, mapped_file.mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+		if (address == MAP_FAILED)
+		{
+			::close(fd);
+			return {};
+		}
+		mapped_file.mapped_data = static_cast<const Byte*>(address);
+		madvise(address, mapped_file.mapped_size, to_advice(access));
+	}
+
+	// The mapping keeps its own reference to the file
+	::close(fd);
+
+	return mapped_file;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+	advise_range(mapped_data, mapped_size, offset, size, MADV_WILLNEED);
+}
+
+void MappedFile::release(size_t offset, size_t size) const
+{
+	advise_range(mapped_data, mapped_size, offset, size, MADV_DONTNEED);
+}
+
+void MappedFile::unmap()
+{
+	if (mapped_data)
+	{
+		munmap(const_cast<Byte*>(mapped_data), mapped_size);
+	}
+	mapped_data = nullptr;
+	mapped_size = 0;
+}
@@ -0,0 +1,590 @@
+#include "vulkan_allocator.h"
+
+#include "core/log.h"
+
+#include <algorithm>
+
+struct MemoryBlock
+{
+	MemoryBlock(VkDeviceMemory memory, uint32_t memory_type, VkDeviceSize size, void* mapped)
+	    : memory(memory)
+	    , memory_type(memory_type)
+	    , mapped(mapped)
+	    , allocator(size)
+	{
+	}
+
+	VkDeviceMemory memory;
+	uint32_t memory_type;
+	void* mapped;
+	TLSFAllocator allocator;
+};
+
+namespace
+{
+uint32_t count_bits(uint32_t value)
+{
+	uint32_t count = 0;
+	for (; value; value &= value - 1)
+	{
+		count++;
+	}
+	return count;
+}
+}
+
+VulkanAllocator::VulkanAllocator(VkPhysicalDevice gpu, VkDevice device, VkDeviceSize block_size)
+    : device(device)
+    , block_size(block_size)
+{
+	vkGetPhysicalDeviceMemoryProperties(gpu, &memory_properties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(gpu, &properties);
+	max_allocation_count = properties.limits.maxMemoryAllocationCount;
+}
+
+VulkanAllocator::~VulkanAllocator()
+{
+	Stats stats = get_stats();
+	if (stats.allocation_count > 0 || stats.dedicated_allocation_count > 0)
+	{
+		WARN("Destroying GPU allocator with {} live allocations", stats.allocation_count + stats.dedicated_allocation_count);
+	}
+
+	for (Pool& pool : pools)
+	{
+		for (Ptr<MemoryBlock>& block : pool.blocks)
+		{
+			free_device_memory(block->memory);
+		}
+	}
+}
+
+bool VulkanAllocator::allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, bool is_linear, bool dedicated, VulkanAllocation* out_allocation)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return allocate_locked(requirements, usage, is_linear, dedicated, out_allocation, VK_NULL_HANDLE, VK_NULL_HANDLE);
+}
+
+void VulkanAllocator::free(VulkanAllocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	free_locked(allocation);
+}
+
+bool VulkanAllocator::create_buffer(const VkBufferCreateInfo& buffer_info, MemoryUsage usage, VulkanBuffer* out_buffer)
+{
+	VkBuffer buffer;
+	if (vkCreateBuffer(device, &buffer_info, nullptr, &buffer) != VK_SUCCESS)
+	{
+		ERR("Could not create buffer of {} bytes", buffer_info.size);
+		return false;
+	}
+
+	VkBufferMemoryRequirementsInfo2 requirements_info = {};
+	requirements_info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+	requirements_info.buffer = buffer;
+
+	VkMemoryDedicatedRequirements dedicated_requirements = {};
+	dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements = {};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicated_requirements;
+	vkGetBufferMemoryRequirements2(device, &requirements_info, &requirements);
+
+	bool dedicated = dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+
+	VulkanAllocation allocation;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!allocate_locked(requirements.memoryRequirements, usage, true, dedicated, &allocation, buffer, VK_NULL_HANDLE))
+		{
+			vkDestroyBuffer(device, buffer, nullptr);
+			return false;
+		}
+	}
+
+	if (vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS)
+	{
+		ERR("Could not bind buffer memory");
+		free(allocation);
+		vkDestroyBuffer(device, buffer, nullptr);
+		return false;
+	}
+
+	out_buffer->buffer = buffer;
+	out_buffer->allocation = allocation;
+	return true;
+}
+
+void VulkanAllocator::destroy_buffer(VulkanBuffer& buffer)
+{
+	if (buffer.buffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(device, buffer.buffer, nullptr);
+	}
+	free(buffer.allocation);
+	buffer = {};
+}
+
+bool VulkanAllocator::create_image(const VkImageCreateInfo& image_info, MemoryUsage usage, VulkanImage* out_image)
+{
+	VkImage image;
+	if (vkCreateImage(device, &image_info, nullptr, &image) != VK_SUCCESS)
+	{
+		ERR("Could not create {}x{} image", image_info.extent.width, image_info.extent.height);
+		return false;
+	}
+
+	VkImageMemoryRequirementsInfo2 requirements_info = {};
+	requirements_info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+	requirements_info.image = image;
+
+	VkMemoryDedicatedRequirements dedicated_requirements = {};
+	dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements = {};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicated_requirements;
+	vkGetImageMemoryRequirements2(device, &requirements_info, &requirements);
+
+	bool dedicated = dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation;
+	bool is_linear = image_info.tiling == VK_IMAGE_TILING_LINEAR;
+
+	VulkanAllocation allocation;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!allocate_locked(requirements.memoryRequirements, usage, is_linear, dedicated, &allocation, VK_NULL_HANDLE, image))
+		{
+			vkDestroyImage(device, image, nullptr);
+			return false;
+		}
+	}
+
+	if (vkBindImageMemory(device, image, allocation.memory, allocation.offset) != VK_SUCCESS)
+	{
+		ERR("Could not bind image memory");
+		free(allocation);
+		vkDestroyImage(device, image, nullptr);
+		return false;
+	}
+
+	out_image->image = image;
+	out_image->allocation = allocation;
+	return true;
+}
+
+void VulkanAllocator::destroy_image(VulkanImage& image)
+{
+	if (image.image != VK_NULL_HANDLE)
+	{
+		vkDestroyImage(device, image.image, nullptr);
+	}
+	free(image.allocation);
+	image = {};
+}
+
+VulkanAllocator::Stats VulkanAllocator::get_stats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Stats stats;
+	for (const Pool& pool : pools)
+	{
+		for (const Ptr<MemoryBlock>& block : pool.blocks)
+		{
+			stats.block_count++;
+			stats.block_bytes += block->allocator.get_size();
+			stats.allocation_count += block->allocator.get_allocation_count();
+			stats.allocation_bytes += block->allocator.get_size() - block->allocator.get_free_size();
+			stats.largest_free_range = std::max(stats.largest_free_range, block->allocator.get_largest_free_range());
+		}
+	}
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+	{
+		stats.dedicated_allocation_count += dedicated_count[i];
+		stats.dedicated_allocation_bytes += dedicated_bytes[i];
+	}
+	stats.device_memory_count = device_memory_count;
+
+	return stats;
+}
+
+VulkanAllocator::Stats VulkanAllocator::get_heap_stats(uint32_t heap_index) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Stats stats;
+	for (const Pool& pool : pools)
+	{
+		if (memory_properties.memoryTypes[pool.memory_type].heapIndex != heap_index)
+		{
+			continue;
+		}
+
+		for (const Ptr<MemoryBlock>& block : pool.blocks)
+		{
+			stats.block_count++;
+			stats.block_bytes += block->allocator.get_size();
+			stats.allocation_count += block->allocator.get_allocation_count();
+			stats.allocation_bytes += block->allocator.get_size() - block->allocator.get_free_size();
+			stats.largest_free_range = std::max(stats.largest_free_range, block->allocator.get_largest_free_range());
+		}
+	}
+
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+	{
+		if (memory_properties.memoryTypes[i].heapIndex == heap_index)
+		{
+			stats.dedicated_allocation_count += dedicated_count[i];
+			stats.dedicated_allocation_bytes += dedicated_bytes[i];
+		}
+	}
+	stats.device_memory_count = stats.block_count + stats.dedicated_allocation_count;
+
+	return stats;
+}
+
+Vector<VulkanAllocator::DefragmentationMove> VulkanAllocator::plan_defragmentation(const Vector<VulkanAllocation*>& movable_allocations, VkDeviceSize max_bytes_to_move)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	Vector<DefragmentationMove> moves;
+	VkDeviceSize bytes_moved = 0;
+
+	for (Pool& pool : pools)
+	{
+		if (pool.blocks.size() < 2)
+		{
+			continue;
+		}
+
+		// Drain the emptiest blocks into the fullest ones
+		Vector<MemoryBlock*> blocks;
+		for (Ptr<MemoryBlock>& block : pool.blocks)
+		{
+			blocks.push_back(block.get());
+		}
+		std::sort(blocks.begin(), blocks.end(), [](const MemoryBlock* a, const MemoryBlock* b)
+		    { return a->allocator.get_free_size() < b->allocator.get_free_size(); });
+
+		for (size_t source = blocks.size() - 1; source > 0; source--)
+		{
+			for (VulkanAllocation* allocation : movable_allocations)
+			{
+				if (allocation->block != blocks[source])
+				{
+					continue;
+				}
+
+				if (bytes_moved + allocation->size > max_bytes_to_move)
+				{
+					return moves;
+				}
+
+				for (size_t destination = 0; destination < source; destination++)
+				{
+					MemoryBlock* block = blocks[destination];
+					Optional<TLSFAllocator::Allocation> range = block->allocator.allocate(allocation->size, allocation->alignment);
+					if (!range)
+					{
+						continue;
+					}
+
+					DefragmentationMove move;
+					move.allocation = allocation;
+					move.destination = *allocation;
+					move.destination.memory = block->memory;
+					move.destination.offset = range->offset;
+					move.destination.block = block;
+					move.destination.node = range->node;
+					move.destination.mapped = block->mapped ? static_cast<Byte*>(block->mapped) + range->offset : nullptr;
+					moves.push_back(move);
+
+					bytes_moved += allocation->size;
+					break;
+				}
+			}
+		}
+	}
+
+	return moves;
+}
+
+void VulkanAllocator::finish_defragmentation(Vector<DefragmentationMove>& moves)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (DefragmentationMove& move : moves)
+		{
+			free_locked(*move.allocation);
+			*move.allocation = move.destination;
+		}
+	}
+	moves.clear();
+
+	release_empty_blocks();
+}
+
+void VulkanAllocator::release_empty_blocks()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (Pool& pool : pools)
+	{
+		bool kept_spare = false;
+		for (size_t i = 0; i < pool.blocks.size();)
+		{
+			MemoryBlock* block = pool.blocks[i].get();
+			if (!block->allocator.is_empty() || !kept_spare)
+			{
+				kept_spare |= block->allocator.is_empty();
+				i++;
+				continue;
+			}
+
+			free_device_memory(block->memory);
+			pool.blocks.erase(pool.blocks.begin() + i);
+		}
+	}
+}
+
+Optional<uint32_t> VulkanAllocator::find_memory_type(uint32_t type_bits, MemoryUsage usage) const
+{
+	VkMemoryPropertyFlags required = 0;
+	VkMemoryPropertyFlags preferred = 0;
+	VkMemoryPropertyFlags avoided = 0;
+	switch (usage)
+	{
+	case MemoryUsage::GPUOnly:
+		preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		avoided = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		break;
+	case MemoryUsage::CPUToGPU:
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		avoided = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		break;
+	case MemoryUsage::GPUToCPU:
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		break;
+	}
+
+	Optional<uint32_t> best_type;
+	int32_t best_score = -1;
+	for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
+	{
+		VkMemoryPropertyFlags flags = memory_properties.memoryTypes[i].propertyFlags;
+		if (!(type_bits & (1u << i)) || (flags & required) != required)
+		{
+			continue;
+		}
+
+		int32_t score = int32_t(count_bits(flags & preferred)) * 2 - int32_t(count_bits(flags & avoided));
+		if (score > best_score)
+		{
+			best_score = score;
+			best_type = i;
+		}
+	}
+
+	return best_type;
+}
+
+VulkanAllocator::Pool& VulkanAllocator::get_pool(uint32_t memory_type, bool is_linear)
+{
+	for (Pool& pool : pools)
+	{
+		if (pool.memory_type == memory_type && pool.is_linear == is_linear)
+		{
+			return pool;
+		}
+	}
+
+	Pool pool;
+	pool.memory_type = memory_type;
+	pool.is_linear = is_linear;
+	pools.push_back(std::move(pool));
+	return pools.back();
+}
+
+bool VulkanAllocator::allocate_locked(const VkMemoryRequirements& requirements, MemoryUsage usage, bool is_linear, bool dedicated, VulkanAllocation* out_allocation, VkBuffer buffer, VkImage image)
+{
+	// Resources that would eat most of a block are cheaper to give their own allocation
+	dedicated |= requirements.size > block_size / 2;
+
+	// Walk down the list of acceptable memory types until one of them has room
+	uint32_t type_bits = requirements.memoryTypeBits;
+	while (Optional<uint32_t> memory_type = find_memory_type(type_bits, usage))
+	{
+		if (!dedicated && allocate_from_pool(get_pool(*memory_type, is_linear), requirements, out_allocation))
+		{
+			return true;
+		}
+
+		if (allocate_dedicated(*memory_type, requirements.size, out_allocation, buffer, image))
+		{
+			return true;
+		}
+
+		type_bits &= ~(1u << *memory_type);
+	}
+
+	ERR("Out of GPU memory for an allocation of {} bytes", requirements.size);
+	return false;
+}
+
+void VulkanAllocator::free_locked(VulkanAllocation& allocation)
+{
+	if (!allocation.is_valid())
+	{
+		return;
+	}
+
+	if (allocation.block)
+	{
+		allocation.block->allocator.free(allocation.node);
+	}
+	else
+	{
+		dedicated_count[allocation.memory_type]--;
+		dedicated_bytes[allocation.memory_type] -= allocation.size;
+		free_device_memory(allocation.memory);
+	}
+
+	allocation = {};
+}
+
+bool VulkanAllocator::allocate_from_pool(Pool& pool, const VkMemoryRequirements& requirements, VulkanAllocation* out_allocation)
+{
+	auto sub_allocate = [&](MemoryBlock* block)
+	{
+		Optional<TLSFAllocator::Allocation> range = block->allocator.allocate(requirements.size, requirements.alignment);
+		if (!range)
+		{
+			return false;
+		}
+
+		out_allocation->memory = block->memory;
+		out_allocation->offset = range->offset;
+		out_allocation->size = range->size;
+		out_allocation->alignment = requirements.alignment;
+		out_allocation->memory_type = block->memory_type;
+		out_allocation->mapped = block->mapped ? static_cast<Byte*>(block->mapped) + range->offset : nullptr;
+		out_allocation->block = block;
+		out_allocation->node = range->node;
+		return true;
+	};
+
+	for (Ptr<MemoryBlock>& block : pool.blocks)
+	{
+		if (sub_allocate(block.get()))
+		{
+			return true;
+		}
+	}
+
+	// Small heaps (e.g. the host visible window into VRAM) would be exhausted by a few full sized blocks
+	uint32_t heap_index = memory_properties.memoryTypes[pool.memory_type].heapIndex;
+	VkDeviceSize new_block_size = std::min(block_size, memory_properties.memoryHeaps[heap_index].size / 8);
+
+	// Under memory pressure, retry with smaller blocks as long as they can still fit the request
+	for (; new_block_size >= requirements.size + requirements.alignment; new_block_size /= 2)
+	{
+		VkDeviceMemory memory = allocate_device_memory(pool.memory_type, new_block_size, nullptr);
+		if (memory == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		void* mapped = nullptr;
+		if (memory_properties.memoryTypes[pool.memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+			{
+				ERR("Could not map memory block of {} bytes", new_block_size);
+				free_device_memory(memory);
+				return false;
+			}
+		}
+
+		pool.blocks.push_back(MakeUnique<MemoryBlock>(memory, pool.memory_type, new_block_size, mapped));
+		DEBUG("Reserved GPU memory block {} of {} MiB in memory type {}", pool.blocks.size(), new_block_size / (1024 * 1024), pool.memory_type);
+
+		return sub_allocate(pool.blocks.back().get());
+	}
+
+	return false;
+}
+
+bool VulkanAllocator::allocate_dedicated(uint32_t memory_type, VkDeviceSize size, VulkanAllocation* out_allocation, VkBuffer buffer, VkImage image)
+{
+	VkMemoryDedicatedAllocateInfo dedicated_info = {};
+	dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicated_info.buffer = buffer;
+	dedicated_info.image = image;
+
+	bool has_resource = buffer != VK_NULL_HANDLE || image != VK_NULL_HANDLE;
+	VkDeviceMemory memory = allocate_device_memory(memory_type, size, has_resource ? &dedicated_info : nullptr);
+	if (memory == VK_NULL_HANDLE)
+	{
+		return false;
+	}
+
+	void* mapped = nullptr;
+	if (memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		{
+			ERR("Could not map dedicated allocation of {} bytes", size);
+			free_device_memory(memory);
+			return false;
+		}
+	}
+
+	dedicated_count[memory_type]++;
+	dedicated_bytes[memory_type] += size;
+
+	*out_allocation = {};
+	out_allocation->memory = memory;
+	out_allocation->offset = 0;
+	out_allocation->size = size;
+	out_allocation->memory_type = memory_type;
+	out_allocation->mapped = mapped;
+	return true;
+}
+
+VkDeviceMemory VulkanAllocator::allocate_device_memory(uint32_t memory_type, VkDeviceSize size, const void* next)
+{
+	if (device_memory_count >= max_allocation_count)
+	{
+		ERR("Reached the device limit of {} memory allocations", max_allocation_count);
+		return VK_NULL_HANDLE;
+	}
+
+	VkMemoryAllocateInfo allocate_info = {};
+	allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocate_info.pNext = next;
+
+	allocate_info.allocationSize = size;
+	allocate_info.memoryTypeIndex = memory_type;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(device, &allocate_info, nullptr, &memory) != VK_SUCCESS)
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	device_memory_count++;
+	return memory;
+}
+
+void VulkanAllocator::free_device_memory(VkDeviceMemory memory)
+{
+	// Mapped memory is implicitly unmapped when freed
+	vkFreeMemory(device, memory, nullptr);
+	device_memory_count--;
+}
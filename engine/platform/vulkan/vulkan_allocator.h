@@ -0,0 +1,142 @@
+#pragma once
+
+#include "common.h"
+#include "vulkan_tlsf.h"
+
+#include "vulkan/vulkan.h"
+
+#include <mutex>
+
+enum class MemoryUsage
+{
+	GPUOnly, // Device local, filled through transfers
+	CPUToGPU, // Host visible and persistently mapped, written by the CPU every frame or used as staging
+	GPUToCPU // Host visible and cached, for reading results back
+};
+
+struct MemoryBlock;
+
+struct VulkanAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	VkDeviceSize alignment = 1;
+	uint32_t memory_type = 0;
+
+	// Points at offset inside the memory if it is host visible
+	void* mapped = nullptr;
+
+	// Owning block, null for dedicated allocations
+	MemoryBlock* block = nullptr;
+	uint32_t node = TLSFAllocator::invalid_node;
+
+	bool is_valid() const { return memory != VK_NULL_HANDLE; }
+	bool is_dedicated() const { return is_valid() && !block; }
+};
+
+struct VulkanBuffer
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VulkanAllocation allocation;
+};
+
+struct VulkanImage
+{
+	VkImage image = VK_NULL_HANDLE;
+	VulkanAllocation allocation;
+};
+
+// Reserves large VkDeviceMemory blocks per memory type and sub-allocates resources out of them,
+// so the number of vkAllocateMemory calls stays far below maxMemoryAllocationCount.
+// Thread safe.
+class VulkanAllocator
+{
+public:
+	static constexpr VkDeviceSize default_block_size = VkDeviceSize(64) * 1024 * 1024;
+
+	VulkanAllocator(VkPhysicalDevice gpu, VkDevice device, VkDeviceSize block_size = default_block_size);
+	~VulkanAllocator();
+
+	VulkanAllocator(const VulkanAllocator&) = delete;
+	VulkanAllocator(VulkanAllocator&&) = delete;
+	VulkanAllocator& operator=(const VulkanAllocator&) = delete;
+	VulkanAllocator& operator=(VulkanAllocator&&) = delete;
+
+	// Linear resources (buffers, linear images) and optimal images never share a block, which keeps
+	// bufferImageGranularity from ever applying between neighbouring sub-allocations.
+	bool allocate(const VkMemoryRequirements& requirements, MemoryUsage usage, bool is_linear, bool dedicated, VulkanAllocation* out_allocation);
+	void free(VulkanAllocation& allocation);
+
+	bool create_buffer(const VkBufferCreateInfo& buffer_info, MemoryUsage usage, VulkanBuffer* out_buffer);
+	void destroy_buffer(VulkanBuffer& buffer);
+
+	bool create_image(const VkImageCreateInfo& image_info, MemoryUsage usage, VulkanImage* out_image);
+	void destroy_image(VulkanImage& image);
+
+	struct Stats
+	{
+		uint32_t block_count = 0;
+		VkDeviceSize block_bytes = 0;
+
+		uint32_t allocation_count = 0;
+		VkDeviceSize allocation_bytes = 0;
+
+		uint32_t dedicated_allocation_count = 0;
+		VkDeviceSize dedicated_allocation_bytes = 0;
+
+		// Number of live vkAllocateMemory allocations, to compare against maxMemoryAllocationCount
+		uint32_t device_memory_count = 0;
+		VkDeviceSize largest_free_range = 0;
+	};
+	Stats get_stats() const;
+	Stats get_heap_stats(uint32_t heap_index) const;
+
+	// Defragmentation hooks.
+	//
+	// plan_defragmentation() picks allocations from the emptiest blocks and reserves new homes for them
+	// in fuller ones. The caller copies the contents and rebinds its resources to each move's destination,
+	// and once the GPU is done with the old copies finish_defragmentation() releases the sources and
+	// writes the destinations back into the callers' allocations.
+	struct DefragmentationMove
+	{
+		VulkanAllocation* allocation;
+		VulkanAllocation destination;
+	};
+	Vector<DefragmentationMove> plan_defragmentation(const Vector<VulkanAllocation*>& movable_allocations, VkDeviceSize max_bytes_to_move);
+	void finish_defragmentation(Vector<DefragmentationMove>& moves);
+
+	// Returns empty blocks to the driver, keeping at most one spare block per pool
+	void release_empty_blocks();
+
+private:
+	struct Pool
+	{
+		uint32_t memory_type;
+		bool is_linear;
+		Vector<Ptr<MemoryBlock>> blocks;
+	};
+
+	Optional<uint32_t> find_memory_type(uint32_t type_bits, MemoryUsage usage) const;
+	Pool& get_pool(uint32_t memory_type, bool is_linear);
+
+	bool allocate_from_pool(Pool& pool, const VkMemoryRequirements& requirements, VulkanAllocation* out_allocation);
+	bool allocate_dedicated(uint32_t memory_type, VkDeviceSize size, VulkanAllocation* out_allocation, VkBuffer buffer, VkImage image);
+	VkDeviceMemory allocate_device_memory(uint32_t memory_type, VkDeviceSize size, const void* next);
+	void free_device_memory(VkDeviceMemory memory);
+
+	bool allocate_locked(const VkMemoryRequirements& requirements, MemoryUsage usage, bool is_linear, bool dedicated, VulkanAllocation* out_allocation, VkBuffer buffer, VkImage image);
+	void free_locked(VulkanAllocation& allocation);
+
+	VkDevice device;
+	VkPhysicalDeviceMemoryProperties memory_properties;
+	VkDeviceSize block_size;
+	uint32_t max_allocation_count;
+
+	mutable std::mutex mutex;
+	Vector<Pool> pools;
+
+	uint32_t device_memory_count = 0;
+	uint32_t dedicated_count[VK_MAX_MEMORY_TYPES] = {};
+	VkDeviceSize dedicated_bytes[VK_MAX_MEMORY_TYPES] = {};
+};
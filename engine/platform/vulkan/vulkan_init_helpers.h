@@ -1,7 +1,19 @@
 #pragma once
 
+#include "core/log.h"
+
 #include "vulkan/vulkan.h"
 
+#define VK_CHECK(x)                      \
+	do                                   \
+	{                                    \
+		VkResult err = x;                \
+		if (err)                         \
+		{                                \
+			CRITICAL("Vulkan: {}", err); \
+		}                                \
+	} while (0)
+
 namespace VulkanInit
 {
 VkCommandPoolCreateInfo command_pool_create_info(uint32_t queue_family, VkCommandPoolCreateFlags flags = 0);
@@ -0,0 +1,123 @@
+#include "vulkan_pipeline_cache.h"
+
+#include "core/hash.h"
+#include "core/log.h"
+#include "os/file_system.h"
+
+#include <cstring>
+
+VulkanPipelineCache::VulkanPipelineCache(VkDevice device, VkPhysicalDevice gpu, const String& cache_path)
+    : device(device)
+    , path(cache_path)
+{
+	vkGetPhysicalDeviceProperties(gpu, &gpu_properties);
+
+	VkPipelineCacheCreateInfo create_info = {};
+	create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	create_info.pNext = nullptr;
+
+	// Keep the mapping alive until the driver has consumed the initial data
+	Optional<MappedFile> file = MappedFile::map(path);
+	if (file && is_compatible(file->data(), file->size()))
+	{
+		create_info.initialDataSize = file->size() - sizeof(FileHeader);
+		create_info.pInitialData = file->data() + sizeof(FileHeader);
+		INFO("Loaded {} bytes of pipeline cache from {}", create_info.initialDataSize, path);
+	}
+
+	if (vkCreatePipelineCache(device, &create_info, nullptr, &pipeline_cache) != VK_SUCCESS)
+	{
+		ERR("Could not create pipeline cache");
+
+		// Let pipelines be created without a cache rather than failing outright
+		pipeline_cache = VK_NULL_HANDLE;
+		return;
+	}
+	loaded_size = create_info.initialDataSize;
+}
+
+VulkanPipelineCache::~VulkanPipelineCache()
+{
+	if (pipeline_cache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	save();
+	vkDestroyPipelineCache(device, pipeline_cache, nullptr);
+}
+
+void VulkanPipelineCache::save() const
+{
+	if (pipeline_cache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	size_t data_size = 0;
+	if (vkGetPipelineCacheData(device, pipeline_cache, &data_size, nullptr) != VK_SUCCESS || data_size == 0)
+	{
+		return;
+	}
+
+	Vector<Byte> blob(sizeof(FileHeader) + data_size);
+	if (vkGetPipelineCacheData(device, pipeline_cache, &data_size, blob.data() + sizeof(FileHeader)) != VK_SUCCESS)
+	{
+		ERR("Could not read back pipeline cache data");
+		return;
+	}
+
+	FileHeader header;
+	header.magic = file_magic;
+	header.driver_version = gpu_properties.driverVersion;
+	header.data_size = data_size;
+	header.data_hash = Hash::fnv1a64(blob.data() + sizeof(FileHeader), data_size);
+	std::memcpy(blob.data(), &header, sizeof(FileHeader));
+
+	if (FileSystem::write_file(path, blob.data(), sizeof(FileHeader) + data_size))
+	{
+		DEBUG("Saved {} bytes of pipeline cache to {}", data_size, path);
+	}
+}
+
+bool VulkanPipelineCache::is_compatible(const Byte* data, size_t size) const
+{
+	if (size < sizeof(FileHeader) + sizeof(VkPipelineCacheHeaderVersionOne))
+	{
+		return false;
+	}
+
+	FileHeader header;
+	std::memcpy(&header, data, sizeof(FileHeader));
+	if (header.magic != file_magic || header.data_size != size - sizeof(FileHeader))
+	{
+		WARN("Discarding malformed pipeline cache: {}", path);
+		return false;
+	}
+
+	if (header.driver_version != gpu_properties.driverVersion)
+	{
+		INFO("Discarding pipeline cache written by a different driver version: {}", path);
+		return false;
+	}
+
+	const Byte* driver_data = data + sizeof(FileHeader);
+	if (header.data_hash != Hash::fnv1a64(driver_data, header.data_size))
+	{
+		WARN("Discarding corrupted pipeline cache: {}", path);
+		return false;
+	}
+
+	VkPipelineCacheHeaderVersionOne driver_header;
+	std::memcpy(&driver_header, driver_data, sizeof(VkPipelineCacheHeaderVersionOne));
+	if (driver_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+	    || driver_header.vendorID != gpu_properties.vendorID
+	    || driver_header.deviceID != gpu_properties.deviceID
+	    || std::memcmp(driver_header.pipelineCacheUUID, gpu_properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		INFO("Discarding pipeline cache written by a different GPU or driver: {}", path);
+		return false;
+	}
+
+	return true;
+}
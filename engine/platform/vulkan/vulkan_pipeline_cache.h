@@ -0,0 +1,46 @@
+#pragma once
+
+#include "common.h"
+
+#include "vulkan/vulkan.h"
+
+// VkPipelineCache that is loaded from and saved to disk so that pipelines compiled in a previous run are reused.
+// Data written by a different GPU or driver is discarded instead of being handed to the driver.
+class VulkanPipelineCache
+{
+public:
+	VulkanPipelineCache(VkDevice device, VkPhysicalDevice gpu, const String& cache_path);
+	~VulkanPipelineCache();
+
+	VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+	VulkanPipelineCache(VulkanPipelineCache&&) = delete;
+	VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+	VulkanPipelineCache& operator=(VulkanPipelineCache&&) = delete;
+
+	VkPipelineCache get() const { return pipeline_cache; }
+
+	// Bytes of driver data taken from the file, 0 when it was missing or discarded
+	size_t get_loaded_size() const { return loaded_size; }
+
+	void save() const;
+
+private:
+	static constexpr uint32_t file_magic = 0x4350504b; // "KPPC"
+
+	// Prepended to the driver's data. The driver's own header does not carry the driver version.
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t driver_version;
+		uint64_t data_size;
+		uint64_t data_hash;
+	};
+
+	bool is_compatible(const Byte* data, size_t size) const;
+
+	VkDevice device;
+	VkPhysicalDeviceProperties gpu_properties;
+	VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+	String path;
+	size_t loaded_size = 0;
+};
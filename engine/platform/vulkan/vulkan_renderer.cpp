@@ -1,32 +1,97 @@
 #include "vulkan_renderer.h"
 
+#include "core/hash.h"
+#include "core/job_system.h"
 #include "core/log.h"
 #include "core/math.h"
+#include "core/profiler.h"
 #include "os/file_system.h"
 #include "vulkan_init_helpers.h"
 #include "platform/glfw/glfw_window.h"
 
 #include "VkBootstrap.h"
 
-#define VK_CHECK(x)                      \
-	do                                   \
-	{                                    \
-		VkResult err = x;                \
-		if (err)                         \
-		{                                \
-			CRITICAL("Vulkan: {}", err); \
-		}                                \
-	} while (0)
+#ifdef KRONIC_RUNTIME_SHADER_COMPILATION
+#include "shaderc/shaderc.hpp"
+#else
+#include "embedded_shaders.h"
+#endif
+
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+constexpr VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+// In order of preference, vk-bootstrap settles for FIFO when none of them are supported. MAILBOX and IMMEDIATE
+// stand in for each other since both present without waiting for vblank.
+Vector<VkPresentModeKHR> get_present_mode_preferences(PresentMode present_mode)
+{
+	switch (present_mode)
+	{
+	case PresentMode::FifoRelaxed:
+		return { VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+	case PresentMode::Mailbox:
+		return { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+	case PresentMode::Immediate:
+		return { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+	case PresentMode::Fifo:
+		break;
+	}
+	return { VK_PRESENT_MODE_FIFO_KHR };
+}
+
+const char* get_present_mode_name(VkPresentModeKHR present_mode)
+{
+	switch (present_mode)
+	{
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "IMMEDIATE";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "MAILBOX";
+	case VK_PRESENT_MODE_FIFO_KHR:
+		return "FIFO";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		return "FIFO_RELAXED";
+	default:
+		return "unknown";
+	}
+}
+}
 
-VulkanRenderer::VulkanRenderer(const char* app_name, const GLFWWindow* window)
+VulkanRenderer::VulkanRenderer(const char* app_name, const GLFWWindow* window, uint32_t frames_in_flight, PresentMode present_mode)
+    : window(window)
+    , present_mode(present_mode)
 {
+	frames_in_flight = std::clamp(frames_in_flight, 1u, max_frames_in_flight);
+
 	build_vulkan_contexts(app_name, window);
-	build_swapchain(window->get_width(), window->get_height());
-	build_queue_and_command_buffers();
-	build_default_render_pass();
-	build_framebuffers();
-	build_sync_objects();
-	build_pipelines();
+	allocator = MakeUnique<VulkanAllocator>(gpu, device);
+
+	uint32_t width;
+	uint32_t height;
+	window->get_framebuffer_size(width, height);
+	if (!build_swapchain(width, height))
+	{
+		CRITICAL("Could not create the swapchain");
+		return;
+	}
+	build_queue_and_command_buffers(frames_in_flight);
+	build_render_resources();
+
+	is_ok = true;
+}
+
+VulkanRenderer::VulkanRenderer(const char* app_name, uint32_t width, uint32_t height, uint32_t frames_in_flight)
+{
+	frames_in_flight = std::clamp(frames_in_flight, 1u, max_frames_in_flight);
+
+	build_vulkan_contexts(app_name, nullptr);
+	allocator = MakeUnique<VulkanAllocator>(gpu, device);
+	build_queue_and_command_buffers(frames_in_flight);
+	build_offscreen_targets(width, height);
+	build_render_resources();
 
 	is_ok = true;
 }
@@ -38,23 +103,52 @@ VulkanRenderer::~VulkanRenderer()
 		return;
 	}
 
-	VK_CHECK(vkWaitForFences(device, 1, &render_fence, true, uint64_t(1) * Convert::s_to_ns));
+#ifdef KRONIC_RUNTIME_SHADER_COMPILATION
+	JobSystem::get_singleton()->wait(shader_reload_counter);
+	vkDestroyPipeline(device, reloaded_pipeline.exchange(VK_NULL_HANDLE), nullptr);
+#endif
+
+	// Readbacks still in flight are dropped
+	wait_for_frames();
+
+	INFO("Frame stalls: average {:.3f} ms, worst {:.3f} ms", frame_stats.average_stall_ns / 1e6, frame_stats.max_stall_ns / 1e6);
 
-	vkDestroyCommandPool(device, graphics_queue_command_pool, nullptr);
+	destroy_retired_swapchains(true);
 	vkDestroySwapchainKHR(device, swapchain, nullptr);
 
-	vkDestroySemaphore(device, present_semaphore, nullptr);
-	vkDestroySemaphore(device, render_semaphore, nullptr);
-	vkDestroyFence(device, render_fence, nullptr);
+	for (FrameData& frame : frames)
+	{
+		vkDestroyCommandPool(device, frame.command_pool, nullptr);
+		vkDestroySemaphore(device, frame.present_semaphore, nullptr);
+		vkDestroySemaphore(device, frame.render_semaphore, nullptr);
+		vkDestroyFence(device, frame.render_fence, nullptr);
+		vkDestroyQueryPool(device, frame.timestamp_pool, nullptr);
+		allocator->destroy_buffer(frame.readback_buffer);
+	}
 
 	vkDestroyRenderPass(device, render_pass, nullptr);
 
+	for (const RetiredPipeline& retired : retired_pipelines)
+	{
+		vkDestroyPipeline(device, retired.pipeline, nullptr);
+	}
+	vkDestroyPipeline(device, triangle_pipeline, nullptr);
+	vkDestroyPipelineLayout(device, triangle_pipeline_layout, nullptr);
+
+	pipeline_cache.reset();
+
 	for (int i = 0; i < swapchain_image_views.size(); i++)
 	{
 		vkDestroyFramebuffer(device, framebuffers[i], nullptr);
 		vkDestroyImageView(device, swapchain_image_views[i], nullptr);
 	}
+	for (VulkanImage& image : offscreen_images)
+	{
+		allocator->destroy_image(image);
+	}
 
+	uploader.reset();
+	allocator.reset();
 	vkDestroyDevice(device, nullptr);
 	vkDestroySurfaceKHR(instance, surface, nullptr);
 	vkb::destroy_debug_utils_messenger(instance, debug_messenger);
@@ -63,13 +157,74 @@ VulkanRenderer::~VulkanRenderer()
 
 void VulkanRenderer::draw()
 {
-	VK_CHECK(vkWaitForFences(device, 1, &render_fence, true, 1 * Convert::s_to_ns));
-	VK_CHECK(vkResetFences(device, 1, &render_fence));
+	PROFILE_FUNCTION();
+
+	FrameData& frame = get_current_frame();
+
+	// Only blocks if the GPU is still working on the frame that last used these resources
+	auto stall_start = std::chrono::steady_clock::now();
+	{
+		PROFILE_SCOPE("Wait for frame");
+		VK_CHECK(vkWaitForFences(device, 1, &frame.render_fence, true, 1 * Convert::s_to_ns));
+	}
+	auto stall_end = std::chrono::steady_clock::now();
+	frame_stats.record_stall(std::chrono::duration_cast<std::chrono::nanoseconds>(stall_end - stall_start).count());
+
+	// Headless frames each own an offscreen image
+	uint32_t image_index = frame_number % frames.size();
+	if (!is_headless())
+	{
+		PROFILE_SCOPE("Acquire image");
+		destroy_retired_swapchains();
+
+		// Frames that return early leave the fence signalled, so the next draw() does not wait on it
+		if (is_swapchain_dirty && !recreate_swapchain())
+		{
+			return;
+		}
+
+		VkResult result = vkAcquireNextImageKHR(device, swapchain, 1 * Convert::s_to_ns, frame.present_semaphore, nullptr, &image_index);
+
+		// The window changed after the last resize event, replacing the swapchain right away keeps the frame
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			if (!recreate_swapchain())
+			{
+				return;
+			}
+			result = vkAcquireNextImageKHR(device, swapchain, 1 * Convert::s_to_ns, frame.present_semaphore, nullptr, &image_index);
+		}
+
+		// Suboptimal images can still be presented, the swapchain is replaced on the next frame
+		if (result == VK_SUBOPTIMAL_KHR)
+		{
+			is_swapchain_dirty = true;
+		}
+		else if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			is_swapchain_dirty = true;
+			return;
+		}
+		else
+		{
+			VK_CHECK(result);
+		}
+	}
+
+	VK_CHECK(vkResetFences(device, 1, &frame.render_fence));
+	read_timestamps(frame);
+	deliver_readback(frame);
 
-	uint32_t swapchain_image_index = 0;
-	VK_CHECK(vkAcquireNextImageKHR(device, swapchain, 1 * Convert::s_to_ns, present_semaphore, nullptr, &swapchain_image_index));
+#ifdef KRONIC_RUNTIME_SHADER_COMPILATION
+	swap_reloaded_pipeline();
+#endif
+	destroy_retired_pipelines();
 
-	VK_CHECK(vkResetCommandBuffer(graphics_queue_command_buffer, 0));
+	// Everything uploaded since the last frame goes out in a single transfer submit
+	uint64_t upload_timeline_value = uploader->flush();
+
+	VkCommandBuffer cmd = frame.command_buffer;
+	VK_CHECK(vkResetCommandPool(device, frame.command_pool, 0));
 	VkCommandBufferBeginInfo cmd_begin_info = {};
 	cmd_begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	cmd_begin_info.pNext = nullptr;
@@ -77,8 +232,16 @@ void VulkanRenderer::draw()
 	cmd_begin_info.pInheritanceInfo = nullptr;
 	cmd_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	VK_CHECK(vkBeginCommandBuffer(graphics_queue_command_buffer, &cmd_begin_info));
+	VK_CHECK(vkBeginCommandBuffer(cmd, &cmd_begin_info));
 	{
+		uploader->record_acquire_barriers(cmd);
+
+		if (frame.timestamp_pool)
+		{
+			vkCmdResetQueryPool(cmd, frame.timestamp_pool, 0, 2);
+			vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestamp_pool, 0);
+		}
+
 		VkRenderPassBeginInfo render_pass_begin_info = {};
 		render_pass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		render_pass_begin_info.pNext = nullptr;
@@ -88,7 +251,7 @@ void VulkanRenderer::draw()
 		render_pass_begin_info.renderArea.offset.y = 0;
 		render_pass_begin_info.renderArea.extent.width = swapchain_image_width;
 		render_pass_begin_info.renderArea.extent.height = swapchain_image_height;
-		render_pass_begin_info.framebuffer = framebuffers[swapchain_image_index];
+		render_pass_begin_info.framebuffer = framebuffers[image_index];
 
 		VkClearValue clear_value = {};
 		float flash = std::abs(std::sin(frame_number / 120.0f));
@@ -97,68 +260,236 @@ void VulkanRenderer::draw()
 		render_pass_begin_info.clearValueCount = 1;
 		render_pass_begin_info.pClearValues = &clear_value;
 
-		vkCmdBeginRenderPass(graphics_queue_command_buffer, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(cmd, &render_pass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
 		{
-			vkCmdBindPipeline(graphics_queue_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, triangle_pipeline);
-			vkCmdDraw(graphics_queue_command_buffer, 3, 1, 0, 0);
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, triangle_pipeline);
+
+			VkViewport viewport = { 0.0f, 0.0f, float(swapchain_image_width), float(swapchain_image_height), 0.0f, 1.0f };
+			VkRect2D scissor = { { 0, 0 }, { swapchain_image_width, swapchain_image_height } };
+			vkCmdSetViewport(cmd, 0, 1, &viewport);
+			vkCmdSetScissor(cmd, 0, 1, &scissor);
+			vkCmdDraw(cmd, 3, 1, 0, 0);
+		}
+		vkCmdEndRenderPass(cmd);
+
+		// The render pass leaves headless images in TRANSFER_SRC_OPTIMAL with a dependency on the copy
+		if (pending_readback)
+		{
+			VkBufferImageCopy region = {};
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent = { swapchain_image_width, swapchain_image_height, 1 };
+			vkCmdCopyImageToBuffer(cmd, swapchain_images[image_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, frame.readback_buffer.buffer, 1, &region);
+
+			VkBufferMemoryBarrier host_barrier = {};
+			host_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			host_barrier.pNext = nullptr;
+			host_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			host_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			host_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			host_barrier.buffer = frame.readback_buffer.buffer;
+			host_barrier.size = VK_WHOLE_SIZE;
+			vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &host_barrier, 0, nullptr);
+
+			frame.readback_callback = std::move(pending_readback);
+			pending_readback = nullptr;
+		}
+
+		if (frame.timestamp_pool)
+		{
+			vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestamp_pool, 1);
+			frame.has_timestamps = true;
 		}
-		vkCmdEndRenderPass(graphics_queue_command_buffer);
 	}
-	VK_CHECK(vkEndCommandBuffer(graphics_queue_command_buffer));
+	VK_CHECK(vkEndCommandBuffer(cmd));
 
 	VkSubmitInfo submit = {};
 	submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit.pNext = nullptr;
-
-	VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	submit.pWaitDstStageMask = &wait_stage;
-	submit.waitSemaphoreCount = 1;
-	submit.pWaitSemaphores = &present_semaphore;
-	submit.signalSemaphoreCount = 1;
-	submit.pSignalSemaphores = &render_semaphore;
+
+	// Binary semaphores ignore their entry in the timeline value array
+	VkSemaphore wait_semaphores[2];
+	VkPipelineStageFlags wait_stages[2];
+	uint64_t wait_values[2];
+	uint32_t wait_count = 0;
+	if (!is_headless())
+	{
+		wait_semaphores[wait_count] = frame.present_semaphore;
+		wait_stages[wait_count] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		wait_values[wait_count] = 0;
+		wait_count++;
+	}
+	if (upload_timeline_value)
+	{
+		wait_semaphores[wait_count] = uploader->get_timeline_semaphore();
+		wait_stages[wait_count] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+		wait_values[wait_count] = upload_timeline_value;
+		wait_count++;
+	}
+
+	VkTimelineSemaphoreSubmitInfo timeline_info = {};
+	timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_info.pNext = nullptr;
+	timeline_info.waitSemaphoreValueCount = wait_count;
+	timeline_info.pWaitSemaphoreValues = wait_values;
+
+	submit.pNext = &timeline_info;
+	submit.pWaitDstStageMask = wait_stages;
+	submit.waitSemaphoreCount = wait_count;
+	submit.pWaitSemaphores = wait_semaphores;
+	submit.signalSemaphoreCount = is_headless() ? 0 : 1;
+	submit.pSignalSemaphores = &frame.render_semaphore;
 	submit.commandBufferCount = 1;
-	submit.pCommandBuffers = &graphics_queue_command_buffer;
+	submit.pCommandBuffers = &cmd;
 
-	VK_CHECK(vkQueueSubmit(graphics_queue, 1, &submit, render_fence));
+	frame.submit_ns = Profiler::now_ns();
+	VK_CHECK(vkQueueSubmit(graphics_queue, 1, &submit, frame.render_fence));
+
+	if (is_headless())
+	{
+		frame_number++;
+		return;
+	}
 
 	VkPresentInfoKHR present_info = {};
 	present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	present_info.pNext = nullptr;
 	present_info.pSwapchains = &swapchain;
 	present_info.swapchainCount = 1;
-	present_info.pWaitSemaphores = &render_semaphore;
+	present_info.pWaitSemaphores = &frame.render_semaphore;
 	present_info.waitSemaphoreCount = 1;
-	present_info.pImageIndices = &swapchain_image_index;
+	present_info.pImageIndices = &image_index;
 
-	VK_CHECK(vkQueuePresentKHR(graphics_queue, &present_info));
+	{
+		PROFILE_SCOPE("Present");
+		VkResult result = vkQueuePresentKHR(graphics_queue, &present_info);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		{
+			is_swapchain_dirty = true;
+		}
+		else
+		{
+			VK_CHECK(result);
+		}
+	}
+
+	// Stops at the hand-off to the presentation engine, scanout adds up to a refresh on top depending on the mode
+	if (input_time_ns != 0)
+	{
+		frame_stats.record_input_latency(Profiler::now_ns() - input_time_ns);
+		input_time_ns = 0;
+	}
 
 	frame_number++;
 }
 
+void VulkanRenderer::request_readback(ReadbackCallback callback)
+{
+	if (!is_headless())
+	{
+		ERR("Readbacks are only supported by headless renderers");
+		return;
+	}
+	pending_readback = std::move(callback);
+}
+
+void VulkanRenderer::finish()
+{
+	wait_for_frames();
+
+	// Deliver in submission order, the oldest frame is the one that would be reused next
+	for (uint32_t i = 0; i < frames.size(); i++)
+	{
+		deliver_readback(frames[(frame_number + i) % frames.size()]);
+	}
+}
+
+void VulkanRenderer::wait_for_frames()
+{
+	Vector<VkFence> render_fences;
+	for (FrameData& frame : frames)
+	{
+		render_fences.push_back(frame.render_fence);
+	}
+	VK_CHECK(vkWaitForFences(device, render_fences.size(), render_fences.data(), true, uint64_t(1) * Convert::s_to_ns));
+}
+
+void VulkanRenderer::deliver_readback(FrameData& frame)
+{
+	if (!frame.readback_callback)
+	{
+		return;
+	}
+
+	ReadbackCallback callback = std::move(frame.readback_callback);
+	frame.readback_callback = nullptr;
+	callback(static_cast<const Byte*>(frame.readback_buffer.allocation.mapped), swapchain_image_width, swapchain_image_height);
+}
+
+void VulkanRenderer::read_timestamps(FrameData& frame)
+{
+	if (!frame.has_timestamps)
+	{
+		return;
+	}
+	frame.has_timestamps = false;
+
+	// The frame's fence has signalled so the results are ready and this does not wait
+	uint64_t timestamps[2] = {};
+	if (vkGetQueryPoolResults(device, frame.timestamp_pool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	// GPU and CPU clocks are not calibrated against each other, so the zone is anchored at the submit
+	uint64_t gpu_ns = ((timestamps[1] - timestamps[0]) & timestamp_mask) * double(timestamp_period);
+	Profiler::get_singleton()->record_gpu("Render pass", frame.submit_ns, frame.submit_ns + gpu_ns);
+}
+
 void VulkanRenderer::build_vulkan_contexts(const char* app_name, const GLFWWindow* window)
 {
 	vkb::detail::Result<vkb::Instance> builder_instance
 	    = vkb::InstanceBuilder()
 	          .set_app_name(app_name)
+	          .set_headless(window == nullptr)
 #ifndef NDEBUG
 	          .request_validation_layers(true)
 #endif
 	          .use_default_debug_messenger()
-	          .require_api_version(1, 1, 0)
+	          .require_api_version(1, 2, 0)
 	          .build();
 
+	if (!builder_instance)
+	{
+		CRITICAL("Could not create a Vulkan instance: {}", builder_instance.error().message());
+	}
 	vkb::Instance vkb_instance = builder_instance.value();
 
 	instance = vkb_instance.instance;
 	debug_messenger = vkb_instance.debug_messenger;
-	surface = window->get_surface(instance);
+	if (window)
+	{
+		surface = window->get_surface(instance);
+	}
+
+	// Timeline semaphores hand uploads over from the transfer queue
+	VkPhysicalDeviceVulkan12Features features_12 = {};
+	features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features_12.timelineSemaphore = VK_TRUE;
 
-	vkb::PhysicalDevice vkb_physical_device
+	vkb::detail::Result<vkb::PhysicalDevice> selected_physical_device
 	    = vkb::PhysicalDeviceSelector { vkb_instance }
-	          .set_minimum_version(1, 1)
+	          .set_minimum_version(1, 2)
+	          .set_required_features_12(features_12)
 	          .set_surface(surface)
-	          .select()
-	          .value();
+	          .select();
+	if (!selected_physical_device)
+	{
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+		vkb::destroy_instance(vkb_instance);
+		CRITICAL("Could not find a suitable Vulkan device: {}", selected_physical_device.error().message());
+	}
+	vkb::PhysicalDevice vkb_physical_device = selected_physical_device.value();
 
 	vkb::Device vkb_device = vkb::DeviceBuilder { vkb_physical_device }.build().value();
 
@@ -167,40 +498,220 @@ void VulkanRenderer::build_vulkan_contexts(const char* app_name, const GLFWWindo
 
 	graphics_queue_family = vkb_device.get_queue_index(vkb::QueueType::graphics).value();
 	graphics_queue = vkb_device.get_queue(vkb::QueueType::graphics).value();
+
+	// Prefer a transfer-only family (usually backed by a DMA engine), then any other family that can transfer
+	if (vkb::detail::Result<VkQueue> dedicated_queue = vkb_device.get_dedicated_queue(vkb::QueueType::transfer))
+	{
+		transfer_queue = dedicated_queue.value();
+		transfer_queue_family = vkb_device.get_dedicated_queue_index(vkb::QueueType::transfer).value();
+	}
+	else if (vkb::detail::Result<VkQueue> separate_queue = vkb_device.get_queue(vkb::QueueType::transfer))
+	{
+		transfer_queue = separate_queue.value();
+		transfer_queue_family = vkb_device.get_queue_index(vkb::QueueType::transfer).value();
+	}
+	else
+	{
+		transfer_queue = graphics_queue;
+		transfer_queue_family = graphics_queue_family;
+	}
+	INFO("Using queue family {} for transfers and {} for graphics", transfer_queue_family, graphics_queue_family);
 }
 
-void VulkanRenderer::build_swapchain(uint32_t width, uint32_t height)
+bool VulkanRenderer::build_swapchain(uint32_t width, uint32_t height)
 {
-	vkb::Swapchain vkb_swapchain
-	    = vkb::SwapchainBuilder { gpu, device, surface }
-	          .use_default_format_selection()
-	          .set_desired_present_mode(VK_PRESENT_MODE_FIFO_KHR)
-	          .set_desired_extent(width, height)
-	          .build()
-	          .value();
+	vkb::SwapchainBuilder builder { gpu, device, surface };
+	builder.use_default_format_selection();
+	for (VkPresentModeKHR preference : get_present_mode_preferences(present_mode))
+	{
+		builder.add_fallback_present_mode(preference);
+	}
 
+	// Lets the driver reuse what it can and keeps presents of the old images valid while they drain
+	builder.set_old_swapchain(swapchain);
+
+	vkb::Result<vkb::Swapchain> result = builder.set_desired_extent(width, height).build();
+	if (!result)
+	{
+		ERR("Could not create a {}x{} swapchain: {}", width, height, result.error().message());
+		return false;
+	}
+
+	vkb::Swapchain vkb_swapchain = result.value();
+	if (swapchain == VK_NULL_HANDLE)
+	{
+		INFO("Presenting with {}", get_present_mode_name(vkb_swapchain.present_mode));
+	}
+
+	// The format selection is the same every time, which keeps the render pass compatible
 	swapchain = vkb_swapchain.swapchain;
-	swapchain_image_width = width;
-	swapchain_image_height = height;
+	swapchain_image_width = vkb_swapchain.extent.width;
+	swapchain_image_height = vkb_swapchain.extent.height;
 	swapchain_images = vkb_swapchain.get_images().value();
 	swapchain_image_views = vkb_swapchain.get_image_views().value();
 	swapchain_image_format = vkb_swapchain.image_format;
+	return true;
+}
+
+void VulkanRenderer::handle_resize(const EventWindowResizing& e)
+{
+	if (!is_headless())
+	{
+		is_swapchain_dirty = true;
+	}
+}
+
+bool VulkanRenderer::recreate_swapchain()
+{
+	PROFILE_FUNCTION();
+
+	// Minimized windows have nothing to present to, drawing resumes once they are restored
+	uint32_t width;
+	uint32_t height;
+	window->get_framebuffer_size(width, height);
+	if (width == 0 || height == 0)
+	{
+		is_swapchain_dirty = true;
+		return false;
+	}
+
+	// The previous frame was the last one that could have rendered to the old images
+	RetiredSwapchain retired = { swapchain, std::move(swapchain_image_views), std::move(framebuffers), frame_number - 1 };
+	if (!build_swapchain(width, height))
+	{
+		swapchain_image_views = std::move(retired.image_views);
+		framebuffers = std::move(retired.framebuffers);
+		is_swapchain_dirty = true;
+		return false;
+	}
+	retired_swapchains.push_back(std::move(retired));
+
+	build_framebuffers();
+	is_swapchain_dirty = false;
+
+	DEBUG("Recreated the swapchain at {}x{}", swapchain_image_width, swapchain_image_height);
+	return true;
+}
+
+void VulkanRenderer::destroy_retired_swapchains(bool is_device_idle)
+{
+	// Same rule as retired pipelines. Fences do not cover presents, so a whole cycle of frames in flight is the
+	// closest available guarantee that the presentation engine is done with the old images.
+	for (size_t i = 0; i < retired_swapchains.size();)
+	{
+		RetiredSwapchain& retired = retired_swapchains[i];
+		if (!is_device_idle && retired.last_used_frame + frames.size() > frame_number)
+		{
+			i++;
+			continue;
+		}
+
+		for (size_t j = 0; j < retired.image_views.size(); j++)
+		{
+			vkDestroyFramebuffer(device, retired.framebuffers[j], nullptr);
+			vkDestroyImageView(device, retired.image_views[j], nullptr);
+		}
+		vkDestroySwapchainKHR(device, retired.swapchain, nullptr);
+
+		retired_swapchains[i] = std::move(retired_swapchains.back());
+		retired_swapchains.pop_back();
+	}
+}
+
+void VulkanRenderer::build_offscreen_targets(uint32_t width, uint32_t height)
+{
+	swapchain_image_width = width;
+	swapchain_image_height = height;
+	swapchain_image_format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	VkImageCreateInfo image_info = {};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.pNext = nullptr;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.format = swapchain_image_format;
+	image_info.extent = { width, height, 1 };
+	image_info.mipLevels = 1;
+	image_info.arrayLayers = 1;
+	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkImageViewCreateInfo view_info = {};
+	view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_info.pNext = nullptr;
+	view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_info.format = swapchain_image_format;
+	view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	view_info.subresourceRange.levelCount = 1;
+	view_info.subresourceRange.layerCount = 1;
+
+	VkBufferCreateInfo readback_info = {};
+	readback_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	readback_info.pNext = nullptr;
+	readback_info.size = VkDeviceSize(width) * height * 4;
+	readback_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	readback_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// One target per frame in flight so that a frame never renders over one the GPU is still reading from
+	offscreen_images = Vector<VulkanImage>(frames.size());
+	swapchain_image_views = Vector<VkImageView>(frames.size());
+	for (uint32_t i = 0; i < frames.size(); i++)
+	{
+		if (!allocator->create_image(image_info, MemoryUsage::GPUOnly, &offscreen_images[i]))
+		{
+			CRITICAL("Could not create a {}x{} offscreen image", width, height);
+		}
+		swapchain_images.push_back(offscreen_images[i].image);
+
+		view_info.image = offscreen_images[i].image;
+		VK_CHECK(vkCreateImageView(device, &view_info, nullptr, &swapchain_image_views[i]));
+
+		if (!allocator->create_buffer(readback_info, MemoryUsage::GPUToCPU, &frames[i].readback_buffer))
+		{
+			CRITICAL("Could not create a {} byte readback buffer", readback_info.size);
+		}
+	}
 }
 
-void VulkanRenderer::build_queue_and_command_buffers()
+void VulkanRenderer::build_queue_and_command_buffers(uint32_t frames_in_flight)
 {
-	VkCommandPoolCreateInfo cmd_pool_info = VulkanInit::command_pool_create_info(graphics_queue_family, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
-	VK_CHECK(vkCreateCommandPool(
-	    device,
-	    &cmd_pool_info,
-	    nullptr,
-	    &graphics_queue_command_pool));
+	frames = Vector<FrameData>(frames_in_flight);
+
+	// Each frame owns its pool so it can be reset wholesale once the frame's fence has signalled
+	VkCommandPoolCreateInfo cmd_pool_info = VulkanInit::command_pool_create_info(graphics_queue_family, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	for (FrameData& frame : frames)
+	{
+		VK_CHECK(vkCreateCommandPool(
+		    device,
+		    &cmd_pool_info,
+		    nullptr,
+		    &frame.command_pool));
+
+		VkCommandBufferAllocateInfo cmd_buffer_info = VulkanInit::command_buffer_allocate_info(frame.command_pool);
+		VK_CHECK(vkAllocateCommandBuffers(
+		    device,
+		    &cmd_buffer_info,
+		    &frame.command_buffer));
+	}
+}
+
+void VulkanRenderer::build_render_resources()
+{
+	build_upload_context();
+	build_default_render_pass();
+	build_framebuffers();
+	build_sync_objects();
+	build_timestamp_queries();
+
+	pipeline_cache = MakeUnique<VulkanPipelineCache>(device, gpu, ".cache/pipelines.bin");
+	build_pipelines();
+}
 
-	VkCommandBufferAllocateInfo cmd_buffer_info = VulkanInit::command_buffer_allocate_info(graphics_queue_command_pool);
-	VK_CHECK(vkAllocateCommandBuffers(
-	    device,
-	    &cmd_buffer_info,
-	    &graphics_queue_command_buffer));
+void VulkanRenderer::build_upload_context()
+{
+	uploader = MakeUnique<VulkanUploader>(device, *allocator, transfer_queue, transfer_queue_family, graphics_queue_family);
 }
 
 void VulkanRenderer::build_default_render_pass()
@@ -212,7 +723,7 @@ void VulkanRenderer::build_default_render_pass()
 	//     Subpass 0 begins(Transition to Attachment Optimal)
 	//     Subpass 0 renders
 	//     Subpass 0 ends
-	//   Renderpass Ends(Transitions to Present Source)
+	//   Renderpass Ends(Transitions to Present Source, or Transfer Source when headless)
 
 	VkAttachmentDescription color_attachment = {};
 	color_attachment.format = swapchain_image_format;
@@ -223,7 +734,7 @@ void VulkanRenderer::build_default_render_pass()
 	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
 	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	color_attachment.finalLayout = is_headless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkAttachmentReference color_attachment_ref = {};
 	color_attachment_ref.attachment = 0;
@@ -242,6 +753,21 @@ void VulkanRenderer::build_default_render_pass()
 	render_pass_info.subpassCount = 1;
 	render_pass_info.pSubpasses = &subpass;
 
+	// Headless frames may be copied out right after the pass, which the implicit external dependency does not cover
+	VkSubpassDependency readback_dependency = {};
+	readback_dependency.srcSubpass = 0;
+	readback_dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+	readback_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	readback_dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	readback_dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	readback_dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	if (is_headless())
+	{
+		render_pass_info.dependencyCount = 1;
+		render_pass_info.pDependencies = &readback_dependency;
+	}
+
 	VK_CHECK(vkCreateRenderPass(device, &render_pass_info, nullptr, &render_pass));
 }
 
@@ -274,89 +800,290 @@ void VulkanRenderer::build_sync_objects()
 
 	fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-	VK_CHECK(vkCreateFence(device, &fence_create_info, nullptr, &render_fence));
-
 	VkSemaphoreCreateInfo semaphore_create_info = {};
 	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 	semaphore_create_info.pNext = nullptr;
 	semaphore_create_info.flags = 0;
 
-	VK_CHECK(vkCreateSemaphore(device, &semaphore_create_info, nullptr, &present_semaphore));
-	VK_CHECK(vkCreateSemaphore(device, &semaphore_create_info, nullptr, &render_semaphore));
+	for (FrameData& frame : frames)
+	{
+		VK_CHECK(vkCreateFence(device, &fence_create_info, nullptr, &frame.render_fence));
+		VK_CHECK(vkCreateSemaphore(device, &semaphore_create_info, nullptr, &frame.present_semaphore));
+		VK_CHECK(vkCreateSemaphore(device, &semaphore_create_info, nullptr, &frame.render_semaphore));
+	}
+}
+
+void VulkanRenderer::build_timestamp_queries()
+{
+	if (!is_profiler_enabled)
+	{
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(gpu, &properties);
+
+	uint32_t family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(gpu, &family_count, nullptr);
+	Vector<VkQueueFamilyProperties> families(family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(gpu, &family_count, families.data());
+
+	uint32_t valid_bits = families[graphics_queue_family].timestampValidBits;
+	if (valid_bits == 0 || properties.limits.timestampPeriod == 0.0f)
+	{
+		WARN("Graphics queue does not support timestamps, GPU zones will not be profiled");
+		return;
+	}
+
+	timestamp_period = properties.limits.timestampPeriod;
+	timestamp_mask = valid_bits == 64 ? ~uint64_t(0) : (uint64_t(1) << valid_bits) - 1;
+
+	VkQueryPoolCreateInfo pool_info = {};
+	pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	pool_info.pNext = nullptr;
+	pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	pool_info.queryCount = 2;
+
+	for (FrameData& frame : frames)
+	{
+		VK_CHECK(vkCreateQueryPool(device, &pool_info, nullptr, &frame.timestamp_pool));
+	}
 }
 
 void VulkanRenderer::build_pipelines()
+{
+	VkPipelineLayoutCreateInfo pipeline_layout_info = VulkanInit::pipeline_layout_create_info();
+	VK_CHECK(vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &triangle_pipeline_layout));
+
+	// Startup pipelines are created in one batch so the driver compiles them in parallel
+	Vector<PipelineBuilder> builders(1);
+	if (!make_triangle_pipeline_builder(builders[0]))
+	{
+		triangle_pipeline = VK_NULL_HANDLE;
+		return;
+	}
+
+	Vector<VkPipeline> pipelines = PipelineBuilder::build_pipelines(device, render_pass, pipeline_cache->get(), builders);
+	triangle_pipeline = pipelines[0];
+
+	for (const PipelineBuilder& builder : builders)
+	{
+		destroy_shader_modules(builder);
+	}
+}
+
+VkPipeline VulkanRenderer::build_triangle_pipeline()
+{
+	PipelineBuilder pipeline_builder;
+	if (!make_triangle_pipeline_builder(pipeline_builder))
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	VkPipeline pipeline = pipeline_builder.build_pipeline(device, render_pass, pipeline_cache->get());
+	destroy_shader_modules(pipeline_builder);
+	return pipeline;
+}
+
+bool VulkanRenderer::make_triangle_pipeline_builder(PipelineBuilder& pipeline_builder)
 {
 	VkShaderModule frag_module;
 	if (!load_shader("assets/shaders/shader.frag", ShaderType::Fragment, &frag_module))
 	{
 		ERR("Could not create fragment shader: {}", "assets/shaders/shader.frag");
+		return false;
 	}
 
 	VkShaderModule vert_module;
 	if (!load_shader("assets/shaders/shader.vert", ShaderType::Vertex, &vert_module))
 	{
 		ERR("Could not create vertex shader: {}", "assets/shaders/shader.vert");
+		vkDestroyShaderModule(device, frag_module, nullptr);
+		return false;
 	}
 
-	VkPipelineLayoutCreateInfo pipeline_layout_info = VulkanInit::pipeline_layout_create_info();
-	VK_CHECK(vkCreatePipelineLayout(device, &pipeline_layout_info, nullptr, &triangle_pipeline_layout));
-
-	PipelineBuilder pipeline_builder;
 	pipeline_builder.shader_stages.push_back(VulkanInit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, vert_module));
 	pipeline_builder.shader_stages.push_back(VulkanInit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_FRAGMENT_BIT, frag_module));
 
 	pipeline_builder.vertex_input_info = VulkanInit::pipeline_vertex_input_state_create_info();
 	pipeline_builder.input_assembly = VulkanInit::pipeline_input_assembly_state_create_info(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
 
-	pipeline_builder.viewport.x = 0.0f;
-	pipeline_builder.viewport.y = 0.0f;
-	pipeline_builder.viewport.width = swapchain_image_width;
-	pipeline_builder.viewport.height = swapchain_image_height;
-	pipeline_builder.viewport.minDepth = 0.0f;
-	pipeline_builder.viewport.maxDepth = 1.0f;
-
-	pipeline_builder.scissor.offset = { 0, 0 };
-	pipeline_builder.scissor.extent = { swapchain_image_width, swapchain_image_height };
-
 	pipeline_builder.rasterizer = VulkanInit::pipeline_rasterization_state_create_info(VK_POLYGON_MODE_FILL);
 
 	pipeline_builder.multisampling = VulkanInit::pipeline_multisample_state_create_info();
 	pipeline_builder.color_blend_attachment = VulkanInit::color_blend_attachment_state();
 	pipeline_builder.pipeline_layout = triangle_pipeline_layout;
 
-	triangle_pipeline = pipeline_builder.build_pipeline(device, render_pass);
+	return true;
 }
 
+void VulkanRenderer::destroy_shader_modules(const PipelineBuilder& builder)
+{
+	// Pipelines keep what they need from the modules
+	for (const VkPipelineShaderStageCreateInfo& stage : builder.shader_stages)
+	{
+		vkDestroyShaderModule(device, stage.module, nullptr);
+	}
+}
+
+void VulkanRenderer::destroy_retired_pipelines()
+{
+	// The fence that draw() just waited on belonged to frame_number - frames.size(), every frame up to it is done
+	for (size_t i = 0; i < retired_pipelines.size();)
+	{
+		if (retired_pipelines[i].last_used_frame + frames.size() <= frame_number)
+		{
+			vkDestroyPipeline(device, retired_pipelines[i].pipeline, nullptr);
+			retired_pipelines[i] = retired_pipelines.back();
+			retired_pipelines.pop_back();
+			continue;
+		}
+		i++;
+	}
+}
+
+#ifdef KRONIC_RUNTIME_SHADER_COMPILATION
+void VulkanRenderer::handle_file_changed(const EventFileChanged& e)
+{
+	if (e.path.rfind("assets/shaders/", 0) == 0)
+	{
+		start_shader_reload();
+	}
+}
+
+void VulkanRenderer::start_shader_reload()
+{
+	// Edits made while compiling are picked up by one more reload afterwards
+	if (!shader_reload_counter.is_done())
+	{
+		is_shader_reload_queued = true;
+		return;
+	}
+
+	INFO("Recompiling shaders");
+	JobSystem::get_singleton()->run([this]()
+	                                {
+		PROFILE_SCOPE("Reload shaders");
+		VkPipeline pipeline = build_triangle_pipeline();
+		if (!pipeline)
+		{
+			ERR("Keeping the previous pipeline, shaders failed to compile");
+			return;
+		}
+
+		// A pipeline that was never swapped in was never used either
+		vkDestroyPipeline(device, reloaded_pipeline.exchange(pipeline), nullptr); },
+	                                &shader_reload_counter);
+}
+
+void VulkanRenderer::swap_reloaded_pipeline()
+{
+	if (VkPipeline pipeline = reloaded_pipeline.exchange(VK_NULL_HANDLE))
+	{
+		retired_pipelines.push_back({ triangle_pipeline, frame_number - 1 });
+		triangle_pipeline = pipeline;
+		INFO("Swapped in reloaded shaders");
+	}
+
+	if (is_shader_reload_queued && shader_reload_counter.is_done())
+	{
+		is_shader_reload_queued = false;
+		start_shader_reload();
+	}
+}
+#endif
+
+#ifdef KRONIC_RUNTIME_SHADER_COMPILATION
 bool VulkanRenderer::load_shader(const char* file_path, ShaderType type, VkShaderModule* out_shader_module)
 {
-	Optional<File> file_data = FileSystem::read_file(file_path);
+	shaderc_shader_kind shader_kind = shaderc_glsl_infer_from_source;
+	switch (type)
+	{
+	case ShaderType::Vertex:
+		shader_kind = shaderc_glsl_vertex_shader;
+		break;
+	case ShaderType::Fragment:
+		shader_kind = shaderc_glsl_fragment_shader;
+		break;
+	}
+
+	// shaderc reads the source straight out of the mounted archive or the mapping
+	Optional<FileContents> file_data = FileSystem::view_file(file_path);
 	if (!file_data)
 	{
 		ERR("Could not load shader from: {}", file_path);
 		return {};
 	}
 
+	// Everything set here changes the generated code, so all of it goes into the cache key
+	shaderc::CompileOptions options;
+	uint64_t options_hash = Hash::fnv1a64_offset;
+
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
+	options_hash = Hash::combine(options_hash, shaderc_env_version_vulkan_1_1);
+
+#ifdef NDEBUG
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+	options_hash = Hash::combine(options_hash, shaderc_optimization_level_performance);
+#else
+	options.SetOptimizationLevel(shaderc_optimization_level_zero);
+	options.SetGenerateDebugInfo();
+	options_hash = Hash::combine(options_hash, shaderc_optimization_level_zero);
+#endif
+
+	FileView source = file_data->view();
+	uint64_t cache_key = VulkanShaderCache::make_key(source.chars(), source.size, uint32_t(shader_kind), options_hash);
+
+	if (Optional<VulkanShaderCache::Entry> cached = shader_cache.find(cache_key))
+	{
+		DEBUG("Loaded shader {} from cache", file_path);
+		return create_shader_module(cached->code, cached->code_size, file_path, out_shader_module);
+	}
+
 	static shaderc::Compiler compiler;
-	shaderc::CompilationResult result = compiler.CompileGlslToSpv(file_data->contents, shaderc_shader_kind(int(type)), file_path);
+	shaderc::CompilationResult result = compiler.CompileGlslToSpv(source.chars(), source.size, shader_kind, file_path, options);
 
 	if (result.GetCompilationStatus() != shaderc_compilation_status_success)
 	{
-		ERR("Found {} errors and {} warnings while compiling shader {}: {}", result.GetNumWarnings(), result.GetNumErrors(), file_path, result.GetErrorMessage());
+		ERR("Found {} errors and {} warnings while compiling shader {}: {}", result.GetNumErrors(), result.GetNumWarnings(), file_path, result.GetErrorMessage());
 		return {};
 	}
 
+	size_t code_size = sizeof(uint32_t) * (result.end() - result.begin());
+	shader_cache.store(cache_key, result.begin(), code_size);
+
+	return create_shader_module(result.begin(), code_size, file_path, out_shader_module);
+}
+#else
+bool VulkanRenderer::load_shader(const char* file_path, ShaderType type, VkShaderModule* out_shader_module)
+{
+	// Shaders were compiled to SPIR-V at build time, the stage is already baked into the module
+	for (const EmbeddedShader& shader : embedded_shaders)
+	{
+		if (std::strcmp(shader.path, file_path) == 0)
+		{
+			return create_shader_module(shader.code, shader.code_size, file_path, out_shader_module);
+		}
+	}
+
+	ERR("Could not find embedded shader: {}", file_path);
+	return {};
+}
+#endif
+
+bool VulkanRenderer::create_shader_module(const uint32_t* code, size_t code_size, const char* name, VkShaderModule* out_shader_module)
+{
 	VkShaderModuleCreateInfo create_info = {};
 	create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	create_info.pNext = nullptr;
 
-	create_info.codeSize = sizeof(uint32_t) * (result.end() - result.begin());
-	create_info.pCode = result.begin();
+	create_info.codeSize = code_size;
+	create_info.pCode = code;
 
 	VkShaderModule shader_module;
 	if (vkCreateShaderModule(device, &create_info, nullptr, &shader_module) != VK_SUCCESS)
 	{
-		ERR("Could not load shader module from: {}", file_path);
+		ERR("Could not load shader module from: {}", name);
 		return {};
 	}
 
@@ -365,18 +1092,69 @@ bool VulkanRenderer::load_shader(const char* file_path, ShaderType type, VkShade
 	return true;
 }
 
-VkPipeline VulkanRenderer::PipelineBuilder::build_pipeline(VkDevice device, VkRenderPass pass)
+VkPipeline VulkanRenderer::PipelineBuilder::build_pipeline(VkDevice device, VkRenderPass pass, VkPipelineCache cache) const
 {
-	VkPipelineViewportStateCreateInfo viewport_info {};
+	CreateInfo info;
+	fill_create_info(pass, info);
+
+	VkPipeline new_pipeline;
+	if (vkCreateGraphicsPipelines(device, cache, 1, &info.pipeline_info, nullptr, &new_pipeline) != VK_SUCCESS)
+	{
+		ERR("Couldn't create pipeline");
+		return VK_NULL_HANDLE;
+	}
+
+	return new_pipeline;
+}
+
+Vector<VkPipeline> VulkanRenderer::PipelineBuilder::build_pipelines(VkDevice device, VkRenderPass pass, VkPipelineCache cache, const Vector<PipelineBuilder>& builders)
+{
+	Vector<CreateInfo> infos(builders.size());
+	for (size_t i = 0; i < builders.size(); i++)
+	{
+		builders[i].fill_create_info(pass, infos[i]);
+	}
+
+	// Pipeline caches are internally synchronized, so every worker can feed the same one
+	Vector<VkPipeline> pipelines(builders.size(), VK_NULL_HANDLE);
+	JobSystem::get_singleton()->parallel_for(0, builders.size(), 1, [&](size_t begin, size_t end)
+	    {
+		    for (size_t i = begin; i < end; i++)
+		    {
+			    if (vkCreateGraphicsPipelines(device, cache, 1, &infos[i].pipeline_info, nullptr, &pipelines[i]) != VK_SUCCESS)
+			    {
+				    ERR("Couldn't create pipeline {} of {}", i, builders.size());
+				    pipelines[i] = VK_NULL_HANDLE;
+			    }
+		    }
+	    });
+
+	return pipelines;
+}
+
+void VulkanRenderer::PipelineBuilder::fill_create_info(VkRenderPass pass, CreateInfo& info) const
+{
+	VkPipelineViewportStateCreateInfo& viewport_info = info.viewport_info;
+	viewport_info = {};
 	viewport_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewport_info.pNext = nullptr;
 
+	// Set while recording, so one pipeline works for every swapchain extent
 	viewport_info.viewportCount = 1;
-	viewport_info.pViewports = &viewport;
+	viewport_info.pViewports = nullptr;
 	viewport_info.scissorCount = 1;
-	viewport_info.pScissors = &scissor;
+	viewport_info.pScissors = nullptr;
 
-	VkPipelineColorBlendStateCreateInfo color_blending = {};
+	VkPipelineDynamicStateCreateInfo& dynamic_state = info.dynamic_state;
+	dynamic_state = {};
+	dynamic_state.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamic_state.pNext = nullptr;
+
+	dynamic_state.dynamicStateCount = uint32_t(std::size(dynamic_states));
+	dynamic_state.pDynamicStates = dynamic_states;
+
+	VkPipelineColorBlendStateCreateInfo& color_blending = info.color_blending;
+	color_blending = {};
 	color_blending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	color_blending.pNext = nullptr;
 
@@ -385,7 +1163,8 @@ VkPipeline VulkanRenderer::PipelineBuilder::build_pipeline(VkDevice device, VkRe
 	color_blending.attachmentCount = 1;
 	color_blending.pAttachments = &color_blend_attachment;
 
-	VkGraphicsPipelineCreateInfo pipeline_info = {};
+	VkGraphicsPipelineCreateInfo& pipeline_info = info.pipeline_info;
+	pipeline_info = {};
 	pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipeline_info.pNext = nullptr;
 
@@ -397,17 +1176,9 @@ VkPipeline VulkanRenderer::PipelineBuilder::build_pipeline(VkDevice device, VkRe
 	pipeline_info.pRasterizationState = &rasterizer;
 	pipeline_info.pMultisampleState = &multisampling;
 	pipeline_info.pColorBlendState = &color_blending;
+	pipeline_info.pDynamicState = &dynamic_state;
 	pipeline_info.layout = pipeline_layout;
 	pipeline_info.renderPass = pass;
 	pipeline_info.subpass = 0;
 	pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
-
-	VkPipeline new_pipeline;
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &new_pipeline) != VK_SUCCESS)
-	{
-		ERR("Couldn't create pipeline");
-		return VK_NULL_HANDLE;
-	}
-
-	return new_pipeline;
 }
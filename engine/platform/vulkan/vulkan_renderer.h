@@ -1,50 +1,130 @@
 #pragma once
 
+#include "core/event.h"
+#include "core/event_link.h"
+#include "core/job_system.h"
 #include "core/renderer.h"
 
 #include "vulkan/vulkan.h"
-#include "shaderc/shaderc.hpp"
+#include "vulkan_allocator.h"
+#include "vulkan_pipeline_cache.h"
+#include "vulkan_uploader.h"
+
+#ifdef KRONIC_RUNTIME_SHADER_COMPILATION
+#include "vulkan_shader_cache.h"
+#endif
 
 class GLFWWindow;
 
 class VulkanRenderer : public Renderer
 {
 public:
-	VulkanRenderer(const char* app_name, const GLFWWindow* window);
+	VulkanRenderer(const char* app_name, const GLFWWindow* window, uint32_t frames_in_flight = default_frames_in_flight, PresentMode present_mode = PresentMode::Fifo);
+
+	// Renders into offscreen images instead of a swapchain, so neither a window nor a display is needed
+	VulkanRenderer(const char* app_name, uint32_t width, uint32_t height, uint32_t frames_in_flight = default_frames_in_flight);
 	~VulkanRenderer();
 
 	void draw() override;
+	const FrameStats& get_frame_stats() const override { return frame_stats; }
 
-private:
-	void build_vulkan_contexts(const char* app_name, const GLFWWindow* window);
-	void build_swapchain(uint32_t width, uint32_t height);
-	void build_queue_and_command_buffers();
-	void build_default_render_pass();
-	void build_framebuffers();
-	void build_sync_objects();
+	bool is_headless() const { return surface == VK_NULL_HANDLE; }
+
+	// Tightly packed RGBA8 rows
+	using ReadbackCallback = Function<void(const Byte* pixels, uint32_t width, uint32_t height)>;
+
+	// Copies the next drawn frame into host memory, headless only. The callback runs inside a later draw() or
+	// finish(), once the GPU is done with that frame, so the CPU never waits for the copy.
+	void request_readback(ReadbackCallback callback);
+
+	// Waits for every frame in flight and delivers their pending readbacks
+	void finish();
+
+	VulkanAllocator& get_allocator() { return *allocator; }
+	VulkanUploader& get_uploader() { return *uploader; }
+	VulkanPipelineCache& get_pipeline_cache() { return *pipeline_cache; }
+	VkDevice get_device() const { return device; }
+	VkRenderPass get_render_pass() const { return render_pass; }
 
 	struct PipelineBuilder
 	{
 		Vector<VkPipelineShaderStageCreateInfo> shader_stages;
 		VkPipelineVertexInputStateCreateInfo vertex_input_info;
 		VkPipelineInputAssemblyStateCreateInfo input_assembly;
-		VkViewport viewport;
-		VkRect2D scissor;
 		VkPipelineRasterizationStateCreateInfo rasterizer;
 		VkPipelineColorBlendAttachmentState color_blend_attachment;
 		VkPipelineMultisampleStateCreateInfo multisampling;
 		VkPipelineLayout pipeline_layout;
 
-		VkPipeline build_pipeline(VkDevice device, VkRenderPass pass);
+		VkPipeline build_pipeline(VkDevice device, VkRenderPass pass, VkPipelineCache cache = VK_NULL_HANDLE) const;
+
+		// Creates one pipeline per builder, spreading the driver's compilation work across threads.
+		// Failed pipelines are returned as VK_NULL_HANDLE.
+		static Vector<VkPipeline> build_pipelines(VkDevice device, VkRenderPass pass, VkPipelineCache cache, const Vector<PipelineBuilder>& builders);
+
+	private:
+		// Storage for everything VkGraphicsPipelineCreateInfo points to
+		struct CreateInfo
+		{
+			VkPipelineViewportStateCreateInfo viewport_info;
+			VkPipelineDynamicStateCreateInfo dynamic_state;
+			VkPipelineColorBlendStateCreateInfo color_blending;
+			VkGraphicsPipelineCreateInfo pipeline_info;
+		};
+		void fill_create_info(VkRenderPass pass, CreateInfo& info) const;
 	};
+
+	// Loads the triangle shaders into builder. The modules stay alive until destroy_shader_modules(), so
+	// variants can be built from it.
+	bool make_triangle_pipeline_builder(PipelineBuilder& builder);
+	void destroy_shader_modules(const PipelineBuilder& builder);
+
+	static constexpr uint32_t default_frames_in_flight = 2;
+	static constexpr uint32_t max_frames_in_flight = 4;
+
+private:
+	// Without a window the instance is created headless and no surface is made
+	void build_vulkan_contexts(const char* app_name, const GLFWWindow* window);
+	// Passes the current swapchain as oldSwapchain, so it must be retired by the caller
+	bool build_swapchain(uint32_t width, uint32_t height);
+	void build_offscreen_targets(uint32_t width, uint32_t height);
+	void build_queue_and_command_buffers(uint32_t frames_in_flight);
+	void build_upload_context();
+	void build_default_render_pass();
+	void build_framebuffers();
+	void build_sync_objects();
+	void build_timestamp_queries();
+
+	// Everything after the render targets, shared by both modes
+	void build_render_resources();
+
 	void build_pipelines();
 
+	// Returns VK_NULL_HANDLE when a shader fails to compile. Only reads renderer state that never changes after
+	// startup, so shader reloads call it from a job.
+	VkPipeline build_triangle_pipeline();
+
 	enum class ShaderType
 	{
-		Vertex = shaderc_glsl_vertex_shader,
-		Fragment = shaderc_glsl_fragment_shader
+		Vertex,
+		Fragment
 	};
 	bool load_shader(const char* file_path, ShaderType type, VkShaderModule* out_shader_module);
+	bool create_shader_module(const uint32_t* code, size_t code_size, const char* name, VkShaderModule* out_shader_module);
+
+#ifdef KRONIC_RUNTIME_SHADER_COMPILATION
+	VulkanShaderCache shader_cache = { ".cache/shaders" };
+
+	// Edited shaders are recompiled on a job and the pipeline is swapped at the start of the next draw()
+	void handle_file_changed(const EventFileChanged& e);
+	void start_shader_reload();
+	void swap_reloaded_pipeline();
+	EventLink<VulkanRenderer, EventFileChanged> event_file_changed = { this, &VulkanRenderer::handle_file_changed };
+
+	JobCounter shader_reload_counter;
+	bool is_shader_reload_queued = false;
+	std::atomic<VkPipeline> reloaded_pipeline = VK_NULL_HANDLE;
+#endif
 
 	// Context variables
 	bool is_ok = false;
@@ -52,10 +132,13 @@ private:
 	VkDebugUtilsMessengerEXT debug_messenger;
 	VkPhysicalDevice gpu;
 	VkDevice device;
-	VkSurfaceKHR surface;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	Ptr<VulkanAllocator> allocator;
 
-	// Swapchain
-	VkSwapchainKHR swapchain;
+	// Swapchain, in headless mode the images are offscreen_images with one per frame in flight
+	const GLFWWindow* window = nullptr;
+	PresentMode present_mode = PresentMode::Fifo;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
 	VkFormat swapchain_image_format;
 	Vector<VkImage> swapchain_images;
 	Vector<VkImageView> swapchain_image_views;
@@ -63,24 +146,82 @@ private:
 	uint32_t swapchain_image_height;
 	uint32_t frame_number = 1;
 
+	// Resizes and out of date swapchains are handled at the start of the next draw(). Viewport and scissor are
+	// dynamic, so pipelines survive the new extent.
+	void handle_resize(const EventWindowResizing& e);
+	bool recreate_swapchain();
+	EventLink<VulkanRenderer, EventWindowResizing> event_resize = { this, &VulkanRenderer::handle_resize };
+	bool is_swapchain_dirty = false;
+
+	// Replaced swapchains keep their views and framebuffers until every frame that rendered to them has finished
+	struct RetiredSwapchain
+	{
+		VkSwapchainKHR swapchain;
+		Vector<VkImageView> image_views;
+		Vector<VkFramebuffer> framebuffers;
+		uint32_t last_used_frame;
+	};
+	Vector<RetiredSwapchain> retired_swapchains;
+	void destroy_retired_swapchains(bool is_device_idle = false);
+
+	Vector<VulkanImage> offscreen_images;
+	ReadbackCallback pending_readback;
+
 	// Queue handles
 	VkQueue graphics_queue;
 	uint32_t graphics_queue_family;
+	VkQueue transfer_queue;
+	uint32_t transfer_queue_family;
 
-	// Command pools/buffers
-	VkCommandPool graphics_queue_command_pool;
-	VkCommandBuffer graphics_queue_command_buffer;
+	// Streams resource data through the transfer queue
+	Ptr<VulkanUploader> uploader;
+
+	// Per-frame resources, cycled so that the CPU can record frame N + 1 while the GPU renders frame N
+	struct FrameData
+	{
+		VkCommandPool command_pool;
+		VkCommandBuffer command_buffer;
+
+		VkSemaphore render_semaphore;
+		VkSemaphore present_semaphore;
+		VkFence render_fence;
+
+		// Timestamps around the render pass, only created when the profiler is enabled
+		VkQueryPool timestamp_pool = VK_NULL_HANDLE;
+		bool has_timestamps = false;
+		uint64_t submit_ns = 0;
+
+		// Headless only, holds the frame's pixels once its fence has signalled
+		VulkanBuffer readback_buffer;
+		ReadbackCallback readback_callback;
+	};
+	Vector<FrameData> frames;
+	FrameData& get_current_frame() { return frames[frame_number % frames.size()]; }
+
+	FrameStats frame_stats;
+
+	// Nanoseconds per timestamp tick and the bits the graphics queue actually writes
+	float timestamp_period = 0.0f;
+	uint64_t timestamp_mask = 0;
+	void read_timestamps(FrameData& frame);
+	void deliver_readback(FrameData& frame);
+	void wait_for_frames();
 
 	// Renderpass objects
 	VkRenderPass render_pass;
 	Vector<VkFramebuffer> framebuffers;
 
-	// Sync objects
-	VkSemaphore render_semaphore;
-	VkSemaphore present_semaphore;
-	VkFence render_fence;
-
 	// Pipeline vars
+	Ptr<VulkanPipelineCache> pipeline_cache;
 	VkPipelineLayout triangle_pipeline_layout;
 	VkPipeline triangle_pipeline;
+
+	// Replaced pipelines live until every frame that could have bound them has finished on the GPU
+	struct RetiredPipeline
+	{
+		VkPipeline pipeline;
+		uint32_t last_used_frame;
+	};
+	Vector<RetiredPipeline> retired_pipelines;
+	void destroy_retired_pipelines();
 };
@@ -0,0 +1,77 @@
+#include "vulkan_shader_cache.h"
+
+#include "core/hash.h"
+#include "core/log.h"
+
+#include <cstring>
+#include <iomanip>
+
+VulkanShaderCache::VulkanShaderCache(const String& cache_directory)
+    : directory(cache_directory)
+{
+}
+
+uint64_t VulkanShaderCache::make_key(const char* source, size_t source_size, uint32_t shader_kind, uint64_t options_hash)
+{
+	uint64_t key = Hash::fnv1a64(source, source_size);
+	key = Hash::combine(key, shader_kind);
+	key = Hash::combine(key, options_hash);
+	key = Hash::combine(key, cache_version);
+	return key;
+}
+
+Optional<VulkanShaderCache::Entry> VulkanShaderCache::find(uint64_t key) const
+{
+	String path = get_entry_path(key);
+
+	// A miss is expected on cold starts, so don't go through FileSystem::map_file which reports errors
+	Optional<MappedFile> file = MappedFile::map(path);
+	if (!file)
+	{
+		return {};
+	}
+
+	if (file->size() < sizeof(EntryHeader))
+	{
+		WARN("Ignoring truncated shader cache entry: {}", path);
+		return {};
+	}
+
+	EntryHeader header;
+	std::memcpy(&header, file->data(), sizeof(EntryHeader));
+	if (header.magic != cache_magic || header.version != cache_version || header.key != key
+	    || header.code_size != file->size() - sizeof(EntryHeader) || header.code_size % sizeof(uint32_t) != 0)
+	{
+		WARN("Ignoring invalid shader cache entry: {}", path);
+		return {};
+	}
+
+	Entry entry;
+	entry.code = reinterpret_cast<const uint32_t*>(file->data() + sizeof(EntryHeader));
+	entry.code_size = header.code_size;
+	entry.file = std::move(*file);
+
+	return entry;
+}
+
+void VulkanShaderCache::store(uint64_t key, const uint32_t* code, size_t code_size) const
+{
+	EntryHeader header;
+	header.magic = cache_magic;
+	header.version = cache_version;
+	header.key = key;
+	header.code_size = code_size;
+
+	Vector<Byte> blob(sizeof(EntryHeader) + code_size);
+	std::memcpy(blob.data(), &header, sizeof(EntryHeader));
+	std::memcpy(blob.data() + sizeof(EntryHeader), code, code_size);
+
+	FileSystem::write_file(get_entry_path(key), blob.data(), blob.size());
+}
+
+String VulkanShaderCache::get_entry_path(uint64_t key) const
+{
+	OStringStream path;
+	path << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".spv";
+	return path.str();
+}
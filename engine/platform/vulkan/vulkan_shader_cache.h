@@ -0,0 +1,40 @@
+#pragma once
+
+#include "common.h"
+#include "os/file_system.h"
+
+// On-disk SPIR-V cache keyed by a hash of everything that affects the compiler output.
+// Entries are memory mapped on lookup so a hit never copies or compiles anything.
+class VulkanShaderCache
+{
+public:
+	VulkanShaderCache(const String& cache_directory);
+
+	static uint64_t make_key(const char* source, size_t source_size, uint32_t shader_kind, uint64_t options_hash);
+
+	struct Entry
+	{
+		MappedFile file;
+		const uint32_t* code = nullptr;
+		size_t code_size = 0; // In bytes
+	};
+	Optional<Entry> find(uint64_t key) const;
+	void store(uint64_t key, const uint32_t* code, size_t code_size) const;
+
+private:
+	// Bump whenever the entry layout or the compiler changes in a way the key cannot see
+	static constexpr uint32_t cache_version = 1;
+	static constexpr uint32_t cache_magic = 0x5650534b; // "KSPV"
+
+	struct EntryHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		uint64_t code_size;
+	};
+
+	String get_entry_path(uint64_t key) const;
+
+	String directory;
+};
@@ -0,0 +1,311 @@
+#include "vulkan_tlsf.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+uint32_t find_last_set(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+uint32_t find_first_set(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return index;
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+TLSFAllocator::TLSFAllocator(uint64_t size)
+    : total_size(size)
+    , free_size(size)
+{
+	for (uint32_t fl = 0; fl < fl_count; fl++)
+	{
+		for (uint32_t sl = 0; sl < sl_count; sl++)
+		{
+			free_heads[fl][sl] = invalid_node;
+		}
+	}
+
+	if (size == 0)
+	{
+		return;
+	}
+
+	uint32_t node = create_node();
+	blocks[node].offset = 0;
+	blocks[node].size = size;
+	insert_free_block(node);
+}
+
+Optional<TLSFAllocator::Allocation> TLSFAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+	if (size == 0 || alignment == 0)
+	{
+		return {};
+	}
+
+	// Over-ask by the worst case padding so that any block found is guaranteed to fit after aligning
+	uint64_t search_size = size + alignment - 1;
+	if (search_size > free_size)
+	{
+		return {};
+	}
+
+	uint32_t node = find_free_block(search_size);
+	if (node == invalid_node)
+	{
+		return {};
+	}
+	remove_free_block(node);
+
+	uint64_t padding = align_up(blocks[node].offset, alignment) - blocks[node].offset;
+	if (padding > 0)
+	{
+		uint32_t padding_node = split_front(node, padding);
+		insert_free_block(padding_node);
+	}
+
+	if (blocks[node].size > size)
+	{
+		uint32_t used_node = split_front(node, size);
+		insert_free_block(node);
+		node = used_node;
+	}
+
+	Block& block = blocks[node];
+	block.is_used = true;
+	free_size -= block.size;
+	allocation_count++;
+
+	Allocation allocation;
+	allocation.offset = block.offset;
+	allocation.size = block.size;
+	allocation.node = node;
+	return allocation;
+}
+
+void TLSFAllocator::free(uint32_t node)
+{
+	Block& block = blocks[node];
+	block.is_used = false;
+	free_size += block.size;
+	allocation_count--;
+
+	if (block.next_physical != invalid_node && blocks[block.next_physical].is_free)
+	{
+		remove_free_block(block.next_physical);
+		merge_with_next(node);
+	}
+
+	uint32_t prev = blocks[node].prev_physical;
+	if (prev != invalid_node && blocks[prev].is_free)
+	{
+		remove_free_block(prev);
+		merge_with_next(prev);
+		node = prev;
+	}
+
+	insert_free_block(node);
+}
+
+uint64_t TLSFAllocator::get_largest_free_range() const
+{
+	if (fl_bitmap == 0)
+	{
+		return 0;
+	}
+
+	// Blocks in the highest non-empty class can differ in size, so scan that one list
+	uint32_t fl = find_last_set(fl_bitmap);
+	uint32_t sl = find_last_set(sl_bitmaps[fl]);
+
+	uint64_t largest = 0;
+	for (uint32_t node = free_heads[fl][sl]; node != invalid_node; node = blocks[node].next_free)
+	{
+		largest = std::max(largest, blocks[node].size);
+	}
+	return largest;
+}
+
+void TLSFAllocator::get_mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+	if (size < sl_count)
+	{
+		// Small sizes get one exact class each
+		fl = 0;
+		sl = uint32_t(size);
+		return;
+	}
+
+	uint32_t msb = find_last_set(size);
+	fl = msb - sl_bits + 1;
+	sl = uint32_t(size >> (msb - sl_bits)) ^ sl_count;
+}
+
+uint32_t TLSFAllocator::find_free_block(uint64_t size) const
+{
+	// Round up to the next class boundary so that every block in the class found is big enough
+	if (size >= sl_count)
+	{
+		uint64_t round = (uint64_t(1) << (find_last_set(size) - sl_bits)) - 1;
+		if (size + round < size)
+		{
+			return invalid_node;
+		}
+		size += round;
+	}
+
+	uint32_t fl, sl;
+	get_mapping(size, fl, sl);
+	if (fl >= fl_count)
+	{
+		return invalid_node;
+	}
+
+	uint32_t sl_map = sl_bitmaps[fl] & (~0u << sl);
+	if (!sl_map)
+	{
+		uint64_t fl_map = (fl + 1 < 64) ? fl_bitmap & (~uint64_t(0) << (fl + 1)) : 0;
+		if (!fl_map)
+		{
+			return invalid_node;
+		}
+
+		fl = find_first_set(fl_map);
+		sl_map = sl_bitmaps[fl];
+	}
+	sl = find_first_set(sl_map);
+
+	return free_heads[fl][sl];
+}
+
+uint32_t TLSFAllocator::create_node()
+{
+	if (unused_nodes != invalid_node)
+	{
+		uint32_t node = unused_nodes;
+		unused_nodes = blocks[node].next_free;
+		blocks[node] = {};
+		return node;
+	}
+
+	blocks.emplace_back();
+	return uint32_t(blocks.size() - 1);
+}
+
+void TLSFAllocator::release_node(uint32_t node)
+{
+	blocks[node] = {};
+	blocks[node].next_free = unused_nodes;
+	unused_nodes = node;
+}
+
+void TLSFAllocator::insert_free_block(uint32_t node)
+{
+	Block& block = blocks[node];
+
+	uint32_t fl, sl;
+	get_mapping(block.size, fl, sl);
+
+	block.is_free = true;
+	block.prev_free = invalid_node;
+	block.next_free = free_heads[fl][sl];
+	if (block.next_free != invalid_node)
+	{
+		blocks[block.next_free].prev_free = node;
+	}
+	free_heads[fl][sl] = node;
+
+	fl_bitmap |= uint64_t(1) << fl;
+	sl_bitmaps[fl] |= 1u << sl;
+}
+
+void TLSFAllocator::remove_free_block(uint32_t node)
+{
+	Block& block = blocks[node];
+
+	uint32_t fl, sl;
+	get_mapping(block.size, fl, sl);
+
+	if (block.prev_free != invalid_node)
+	{
+		blocks[block.prev_free].next_free = block.next_free;
+	}
+	else
+	{
+		free_heads[fl][sl] = block.next_free;
+	}
+
+	if (block.next_free != invalid_node)
+	{
+		blocks[block.next_free].prev_free = block.prev_free;
+	}
+
+	if (free_heads[fl][sl] == invalid_node)
+	{
+		sl_bitmaps[fl] &= ~(1u << sl);
+		if (!sl_bitmaps[fl])
+		{
+			fl_bitmap &= ~(uint64_t(1) << fl);
+		}
+	}
+
+	block.is_free = false;
+	block.prev_free = invalid_node;
+	block.next_free = invalid_node;
+}
+
+uint32_t TLSFAllocator::split_front(uint32_t node, uint64_t size)
+{
+	// create_node() can reallocate the block storage, so don't hold references across it
+	uint32_t front = create_node();
+
+	blocks[front].offset = blocks[node].offset;
+	blocks[front].size = size;
+	blocks[front].prev_physical = blocks[node].prev_physical;
+	blocks[front].next_physical = node;
+	if (blocks[front].prev_physical != invalid_node)
+	{
+		blocks[blocks[front].prev_physical].next_physical = front;
+	}
+
+	blocks[node].offset += size;
+	blocks[node].size -= size;
+	blocks[node].prev_physical = front;
+
+	return front;
+}
+
+void TLSFAllocator::merge_with_next(uint32_t node)
+{
+	uint32_t next = blocks[node].next_physical;
+
+	blocks[node].size += blocks[next].size;
+	blocks[node].next_physical = blocks[next].next_physical;
+	if (blocks[node].next_physical != invalid_node)
+	{
+		blocks[blocks[node].next_physical].prev_physical = node;
+	}
+
+	release_node(next);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "common.h"
+
+// Two-level segregated fit allocator over an abstract range of offsets [0, size).
+// It never touches the memory it manages, which lets one instance sub-allocate a VkDeviceMemory block.
+// Allocation and free are O(1).
+class TLSFAllocator
+{
+public:
+	static constexpr uint32_t invalid_node = ~0u;
+
+	struct Allocation
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t node = invalid_node;
+	};
+
+	TLSFAllocator(uint64_t size);
+
+	Optional<Allocation> allocate(uint64_t size, uint64_t alignment = 1);
+	void free(uint32_t node);
+
+	uint64_t get_size() const { return total_size; }
+	uint64_t get_free_size() const { return free_size; }
+	uint64_t get_largest_free_range() const;
+	uint32_t get_allocation_count() const { return allocation_count; }
+	bool is_empty() const { return allocation_count == 0; }
+
+private:
+	static constexpr uint32_t sl_bits = 4;
+	static constexpr uint32_t sl_count = 1 << sl_bits;
+	static constexpr uint32_t fl_count = 64 - sl_bits + 1;
+
+	struct Block
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+
+		// Neighbours in address order
+		uint32_t prev_physical = invalid_node;
+		uint32_t next_physical = invalid_node;
+
+		// Neighbours in the same size class while free, next_free doubles as the node free list link
+		uint32_t prev_free = invalid_node;
+		uint32_t next_free = invalid_node;
+
+		bool is_free = false;
+		bool is_used = false;
+	};
+
+	static void get_mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+	uint32_t find_free_block(uint64_t size) const;
+
+	uint32_t create_node();
+	void release_node(uint32_t node);
+
+	void insert_free_block(uint32_t node);
+	void remove_free_block(uint32_t node);
+
+	// Carves [offset, offset + size) off the front of a free block and returns the new node for it
+	uint32_t split_front(uint32_t node, uint64_t size);
+	void merge_with_next(uint32_t node);
+
+	Vector<Block> blocks;
+	uint32_t unused_nodes = invalid_node;
+
+	uint64_t fl_bitmap = 0;
+	uint32_t sl_bitmaps[fl_count] = {};
+	uint32_t free_heads[fl_count][sl_count];
+
+	uint64_t total_size = 0;
+	uint64_t free_size = 0;
+	uint32_t allocation_count = 0;
+};
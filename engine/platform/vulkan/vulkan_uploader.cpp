@@ -0,0 +1,405 @@
+#include "vulkan_uploader.h"
+
+#include "core/log.h"
+#include "vulkan_init_helpers.h"
+
+#include <cstring>
+
+namespace
+{
+// Satisfies the copy offset rules for every format up to 16 bytes per texel
+constexpr VkDeviceSize staging_alignment = 16;
+}
+
+VulkanUploader::VulkanUploader(VkDevice device, VulkanAllocator& allocator, VkQueue transfer_queue, uint32_t transfer_queue_family, uint32_t graphics_queue_family, VkDeviceSize staging_size)
+    : device(device)
+    , allocator(allocator)
+    , transfer_queue(transfer_queue)
+    , transfer_queue_family(transfer_queue_family)
+    , graphics_queue_family(graphics_queue_family)
+    , staging_size(staging_size)
+{
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.pNext = nullptr;
+
+	buffer_info.size = staging_size;
+	buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (!allocator.create_buffer(buffer_info, MemoryUsage::CPUToGPU, &staging_buffer) || !staging_buffer.allocation.mapped)
+	{
+		CRITICAL("Could not create a {} MiB staging buffer", staging_size / (1024 * 1024));
+	}
+
+	VkCommandPoolCreateInfo pool_info = VulkanInit::command_pool_create_info(transfer_queue_family, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	VK_CHECK(vkCreateCommandPool(device, &pool_info, nullptr, &command_pool));
+
+	VkSemaphoreTypeCreateInfo timeline_info = {};
+	timeline_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timeline_info.pNext = nullptr;
+	timeline_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timeline_info.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphore_info = {};
+	semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_info.pNext = &timeline_info;
+	VK_CHECK(vkCreateSemaphore(device, &semaphore_info, nullptr, &timeline_semaphore));
+}
+
+VulkanUploader::~VulkanUploader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		flush_locked();
+	}
+	wait(last_submitted_value);
+
+	vkDestroySemaphore(device, timeline_semaphore, nullptr);
+	vkDestroyCommandPool(device, command_pool, nullptr);
+	allocator.destroy_buffer(staging_buffer);
+}
+
+bool VulkanUploader::upload_buffer(VkBuffer destination, VkDeviceSize destination_offset, const void* data, VkDeviceSize size)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Big uploads are streamed in pieces so they never need the whole ring at once
+	const VkDeviceSize max_chunk_size = get_max_chunk_size();
+	const Byte* source = static_cast<const Byte*>(data);
+	for (VkDeviceSize copied = 0; copied < size;)
+	{
+		VkDeviceSize chunk_size = std::min(size - copied, max_chunk_size);
+		Optional<VkDeviceSize> staging_offset = reserve_staging(chunk_size, staging_alignment);
+		if (!staging_offset)
+		{
+			ERR("Could not reserve {} bytes of staging memory", chunk_size);
+			return false;
+		}
+		std::memcpy(static_cast<Byte*>(staging_buffer.allocation.mapped) + *staging_offset, source + copied, chunk_size);
+
+		VkBufferCopy region = {};
+		region.srcOffset = *staging_offset;
+		region.dstOffset = destination_offset + copied;
+		region.size = chunk_size;
+		vkCmdCopyBuffer(get_recording_command_buffer(), staging_buffer.buffer, destination, 1, &region);
+
+		copied += chunk_size;
+	}
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.pNext = nullptr;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = transfer_queue_family;
+	barrier.dstQueueFamilyIndex = graphics_queue_family;
+	barrier.buffer = destination;
+	barrier.offset = destination_offset;
+	barrier.size = size;
+
+	// Within one family the timeline semaphore wait already makes the writes available
+	if (transfer_queue_family != graphics_queue_family)
+	{
+		pending_buffer_barriers.push_back(barrier);
+	}
+
+	return true;
+}
+
+bool VulkanUploader::upload_image(VkImage destination, VkExtent3D extent, VkImageAspectFlags aspect, const void* data, VkDeviceSize size, VkImageLayout final_layout)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Big images are streamed in slices of whole rows, or of whole depth slices when several fit at once
+	const VkDeviceSize max_chunk_size = get_max_chunk_size();
+	uint32_t rows_per_chunk = extent.height;
+	uint32_t slices_per_chunk = extent.depth;
+	VkDeviceSize row_size = size;
+	if (size > max_chunk_size)
+	{
+		VkDeviceSize row_count = VkDeviceSize(extent.height) * extent.depth;
+		row_size = size / row_count;
+		if (row_size * row_count != size || row_size > staging_size)
+		{
+			ERR("Image of {} bytes cannot be split into rows that fit the staging ring", size);
+			return false;
+		}
+
+		VkDeviceSize slice_size = row_size * extent.height;
+		rows_per_chunk = slice_size <= max_chunk_size ? extent.height : uint32_t(std::max<VkDeviceSize>(max_chunk_size / row_size, 1));
+		slices_per_chunk = slice_size <= max_chunk_size ? uint32_t(max_chunk_size / slice_size) : 1;
+	}
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.pNext = nullptr;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = destination;
+	barrier.subresourceRange.aspectMask = aspect;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	vkCmdPipelineBarrier(get_recording_command_buffer(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	// Reserving may submit the batch being recorded, so every copy asks for the current command buffer.
+	// Batches run in submission order on the transfer queue, the layout transition still comes first.
+	const Byte* source = static_cast<const Byte*>(data);
+	for (uint32_t z = 0; z < extent.depth; z += slices_per_chunk)
+	{
+		uint32_t slice_count = std::min(slices_per_chunk, extent.depth - z);
+		for (uint32_t y = 0; y < extent.height; y += rows_per_chunk)
+		{
+			uint32_t row_count = std::min(rows_per_chunk, extent.height - y);
+			VkDeviceSize chunk_size = size > max_chunk_size ? row_size * row_count * slice_count : size;
+			Optional<VkDeviceSize> staging_offset = reserve_staging(chunk_size, staging_alignment);
+			if (!staging_offset)
+			{
+				ERR("Could not reserve {} bytes of staging memory", chunk_size);
+				return false;
+			}
+			VkDeviceSize source_offset = (VkDeviceSize(z) * extent.height + y) * row_size;
+			std::memcpy(static_cast<Byte*>(staging_buffer.allocation.mapped) + *staging_offset, source + source_offset, chunk_size);
+
+			VkBufferImageCopy region = {};
+			region.bufferOffset = *staging_offset;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = aspect;
+			region.imageSubresource.mipLevel = 0;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = { 0, int32_t(y), int32_t(z) };
+			region.imageExtent = { extent.width, row_count, slice_count };
+			vkCmdCopyBufferToImage(get_recording_command_buffer(), staging_buffer.buffer, destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		}
+	}
+
+	// The layout transition to final_layout doubles as the release half of the ownership transfer
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = final_layout;
+	if (transfer_queue_family != graphics_queue_family)
+	{
+		barrier.srcQueueFamilyIndex = transfer_queue_family;
+		barrier.dstQueueFamilyIndex = graphics_queue_family;
+		pending_image_barriers.push_back(barrier);
+	}
+	else
+	{
+		vkCmdPipelineBarrier(get_recording_command_buffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	return true;
+}
+
+uint64_t VulkanUploader::flush()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return flush_locked();
+}
+
+void VulkanUploader::record_acquire_barriers(VkCommandBuffer graphics_command_buffer)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (acquire_buffer_barriers.empty() && acquire_image_barriers.empty())
+	{
+		return;
+	}
+
+	for (VkBufferMemoryBarrier& barrier : acquire_buffer_barriers)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	}
+	for (VkImageMemoryBarrier& barrier : acquire_image_barriers)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	}
+
+	vkCmdPipelineBarrier(
+	    graphics_command_buffer,
+	    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+	    VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
+	    0,
+	    0,
+	    nullptr,
+	    acquire_buffer_barriers.size(),
+	    acquire_buffer_barriers.data(),
+	    acquire_image_barriers.size(),
+	    acquire_image_barriers.data());
+
+	acquire_buffer_barriers.clear();
+	acquire_image_barriers.clear();
+}
+
+bool VulkanUploader::is_complete(uint64_t timeline_value) const
+{
+	uint64_t completed_value = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(device, timeline_semaphore, &completed_value));
+	return completed_value >= timeline_value;
+}
+
+void VulkanUploader::wait(uint64_t timeline_value) const
+{
+	if (timeline_value == 0)
+	{
+		return;
+	}
+
+	VkSemaphoreWaitInfo wait_info = {};
+	wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	wait_info.pNext = nullptr;
+	wait_info.semaphoreCount = 1;
+	wait_info.pSemaphores = &timeline_semaphore;
+	wait_info.pValues = &timeline_value;
+	VK_CHECK(vkWaitSemaphores(device, &wait_info, UINT64_MAX));
+}
+
+Optional<VkDeviceSize> VulkanUploader::reserve_staging(VkDeviceSize size, VkDeviceSize alignment)
+{
+	if (size > staging_size)
+	{
+		return {};
+	}
+
+	uint64_t start = (ring_write_position + alignment - 1) / alignment * alignment;
+
+	// Never let a reservation straddle the end of the buffer, skip to the start instead
+	if (start % staging_size + size > staging_size)
+	{
+		start += staging_size - start % staging_size;
+	}
+	uint64_t end = start + size;
+
+	while (end - ring_retired_position > staging_size)
+	{
+		if (submissions.empty())
+		{
+			// The space is held by the batch being recorded, get it going so it can be recycled
+			if (recording_command_buffer == VK_NULL_HANDLE)
+			{
+				return {};
+			}
+			flush_locked();
+		}
+		retire_submissions(true);
+	}
+
+	ring_write_position = end;
+	return start % staging_size;
+}
+
+VkCommandBuffer VulkanUploader::get_recording_command_buffer()
+{
+	if (recording_command_buffer != VK_NULL_HANDLE)
+	{
+		return recording_command_buffer;
+	}
+
+	retire_submissions(false);
+	if (free_command_buffers.empty())
+	{
+		VkCommandBuffer cmd;
+		VkCommandBufferAllocateInfo allocate_info = VulkanInit::command_buffer_allocate_info(command_pool);
+		VK_CHECK(vkAllocateCommandBuffers(device, &allocate_info, &cmd));
+		free_command_buffers.push_back(cmd);
+	}
+
+	recording_command_buffer = free_command_buffers.back();
+	free_command_buffers.pop_back();
+
+	VkCommandBufferBeginInfo begin_info = {};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.pNext = nullptr;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_CHECK(vkBeginCommandBuffer(recording_command_buffer, &begin_info));
+
+	return recording_command_buffer;
+}
+
+uint64_t VulkanUploader::flush_locked()
+{
+	if (recording_command_buffer == VK_NULL_HANDLE)
+	{
+		return 0;
+	}
+
+	if (!pending_buffer_barriers.empty() || !pending_image_barriers.empty())
+	{
+		vkCmdPipelineBarrier(
+		    recording_command_buffer,
+		    VK_PIPELINE_STAGE_TRANSFER_BIT,
+		    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		    0,
+		    0,
+		    nullptr,
+		    pending_buffer_barriers.size(),
+		    pending_buffer_barriers.data(),
+		    pending_image_barriers.size(),
+		    pending_image_barriers.data());
+
+		acquire_buffer_barriers.insert(acquire_buffer_barriers.end(), pending_buffer_barriers.begin(), pending_buffer_barriers.end());
+		acquire_image_barriers.insert(acquire_image_barriers.end(), pending_image_barriers.begin(), pending_image_barriers.end());
+		pending_buffer_barriers.clear();
+		pending_image_barriers.clear();
+	}
+
+	VK_CHECK(vkEndCommandBuffer(recording_command_buffer));
+
+	uint64_t signal_value = last_submitted_value + 1;
+
+	VkTimelineSemaphoreSubmitInfo timeline_info = {};
+	timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timeline_info.pNext = nullptr;
+	timeline_info.signalSemaphoreValueCount = 1;
+	timeline_info.pSignalSemaphoreValues = &signal_value;
+
+	VkSubmitInfo submit = {};
+	submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit.pNext = &timeline_info;
+	submit.commandBufferCount = 1;
+	submit.pCommandBuffers = &recording_command_buffer;
+	submit.signalSemaphoreCount = 1;
+	submit.pSignalSemaphores = &timeline_semaphore;
+
+	VK_CHECK(vkQueueSubmit(transfer_queue, 1, &submit, VK_NULL_HANDLE));
+
+	Submission submission;
+	submission.command_buffer = recording_command_buffer;
+	submission.timeline_value = signal_value;
+	submission.ring_end = ring_write_position;
+	submissions.push_back(submission);
+
+	recording_command_buffer = VK_NULL_HANDLE;
+	last_submitted_value = signal_value;
+
+	return signal_value;
+}
+
+void VulkanUploader::retire_submissions(bool wait_for_oldest)
+{
+	if (wait_for_oldest && !submissions.empty())
+	{
+		wait(submissions.front().timeline_value);
+	}
+
+	uint64_t completed_value = 0;
+	VK_CHECK(vkGetSemaphoreCounterValue(device, timeline_semaphore, &completed_value));
+
+	while (!submissions.empty() && submissions.front().timeline_value <= completed_value)
+	{
+		ring_retired_position = submissions.front().ring_end;
+		free_command_buffers.push_back(submissions.front().command_buffer);
+		submissions.pop_front();
+	}
+}
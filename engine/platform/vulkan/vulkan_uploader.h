@@ -0,0 +1,91 @@
+#pragma once
+
+#include "common.h"
+#include "vulkan_allocator.h"
+
+#include "vulkan/vulkan.h"
+
+#include <deque>
+#include <mutex>
+
+// Streams buffer and image contents to device local memory through a persistently mapped staging ring.
+//
+// Uploads are recorded on the transfer queue as they come in and submitted together once per frame by flush().
+// The returned timeline value is what the graphics queue has to wait on before it can read the uploaded data.
+// When the transfer and graphics queues belong to different families, record_acquire_barriers() has to be
+// recorded on the graphics queue to complete the ownership transfer. Thread safe.
+class VulkanUploader
+{
+public:
+	static constexpr VkDeviceSize default_staging_size = VkDeviceSize(32) * 1024 * 1024;
+
+	VulkanUploader(VkDevice device, VulkanAllocator& allocator, VkQueue transfer_queue, uint32_t transfer_queue_family, uint32_t graphics_queue_family, VkDeviceSize staging_size = default_staging_size);
+	~VulkanUploader();
+
+	VulkanUploader(const VulkanUploader&) = delete;
+	VulkanUploader(VulkanUploader&&) = delete;
+	VulkanUploader& operator=(const VulkanUploader&) = delete;
+	VulkanUploader& operator=(VulkanUploader&&) = delete;
+
+	// The data is copied into the staging ring before returning. The destination must not be in use by the GPU.
+	bool upload_buffer(VkBuffer destination, VkDeviceSize destination_offset, const void* data, VkDeviceSize size);
+
+	// Uploads mip 0, layer 0 of a tightly packed image and leaves it in final_layout. Images bigger than a chunk
+	// of the staging ring are copied in row slices, which needs an uncompressed format.
+	bool upload_image(VkImage destination, VkExtent3D extent, VkImageAspectFlags aspect, const void* data, VkDeviceSize size, VkImageLayout final_layout);
+
+	// Submits all uploads recorded since the last flush. Returns the timeline value to wait on, or 0 if nothing was submitted.
+	uint64_t flush();
+
+	// Records the queue family acquire half of the ownership transfers for everything flushed so far
+	void record_acquire_barriers(VkCommandBuffer graphics_command_buffer);
+
+	VkSemaphore get_timeline_semaphore() const { return timeline_semaphore; }
+	bool is_complete(uint64_t timeline_value) const;
+	void wait(uint64_t timeline_value) const;
+
+private:
+	struct Submission
+	{
+		VkCommandBuffer command_buffer;
+		uint64_t timeline_value;
+		uint64_t ring_end;
+	};
+
+	// Uploads bigger than this are split so they never need the whole ring at once
+	VkDeviceSize get_max_chunk_size() const { return staging_size / 4; }
+
+	// Returns the offset into the staging buffer or nothing if the request can never fit
+	Optional<VkDeviceSize> reserve_staging(VkDeviceSize size, VkDeviceSize alignment);
+	VkCommandBuffer get_recording_command_buffer();
+	uint64_t flush_locked();
+	void retire_submissions(bool wait_for_oldest);
+
+	VkDevice device;
+	VulkanAllocator& allocator;
+	VkQueue transfer_queue;
+	uint32_t transfer_queue_family;
+	uint32_t graphics_queue_family;
+
+	mutable std::mutex mutex;
+
+	// Staging ring. Positions grow monotonically and are wrapped into the buffer on use.
+	VulkanBuffer staging_buffer;
+	VkDeviceSize staging_size;
+	uint64_t ring_write_position = 0;
+	uint64_t ring_retired_position = 0;
+
+	VkCommandPool command_pool = VK_NULL_HANDLE;
+	Vector<VkCommandBuffer> free_command_buffers;
+	VkCommandBuffer recording_command_buffer = VK_NULL_HANDLE;
+	std::deque<Submission> submissions;
+
+	VkSemaphore timeline_semaphore = VK_NULL_HANDLE;
+	uint64_t last_submitted_value = 0;
+
+	// Ownership transfers waiting to be released by the next flush and acquired by the graphics queue
+	Vector<VkBufferMemoryBarrier> pending_buffer_barriers;
+	Vector<VkImageMemoryBarrier> pending_image_barriers;
+	Vector<VkBufferMemoryBarrier> acquire_buffer_barriers;
+	Vector<VkImageMemoryBarrier> acquire_image_barriers;
+};
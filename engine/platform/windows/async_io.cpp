@@ -0,0 +1,7 @@
+#include "os/async_io.h"
+
+Ptr<AsyncIOBackend> AsyncIOBackend::create_native(uint32_t, CompletionHandler)
+{
+	// Windows deliberately reads through the thread pool backend
+	return nullptr;
+}
@@ -0,0 +1,7 @@
+#include "os/file_watcher.h"
+
+Ptr<FileWatcherBackend> FileWatcherBackend::create_native()
+{
+	// Windows deliberately uses the polling backend
+	return nullptr;
+}
@@ -0,0 +1,94 @@
+#include "os/file_system.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+
+namespace
+{
+DWORD to_flags(FileAccess access)
+{
+	switch (access)
+	{
+	case FileAccess::Sequential:
+		return FILE_FLAG_SEQUENTIAL_SCAN;
+	case FileAccess::Random:
+		return FILE_FLAG_RANDOM_ACCESS;
+	default:
+		return FILE_ATTRIBUTE_NORMAL;
+	}
+}
+}
+
+Optional<MappedFile> MappedFile::map(const String& path, FileAccess access)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, to_flags(access), nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return {};
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		CloseHandle(file);
+		return {};
+	}
+
+	MappedFile mapped_file;
+	mapped_file.path = path;
+	mapped_file.mapped_size = file_size.QuadPart;
+
+	// Empty files are valid but cannot be mapped
+	if (mapped_file.mapped_size > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			CloseHandle(file);
+			return {};
+		}
+
+		void* address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+		// The view keeps its own references to the mapping and the file
+		CloseHandle(mapping);
+		if (!address)
+		{
+			CloseHandle(file);
+			return {};
+		}
+		mapped_file.mapped_data = static_cast<const Byte*>(address);
+	}
+	CloseHandle(file);
+
+	return mapped_file;
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const
+{
+	if (!mapped_data || offset >= mapped_size)
+	{
+		return;
+	}
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<Byte*>(mapped_data) + offset;
+	range.NumberOfBytes = (std::min)(size, mapped_size - offset);
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MappedFile::release(size_t offset, size_t size) const
+{
+	// Mapped views are trimmed by the working set manager on their own
+}
+
+void MappedFile::unmap()
+{
+	if (mapped_data)
+	{
+		UnmapViewOfFile(mapped_data);
+	}
+	mapped_data = nullptr;
+	mapped_size = 0;
+}
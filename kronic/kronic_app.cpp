@@ -1,6 +1,11 @@
 #include "kronic_app.h"
 
+#include "core/allocator.h"
+#include "core/input.h"
+#include "core/job_system.h"
 #include "core/log.h"
+#include "core/profiler.h"
+#include "os/async_io.h"
 #include "platform/vulkan/vulkan_renderer.h"
 #include "platform/glfw/glfw_window.h"
 
@@ -14,29 +19,169 @@ KronicApplication::KronicApplication()
 
 	if (konfig.rendering_api == Konfig::RenderingAPI::Vulkan)
 	{
-		renderer = MakeUnique<VulkanRenderer>("Kronic", static_cast<GLFWWindow*>(window.get())); // TODO: Should be in user konfig
+		renderer = MakeUnique<VulkanRenderer>("Kronic", static_cast<GLFWWindow*>(window.get()), konfig.frames_in_flight, konfig.present_mode);
 		INFO("Created Vulkan renderer");
 	}
+
+	frame_pacer.set_max_frame_rate(konfig.max_frame_rate);
+	mouse_sensitivity = konfig.mouse_sensitivity;
+
+	simulation = MakeUnique<Simulation>(konfig.tick_rate, [this](const SimulationTick& tick)
+	    { this->tick(tick); });
+	INFO("Simulating at {} ticks per second", konfig.tick_rate);
 }
 
 KronicApplication::~KronicApplication()
 {
 	INFO("Kronic application is ending");
+
+	simulation->stop();
+	INFO("Ran {} simulation ticks, dropped {}, longest took {:.3f} ms", simulation->get_tick_count(), simulation->get_dropped_tick_count(), simulation->get_max_tick_duration_ns() / 1e6);
+
+	if (is_profiler_enabled)
+	{
+		const FrameHistogram& histogram = Profiler::get_singleton()->get_frame_histogram();
+		INFO("Frame times over the last {} frames: average {:.3f} ms, p50 {:.3f} ms, p99 {:.3f} ms", histogram.get_frame_count(), histogram.get_average(), histogram.get_percentile(0.5), histogram.get_percentile(0.99));
+
+		if (Profiler::get_singleton()->write_chrome_trace(".cache/trace.json"))
+		{
+			INFO("Wrote profiler trace to {}", ".cache/trace.json");
+		}
+	}
+
+	const FrameHistogram& latency = renderer->get_frame_stats().input_latency;
+	if (latency.get_frame_count() > 0)
+	{
+		INFO("Input to present latency over the last {} frames: average {:.3f} ms, p50 {:.3f} ms, p99 {:.3f} ms", latency.get_frame_count(), latency.get_average(), latency.get_percentile(0.5), latency.get_percentile(0.99));
+	}
 	EventWindowClosing::fire({});
+
+	// Reloads still running hold on to this
+	JobSystem::get_singleton()->wait(konfig_reload_counter);
+	JobSystem::get_singleton()->pump_main_thread();
 }
 
 void KronicApplication::run()
 {
-	EventWindowResizing event = { {}, 100, 100 };
+	simulation->start();
+
 	while (!window->has_closed())
 	{
+		// Waiting out the frame cap before sampling input keeps the input as fresh as possible when drawing
+		// Input arriving while the pacer waits is stamped as it comes in rather than at the next poll
+		frame_pacer.wait([this](uint64_t timeout_ns)
+		                 { window->wait_events(timeout_ns); });
+		window->collect_events();
+		renderer->set_input_time(Profiler::now_ns());
+		JobSystem::get_singleton()->pump_main_thread();
+		AsyncIO::get_singleton()->pump();
+		EventBus::dispatch(EventPhase::FrameStart);
+
+		// Drawn between the last two ticks at the current time, however many ticks ran since the last frame
+		snapshots.acquire();
+		if (snapshots.has_snapshot())
+		{
+			float alpha = snapshots.get_alpha(Profiler::now_ns());
+			render_snapshot = interpolate(snapshots.get_previous().state, snapshots.get_current().state, alpha);
+
+			// The view is not interpolated but taken from the newest tick plus the motion the simulation has not
+			// seen yet, so aim never waits for the next tick
+			float sensitivity = mouse_sensitivity.load(std::memory_order_relaxed);
+			const GameSnapshot& current = snapshots.get_current().state;
+			render_snapshot.yaw = current.yaw - float(Input::get_singleton()->get_pushed_motion_x() - current.consumed_motion_x) * sensitivity;
+			render_snapshot.pitch = std::clamp(current.pitch - float(Input::get_singleton()->get_pushed_motion_y() - current.consumed_motion_y) * sensitivity, -89.0f, 89.0f);
+		}
+
 		renderer->draw();
 
-		window->collect_events();
+		EventBus::dispatch(EventPhase::FrameEnd);
+		FrameArena::get_singleton()->end_frame();
+		PROFILE_FRAME();
 	}
 }
 
+void KronicApplication::tick(const SimulationTick& tick)
+{
+	// Events are split between ticks by when they happened, a tick running late leaves the ones after its end
+	// to the next tick
+	Input* input = Input::get_singleton();
+	float sensitivity = mouse_sensitivity.load(std::memory_order_relaxed);
+	input->consume(tick.end_ns, [this, sensitivity](const InputEvent& event)
+	               {
+		if (event.type == InputEventType::MouseMotion)
+		{
+			yaw -= event.delta_x * sensitivity;
+			pitch = std::clamp(pitch - event.delta_y * sensitivity, -89.0f, 89.0f);
+		} });
+
+	GameSnapshot& snapshot = snapshots.begin_write();
+	snapshot.time_s = (tick.index + 1) * tick.delta_s;
+	snapshot.yaw = yaw;
+	snapshot.pitch = pitch;
+	snapshot.consumed_motion_x = input->get_consumed_motion_x();
+	snapshot.consumed_motion_y = input->get_consumed_motion_y();
+	snapshots.publish(tick.index, tick.end_ns);
+}
+
+GameSnapshot interpolate(const GameSnapshot& previous, const GameSnapshot& current, float alpha)
+{
+	GameSnapshot result = current;
+	result.time_s = previous.time_s + (current.time_s - previous.time_s) * alpha;
+	return result;
+}
+
 void KronicApplication::handle_resize(const EventWindowResizing& e)
 {
 	DEBUG("New size: {}x{}", e.width, e.height);
 }
+
+void KronicApplication::handle_file_changed(const EventFileChanged& e)
+{
+	if (e.path != Konfig::path)
+	{
+		return;
+	}
+
+	JobSystem::get_singleton()->run([this]()
+	                                {
+		Optional<FileYAML> file = FileSystem::read_yaml(Konfig::path);
+		if (!file)
+		{
+			ERR("Keeping the previous konfig, {} could not be loaded", Konfig::path);
+			return;
+		}
+
+		// Missing or mistyped values throw, which must not take the job thread down
+		Ref<Konfig> reloaded;
+		try
+		{
+			reloaded = MakeRef<Konfig>(*file);
+		}
+		catch (const std::exception& exception)
+		{
+			ERR("Keeping the previous konfig, {} is invalid. {}", Konfig::path, exception.what());
+			return;
+		}
+
+		JobSystem::get_singleton()->run_on_main_thread([this, reloaded]()
+		                                               { apply_konfig(*reloaded); }); },
+	                                &konfig_reload_counter);
+}
+
+void KronicApplication::apply_konfig(const Konfig& reloaded)
+{
+	// These pick the window, the renderer and its frame resources, none of which are rebuilt while running
+	if (reloaded.rendering_api != konfig.rendering_api || reloaded.windowing_api != konfig.windowing_api || reloaded.frames_in_flight != konfig.frames_in_flight || reloaded.present_mode != konfig.present_mode || reloaded.tick_rate != konfig.tick_rate)
+	{
+		WARN("Rendering API, windowing API, frames in flight, present mode and tick rate changes take effect after a restart");
+	}
+
+	if (reloaded.max_frame_rate != konfig.max_frame_rate)
+	{
+		frame_pacer.set_max_frame_rate(reloaded.max_frame_rate);
+	}
+
+	mouse_sensitivity = reloaded.mouse_sensitivity;
+
+	konfig = reloaded;
+}
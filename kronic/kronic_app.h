@@ -5,10 +5,31 @@
 #include "core/log.h"
 #include "core/event_link.h"
 #include "core/event.h"
+#include "core/frame_pacer.h"
+#include "core/job_system.h"
+#include "core/simulation.h"
+
+#include <atomic>
 
 class Window;
 class Renderer;
 
+// Everything the render thread needs from a simulation tick
+struct GameSnapshot
+{
+	double time_s = 0.0;
+
+	// View angles in degrees
+	float yaw = 0.0f;
+	float pitch = 0.0f;
+
+	// Input::get_consumed_motion_x() and y after the tick
+	double consumed_motion_x = 0.0;
+	double consumed_motion_y = 0.0;
+};
+
+GameSnapshot interpolate(const GameSnapshot& previous, const GameSnapshot& current, float alpha);
+
 class KronicApplication : public Application
 {
 public:
@@ -21,7 +42,27 @@ private:
 	Konfig konfig;
 	Ptr<Window> window;
 	Ptr<Renderer> renderer;
+	FramePacer frame_pacer;
+
+	// Ticks on its own thread, the render loop only ever reads the snapshots it publishes
+	void tick(const SimulationTick& tick);
+	Ptr<Simulation> simulation;
+	SnapshotBuffer<GameSnapshot> snapshots;
+
+	// State the frame being drawn shows. Placeholder until the renderer has a camera to hand it to.
+	GameSnapshot render_snapshot;
+
+	// Simulation thread only
+	float yaw = 0.0f;
+	float pitch = 0.0f;
+	std::atomic<float> mouse_sensitivity;
 
 	void handle_resize(const EventWindowResizing& e);
 	EventLink<KronicApplication, EventWindowResizing> event_resize = { this, &KronicApplication::handle_resize };
+
+	// The konfig file is parsed on a job and applied on the main thread at the start of a frame
+	void handle_file_changed(const EventFileChanged& e);
+	void apply_konfig(const Konfig& reloaded);
+	EventLink<KronicApplication, EventFileChanged> event_file_changed = { this, &KronicApplication::handle_file_changed };
+	JobCounter konfig_reload_counter;
 };
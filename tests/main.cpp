@@ -1,7 +1,27 @@
 #include "gtest/gtest.h"
 
+#include "test_allocator.h"
+#include "test_async_io.h"
+#include "test_broadphase.h"
+#include "test_bvh.h"
+#include "test_character_controller.h"
+#include "test_ecs.h"
+#include "test_event.h"
+#include "test_file_system.h"
+#include "test_file_watcher.h"
+#include "test_frame_pacer.h"
 #include "test_headless.h"
+#include "test_input.h"
+#include "test_job_system.h"
+#include "test_log.h"
+#include "test_math_simd.h"
+#include "test_pak.h"
+#include "test_profiler.h"
+#include "test_simulation.h"
 #include "test_utils.h"
+#include "test_vulkan_allocator.h"
+#include "test_vulkan_pipeline_cache.h"
+#include "test_vulkan_uploader.h"
 
 int main()
 {
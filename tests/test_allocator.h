@@ -0,0 +1,176 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/allocator.h"
+
+#include <thread>
+
+// Counts what reaches upstream so tests can check nothing does
+class CountingResource : public MemoryResource
+{
+public:
+	uint32_t allocation_count = 0;
+	uint32_t live_count = 0;
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		allocation_count++;
+		live_count++;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* pointer, size_t bytes, size_t alignment) override
+	{
+		live_count--;
+		std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+	}
+
+	bool do_is_equal(const MemoryResource& other) const noexcept override { return this == &other; }
+};
+
+TEST(Allocator, LinearArena)
+{
+	CountingResource upstream;
+	{
+		LinearArena arena(4096, &upstream);
+		EXPECT_EQ(upstream.allocation_count, 1);
+
+		void* a = arena.allocate(10, 1);
+		void* b = arena.allocate(16, 64);
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 64, 0);
+		EXPECT_GT(b, a);
+		EXPECT_LE(arena.get_used(), 10 + 64 + 16);
+
+		// Running out falls back to upstream until the next reset
+		void* large = arena.allocate(8192, 16);
+		EXPECT_EQ(reinterpret_cast<uintptr_t>(large) % 16, 0);
+		EXPECT_EQ(arena.get_overflow_count(), 1);
+		EXPECT_EQ(upstream.live_count, 2);
+		EXPECT_GT(arena.get_peak(), 8192);
+
+		arena.reset();
+		EXPECT_EQ(arena.get_used(), 0);
+		EXPECT_EQ(arena.get_overflow_count(), 0);
+		EXPECT_EQ(upstream.live_count, 1);
+		EXPECT_EQ(arena.allocate(10, 1), a);
+
+		uint32_t allocations = upstream.allocation_count;
+		for (uint32_t frame = 0; frame < 100; frame++)
+		{
+			Pmr::Vector<uint32_t> values(&arena);
+			for (uint32_t i = 0; i < 100; i++)
+			{
+				values.push_back(i);
+			}
+			Pmr::String text("long enough to not fit in the small string buffer", &arena);
+			arena.reset();
+		}
+		EXPECT_EQ(upstream.allocation_count, allocations);
+	}
+	EXPECT_EQ(upstream.live_count, 0);
+}
+
+TEST(Allocator, Rewind)
+{
+	CountingResource upstream;
+	LinearArena arena(256, &upstream);
+	void* kept = arena.allocate(100, 8);
+
+	LinearArena::Marker marker = arena.get_marker();
+	void* released = arena.allocate(100, 8);
+	EXPECT_NE(arena.allocate(1000, 8), nullptr);
+	EXPECT_EQ(upstream.live_count, 2);
+
+	arena.rewind(marker);
+	EXPECT_EQ(arena.get_used(), 100);
+	EXPECT_EQ(upstream.live_count, 1);
+	EXPECT_EQ(arena.allocate(100, 8), released);
+	EXPECT_NE(kept, released);
+}
+
+TEST(Allocator, FrameArena)
+{
+	FrameArena* frame_arena = FrameArena::get_singleton();
+	{
+		Pmr::HashMap<uint32_t, Pmr::String> names(frame_arena);
+		names[1] = "one";
+		Pmr::Map<uint32_t, uint32_t> ordered(frame_arena);
+		ordered[2] = 3;
+		EXPECT_GT(frame_arena->get_used(), 0);
+	}
+	frame_arena->end_frame();
+	EXPECT_EQ(frame_arena->get_used(), 0);
+}
+
+TEST(Allocator, ScratchScope)
+{
+	LinearArena* arena = ScratchScope::get_thread_arena();
+	size_t used = arena->get_used();
+	{
+		ScratchScope scratch;
+		EXPECT_EQ(scratch.get_arena(), arena);
+		EXPECT_NE(scratch.get_arena()->allocate(64, 8), nullptr);
+		{
+			ScratchScope nested;
+			EXPECT_NE(nested.get_arena()->allocate(128, 8), nullptr);
+			EXPECT_GE(arena->get_used(), used + 192);
+		}
+		EXPECT_LT(arena->get_used(), used + 128);
+	}
+	EXPECT_EQ(arena->get_used(), used);
+
+	// Every thread has its own
+	LinearArena* other = nullptr;
+	std::thread thread([&other]
+	                   { other = ScratchScope::get_thread_arena(); });
+	thread.join();
+	EXPECT_NE(other, arena);
+}
+
+TEST(Allocator, Pool)
+{
+	EXPECT_THROW(PoolAllocator(16, 3), Exception);
+
+	CountingResource upstream;
+	{
+		PoolAllocator pool(24, 8, 4, &upstream);
+		EXPECT_EQ(pool.get_block_size(), 24);
+
+		Vector<void*> blocks;
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			blocks.push_back(pool.allocate_block());
+			EXPECT_EQ(reinterpret_cast<uintptr_t>(blocks.back()) % 8, 0);
+		}
+		EXPECT_EQ(pool.get_block_count(), 8);
+		EXPECT_EQ(pool.get_free_count(), 2);
+		EXPECT_EQ(upstream.allocation_count, 2);
+
+		// Freed blocks are reused before growing again
+		pool.deallocate_block(blocks[3]);
+		EXPECT_EQ(pool.allocate_block(), blocks[3]);
+		for (void* block : blocks)
+		{
+			pool.deallocate_block(block);
+		}
+		EXPECT_EQ(pool.get_free_count(), 8);
+
+		// Map nodes come from the pool, anything bigger than a block goes upstream
+		PoolAllocator node_pool(64);
+		Pmr::Map<uint32_t, uint32_t> map(&node_pool);
+		for (uint32_t i = 0; i < 100; i++)
+		{
+			map[i] = i * 2;
+		}
+		EXPECT_EQ(node_pool.get_block_count() - node_pool.get_free_count(), 100);
+		map.clear();
+		EXPECT_EQ(node_pool.get_free_count(), node_pool.get_block_count());
+
+		void* large = pool.allocate(100, 8);
+		EXPECT_EQ(upstream.live_count, 3);
+		pool.deallocate(large, 100, 8);
+	}
+	EXPECT_EQ(upstream.live_count, 0);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "os/async_io.h"
+
+#include <cstring>
+#include <filesystem>
+
+class AsyncIOTest : public testing::TestWithParam<bool>
+{
+protected:
+	void SetUp() override
+	{
+		for (uint32_t i = 0; i < file_count; i++)
+		{
+			String contents = "file " + std::to_string(i) + " ";
+			contents.resize(contents.size() + i * 997, char('a' + i % 26));
+			ASSERT_TRUE(FileSystem::write_file(get_path(i), contents.data(), contents.size()));
+			expected.push_back(std::move(contents));
+		}
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all("test_output");
+	}
+
+	static String get_path(uint32_t i) { return "test_output/async_io/" + std::to_string(i) + ".bin"; }
+
+	static constexpr uint32_t file_count = 200;
+	Vector<String> expected;
+};
+
+TEST_P(AsyncIOTest, ReadsManyFiles)
+{
+	AsyncIO io(32, GetParam());
+
+	uint32_t completed = 0;
+	for (uint32_t i = 0; i < file_count; i++)
+	{
+		IOPriority priority = IOPriority(i % uint32_t(IOPriority::Count));
+		io.read(get_path(i), [&, i](IOResult& result)
+		        {
+			EXPECT_EQ(result.status, IOStatus::Completed);
+			EXPECT_EQ(result.view().as_string_view(), expected[i]);
+			completed++; },
+		        priority);
+	}
+	io.wait_idle();
+
+	EXPECT_EQ(completed, file_count);
+	EXPECT_EQ(io.get_pending_count(), 0);
+}
+
+TEST_P(AsyncIOTest, ReadsRangesAndReportsFailures)
+{
+	AsyncIO io(4, GetParam());
+
+	IOStatus missing_status = IOStatus::Completed;
+	io.read("test_output/async_io/missing.bin", [&](IOResult& result)
+	        { missing_status = result.status; });
+
+	String range;
+	io.read(get_path(10), [&](IOResult& result)
+	        { range = String(result.view().as_string_view()); },
+	        IOPriority::High, 3, 5);
+
+	// Callbacks only run when pumped
+	io.wait_idle();
+
+	EXPECT_EQ(missing_status, IOStatus::Failed);
+	EXPECT_EQ(range, expected[10].substr(3, 5));
+}
+
+TEST_P(AsyncIOTest, CancelledReadsReportCancellation)
+{
+	AsyncIO io(1, GetParam());
+
+	Vector<IOStatus> statuses(file_count, IOStatus::Failed);
+	Vector<IOHandle> handles;
+	for (uint32_t i = 0; i < file_count; i++)
+	{
+		handles.push_back(io.read(get_path(i), [&, i](IOResult& result)
+		                          { statuses[i] = result.status; }));
+	}
+
+	for (uint32_t i = 0; i < file_count; i += 2)
+	{
+		EXPECT_TRUE(io.cancel(handles[i]));
+	}
+	io.wait_idle();
+
+	for (uint32_t i = 0; i < file_count; i++)
+	{
+		EXPECT_EQ(statuses[i], i % 2 == 0 ? IOStatus::Cancelled : IOStatus::Completed);
+	}
+
+	// Already delivered
+	EXPECT_FALSE(io.cancel(handles[0]));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncIOTest, testing::Values(true, false), [](const testing::TestParamInfo<bool>& info)
+                         { return info.param ? "Native" : "ThreadPool"; });
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "physics/broadphase.h"
+
+#include <random>
+
+inline Vector<BroadphasePair> find_pairs_brute_force(const Vector<AABB>& boxes, const Vector<uint8_t>& is_alive)
+{
+	Vector<BroadphasePair> pairs;
+	for (uint32_t a = 0; a < boxes.size(); a++)
+	{
+		for (uint32_t b = a + 1; b < boxes.size(); b++)
+		{
+			if (is_alive[a] && is_alive[b] && boxes[a].overlaps(boxes[b]))
+			{
+				pairs.push_back({ a, b });
+			}
+		}
+	}
+	return pairs;
+}
+
+TEST(Broadphase, Layers)
+{
+	constexpr uint32_t player_layer = 1 << 0;
+	constexpr uint32_t projectile_layer = 1 << 1;
+
+	Broadphase broadphase;
+	AABB box = { Vector3(0.0f), Vector3(1.0f) };
+	ProxyID player = broadphase.add(box, player_layer);
+	ProxyID projectile = broadphase.add(box, projectile_layer, player_layer);
+	broadphase.add(box, projectile_layer, player_layer);
+	broadphase.update();
+
+	// Projectiles only pair with the player
+	ASSERT_EQ(broadphase.get_pairs().size(), 2);
+	EXPECT_EQ(broadphase.get_pairs()[0], (BroadphasePair { player, projectile }));
+	EXPECT_EQ(broadphase.get_added_pairs().size(), 2);
+
+	broadphase.move(projectile, { Vector3(5.0f), Vector3(6.0f) });
+	broadphase.update();
+	EXPECT_EQ(broadphase.get_pairs().size(), 1);
+	EXPECT_TRUE(broadphase.get_added_pairs().empty());
+	ASSERT_EQ(broadphase.get_removed_pairs().size(), 1);
+	EXPECT_EQ(broadphase.get_removed_pairs()[0], (BroadphasePair { player, projectile }));
+}
+
+TEST(Broadphase, RemovedProxiesAreReusedAfterUpdate)
+{
+	Broadphase broadphase;
+	AABB box = { Vector3(0.0f), Vector3(1.0f) };
+	ProxyID a = broadphase.add(box);
+	ProxyID b = broadphase.add(box);
+	broadphase.update();
+
+	broadphase.remove(b);
+	ProxyID c = broadphase.add({ Vector3(5.0f), Vector3(6.0f) });
+	EXPECT_NE(c, b);
+	broadphase.update();
+	EXPECT_TRUE(broadphase.get_pairs().empty());
+	ASSERT_EQ(broadphase.get_removed_pairs().size(), 1);
+	EXPECT_EQ(broadphase.get_removed_pairs()[0], (BroadphasePair { a, b }));
+	EXPECT_EQ(broadphase.get_proxy_count(), 2);
+
+	EXPECT_EQ(broadphase.add(box), b);
+}
+
+TEST(Broadphase, MatchesBruteForce)
+{
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> position(0.0f, 100.0f);
+	std::uniform_real_distribution<float> size(0.5f, 4.0f);
+	std::uniform_real_distribution<float> step(-1.0f, 1.0f);
+	std::uniform_int_distribution<uint32_t> pick(0, 499);
+
+	Broadphase broadphase;
+	Vector<AABB> boxes;
+	Vector<uint8_t> is_alive;
+	for (uint32_t i = 0; i < 500; i++)
+	{
+		Vector3 min(position(random), position(random) * 0.1f, position(random));
+		boxes.push_back({ min, min + Vector3(size(random), size(random), size(random)) });
+		is_alive.push_back(true);
+		ASSERT_EQ(broadphase.add(boxes.back()), i);
+	}
+
+	Vector<BroadphasePair> previous;
+	uint32_t added_count = 0;
+	uint32_t removed_count = 0;
+	for (uint32_t frame = 0; frame < 50; frame++)
+	{
+		for (uint32_t i = 0; i < boxes.size(); i++)
+		{
+			if (!is_alive[i])
+			{
+				continue;
+			}
+			Vector3 offset(step(random), step(random) * 0.1f, step(random));
+			boxes[i].min += offset;
+			boxes[i].max += offset;
+			broadphase.move(i, boxes[i]);
+		}
+
+		// Churn a few proxies, re-adding them under the ids they were given before
+		for (uint32_t i = 0; i < 5; i++)
+		{
+			uint32_t proxy = pick(random);
+			if (is_alive[proxy])
+			{
+				broadphase.remove(proxy);
+				is_alive[proxy] = false;
+			}
+		}
+		broadphase.update();
+
+		Vector<BroadphasePair> expected = find_pairs_brute_force(boxes, is_alive);
+		ASSERT_EQ(broadphase.get_pairs(), expected) << "frame " << frame;
+
+		Vector<BroadphasePair> added;
+		Vector<BroadphasePair> removed;
+		std::set_difference(expected.begin(), expected.end(), previous.begin(), previous.end(), std::back_inserter(added));
+		std::set_difference(previous.begin(), previous.end(), expected.begin(), expected.end(), std::back_inserter(removed));
+		ASSERT_EQ(broadphase.get_added_pairs(), added) << "frame " << frame;
+		ASSERT_EQ(broadphase.get_removed_pairs(), removed) << "frame " << frame;
+		added_count += added.size();
+		removed_count += removed.size();
+		previous = expected;
+
+		for (uint32_t i = 0; i < boxes.size(); i++)
+		{
+			if (!is_alive[i])
+			{
+				ProxyID proxy = broadphase.add(boxes[i]);
+				ASSERT_LT(proxy, boxes.size());
+				ASSERT_FALSE(is_alive[proxy]);
+				boxes[proxy] = boxes[i];
+				is_alive[proxy] = true;
+				break;
+			}
+		}
+	}
+
+	// Boxes must actually have moved in and out of each other
+	EXPECT_GT(added_count, 100);
+	EXPECT_GT(removed_count, 100);
+}
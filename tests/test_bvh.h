@@ -0,0 +1,176 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "physics/bvh.h"
+
+#include <random>
+
+// Random triangles scattered through a 100 m cube, small enough that most rays pass between them
+inline void make_test_triangles(uint32_t triangle_count, Vector<Vector3>& vertices, Vector<uint32_t>& indices)
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> offset(-3.0f, 3.0f);
+
+	for (uint32_t i = 0; i < triangle_count; i++)
+	{
+		Vector3 center(position(random), position(random), position(random));
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			indices.push_back(vertices.size());
+			vertices.push_back(center + Vector3(offset(random), offset(random), offset(random)));
+		}
+	}
+}
+
+inline float intersect_brute_force(const Vector<Vector3>& vertices, const Vector<uint32_t>& indices, const Ray& ray)
+{
+	float closest = ray.max_distance;
+	bool has_hit = false;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		Vector3 v0 = vertices[indices[i]];
+		Vector3 edge1 = vertices[indices[i + 1]] - v0;
+		Vector3 edge2 = vertices[indices[i + 2]] - v0;
+
+		// Intersect the plane, then check the barycentric coordinates of the hit point
+		Vector3 normal = Math::cross(edge1, edge2);
+		float denominator = Math::dot(normal, ray.direction);
+		if (denominator == 0.0f)
+		{
+			continue;
+		}
+		float distance = Math::dot(normal, v0 - ray.origin) / denominator;
+		if (distance < 0.0f || distance > closest)
+		{
+			continue;
+		}
+
+		Vector3 point = ray.origin + ray.direction * distance - v0;
+		float d00 = Math::dot(edge1, edge1);
+		float d01 = Math::dot(edge1, edge2);
+		float d11 = Math::dot(edge2, edge2);
+		float d20 = Math::dot(point, edge1);
+		float d21 = Math::dot(point, edge2);
+		float area = d00 * d11 - d01 * d01;
+		float u = (d11 * d20 - d01 * d21) / area;
+		float v = (d00 * d21 - d01 * d20) / area;
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f)
+		{
+			closest = distance;
+			has_hit = true;
+		}
+	}
+	return has_hit ? closest : -1.0f;
+}
+
+TEST(BVH, Empty)
+{
+	BVH bvh;
+	bvh.build(nullptr, 0, nullptr, 0);
+
+	RayHit hit;
+	EXPECT_FALSE(bvh.intersect({ Vector3(0.0f), Vector3(1.0f, 0.0f, 0.0f) }, hit));
+	EXPECT_FALSE(bvh.is_occluded({ Vector3(0.0f), Vector3(1.0f, 0.0f, 0.0f) }));
+	EXPECT_FALSE(hit.is_hit());
+}
+
+TEST(BVH, SingleTriangle)
+{
+	Vector<Vector3> vertices = { Vector3(0.0f, 0.0f, 5.0f), Vector3(1.0f, 0.0f, 5.0f), Vector3(0.0f, 1.0f, 5.0f) };
+	Vector<uint32_t> indices = { 0, 1, 2 };
+	EXPECT_THROW(BVH().build(vertices.data(), 2, indices.data(), 1), Exception);
+
+	BVH bvh;
+	bvh.build(vertices.data(), vertices.size(), indices.data(), 1);
+
+	// Axis aligned rays have zero direction components, which the slab test must survive
+	RayHit hit;
+	ASSERT_TRUE(bvh.intersect({ Vector3(0.25f, 0.25f, 0.0f), Vector3(0.0f, 0.0f, 1.0f) }, hit));
+	EXPECT_FLOAT_EQ(hit.distance, 5.0f);
+	EXPECT_EQ(hit.triangle, 0);
+	EXPECT_FLOAT_EQ(hit.u, 0.25f);
+	EXPECT_FLOAT_EQ(hit.v, 0.25f);
+
+	EXPECT_FALSE(bvh.intersect({ Vector3(0.75f, 0.75f, 0.0f), Vector3(0.0f, 0.0f, 1.0f) }, hit));
+	EXPECT_FALSE(bvh.is_occluded({ Vector3(0.25f, 0.25f, 0.0f), Vector3(0.0f, 0.0f, 1.0f), 4.0f }));
+	EXPECT_TRUE(bvh.is_occluded({ Vector3(0.25f, 0.25f, 10.0f), Vector3(0.0f, 0.0f, -1.0f), 6.0f }));
+}
+
+TEST(BVH, MatchesBruteForce)
+{
+	Vector<Vector3> vertices;
+	Vector<uint32_t> indices;
+	make_test_triangles(10000, vertices, indices);
+
+	BVH bvh;
+	bvh.build(vertices.data(), vertices.size(), indices.data(), indices.size() / 3);
+	EXPECT_EQ(bvh.get_triangle_count(), 10000);
+	EXPECT_LE(bvh.get_depth(), BVH::max_depth);
+
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+
+	constexpr size_t ray_count = 2000;
+	Vector<Ray> rays(ray_count);
+	for (Ray& ray : rays)
+	{
+		ray.origin = Vector3(position(random), position(random), position(random));
+		ray.direction = Vector3(direction(random), direction(random), direction(random));
+		ray.max_distance = 100.0f;
+	}
+
+	Vector<RayHit> hits(ray_count);
+	Vector<uint8_t> occluded(ray_count);
+	bvh.intersect(rays.data(), hits.data(), ray_count);
+	bvh.test_occlusion(rays.data(), occluded.data(), ray_count);
+
+	uint32_t hit_count = 0;
+	for (size_t i = 0; i < ray_count; i++)
+	{
+		float expected = intersect_brute_force(vertices, indices, rays[i]);
+		ASSERT_EQ(hits[i].is_hit(), expected >= 0.0f) << "ray " << i;
+		ASSERT_EQ(bool(occluded[i]), expected >= 0.0f) << "ray " << i;
+		if (expected >= 0.0f)
+		{
+			ASSERT_NEAR(hits[i].distance, expected, 1e-3f * expected);
+			hit_count++;
+		}
+	}
+
+	// Most rays should hit something or the test proves little
+	EXPECT_GT(hit_count, ray_count / 4);
+}
+
+TEST(BVH, Query)
+{
+	Vector<Vector3> vertices;
+	Vector<uint32_t> indices;
+	make_test_triangles(2000, vertices, indices);
+
+	BVH bvh;
+	bvh.build(vertices.data(), vertices.size(), indices.data(), indices.size() / 3);
+
+	AABB box = { Vector3(-10.0f), Vector3(10.0f) };
+	Vector<uint32_t> found;
+	bvh.query(box, [&found](uint32_t triangle)
+	    { found.push_back(triangle); });
+	std::sort(found.begin(), found.end());
+	EXPECT_LT(found.size(), indices.size() / 3 / 4);
+
+	for (uint32_t i = 0; i < indices.size() / 3; i++)
+	{
+		AABB triangle_box;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			triangle_box.add(vertices[indices[i * 3 + corner]]);
+			EXPECT_EQ(bvh.get_vertex(i, corner), vertices[indices[i * 3 + corner]]);
+		}
+		if (triangle_box.overlaps(box))
+		{
+			EXPECT_TRUE(std::binary_search(found.begin(), found.end(), i)) << "triangle " << i;
+		}
+	}
+}
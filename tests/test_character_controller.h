@@ -0,0 +1,229 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "physics/bvh.h"
+#include "physics/character_controller.h"
+
+#include <cstring>
+#include <random>
+
+struct TestLevel
+{
+	Vector<Vector3> vertices;
+	Vector<uint32_t> indices;
+	BVH bvh;
+
+	void add_box(const Vector3& min, const Vector3& max)
+	{
+		const uint32_t box_faces[36] = { 0, 1, 2, 2, 1, 3, 4, 6, 5, 5, 6, 7, 0, 4, 1, 1, 4, 5, 2, 3, 6, 6, 3, 7, 0, 2, 4, 4, 2, 6, 1, 5, 3, 3, 5, 7 };
+		uint32_t first = vertices.size();
+		for (uint32_t corner = 0; corner < 8; corner++)
+		{
+			vertices.push_back(Vector3(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z));
+		}
+		for (uint32_t index : box_faces)
+		{
+			indices.push_back(first + index);
+		}
+	}
+
+	void add_floor() { add_box(Vector3(-50.0f, -1.0f, -50.0f), Vector3(50.0f, 0.0f, 50.0f)); }
+
+	void build() { bvh.build(vertices.data(), vertices.size(), indices.data(), indices.size() / 3); }
+};
+
+constexpr float test_delta_s = 1.0f / 128.0f;
+
+// Sets the horizontal velocity every tick like player input does
+inline void walk(const CharacterController& controller, Character& character, float velocity_x, float velocity_z, float duration_s)
+{
+	for (float time_s = 0.0f; time_s < duration_s; time_s += test_delta_s)
+	{
+		character.velocity.x = velocity_x;
+		character.velocity.z = velocity_z;
+		controller.move(character, test_delta_s);
+	}
+}
+
+TEST(CharacterController, InvalidSettings)
+{
+	BVH bvh;
+	CharacterSettings settings;
+	settings.height = settings.radius;
+	EXPECT_THROW(CharacterController(&bvh, settings), Exception);
+	settings = {};
+	settings.skin = 0.0f;
+	EXPECT_THROW(CharacterController(&bvh, settings), Exception);
+}
+
+TEST(CharacterController, FallsOntoGround)
+{
+	TestLevel level;
+	level.add_floor();
+	level.build();
+	CharacterController controller(&level.bvh);
+
+	Character character;
+	character.position = Vector3(0.0f, 3.0f, 0.0f);
+	walk(controller, character, 0.0f, 0.0f, 2.0f);
+
+	EXPECT_TRUE(character.is_grounded);
+	EXPECT_GE(character.position.y, 0.0f);
+	EXPECT_LE(character.position.y, controller.get_settings().skin);
+	EXPECT_EQ(character.velocity, Vector3(0.0f));
+
+	// Jumping leaves the ground
+	character.velocity.y = 6.0f;
+	controller.move(character, test_delta_s);
+	EXPECT_FALSE(character.is_grounded);
+	EXPECT_GT(character.position.y, 0.02f);
+}
+
+TEST(CharacterController, SlidesAlongWalls)
+{
+	TestLevel level;
+	level.add_floor();
+	level.add_box(Vector3(5.0f, 0.0f, -50.0f), Vector3(6.0f, 3.0f, 50.0f));
+	level.build();
+	CharacterController controller(&level.bvh);
+
+	Character character;
+	character.is_grounded = true;
+	walk(controller, character, 8.0f, 4.0f, 1.0f);
+
+	EXPECT_TRUE(character.is_grounded);
+	EXPECT_LE(character.position.x, 5.0f - controller.get_settings().radius);
+	EXPECT_GT(character.position.x, 5.0f - controller.get_settings().radius - 0.05f);
+	EXPECT_GT(character.position.z, 3.5f);
+	EXPECT_LT(std::abs(character.velocity.x), 0.05f);
+}
+
+TEST(CharacterController, StepsUpLedges)
+{
+	for (float ledge_height : { 0.3f, 1.0f })
+	{
+		TestLevel level;
+		level.add_floor();
+		level.add_box(Vector3(3.0f, 0.0f, -50.0f), Vector3(10.0f, ledge_height, 50.0f));
+		level.build();
+		CharacterController controller(&level.bvh);
+
+		Character character;
+		character.is_grounded = true;
+		walk(controller, character, 5.0f, 0.0f, 1.0f);
+
+		EXPECT_TRUE(character.is_grounded);
+		if (ledge_height <= controller.get_settings().step_height)
+		{
+			EXPECT_NEAR(character.position.y, ledge_height, 0.02f);
+			EXPECT_GT(character.position.x, 4.5f);
+		}
+		else
+		{
+			EXPECT_NEAR(character.position.y, 0.0f, 0.02f);
+			EXPECT_LE(character.position.x, 3.0f - controller.get_settings().radius);
+		}
+	}
+}
+
+TEST(CharacterController, StaysOnSlopes)
+{
+	// 30 degree ramp going down along x, tan(30) is 0.57735
+	TestLevel level;
+	float drop = 0.57735f * 20.0f;
+	level.vertices = { Vector3(-10.0f, 0.0f, -10.0f), Vector3(10.0f, -drop, -10.0f), Vector3(-10.0f, 0.0f, 10.0f), Vector3(10.0f, -drop, 10.0f) };
+	level.indices = { 0, 2, 1, 1, 2, 3 };
+	level.build();
+	CharacterController controller(&level.bvh);
+
+	Character character;
+	character.position = Vector3(-5.0f, -2.5f, 0.0f);
+	walk(controller, character, 0.0f, 0.0f, 0.5f);
+	ASSERT_TRUE(character.is_grounded);
+	EXPECT_NEAR(character.ground_normal.y, 0.86603f, 1e-3f);
+
+	// Down, then back up
+	for (float velocity_x : { 6.0f, -6.0f })
+	{
+		for (uint32_t tick = 0; tick < 128; tick++)
+		{
+			walk(controller, character, velocity_x, 0.0f, test_delta_s);
+			ASSERT_TRUE(character.is_grounded) << "tick " << tick;
+		}
+	}
+	EXPECT_LT(character.position.x, -3.0f);
+}
+
+TEST(CharacterController, DoesNotTunnel)
+{
+	TestLevel level;
+	level.add_floor();
+	level.add_box(Vector3(5.0f, 0.0f, -50.0f), Vector3(5.05f, 3.0f, 50.0f));
+	level.build();
+	CharacterController controller(&level.bvh);
+
+	Character character;
+	character.is_grounded = true;
+	character.velocity = Vector3(400.0f, 0.0f, 0.0f);
+	controller.move(character, 1.0f / 16.0f);
+	EXPECT_LE(character.position.x, 5.0f - controller.get_settings().radius);
+	EXPECT_GT(character.position.x, 4.0f);
+}
+
+TEST(CharacterController, BatchedIsDeterministic)
+{
+	TestLevel level;
+	level.add_floor();
+	std::mt19937 random(9);
+	std::uniform_real_distribution<float> position(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> size(0.2f, 2.0f);
+	std::uniform_real_distribution<float> speed(-8.0f, 8.0f);
+	for (uint32_t i = 0; i < 300; i++)
+	{
+		Vector3 min(position(random), 0.0f, position(random));
+		level.add_box(min, min + Vector3(size(random), size(random), size(random)));
+	}
+	level.build();
+	CharacterController controller(&level.bvh);
+
+	constexpr size_t character_count = 64;
+	Vector<Character> batched(character_count);
+	for (Character& character : batched)
+	{
+		character.position = Vector3(position(random), 3.0f, position(random));
+	}
+	Vector<Character> one_by_one = batched;
+
+	for (uint32_t tick = 0; tick < 256; tick++)
+	{
+		if (tick % 32 == 0)
+		{
+			for (size_t i = 0; i < character_count; i++)
+			{
+				batched[i].velocity.x = one_by_one[i].velocity.x = speed(random);
+				batched[i].velocity.z = one_by_one[i].velocity.z = speed(random);
+			}
+		}
+
+		controller.move(batched.data(), character_count, test_delta_s);
+		for (size_t i = character_count; i > 0; i--)
+		{
+			controller.move(one_by_one[i - 1], test_delta_s);
+		}
+	}
+
+	// Bitwise, both orders must produce exactly the same floats. Compared field by field, Character has padding.
+	auto is_same = [](const Vector3& a, const Vector3& b)
+	{
+		return std::memcmp(&a, &b, sizeof(Vector3)) == 0;
+	};
+	for (size_t i = 0; i < character_count; i++)
+	{
+		EXPECT_TRUE(is_same(batched[i].position, one_by_one[i].position)) << "character " << i;
+		EXPECT_TRUE(is_same(batched[i].velocity, one_by_one[i].velocity)) << "character " << i;
+		EXPECT_TRUE(is_same(batched[i].ground_normal, one_by_one[i].ground_normal)) << "character " << i;
+		EXPECT_EQ(batched[i].is_grounded, one_by_one[i].is_grounded) << "character " << i;
+		EXPECT_GT(batched[i].position.y, -0.01f) << "character " << i;
+	}
+}
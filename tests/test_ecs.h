@@ -0,0 +1,191 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/ecs.h"
+
+#include <atomic>
+
+struct TestPosition
+{
+	float x, y, z;
+};
+
+struct TestVelocity
+{
+	float x, y, z;
+};
+
+struct TestName
+{
+	String name;
+};
+
+TEST(ECS, CreateAndGet)
+{
+	World world;
+
+	Entity entity = world.create(TestPosition { 1.0f, 2.0f, 3.0f }, TestName { "player" });
+	EXPECT_TRUE(world.is_alive(entity));
+	EXPECT_TRUE(world.has<TestPosition>(entity));
+	EXPECT_FALSE(world.has<TestVelocity>(entity));
+	EXPECT_EQ(world.get<TestPosition>(entity)->y, 2.0f);
+	EXPECT_EQ(world.get<TestName>(entity)->name, "player");
+
+	world.destroy(entity);
+	EXPECT_FALSE(world.is_alive(entity));
+	EXPECT_EQ(world.get<TestPosition>(entity), nullptr);
+
+	// Recycled indices must not revive old handles
+	Entity recycled = world.create(TestPosition {});
+	EXPECT_EQ(recycled.index, entity.index);
+	EXPECT_FALSE(world.is_alive(entity));
+	EXPECT_TRUE(world.is_alive(recycled));
+}
+
+TEST(ECS, AddRemoveKeepsData)
+{
+	World world;
+
+	Vector<Entity> entities;
+	for (uint32_t i = 0; i < 2000; i++)
+	{
+		entities.push_back(world.create(TestPosition { float(i), 0.0f, 0.0f }, TestName { std::to_string(i) }));
+	}
+
+	// Moving every other entity leaves holes that get filled from the end of the archetype
+	for (uint32_t i = 0; i < entities.size(); i += 2)
+	{
+		world.add(entities[i], TestVelocity { 1.0f, 0.0f, 0.0f });
+	}
+	for (uint32_t i = 0; i < entities.size(); i += 4)
+	{
+		world.remove<TestName>(entities[i]);
+	}
+
+	for (uint32_t i = 0; i < entities.size(); i++)
+	{
+		ASSERT_EQ(world.get<TestPosition>(entities[i])->x, float(i));
+		ASSERT_EQ(world.has<TestVelocity>(entities[i]), i % 2 == 0);
+		ASSERT_EQ(world.has<TestName>(entities[i]), i % 4 != 0);
+		if (i % 4 != 0)
+		{
+			ASSERT_EQ(world.get<TestName>(entities[i])->name, std::to_string(i));
+		}
+	}
+}
+
+TEST(ECS, Queries)
+{
+	World world;
+
+	for (uint32_t i = 0; i < 10000; i++)
+	{
+		if (i % 2 == 0)
+		{
+			world.create(TestPosition { 0.0f, 0.0f, 0.0f }, TestVelocity { 1.0f, 2.0f, 3.0f });
+		}
+		else
+		{
+			world.create(TestPosition { 0.0f, 0.0f, 0.0f });
+		}
+	}
+
+	uint32_t moved = 0;
+	world.each<TestPosition, const TestVelocity>([&moved](TestPosition& position, const TestVelocity& velocity)
+	    {
+		    position.x += velocity.x;
+		    moved++;
+	    });
+	EXPECT_EQ(moved, 5000);
+
+	uint32_t total = 0;
+	world.each<TestPosition>([&world, &total](Entity entity, TestPosition& position)
+	    {
+		    EXPECT_EQ(position.x, world.has<TestVelocity>(entity) ? 1.0f : 0.0f);
+		    total++;
+	    });
+	EXPECT_EQ(total, 10000);
+}
+
+TEST(ECS, ParallelEachWithCommandBuffer)
+{
+	World world;
+
+	for (uint32_t i = 0; i < 10000; i++)
+	{
+		world.create(TestPosition { float(i), 0.0f, 0.0f }, TestVelocity { 1.0f, 0.0f, 0.0f });
+	}
+
+	EntityCommandBuffer commands;
+	std::atomic<uint32_t> visited = 0;
+	world.parallel_each<TestPosition, const TestVelocity>([&commands, &visited](Entity entity, TestPosition& position, const TestVelocity& velocity)
+	    {
+		    position.x += velocity.x;
+		    visited++;
+
+		    if (int(position.x) % 10 == 0)
+		    {
+			    commands.destroy(entity);
+			    commands.create(TestName { "spawned" });
+		    }
+	    });
+	EXPECT_EQ(visited, 10000);
+
+	commands.execute(world);
+	EXPECT_TRUE(commands.is_empty());
+	EXPECT_EQ(world.get_entity_count(), 10000);
+
+	uint32_t spawned = 0;
+	world.each<TestName>([&spawned](const TestName& name)
+	    {
+		    EXPECT_EQ(name.name, "spawned");
+		    spawned++;
+	    });
+	EXPECT_EQ(spawned, 1000);
+}
+
+// Checks the alignment of every copy it is moved from or into
+struct alignas(64) TestAligned
+{
+	static inline std::atomic<uint32_t> misaligned = 0;
+
+	float value;
+
+	explicit TestAligned(float value) :
+	    value(value) {}
+
+	TestAligned(TestAligned&& other) :
+	    value(other.value)
+	{
+		check(this);
+		check(&other);
+	}
+
+	static void check(const void* address)
+	{
+		if (reinterpret_cast<uintptr_t>(address) % alignof(TestAligned) != 0)
+		{
+			misaligned++;
+		}
+	}
+};
+
+TEST(ECS, CommandBufferAlignsPayloads)
+{
+	World world;
+	Entity first = world.create(TestPosition { 0.0f, 0.0f, 0.0f });
+	Entity second = world.create(TestPosition { 0.0f, 0.0f, 0.0f });
+
+	// The second payload lands behind the first one in the same page
+	EntityCommandBuffer commands;
+	commands.add(first, TestAligned(1.0f));
+	commands.add(second, TestAligned(2.0f));
+	commands.execute(world);
+
+	EXPECT_EQ(TestAligned::misaligned, 0);
+	ASSERT_TRUE(world.has<TestAligned>(first));
+	ASSERT_TRUE(world.has<TestAligned>(second));
+	EXPECT_EQ(world.get<TestAligned>(first)->value, 1.0f);
+	EXPECT_EQ(world.get<TestAligned>(second)->value, 2.0f);
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/event.h"
+
+#include <thread>
+
+struct TestEventCount : public BaseEvent<TestEventCount>
+{
+	uint32_t value;
+};
+
+struct TestEventFrameEnd : public BaseEvent<TestEventFrameEnd>
+{
+	static constexpr EventPhase phase = EventPhase::FrameEnd;
+	uint32_t value;
+};
+
+struct TestEventReceiver
+{
+	uint32_t received = 0;
+	uint32_t sum = 0;
+
+	void handle(const TestEventCount& e)
+	{
+		received++;
+		sum += e.value;
+	}
+	EventLink<TestEventReceiver, TestEventCount> link = { this, &TestEventReceiver::handle };
+};
+
+TEST(Event, FireAndUnsubscribe)
+{
+	Vector<Ptr<TestEventReceiver>> receivers;
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		receivers.push_back(MakeUnique<TestEventReceiver>());
+	}
+	EXPECT_EQ(TestEventCount::get_subscriber_count(), 8);
+
+	TestEventCount::fire({ {}, 2 });
+
+	// Leaving from the middle swaps the last link into the hole
+	receivers.erase(receivers.begin() + 3);
+	receivers.erase(receivers.begin());
+	EXPECT_EQ(TestEventCount::get_subscriber_count(), 6);
+
+	TestEventCount::fire({ {}, 3 });
+	for (const Ptr<TestEventReceiver>& receiver : receivers)
+	{
+		EXPECT_EQ(receiver->received, 2);
+		EXPECT_EQ(receiver->sum, 5);
+	}
+
+	receivers.clear();
+	EXPECT_EQ(TestEventCount::get_subscriber_count(), 0);
+}
+
+struct TestEventSelfDestructing
+{
+	Vector<Ptr<TestEventSelfDestructing>>* owners;
+	uint32_t received = 0;
+
+	void handle(const TestEventCount& e)
+	{
+		received++;
+
+		// Destroys every receiver including this one, the rest must not be called anymore
+		if (e.value == 1)
+		{
+			owners->clear();
+		}
+	}
+	EventLink<TestEventSelfDestructing, TestEventCount> link = { this, &TestEventSelfDestructing::handle };
+};
+
+TEST(Event, UnsubscribeWhileFiring)
+{
+	Vector<Ptr<TestEventSelfDestructing>> receivers;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		receivers.push_back(MakeUnique<TestEventSelfDestructing>());
+		receivers.back()->owners = &receivers;
+	}
+
+	TestEventCount::fire({ {}, 1 });
+	EXPECT_TRUE(receivers.empty());
+	EXPECT_EQ(TestEventCount::get_subscriber_count(), 0);
+
+	TestEventReceiver survivor;
+	TestEventCount::fire({ {}, 4 });
+	EXPECT_EQ(survivor.received, 1);
+}
+
+TEST(Event, PostFromThreads)
+{
+	TestEventReceiver receiver;
+
+	Vector<std::thread> producers;
+	for (uint32_t t = 0; t < 4; t++)
+	{
+		producers.emplace_back([]()
+		    {
+			    for (uint32_t i = 1; i <= 1000; i++)
+			    {
+				    TestEventCount::post({ {}, i });
+			    }
+		    });
+	}
+	for (std::thread& producer : producers)
+	{
+		producer.join();
+	}
+
+	// Nothing is delivered until the event's phase is dispatched
+	EXPECT_EQ(receiver.received, 0);
+	EventBus::dispatch(EventPhase::FrameEnd);
+	EXPECT_EQ(receiver.received, 0);
+
+	EventBus::dispatch(EventPhase::FrameStart);
+	EXPECT_EQ(receiver.received, 4000);
+	EXPECT_EQ(receiver.sum, 4 * 500500);
+}
+
+TEST(Event, PostIsOrderedPerPhase)
+{
+	struct Receiver
+	{
+		Vector<uint32_t> values;
+		void handle(const TestEventFrameEnd& e) { values.push_back(e.value); }
+		EventLink<Receiver, TestEventFrameEnd> link = { this, &Receiver::handle };
+	} receiver;
+
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		TestEventFrameEnd::post({ {}, i });
+	}
+
+	EventBus::dispatch(EventPhase::FrameStart);
+	EXPECT_TRUE(receiver.values.empty());
+
+	EventBus::dispatch(EventPhase::FrameEnd);
+	ASSERT_EQ(receiver.values.size(), 16);
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		EXPECT_EQ(receiver.values[i], i);
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "os/file_system.h"
+
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+TEST(FileSystem, WriteAndMapFile)
+{
+	const String path = "test_output/file_system/mapped.bin";
+	const char contents[] = "kronic mapped file";
+
+	ASSERT_TRUE(FileSystem::write_file(path, contents, sizeof(contents)));
+
+	Optional<MappedFile> mapped = FileSystem::map_file(path);
+	ASSERT_TRUE(mapped);
+	ASSERT_EQ(mapped->size(), sizeof(contents));
+	EXPECT_EQ(std::memcmp(mapped->data(), contents, sizeof(contents)), 0);
+
+	// Moving must hand over the mapping without unmapping it
+	MappedFile moved = std::move(*mapped);
+	EXPECT_EQ(mapped->data(), nullptr);
+	EXPECT_EQ(std::memcmp(moved.data(), contents, sizeof(contents)), 0);
+
+	std::filesystem::remove_all("test_output");
+}
+
+TEST(FileSystem, MapMissingFile)
+{
+	EXPECT_FALSE(MappedFile::map("test_output/file_system/missing.bin"));
+}
+
+TEST(FileSystem, FileViewSubview)
+{
+	const char contents[] = "0123456789";
+	FileView view = { reinterpret_cast<const Byte*>(contents), 10 };
+
+	EXPECT_EQ(view.subview(2, 3).as_string_view(), "234");
+	EXPECT_EQ(view.subview(8).as_string_view(), "89");
+	EXPECT_TRUE(view.subview(20).is_empty());
+}
+
+TEST(FileSystem, ReadFileAndYAMLFromMapping)
+{
+	const String path = "test_output/file_system/konfig.yaml";
+	const char contents[] = "window:\n  width: 1280\n  title: kronic\n";
+
+	ASSERT_TRUE(FileSystem::write_file(path, contents, sizeof(contents) - 1));
+
+	Optional<File> file = FileSystem::read_file(path);
+	ASSERT_TRUE(file);
+	EXPECT_EQ(file->contents, contents);
+
+	Optional<MappedFile> mapped = FileSystem::map_file(path, FileAccess::Random);
+	ASSERT_TRUE(mapped);
+	mapped->prefetch(0, mapped->size());
+	EXPECT_EQ(mapped->view().as_string_view(), contents);
+	mapped->release(0, mapped->size());
+	EXPECT_EQ(mapped->view().as_string_view(), contents);
+
+	Optional<FileYAML> yaml = FileSystem::read_yaml(path);
+	ASSERT_TRUE(yaml);
+	EXPECT_EQ(yaml->root["window"]["width"].as<int>(), 1280);
+	EXPECT_EQ(yaml->root["window"]["title"].as<String>(), "kronic");
+
+	std::filesystem::remove_all("test_output");
+}
+
+TEST(FileSystem, ConcurrentWritesOfOnePath)
+{
+	const String path = "test_output/file_system/concurrent.bin";
+
+	// Every writer gets its own temp file, so each rename publishes one complete version
+	Vector<std::thread> writers;
+	std::atomic<uint32_t> failures = 0;
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		writers.emplace_back([&path, &failures, i]()
+		    {
+			    const String contents(64 * 1024, char('a' + i));
+			    for (int j = 0; j < 20; j++)
+			    {
+				    if (!FileSystem::write_file(path, contents.data(), contents.size()))
+				    {
+					    failures++;
+				    }
+			    }
+		    });
+	}
+	for (std::thread& writer : writers)
+	{
+		writer.join();
+	}
+	EXPECT_EQ(failures, 0);
+
+	Optional<File> file = FileSystem::read_file(path);
+	ASSERT_TRUE(file);
+	ASSERT_EQ(file->contents.size(), 64 * 1024);
+	EXPECT_EQ(file->contents, String(file->contents.size(), file->contents[0]));
+
+	// No temp files are left behind
+	std::filesystem::directory_iterator files("test_output/file_system");
+	EXPECT_EQ(std::distance(files, std::filesystem::directory_iterator()), 1);
+
+	std::filesystem::remove_all("test_output");
+}
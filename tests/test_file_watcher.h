@@ -0,0 +1,62 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "os/file_system.h"
+#include "os/file_watcher.h"
+
+#include <condition_variable>
+#include <filesystem>
+
+class FileWatcherTest : public testing::TestWithParam<bool>
+{
+protected:
+	void TearDown() override
+	{
+		std::filesystem::remove_all("test_output");
+	}
+
+	// Blocks until the path was reported or a generous timeout runs out
+	bool wait_for(const String& path)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		return condition.wait_for(lock, std::chrono::seconds(5), [&]()
+		                          { return std::find(reported.begin(), reported.end(), path) != reported.end(); });
+	}
+
+	void on_change(const String& path)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		reported.push_back(path);
+		condition.notify_all();
+	}
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	Vector<String> reported;
+};
+
+TEST_P(FileWatcherTest, ReportsWritesAndNewDirectories)
+{
+	ASSERT_TRUE(FileSystem::write_file("test_output/watched/a.txt", "a", 1));
+
+	FileWatcher watcher(10, GetParam());
+	ASSERT_TRUE(watcher.watch("./test_output/watched/", [this](const String& path)
+	                          { on_change(path); }));
+
+	// write_file renames a temporary over the destination, like most editors do
+	ASSERT_TRUE(FileSystem::write_file("test_output/watched/a.txt", "ab", 2));
+	EXPECT_TRUE(wait_for("test_output/watched/a.txt"));
+
+	ASSERT_TRUE(FileSystem::write_file("test_output/watched/nested/b.txt", "b", 1));
+	EXPECT_TRUE(wait_for("test_output/watched/nested/b.txt"));
+
+	// Nothing outside the watched directory is reported
+	ASSERT_TRUE(FileSystem::write_file("test_output/unwatched.txt", "c", 1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	std::lock_guard<std::mutex> lock(mutex);
+	EXPECT_EQ(std::find(reported.begin(), reported.end(), "test_output/unwatched.txt"), reported.end());
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, FileWatcherTest, testing::Values(true, false), [](const testing::TestParamInfo<bool>& info)
+                         { return info.param ? "Native" : "Polling"; });
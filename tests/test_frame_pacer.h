@@ -0,0 +1,65 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/frame_pacer.h"
+#include "core/profiler.h"
+
+#include <thread>
+
+TEST(FramePacer, Unlimited)
+{
+	FramePacer pacer;
+
+	uint64_t start = Profiler::now_ns();
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		pacer.wait();
+	}
+	EXPECT_LT(Profiler::now_ns() - start, 10'000'000);
+}
+
+TEST(FramePacer, HoldsFrameRate)
+{
+	constexpr uint32_t frame_count = 50;
+	FramePacer pacer(500.0);
+
+	// The first wait only starts the schedule
+	pacer.wait();
+	uint64_t start = Profiler::now_ns();
+	for (uint32_t i = 0; i < frame_count; i++)
+	{
+		pacer.wait();
+	}
+	uint64_t elapsed = Profiler::now_ns() - start;
+
+	// A frame may start late after a hitch but never early
+	EXPECT_GE(elapsed, frame_count * 2'000'000 - 2'000'000);
+	EXPECT_LT(elapsed, frame_count * 2'000'000 * 2);
+	EXPECT_GE(pacer.get_spin_margin_ns(), DeadlineWaiter::min_spin_margin_ns);
+	EXPECT_LE(pacer.get_spin_margin_ns(), DeadlineWaiter::max_spin_margin_ns);
+
+	pacer.set_max_frame_rate(0.0);
+	start = Profiler::now_ns();
+	pacer.wait();
+	EXPECT_LT(Profiler::now_ns() - start, 1'000'000);
+}
+
+TEST(FramePacer, IdleCallback)
+{
+	FramePacer pacer(100.0);
+	pacer.wait();
+
+	// Returning early, like a window waking up for an input event, must not end the wait early
+	uint32_t idle_calls = 0;
+	uint64_t start = Profiler::now_ns();
+	pacer.wait([&idle_calls](uint64_t timeout_ns)
+	    {
+		    idle_calls++;
+		    std::this_thread::sleep_for(std::chrono::nanoseconds(std::min<uint64_t>(timeout_ns, 1'000'000))); });
+	uint64_t elapsed = Profiler::now_ns() - start;
+
+	EXPECT_GT(idle_calls, 1);
+	EXPECT_GE(elapsed, 9'000'000);
+	EXPECT_LT(elapsed, 20'000'000);
+}
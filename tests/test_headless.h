@@ -4,6 +4,10 @@
 
 #include "app/app.h"
 #include "app/window_none.h"
+#include "os/file_system.h"
+#include "platform/vulkan/vulkan_renderer.h"
+
+#include <cmath>
 
 class HeadlessTestApplication : public Application
 {
@@ -17,7 +21,6 @@ public:
 
 TEST(Headless, WindowNone)
 {
-	// TODO: Should use a headless window implementation that allows taking off-screen screenshots
 	ASSERT_NO_THROW(WindowNone());
 }
 
@@ -25,3 +28,80 @@ TEST(Headless, HeadlessApplication)
 {
 	ASSERT_NO_THROW(HeadlessTestApplication());
 }
+
+TEST(Headless, OffscreenRendererMatchesReference)
+{
+	FileSystem::set_current_directory_to_root_file("kronic.root");
+
+	Ptr<VulkanRenderer> renderer;
+	try
+	{
+		renderer = MakeUnique<VulkanRenderer>("kronic_tests", 64, 48);
+	}
+	catch (const Exception&)
+	{
+		GTEST_SKIP() << "No Vulkan device available";
+	}
+	ASSERT_TRUE(renderer->is_headless());
+
+	Vector<Byte> pixels;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	renderer->request_readback([&](const Byte* data, uint32_t image_width, uint32_t image_height)
+	    {
+		    pixels.assign(data, data + image_width * image_height * 4);
+		    width = image_width;
+		    height = image_height;
+	    });
+	renderer->draw();
+	renderer->finish();
+	ASSERT_EQ(width, 64);
+	ASSERT_EQ(height, 48);
+
+	// The reference is the triangle from assets/shaders with its vertex colors interpolated over the first
+	// frame's clear color
+	const float vertices[3][2] = { { 1.0f, 1.0f }, { -1.0f, 1.0f }, { 0.0f, -1.0f } };
+	auto edge = [](const float* a, const float* b, float x, float y)
+	{
+		return (b[0] - a[0]) * (y - a[1]) - (b[1] - a[1]) * (x - a[0]);
+	};
+	float area = edge(vertices[0], vertices[1], vertices[2][0], vertices[2][1]);
+	float flash = std::abs(std::sin(1 / 120.0f));
+
+	uint32_t mismatches = 0;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			float ndc_x = (x + 0.5f) / width * 2.0f - 1.0f;
+			float ndc_y = (y + 0.5f) / height * 2.0f - 1.0f;
+			float weights[3] = {
+				edge(vertices[1], vertices[2], ndc_x, ndc_y) / area,
+				edge(vertices[2], vertices[0], ndc_x, ndc_y) / area,
+				edge(vertices[0], vertices[1], ndc_x, ndc_y) / area,
+			};
+
+			bool is_inside = weights[0] >= 0.0f && weights[1] >= 0.0f && weights[2] >= 0.0f;
+			float expected[4] = { 0.0f, 0.0f, flash, 1.0f };
+			if (is_inside)
+			{
+				expected[0] = weights[0];
+				expected[1] = weights[1];
+				expected[2] = weights[2];
+			}
+
+			const Byte* pixel = &pixels[(y * width + x) * 4];
+			for (uint32_t channel = 0; channel < 4; channel++)
+			{
+				if (std::abs(int(pixel[channel]) - int(std::lround(expected[channel] * 255.0f))) > 2)
+				{
+					mismatches++;
+					break;
+				}
+			}
+		}
+	}
+
+	// Pixel centers that fall exactly on an edge may go either way depending on the rasterizer
+	EXPECT_LE(mismatches, width * height / 100);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/input.h"
+#include "core/spsc_queue.h"
+
+#include <thread>
+
+TEST(Input, SPSCQueue)
+{
+	SPSCQueue<uint32_t, 4> queue;
+	EXPECT_EQ(queue.peek(), nullptr);
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		EXPECT_TRUE(queue.push(i));
+	}
+	EXPECT_FALSE(queue.push(4));
+	EXPECT_EQ(queue.get_size(), 4);
+
+	EXPECT_EQ(*queue.peek(), 0);
+	queue.pop();
+	EXPECT_TRUE(queue.push(4));
+	for (uint32_t i = 1; i < 5; i++)
+	{
+		ASSERT_NE(queue.peek(), nullptr);
+		EXPECT_EQ(*queue.peek(), i);
+		queue.pop();
+	}
+	EXPECT_EQ(queue.peek(), nullptr);
+}
+
+TEST(Input, SPSCQueueAcrossThreads)
+{
+	constexpr uint32_t count = 100000;
+	Ptr<SPSCQueue<uint32_t, 256>> queue = MakeUnique<SPSCQueue<uint32_t, 256>>();
+
+	std::thread producer([&queue]()
+	    {
+		    for (uint32_t i = 0; i < count; i++)
+		    {
+			    while (!queue->push(i))
+			    {
+				    std::this_thread::yield();
+			    }
+		    } });
+
+	uint32_t expected = 0;
+	while (expected < count)
+	{
+		if (const uint32_t* value = queue->peek())
+		{
+			ASSERT_EQ(*value, expected);
+			queue->pop();
+			expected++;
+		}
+	}
+	producer.join();
+}
+
+TEST(Input, ConsumesByTimestamp)
+{
+	Ptr<Input> input = MakeUnique<Input>();
+
+	input->push({ 100, InputEventType::MouseMotion, 0, false, 1.0f, -2.0f });
+	input->push({ 200, InputEventType::Key, 87, true });
+	input->push({ 300, InputEventType::MouseMotion, 0, false, 0.5f, 0.0f });
+	EXPECT_DOUBLE_EQ(input->get_pushed_motion_x(), 1.5);
+
+	// A tick ending at 250 only sees what happened before it ended
+	float motion_x = 0.0f;
+	uint32_t keys = 0;
+	auto handler = [&motion_x, &keys](const InputEvent& event)
+	{
+		if (event.type == InputEventType::MouseMotion)
+		{
+			motion_x += event.delta_x;
+		}
+		else if (event.type == InputEventType::Key && event.is_pressed)
+		{
+			keys++;
+		}
+	};
+	EXPECT_EQ(input->consume(250, handler), 2);
+	EXPECT_FLOAT_EQ(motion_x, 1.0f);
+	EXPECT_EQ(keys, 1);
+	EXPECT_DOUBLE_EQ(input->get_consumed_motion_x(), 1.0);
+	EXPECT_DOUBLE_EQ(input->get_consumed_motion_y(), -2.0);
+
+	EXPECT_EQ(input->consume(250, handler), 0);
+	EXPECT_EQ(input->consume(300, handler), 1);
+	EXPECT_EQ(input->get_pushed_motion_x(), input->get_consumed_motion_x());
+	EXPECT_EQ(input->get_pushed_motion_y(), input->get_consumed_motion_y());
+}
+
+TEST(Input, DropsWhenFull)
+{
+	Ptr<Input> input = MakeUnique<Input>();
+	for (uint32_t i = 0; i < Input::capacity + 10; i++)
+	{
+		input->push({ i, InputEventType::MouseMotion, 0, false, 1.0f, 0.0f });
+	}
+	EXPECT_EQ(input->get_dropped_count(), 10);
+	EXPECT_DOUBLE_EQ(input->get_pushed_motion_x(), Input::capacity);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/job_system.h"
+
+#include <atomic>
+
+TEST(JobSystem, RunsJobs)
+{
+	JobSystem job_system(3);
+
+	std::atomic<uint32_t> sum = 0;
+	JobCounter counter;
+	for (uint32_t i = 1; i <= 1000; i++)
+	{
+		job_system.run([&sum, i]()
+		    { sum += i; },
+		    &counter);
+	}
+	job_system.wait(counter);
+
+	EXPECT_TRUE(counter.is_done());
+	EXPECT_EQ(sum, 500500);
+}
+
+TEST(JobSystem, ParallelFor)
+{
+	JobSystem job_system(3);
+
+	Vector<uint32_t> values(100000, 1);
+	job_system.parallel_for(0, values.size(), 1024, [&values](size_t begin, size_t end)
+	    {
+		    for (size_t i = begin; i < end; i++)
+		    {
+			    values[i] *= 2;
+		    }
+	    });
+
+	for (uint32_t value : values)
+	{
+		ASSERT_EQ(value, 2);
+	}
+}
+
+TEST(JobSystem, NestedWait)
+{
+	JobSystem job_system(2);
+
+	std::atomic<uint32_t> leaves = 0;
+	JobCounter outer;
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		job_system.run([&job_system, &leaves]()
+		    {
+			    // Waiting inside a job must keep the worker busy instead of deadlocking
+			    JobCounter inner;
+			    for (uint32_t j = 0; j < 16; j++)
+			    {
+				    job_system.run([&leaves]()
+				        { leaves++; },
+				        &inner);
+			    }
+			    job_system.wait(inner);
+		    },
+		    &outer);
+	}
+	job_system.wait(outer);
+
+	EXPECT_EQ(leaves, 256);
+}
+
+TEST(JobSystem, Dependencies)
+{
+	JobSystem job_system(3);
+
+	std::atomic<uint32_t> stage = 0;
+	std::atomic<bool> ordered = true;
+
+	JobCounter first;
+	JobCounter second;
+	for (uint32_t i = 0; i < 8; i++)
+	{
+		job_system.run([&stage]()
+		    { stage++; },
+		    &first);
+	}
+	job_system.run_after(first, [&stage, &ordered]()
+	    { ordered = ordered && stage == 8; },
+	    &second);
+	job_system.wait(second);
+
+	EXPECT_TRUE(ordered);
+}
+
+TEST(JobSystem, MainThreadAffinity)
+{
+	JobSystem job_system(2);
+
+	std::atomic<bool> ran_on_main_thread = false;
+	JobCounter counter;
+	job_system.run([&job_system, &ran_on_main_thread, &counter]()
+	    { job_system.run_on_main_thread([&job_system, &ran_on_main_thread]()
+		    { ran_on_main_thread = job_system.is_main_thread(); },
+		    &counter); });
+
+	// Waiting on the main thread drains the main thread queue
+	while (counter.is_done() && !ran_on_main_thread)
+	{
+		std::this_thread::yield();
+	}
+	job_system.wait(counter);
+
+	EXPECT_TRUE(ran_on_main_thread);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/log.h"
+
+#include "spdlog/sinks/base_sink.h"
+#include "spdlog/sinks/ostream_sink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+class LogTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		Log::setup();
+
+		// Nothing from earlier tests may still be on its way to the logger being replaced
+		Log::flush();
+		previous_logger = spdlog::default_logger();
+		Ref<spdlog::logger> logger = MakeRef<spdlog::logger>("test", MakeRef<spdlog::sinks::ostream_sink_mt>(output));
+		logger->set_pattern("%v");
+		logger->set_level(spdlog::level::trace);
+		spdlog::set_default_logger(logger);
+	}
+
+	void TearDown() override
+	{
+		Log::flush();
+		spdlog::set_default_logger(previous_logger);
+	}
+
+	uint32_t count_lines(const String& text)
+	{
+		String log = output.str();
+		uint32_t count = 0;
+		for (size_t found = log.find(text); found != String::npos; found = log.find(text, found + 1))
+		{
+			count++;
+		}
+		return count;
+	}
+
+	OStringStream output;
+	Ref<spdlog::logger> previous_logger;
+};
+
+TEST_F(LogTest, FormatsOnBackend)
+{
+	{
+		// The temporary is gone long before the backend formats the message
+		String name = "temporary";
+		INFO("Hello {} {} {:.1f}", name.c_str(), 42, 1.5f);
+	}
+	WARN("Without arguments");
+	Log::flush();
+
+	EXPECT_EQ(count_lines("Hello temporary 42 1.5"), 1);
+	EXPECT_EQ(count_lines("Without arguments"), 1);
+}
+
+TEST_F(LogTest, ManyThreads)
+{
+	// Enough to wrap every thread's ring several times
+	constexpr uint32_t messages = 5000;
+
+	Vector<std::thread> threads;
+	for (uint32_t t = 0; t < 4; t++)
+	{
+		threads.emplace_back([t]()
+		    {
+			    for (uint32_t i = 0; i < messages; i++)
+			    {
+				    INFO("Thread {} message {} {}", t, i, String(40, 'x'));
+			    }
+		    });
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	Log::flush();
+
+	EXPECT_EQ(count_lines("message"), 4 * messages);
+	EXPECT_EQ(count_lines("Thread 3 message 4999 "), 1);
+}
+
+TEST_F(LogTest, InvalidFormat)
+{
+	INFO("Missing {} {}", 1);
+	Log::flush();
+	EXPECT_EQ(count_lines("Invalid log format \"Missing {} {}\""), 1);
+
+	EXPECT_EQ(Log::format("{} {}", 1).rfind("Invalid log format \"{} {}\"", 0), 0);
+}
+
+// Remembers when the backend wrote its last record
+class ArrivalSink : public spdlog::sinks::base_sink<std::mutex>
+{
+public:
+	std::atomic<uint32_t> count = 0;
+	std::atomic<std::chrono::steady_clock::time_point> last_arrival = {};
+
+protected:
+	void sink_it_(const spdlog::details::log_msg&) override
+	{
+		last_arrival = std::chrono::steady_clock::now();
+		count++;
+	}
+	void flush_() override {}
+};
+
+TEST_F(LogTest, WarningsWakeBackend)
+{
+	Ref<ArrivalSink> sink = MakeRef<ArrivalSink>();
+	spdlog::set_default_logger(MakeRef<spdlog::logger>("arrival", sink));
+
+	// Without a wake every warning would sit in its ring until the next 5 ms tick
+	Vector<double> latencies_ms;
+	for (uint32_t i = 0; i < 11; i++)
+	{
+		uint32_t count = sink->count;
+		auto start = std::chrono::steady_clock::now();
+		WARN("Urgent {}", i);
+		while (sink->count == count)
+		{
+			std::this_thread::yield();
+		}
+		latencies_ms.push_back(std::chrono::duration<double, std::milli>(sink->last_arrival.load() - start).count());
+	}
+
+	std::nth_element(latencies_ms.begin(), latencies_ms.begin() + latencies_ms.size() / 2, latencies_ms.end());
+	EXPECT_LT(latencies_ms[latencies_ms.size() / 2], 1.0);
+}
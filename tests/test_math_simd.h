@@ -0,0 +1,184 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/math.h"
+#include "core/math_simd.h"
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include <cmath>
+#include <random>
+
+// Runs the test body once for every instruction set the CPU supports and restores the best one afterwards
+template <class F>
+void for_each_simd_level(F&& function)
+{
+	MathSIMD::set_level(MathSIMD::Level::AVX2);
+	MathSIMD::Level best = MathSIMD::get_level();
+	for (MathSIMD::Level level : { MathSIMD::Level::Scalar, MathSIMD::Level::SSE4, MathSIMD::Level::AVX2 })
+	{
+		if (level > best)
+		{
+			break;
+		}
+
+		MathSIMD::set_level(level);
+		SCOPED_TRACE(MathSIMD::get_level_name(level));
+		function();
+	}
+	MathSIMD::set_level(best);
+}
+
+TEST(MathSIMD, MultiplyMatrices)
+{
+	// Odd count so the SIMD kernels also go through their scalar tail
+	constexpr size_t count = 37;
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+
+	Vector<Matrix4x4> a(count);
+	Vector<Matrix4x4> b(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int j = 0; j < 16; j++)
+		{
+			a[i][j / 4][j % 4] = distribution(random);
+			b[i][j / 4][j % 4] = distribution(random);
+		}
+	}
+
+	for_each_simd_level([&]()
+	    {
+		    Vector<Matrix4x4> out(count);
+		    MathSIMD::multiply_matrices(&a[0][0][0], &b[0][0][0], &out[0][0][0], count);
+		    for (size_t i = 0; i < count; i++)
+		    {
+			    Matrix4x4 expected = a[i] * b[i];
+			    for (int j = 0; j < 16; j++)
+			    {
+				    ASSERT_NEAR(out[i][j / 4][j % 4], expected[j / 4][j % 4], 1e-5f);
+			    }
+		    }
+
+		    // In place over b with one shared matrix
+		    Vector<Matrix4x4> in_place = b;
+		    MathSIMD::multiply_matrix(&a[0][0][0], &in_place[0][0][0], &in_place[0][0][0], count);
+		    for (size_t i = 0; i < count; i++)
+		    {
+			    Matrix4x4 expected = a[0] * b[i];
+			    for (int j = 0; j < 16; j++)
+			    {
+				    ASSERT_NEAR(in_place[i][j / 4][j % 4], expected[j / 4][j % 4], 1e-5f);
+			    }
+		    }
+	    });
+}
+
+TEST(MathSIMD, FrustumCulling)
+{
+	Matrix4x4 projection = Math::perspective(Math::radians(90.0f), 1.0f, 0.1f, 100.0f);
+	Matrix4x4 view = Math::lookAt(Vector3(0.0f), Vector3(0.0f, 0.0f, -1.0f), Vector3(0.0f, 1.0f, 0.0f));
+	Matrix4x4 view_projection = projection * view;
+	MathSIMD::Frustum frustum = MathSIMD::extract_frustum(&view_projection[0][0], MathSIMD::ClipDepth::MinusOneToOne);
+
+	// In front, behind, past the far plane, left of the 90 degree cone, and straddling the left plane
+	Vector<float> x = { 0.0f, 0.0f, 0.0f, -20.0f, -10.5f };
+	Vector<float> y = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	Vector<float> z = { -10.0f, 10.0f, -150.0f, -10.0f, -10.0f };
+	Vector<float> size = { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+	Vector<uint8_t> expected = { 1, 0, 0, 0, 1 };
+
+	// Repeated past a full AVX2 vector
+	for (size_t i = 0; i < 15; i++)
+	{
+		x.push_back(x[i]);
+		y.push_back(y[i]);
+		z.push_back(z[i]);
+		size.push_back(size[i]);
+		expected.push_back(expected[i]);
+	}
+
+	for_each_simd_level([&]()
+	    {
+		    Vector<uint8_t> visible(x.size(), 2);
+		    EXPECT_EQ(MathSIMD::cull_spheres(frustum, { x.data(), y.data(), z.data(), size.data() }, visible.data(), x.size()), 8);
+		    EXPECT_EQ(visible, expected);
+
+		    std::fill(visible.begin(), visible.end(), 2);
+		    MathSIMD::AABBArrays boxes = { x.data(), y.data(), z.data(), size.data(), size.data(), size.data() };
+		    EXPECT_EQ(MathSIMD::cull_aabbs(frustum, boxes, visible.data(), x.size()), 8);
+		    EXPECT_EQ(visible, expected);
+	    });
+}
+
+TEST(MathSIMD, Quaternions)
+{
+	constexpr size_t count = 21;
+
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	Vector<float> a[4];
+	Vector<float> b[4];
+	Vector<float> t(count);
+	for (int component = 0; component < 4; component++)
+	{
+		a[component].resize(count);
+		b[component].resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			a[component][i] = distribution(random);
+			b[component][i] = distribution(random);
+		}
+	}
+	for (float& value : t)
+	{
+		value = distribution(random) * 0.5f + 0.5f;
+	}
+
+	for (int component = 0; component < 4; component++)
+	{
+		a[component][3] = 0.0f;
+	}
+
+	for_each_simd_level([&]()
+	    {
+		    Vector<float> q[4] = { a[0], a[1], a[2], a[3] };
+		    Vector<float> r[4] = { b[0], b[1], b[2], b[3] };
+		    MathSIMD::QuaternionArrays from = { q[0].data(), q[1].data(), q[2].data(), q[3].data() };
+		    MathSIMD::QuaternionArrays to = { r[0].data(), r[1].data(), r[2].data(), r[3].data() };
+		    MathSIMD::normalize_quaternions(from, count);
+		    MathSIMD::normalize_quaternions(to, count);
+
+		    EXPECT_EQ(q[0][3], 0.0f);
+		    EXPECT_EQ(q[3][3], 1.0f);
+		    for (size_t i = 0; i < count; i++)
+		    {
+			    float length = std::sqrt(q[0][i] * q[0][i] + q[1][i] * q[1][i] + q[2][i] * q[2][i] + q[3][i] * q[3][i]);
+			    ASSERT_NEAR(length, 1.0f, 1e-6f);
+		    }
+
+		    Vector<float> out[4] = { Vector<float>(count), Vector<float>(count), Vector<float>(count), Vector<float>(count) };
+		    MathSIMD::slerp_quaternions(from, to, t.data(), { out[0].data(), out[1].data(), out[2].data(), out[3].data() }, count);
+		    for (size_t i = 0; i < count; i++)
+		    {
+			    double cos_theta = 0.0;
+			    for (int component = 0; component < 4; component++)
+			    {
+				    cos_theta += double(q[component][i]) * r[component][i];
+			    }
+			    double sign = cos_theta < 0.0 ? -1.0 : 1.0;
+			    double theta = std::acos(std::min(std::abs(cos_theta), 1.0));
+			    double from_weight = theta < 1e-6 ? 1.0 - t[i] : std::sin((1.0 - t[i]) * theta) / std::sin(theta);
+			    double to_weight = theta < 1e-6 ? t[i] : std::sin(t[i] * theta) / std::sin(theta);
+
+			    for (int component = 0; component < 4; component++)
+			    {
+				    double expected = from_weight * q[component][i] + sign * to_weight * r[component][i];
+				    ASSERT_NEAR(out[component][i], expected, 5e-5);
+			    }
+		    }
+	    });
+}
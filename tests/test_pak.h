@@ -0,0 +1,118 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/compression.h"
+#include "os/pak.h"
+
+#include <filesystem>
+#include <random>
+
+TEST(Pak, CompressionRoundTrip)
+{
+	std::mt19937 random(7);
+	Vector<String> inputs = { "", "short", String(100000, 'k') };
+
+	String mixed;
+	for (int i = 0; i < 20000; i++)
+	{
+		mixed += random() % 4 == 0 ? char(random()) : "kronic"[i % 6];
+	}
+	inputs.push_back(mixed);
+
+	String noise;
+	for (int i = 0; i < 5000; i++)
+	{
+		noise += char(random());
+	}
+	inputs.push_back(noise);
+
+	for (const String& input : inputs)
+	{
+		Vector<Byte> compressed;
+		size_t compressed_size = Compression::compress_block(input.data(), input.size(), compressed);
+		EXPECT_LE(compressed_size, Compression::get_max_compressed_size(input.size()));
+
+		String output(input.size(), '\0');
+		ASSERT_TRUE(Compression::decompress_block(compressed.data(), compressed.size(), output.data(), output.size()));
+		EXPECT_EQ(output, input);
+
+		// Truncated blocks must be rejected rather than read past
+		if (compressed.size() > 1)
+		{
+			EXPECT_FALSE(Compression::decompress_block(compressed.data(), compressed.size() - 1, output.data(), output.size()));
+		}
+	}
+
+	Vector<Byte> run;
+	EXPECT_LT(Compression::compress_block(inputs[2].data(), inputs[2].size(), run), 1000);
+}
+
+TEST(Pak, WriteAndRead)
+{
+	const String raw = "raw entry contents";
+	const String packed(50000, 'p');
+	const String konfig = "frames_in_flight: 3\n";
+
+	PakWriter writer;
+	writer.add("assets/raw.txt", raw.data(), raw.size());
+	writer.add("assets/packed.bin", packed.data(), packed.size(), true);
+	writer.add("assets/empty.txt", "", 0, true);
+	writer.add("assets/pak_only.yaml", konfig.data(), konfig.size());
+	ASSERT_TRUE(writer.write("test_output/pak/test.kpak"));
+
+	Optional<PakArchive> archive = PakArchive::open("test_output/pak/test.kpak");
+	ASSERT_TRUE(archive);
+	EXPECT_EQ(archive->get_entry_count(), 4);
+	EXPECT_EQ(archive->find("assets/missing.txt"), nullptr);
+
+	const PakEntry* raw_entry = archive->find("assets/raw.txt");
+	ASSERT_NE(raw_entry, nullptr);
+	EXPECT_EQ(raw_entry->offset % pak_alignment, 0);
+	ASSERT_TRUE(archive->view(*raw_entry));
+	EXPECT_EQ(archive->view(*raw_entry)->as_string_view(), raw);
+
+	const PakEntry* packed_entry = archive->find("assets/packed.bin");
+	ASSERT_NE(packed_entry, nullptr);
+	EXPECT_EQ(packed_entry->compression, PakCompression::Block);
+	EXPECT_LT(packed_entry->stored_size, packed.size() / 10);
+	EXPECT_FALSE(archive->view(*packed_entry));
+
+	String unpacked(packed_entry->size, '\0');
+	ASSERT_TRUE(archive->read(*packed_entry, reinterpret_cast<Byte*>(unpacked.data())));
+	EXPECT_EQ(unpacked, packed);
+
+	// Mounted archives take priority over loose files, with paths normalized first
+	ASSERT_TRUE(FileSystem::mount("test_output/pak/test.kpak"));
+	Optional<File> file = FileSystem::read_file("./assets//packed.bin");
+	ASSERT_TRUE(file);
+	EXPECT_EQ(file->contents, packed);
+
+	// Stored entries are viewed in place, compressed ones are unpacked once
+	Optional<FileContents> raw_contents = FileSystem::view_file("assets/raw.txt");
+	ASSERT_TRUE(raw_contents);
+	EXPECT_EQ(raw_contents->view().as_string_view(), raw);
+	Optional<FileContents> packed_contents = FileSystem::view_file("assets/packed.bin");
+	ASSERT_TRUE(packed_contents);
+	EXPECT_EQ(packed_contents->view().as_string_view(), packed);
+
+	Optional<FileYAML> yaml = FileSystem::read_yaml("assets/pak_only.yaml");
+	ASSERT_TRUE(yaml);
+	EXPECT_EQ(yaml->root["frames_in_flight"].as<int>(), 3);
+
+	FileSystem::unmount_all();
+	EXPECT_FALSE(FileSystem::read_yaml("assets/pak_only.yaml"));
+
+	std::filesystem::remove_all("test_output");
+}
+
+TEST(Pak, RejectsCorruptArchives)
+{
+	const char garbage[] = "KPAK but not really an archive at all";
+	ASSERT_TRUE(FileSystem::write_file("test_output/pak/corrupt.kpak", garbage, sizeof(garbage)));
+
+	EXPECT_FALSE(PakArchive::open("test_output/pak/corrupt.kpak"));
+	EXPECT_FALSE(FileSystem::mount("test_output/pak/corrupt.kpak"));
+
+	std::filesystem::remove_all("test_output");
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/profiler.h"
+
+#include <iomanip>
+#include <thread>
+
+TEST(Profiler, FrameHistogram)
+{
+	FrameHistogram histogram;
+	for (uint32_t i = 0; i < FrameHistogram::window_size; i++)
+	{
+		histogram.record(i % 2 ? 16.0 : 8.0);
+	}
+	EXPECT_EQ(histogram.get_frame_count(), FrameHistogram::window_size);
+	EXPECT_DOUBLE_EQ(histogram.get_average(), 12.0);
+	EXPECT_EQ(histogram.get_bucket(8), FrameHistogram::window_size / 2);
+	EXPECT_EQ(histogram.get_bucket(16), FrameHistogram::window_size / 2);
+
+	// Older frames fall out of the window
+	for (uint32_t i = 0; i < FrameHistogram::window_size; i++)
+	{
+		histogram.record(100.0);
+	}
+	EXPECT_EQ(histogram.get_bucket(8), 0);
+	EXPECT_EQ(histogram.get_bucket(FrameHistogram::bucket_count - 1), FrameHistogram::window_size);
+	EXPECT_DOUBLE_EQ(histogram.get_percentile(0.5), 100.0);
+}
+
+TEST(Profiler, ChromeTrace)
+{
+	Profiler profiler;
+
+	profiler.set_thread_name("Test \"main\"");
+	profiler.record("Outer", 1000, 5000);
+	profiler.record_gpu("Render pass", 2000, 3000);
+
+	std::thread worker([&profiler]()
+	    {
+		    // Overflowing the ring keeps only the newest events
+		    for (uint32_t i = 0; i < Profiler::events_per_thread + 10; i++)
+		    {
+			    profiler.record(i < 10 ? "Old" : "New", i, i + 1);
+		    }
+	    });
+	worker.join();
+
+	String trace = profiler.export_chrome_trace();
+	EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0);
+	EXPECT_NE(trace.find("\"name\":\"Test \\\"main\\\"\""), String::npos);
+	EXPECT_NE(trace.find("\"name\":\"Outer\""), String::npos);
+	EXPECT_NE(trace.find("\"name\":\"Render pass\""), String::npos);
+
+	// Both were stamped long before the profiler started, so they sit at negative times
+	OStringStream outer;
+	outer << std::fixed << std::setprecision(3) << "\"name\":\"Outer\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << (1000 - int64_t(profiler.get_start_ns())) / 1e3 << ",\"dur\":4.000}";
+	EXPECT_NE(trace.find(outer.str()), String::npos);
+	EXPECT_NE(trace.find(",\"dur\":1.000}"), String::npos);
+	EXPECT_NE(trace.find("\"name\":\"New\""), String::npos);
+	EXPECT_EQ(trace.find("\"name\":\"Old\""), String::npos);
+}
+
+TEST(Profiler, ExportWhileRecording)
+{
+	Profiler profiler;
+
+	std::atomic<bool> is_running = true;
+	std::thread worker([&profiler, &is_running]()
+	    {
+		    uint64_t start = profiler.get_start_ns();
+		    while (is_running)
+		    {
+			    profiler.record("Busy", start, start + 1000);
+		    }
+	    });
+
+	// Every event that makes it into the trace is whole, never half overwritten
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		String trace = profiler.export_chrome_trace();
+		auto count = [&trace](const String& text)
+		{
+			size_t found = 0;
+			for (size_t at = trace.find(text); at != String::npos; at = trace.find(text, at + 1))
+			{
+				found++;
+			}
+			return found;
+		};
+		EXPECT_EQ(count("\"ph\":\"X\""), count("\"name\":\"Busy\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":0.000,\"dur\":1.000}"));
+	}
+
+	is_running = false;
+	worker.join();
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/profiler.h"
+#include "core/simulation.h"
+
+#include <thread>
+
+TEST(Simulation, SnapshotBuffer)
+{
+	SnapshotBuffer<uint64_t> buffer;
+	EXPECT_FALSE(buffer.acquire());
+	EXPECT_FALSE(buffer.has_snapshot());
+
+	buffer.begin_write() = 10;
+	buffer.publish(0, 1000);
+	ASSERT_TRUE(buffer.acquire());
+	EXPECT_EQ(buffer.get_current().state, 10);
+	EXPECT_EQ(buffer.get_previous().state, 10);
+	EXPECT_FALSE(buffer.acquire());
+
+	// Missed ticks are skipped, the previous snapshot is still the tick right before the current one
+	for (uint64_t tick = 1; tick < 5; tick++)
+	{
+		buffer.begin_write() = 10 + tick;
+		buffer.publish(tick, 1000 + tick * 100);
+	}
+	ASSERT_TRUE(buffer.acquire());
+	EXPECT_EQ(buffer.get_previous().state, 13);
+	EXPECT_EQ(buffer.get_current().state, 14);
+	EXPECT_EQ(buffer.get_current().tick, 4);
+
+	EXPECT_FLOAT_EQ(buffer.get_alpha(1300), 0.0f);
+	EXPECT_FLOAT_EQ(buffer.get_alpha(1350), 0.5f);
+	EXPECT_FLOAT_EQ(buffer.get_alpha(2000), 1.0f);
+}
+
+TEST(Simulation, SnapshotBufferAcrossThreads)
+{
+	struct State
+	{
+		uint64_t values[64];
+	};
+
+	constexpr uint64_t tick_count = 20000;
+	SnapshotBuffer<State> buffer;
+
+	std::thread writer([&buffer]()
+	    {
+		    for (uint64_t tick = 0; tick < tick_count; tick++)
+		    {
+			    State& state = buffer.begin_write();
+			    for (uint64_t& value : state.values)
+			    {
+				    value = tick;
+			    }
+			    buffer.publish(tick, tick);
+		    } });
+
+	// A torn snapshot would mix values from different ticks
+	uint64_t last_tick = 0;
+	while (last_tick + 1 < tick_count)
+	{
+		if (!buffer.acquire())
+		{
+			continue;
+		}
+
+		const auto& previous = buffer.get_previous();
+		const auto& current = buffer.get_current();
+		ASSERT_GE(current.tick, last_tick);
+		for (uint64_t value : current.state.values)
+		{
+			ASSERT_EQ(value, current.tick);
+		}
+		for (uint64_t value : previous.state.values)
+		{
+			ASSERT_EQ(value, current.tick == 0 ? 0 : current.tick - 1);
+		}
+		last_tick = current.tick;
+	}
+	writer.join();
+}
+
+TEST(Simulation, TicksIndependentlyOfCaller)
+{
+	std::atomic<uint64_t> last_index = 0;
+	std::atomic<bool> is_spacing_fixed = true;
+	Simulation simulation(500.0, [&](const SimulationTick& tick)
+	    {
+		    is_spacing_fixed = is_spacing_fixed && tick.end_ns - tick.start_ns == 2'000'000;
+		    last_index = tick.index; });
+	EXPECT_THROW(Simulation(0.0, [](const SimulationTick&) {}), Exception);
+
+	// A long frame on the calling thread must not hold the simulation back
+	uint64_t start = Profiler::now_ns();
+	simulation.start();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	simulation.stop();
+	uint64_t elapsed = Profiler::now_ns() - start;
+
+	EXPECT_FALSE(simulation.is_running());
+	EXPECT_TRUE(is_spacing_fixed);
+	EXPECT_EQ(last_index + 1, simulation.get_tick_count());
+	EXPECT_GE(simulation.get_tick_count(), 45);
+	EXPECT_LE(simulation.get_tick_count(), elapsed / 2'000'000 + 1);
+}
+
+TEST(Simulation, DropsTicksWhenTooSlow)
+{
+	Simulation simulation(1000.0, [](const SimulationTick& tick)
+	    {
+		    if (tick.index == 0)
+		    {
+			    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		    } });
+
+	simulation.start();
+	std::this_thread::sleep_for(std::chrono::milliseconds(80));
+	simulation.stop();
+
+	EXPECT_GT(simulation.get_dropped_tick_count(), 0);
+	EXPECT_GE(simulation.get_max_tick_duration_ns(), 50'000'000);
+}
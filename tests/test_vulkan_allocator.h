@@ -0,0 +1,176 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "platform/vulkan/vulkan_allocator.h"
+#include "platform/vulkan/vulkan_tlsf.h"
+
+#include "vulkan_device_test.h"
+
+#include <algorithm>
+#include <cstring>
+
+TEST(TLSF, AllocateAndFree)
+{
+	TLSFAllocator tlsf(1024);
+
+	Optional<TLSFAllocator::Allocation> a = tlsf.allocate(100);
+	Optional<TLSFAllocator::Allocation> b = tlsf.allocate(200);
+	ASSERT_TRUE(a && b);
+	EXPECT_EQ(a->offset, 0);
+	EXPECT_EQ(b->offset, 100);
+	EXPECT_EQ(tlsf.get_free_size(), 1024 - 300);
+	EXPECT_EQ(tlsf.get_allocation_count(), 2);
+
+	tlsf.free(a->node);
+	tlsf.free(b->node);
+	EXPECT_TRUE(tlsf.is_empty());
+	EXPECT_EQ(tlsf.get_largest_free_range(), 1024);
+}
+
+TEST(TLSF, Alignment)
+{
+	TLSFAllocator tlsf(4096);
+
+	Optional<TLSFAllocator::Allocation> a = tlsf.allocate(3);
+	Optional<TLSFAllocator::Allocation> b = tlsf.allocate(64, 256);
+	ASSERT_TRUE(a && b);
+	EXPECT_EQ(b->offset % 256, 0);
+
+	// The padding in front of b must still be usable
+	Optional<TLSFAllocator::Allocation> c = tlsf.allocate(16, 16);
+	ASSERT_TRUE(c);
+	EXPECT_LT(c->offset, b->offset);
+}
+
+TEST(TLSF, Exhaustion)
+{
+	TLSFAllocator tlsf(256);
+
+	Vector<uint32_t> nodes;
+	while (Optional<TLSFAllocator::Allocation> allocation = tlsf.allocate(64))
+	{
+		nodes.push_back(allocation->node);
+	}
+	EXPECT_EQ(nodes.size(), 4);
+	EXPECT_EQ(tlsf.get_free_size(), 0);
+
+	// Freeing two neighbours must coalesce them into a range that fits a larger request
+	tlsf.free(nodes[1]);
+	tlsf.free(nodes[2]);
+	EXPECT_FALSE(tlsf.allocate(129));
+	EXPECT_TRUE(tlsf.allocate(128));
+}
+
+TEST(TLSF, RandomizedCoalescing)
+{
+	constexpr uint64_t size = 1 << 20;
+	TLSFAllocator tlsf(size);
+
+	Vector<TLSFAllocator::Allocation> live;
+	uint32_t seed = 1234;
+	auto next_random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	};
+
+	for (int i = 0; i < 10000; i++)
+	{
+		if (live.empty() || next_random() % 3 != 0)
+		{
+			if (Optional<TLSFAllocator::Allocation> allocation = tlsf.allocate(1 + next_random() % 4096, uint64_t(1) << (next_random() % 9)))
+			{
+				live.push_back(*allocation);
+			}
+		}
+		else
+		{
+			size_t index = next_random() % live.size();
+			tlsf.free(live[index].node);
+			live.erase(live.begin() + index);
+		}
+	}
+
+	// Live ranges must never overlap
+	std::sort(live.begin(), live.end(), [](const TLSFAllocator::Allocation& a, const TLSFAllocator::Allocation& b)
+	    { return a.offset < b.offset; });
+	for (size_t i = 1; i < live.size(); i++)
+	{
+		EXPECT_LE(live[i - 1].offset + live[i - 1].size, live[i].offset);
+	}
+
+	for (const TLSFAllocator::Allocation& allocation : live)
+	{
+		tlsf.free(allocation.node);
+	}
+	EXPECT_EQ(tlsf.get_free_size(), size);
+	EXPECT_EQ(tlsf.get_largest_free_range(), size);
+}
+
+class VulkanAllocatorTest : public VulkanDeviceTest
+{
+};
+
+TEST_F(VulkanAllocatorTest, SubAllocatesBuffers)
+{
+	VulkanAllocator allocator(device.physical_device.physical_device, device.device, 1024 * 1024);
+
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = 4096;
+	buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	Vector<VulkanBuffer> buffers(64);
+	for (VulkanBuffer& buffer : buffers)
+	{
+		ASSERT_TRUE(allocator.create_buffer(buffer_info, MemoryUsage::GPUOnly, &buffer));
+	}
+
+	VulkanAllocator::Stats stats = allocator.get_stats();
+	EXPECT_EQ(stats.allocation_count + stats.dedicated_allocation_count, buffers.size());
+	EXPECT_LT(stats.device_memory_count, buffers.size());
+
+	for (VulkanBuffer& buffer : buffers)
+	{
+		allocator.destroy_buffer(buffer);
+	}
+	EXPECT_EQ(allocator.get_stats().allocation_count, 0);
+}
+
+TEST_F(VulkanAllocatorTest, MapsHostVisibleMemory)
+{
+	VulkanAllocator allocator(device.physical_device.physical_device, device.device, 1024 * 1024);
+
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = 256;
+	buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VulkanBuffer staging;
+	ASSERT_TRUE(allocator.create_buffer(buffer_info, MemoryUsage::CPUToGPU, &staging));
+	ASSERT_NE(staging.allocation.mapped, nullptr);
+	std::memset(staging.allocation.mapped, 0xab, buffer_info.size);
+
+	allocator.destroy_buffer(staging);
+}
+
+TEST_F(VulkanAllocatorTest, LargeResourcesAreDedicated)
+{
+	VulkanAllocator allocator(device.physical_device.physical_device, device.device, 1024 * 1024);
+
+	VkBufferCreateInfo buffer_info = {};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = 4 * 1024 * 1024;
+	buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VulkanBuffer buffer;
+	ASSERT_TRUE(allocator.create_buffer(buffer_info, MemoryUsage::GPUOnly, &buffer));
+	EXPECT_TRUE(buffer.allocation.is_dedicated());
+	EXPECT_EQ(allocator.get_stats().dedicated_allocation_count, 1);
+
+	allocator.destroy_buffer(buffer);
+}
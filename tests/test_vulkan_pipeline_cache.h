@@ -0,0 +1,110 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "core/hash.h"
+#include "os/file_system.h"
+#include "platform/vulkan/vulkan_pipeline_cache.h"
+#include "platform/vulkan/vulkan_renderer.h"
+
+#include "vulkan_device_test.h"
+
+#include <cstring>
+
+TEST(VulkanPipelineBuilder, BuildsBatchThroughSharedCache)
+{
+	FileSystem::set_current_directory_to_root_file("kronic.root");
+
+	Ptr<VulkanRenderer> renderer;
+	try
+	{
+		renderer = MakeUnique<VulkanRenderer>("kronic_tests", 64, 48);
+	}
+	catch (const Exception&)
+	{
+		GTEST_SKIP() << "No Vulkan device available";
+	}
+
+	VulkanRenderer::PipelineBuilder triangle;
+	ASSERT_TRUE(renderer->make_triangle_pipeline_builder(triangle));
+
+	// Variants differ in fixed function state, so the driver compiles each of them
+	const VkCullModeFlags cull_modes[] = { VK_CULL_MODE_NONE, VK_CULL_MODE_FRONT_BIT, VK_CULL_MODE_BACK_BIT, VK_CULL_MODE_FRONT_AND_BACK };
+	const VkFrontFace front_faces[] = { VK_FRONT_FACE_COUNTER_CLOCKWISE, VK_FRONT_FACE_CLOCKWISE };
+	const VkPrimitiveTopology topologies[] = { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP };
+
+	Vector<VulkanRenderer::PipelineBuilder> builders;
+	for (VkCullModeFlags cull_mode : cull_modes)
+	{
+		for (VkFrontFace front_face : front_faces)
+		{
+			for (VkPrimitiveTopology topology : topologies)
+			{
+				VulkanRenderer::PipelineBuilder& builder = builders.emplace_back(triangle);
+				builder.rasterizer.cullMode = cull_mode;
+				builder.rasterizer.frontFace = front_face;
+				builder.input_assembly.topology = topology;
+			}
+		}
+	}
+
+	Vector<VkPipeline> pipelines = VulkanRenderer::PipelineBuilder::build_pipelines(renderer->get_device(), renderer->get_render_pass(), renderer->get_pipeline_cache().get(), builders);
+	ASSERT_EQ(pipelines.size(), builders.size());
+	for (VkPipeline pipeline : pipelines)
+	{
+		EXPECT_NE(pipeline, VK_NULL_HANDLE);
+		vkDestroyPipeline(renderer->get_device(), pipeline, nullptr);
+	}
+
+	renderer->destroy_shader_modules(triangle);
+}
+
+class VulkanPipelineCacheTest : public VulkanDeviceTest
+{
+protected:
+	static constexpr const char* path = "test_output/pipeline_cache/pipelines.bin";
+
+	// Offsets into the file, the header written in front of the driver's data
+	static constexpr size_t magic_offset = 0;
+	static constexpr size_t driver_version_offset = 4;
+	static constexpr size_t data_hash_offset = 16;
+	static constexpr size_t driver_data_offset = 24;
+
+	size_t load(const String& contents)
+	{
+		EXPECT_TRUE(FileSystem::write_file(path, contents.data(), contents.size()));
+		VulkanPipelineCache cache(device.device, device.physical_device.physical_device, path);
+		return cache.get_loaded_size();
+	}
+};
+
+TEST_F(VulkanPipelineCacheTest, RejectsTamperedFiles)
+{
+	// Saved when destroyed, the driver's data always starts with its own header even when empty
+	{
+		VulkanPipelineCache cache(device.device, device.physical_device.physical_device, path);
+	}
+	Optional<File> file = FileSystem::read_file(path);
+	ASSERT_TRUE(file);
+	ASSERT_GT(file->contents.size(), driver_data_offset + sizeof(VkPipelineCacheHeaderVersionOne));
+	const String saved = file->contents;
+	EXPECT_EQ(load(saved), saved.size() - driver_data_offset);
+
+	auto flip = [&saved](size_t offset)
+	{
+		String contents = saved;
+		contents[offset] ^= 0x5a;
+		return contents;
+	};
+	EXPECT_EQ(load(flip(magic_offset)), 0);
+	EXPECT_EQ(load(flip(driver_version_offset)), 0);
+	EXPECT_EQ(load(flip(data_hash_offset)), 0);
+	EXPECT_EQ(load(flip(saved.size() - 1)), 0);
+	EXPECT_EQ(load(saved.substr(0, saved.size() - 1)), 0);
+
+	// A driver header from another GPU is caught even when the hash was updated to match
+	String other_gpu = flip(driver_data_offset + offsetof(VkPipelineCacheHeaderVersionOne, deviceID));
+	uint64_t data_hash = Hash::fnv1a64(other_gpu.data() + driver_data_offset, other_gpu.size() - driver_data_offset);
+	std::memcpy(other_gpu.data() + data_hash_offset, &data_hash, sizeof(data_hash));
+	EXPECT_EQ(load(other_gpu), 0);
+}
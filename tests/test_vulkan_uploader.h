@@ -0,0 +1,194 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "platform/vulkan/vulkan_allocator.h"
+#include "platform/vulkan/vulkan_init_helpers.h"
+#include "platform/vulkan/vulkan_uploader.h"
+
+#include "vulkan_device_test.h"
+
+#include <cstring>
+
+// The uploader needs timeline semaphores
+class VulkanUploaderTest : public VulkanDeviceTest
+{
+protected:
+	// Small enough that the uploads below have to be chunked and wrap around the ring
+	static constexpr VkDeviceSize staging_size = 64 * 1024;
+
+	uint32_t get_api_minor_version() const override { return 2; }
+
+	void require_features(vkb::PhysicalDeviceSelector& selector) override
+	{
+		VkPhysicalDeviceVulkan12Features features_12 = {};
+		features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		features_12.timelineSemaphore = VK_TRUE;
+		selector.set_required_features_12(features_12);
+	}
+
+	void SetUp() override
+	{
+		VulkanDeviceTest::SetUp();
+		if (IsSkipped() || HasFatalFailure())
+		{
+			return;
+		}
+
+		queue = device.get_queue(vkb::QueueType::graphics).value();
+		queue_family = device.get_queue_index(vkb::QueueType::graphics).value();
+	}
+
+	// Records and runs one command buffer to completion
+	void run_commands(const Function<void(VkCommandBuffer)>& record)
+	{
+		VkCommandPoolCreateInfo pool_info = VulkanInit::command_pool_create_info(queue_family);
+		VkCommandPool pool;
+		ASSERT_EQ(vkCreateCommandPool(device.device, &pool_info, nullptr, &pool), VK_SUCCESS);
+
+		VkCommandBuffer cmd;
+		VkCommandBufferAllocateInfo allocate_info = VulkanInit::command_buffer_allocate_info(pool);
+		ASSERT_EQ(vkAllocateCommandBuffers(device.device, &allocate_info, &cmd), VK_SUCCESS);
+
+		VkCommandBufferBeginInfo begin_info = {};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(cmd, &begin_info);
+		record(cmd);
+		vkEndCommandBuffer(cmd);
+
+		VkSubmitInfo submit = {};
+		submit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit.commandBufferCount = 1;
+		submit.pCommandBuffers = &cmd;
+		EXPECT_EQ(vkQueueSubmit(queue, 1, &submit, VK_NULL_HANDLE), VK_SUCCESS);
+		vkQueueWaitIdle(queue);
+
+		vkDestroyCommandPool(device.device, pool, nullptr);
+	}
+
+	// Host visible so the uploaded contents can be read straight back
+	VulkanBuffer create_readback_buffer(VulkanAllocator& allocator, VkDeviceSize size)
+	{
+		VkBufferCreateInfo buffer_info = {};
+		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_info.size = size;
+		buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VulkanBuffer buffer;
+		EXPECT_TRUE(allocator.create_buffer(buffer_info, MemoryUsage::GPUToCPU, &buffer));
+		EXPECT_NE(buffer.allocation.mapped, nullptr);
+		return buffer;
+	}
+
+	static Vector<Byte> make_pattern(size_t size, uint32_t seed)
+	{
+		Vector<Byte> data(size);
+		for (size_t i = 0; i < size; i++)
+		{
+			data[i] = Byte((i * 31 + seed) >> 3);
+		}
+		return data;
+	}
+
+	VkQueue queue = VK_NULL_HANDLE;
+	uint32_t queue_family = 0;
+};
+
+TEST_F(VulkanUploaderTest, ChunksLargeBuffers)
+{
+	VulkanAllocator allocator(device.physical_device.physical_device, device.device, 1024 * 1024);
+	VulkanUploader uploader(device.device, allocator, queue, queue_family, queue_family, staging_size);
+
+	// Four times the whole ring, so it only fits in pieces
+	Vector<Byte> data = make_pattern(4 * staging_size + 100, 1);
+	VulkanBuffer buffer = create_readback_buffer(allocator, data.size());
+	ASSERT_TRUE(uploader.upload_buffer(buffer.buffer, 0, data.data(), data.size()));
+	uploader.wait(uploader.flush());
+
+	EXPECT_EQ(std::memcmp(buffer.allocation.mapped, data.data(), data.size()), 0);
+
+	allocator.destroy_buffer(buffer);
+}
+
+TEST_F(VulkanUploaderTest, WrapsAroundTheRing)
+{
+	VulkanAllocator allocator(device.physical_device.physical_device, device.device, 1024 * 1024);
+	VulkanUploader uploader(device.device, allocator, queue, queue_family, queue_family, staging_size);
+
+	// The ring does not hold a whole number of uploads, so some of them skip back to its start
+	constexpr uint32_t upload_count = 24;
+	constexpr VkDeviceSize upload_size = 10000;
+	VulkanBuffer buffer = create_readback_buffer(allocator, upload_count * upload_size);
+	Vector<Vector<Byte>> uploads;
+	for (uint32_t i = 0; i < upload_count; i++)
+	{
+		uploads.push_back(make_pattern(upload_size, i));
+		ASSERT_TRUE(uploader.upload_buffer(buffer.buffer, i * upload_size, uploads.back().data(), upload_size));
+
+		// Some batches are submitted early, the rest are recycled once the ring runs out
+		if (i % 5 == 4)
+		{
+			uploader.flush();
+		}
+	}
+	uploader.wait(uploader.flush());
+
+	for (uint32_t i = 0; i < upload_count; i++)
+	{
+		EXPECT_EQ(std::memcmp(static_cast<Byte*>(buffer.allocation.mapped) + i * upload_size, uploads[i].data(), upload_size), 0) << "Upload " << i;
+	}
+
+	allocator.destroy_buffer(buffer);
+}
+
+TEST_F(VulkanUploaderTest, UploadsImagesInSlices)
+{
+	VulkanAllocator allocator(device.physical_device.physical_device, device.device, 1024 * 1024);
+	VulkanUploader uploader(device.device, allocator, queue, queue_family, queue_family, staging_size);
+
+	// 256 KiB of RGBA8, four times the ring
+	VkExtent3D extent = { 256, 256, 1 };
+	Vector<Byte> data = make_pattern(extent.width * extent.height * 4, 7);
+
+	VkImageCreateInfo image_info = {};
+	image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_info.imageType = VK_IMAGE_TYPE_2D;
+	image_info.format = VK_FORMAT_R8G8B8A8_UNORM;
+	image_info.extent = extent;
+	image_info.mipLevels = 1;
+	image_info.arrayLayers = 1;
+	image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VulkanImage image;
+	ASSERT_TRUE(allocator.create_image(image_info, MemoryUsage::GPUOnly, &image));
+	ASSERT_TRUE(uploader.upload_image(image.image, extent, VK_IMAGE_ASPECT_COLOR_BIT, data.data(), data.size(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+	uploader.wait(uploader.flush());
+
+	VulkanBuffer readback = create_readback_buffer(allocator, data.size());
+	run_commands([&](VkCommandBuffer cmd)
+	    {
+		    // The upload's own barrier only released the writes, they still have to reach the copy
+		    VkMemoryBarrier barrier = {};
+		    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		    VkBufferImageCopy region = {};
+		    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		    region.imageSubresource.layerCount = 1;
+		    region.imageExtent = extent;
+		    vkCmdCopyImageToBuffer(cmd, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+	    });
+
+	EXPECT_EQ(std::memcmp(readback.allocation.mapped, data.data(), data.size()), 0);
+
+	allocator.destroy_buffer(readback);
+	allocator.destroy_image(image);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "gtest/gtest.h"
+
+#include "VkBootstrap.h"
+
+// Runs against whatever Vulkan driver is available, lavapipe in CI
+class VulkanDeviceTest : public testing::Test
+{
+protected:
+	// Fixtures that need a newer API or extra features override these
+	virtual uint32_t get_api_minor_version() const { return 1; }
+	virtual void require_features(vkb::PhysicalDeviceSelector&) { }
+
+	void SetUp() override
+	{
+		uint32_t minor_version = get_api_minor_version();
+
+		vkb::detail::Result<vkb::Instance> instance_result
+		    = vkb::InstanceBuilder()
+		          .set_app_name("kronic_tests")
+		          .set_headless()
+		          .require_api_version(1, minor_version, 0)
+		          .build();
+		if (!instance_result)
+		{
+			GTEST_SKIP() << "No Vulkan instance available";
+		}
+		instance = instance_result.value();
+
+		vkb::PhysicalDeviceSelector selector { instance };
+		selector.set_minimum_version(1, minor_version);
+		require_features(selector);
+
+		vkb::detail::Result<vkb::PhysicalDevice> gpu_result = selector.select();
+		if (!gpu_result)
+		{
+			GTEST_SKIP() << "No suitable Vulkan device available";
+		}
+
+		vkb::detail::Result<vkb::Device> device_result = vkb::DeviceBuilder { gpu_result.value() }.build();
+		ASSERT_TRUE(device_result);
+		device = device_result.value();
+	}
+
+	void TearDown() override
+	{
+		if (device.device)
+		{
+			vkb::destroy_device(device);
+		}
+		if (instance.instance)
+		{
+			vkb::destroy_instance(instance);
+		}
+	}
+
+	vkb::Instance instance;
+	vkb::Device device;
+};
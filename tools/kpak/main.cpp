@@ -0,0 +1,65 @@
+#include "core/log.h"
+#include "os/file_system.h"
+#include "os/pak.h"
+
+#include <cstring>
+#include <filesystem>
+
+// Usage: kpak [-c] <output.kpak> <directory>...
+// Run from the root directory so names match what the engine asks for, e.g. kpak -c assets.kpak assets
+int main(int argc, char** argv)
+{
+	Log::setup();
+
+	int arg = 1;
+	bool compress = false;
+	if (arg < argc && std::strcmp(argv[arg], "-c") == 0)
+	{
+		compress = true;
+		arg++;
+	}
+
+	if (argc - arg < 2)
+	{
+		ERR("Usage: kpak [-c] <output.kpak> <directory>...");
+		return 1;
+	}
+
+	const String output = argv[arg++];
+	PakWriter writer;
+	size_t total_size = 0;
+	for (; arg < argc; arg++)
+	{
+		std::error_code error;
+		for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(argv[arg], error))
+		{
+			if (!entry.is_regular_file())
+			{
+				continue;
+			}
+
+			String name = entry.path().lexically_normal().generic_string();
+			Optional<File> file = FileSystem::read_file(name);
+			if (!file)
+			{
+				return 1;
+			}
+			writer.add(name, file->contents.data(), file->contents.size(), compress);
+			total_size += file->contents.size();
+		}
+
+		if (error)
+		{
+			ERR("Could not walk {}. {}", argv[arg], error.message());
+			return 1;
+		}
+	}
+
+	if (!writer.write(output))
+	{
+		return 1;
+	}
+
+	INFO("Packed {} files ({} bytes) into {}", writer.get_entry_count(), total_size, output);
+	return 0;
+}